@@ -0,0 +1,347 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmark of the plugin load path.
+ *
+ * This tool measures how long it takes to discover, load, order, and
+ * bootstrap the synthetic plugins generated in the benchmarks directory
+ * (see benchmarks/CMakeLists.txt).
+ *
+ * Each directory named on the command line is expected to include one
+ * set of plugins. Each run happens in a separate child process so the
+ * plugins get loaded from scratch each time (once loaded, a plugin
+ * remains in memory for the lifetime of the process).
+ *
+ * The results are printed as one JSON object per line (JSON Lines) so
+ * they are easy to compare between two versions of the library:
+ *
+ * \code
+ *     {"benchmark":"load","directory":"...","plugins":100,"run":0,...}
+ * \endcode
+ *
+ * All the durations are in nanoseconds. The timing of each phase comes
+ * from a serverplugins::load_report.
+ */
+
+// serverplugins
+//
+#include    <serverplugins/collection.h>
+#include    <serverplugins/load_report.h>
+#include    <serverplugins/server.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <fstream>
+#include    <iostream>
+#include    <sstream>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins_benchmark
+{
+
+
+
+SERVERPLUGINS_VERSION(bench_server, 1, 0)
+
+
+class bench_server
+    : public serverplugins::server
+{
+public:
+    typedef std::shared_ptr<bench_server>   pointer_t;
+
+                        bench_server();
+};
+
+
+SERVERPLUGINS_START_SERVER(bench_server)
+    , ::serverplugins::description("The server of the load benchmark.")
+    , ::serverplugins::categorization_tag("server")
+SERVERPLUGINS_END_SERVER(bench_server)
+
+
+bench_server::bench_server()
+    : server(g_bench_server_factory)
+{
+}
+
+
+
+struct options_t
+{
+    std::vector<std::string>    f_directories = std::vector<std::string>();
+    std::string                 f_output = std::string();
+    std::size_t                 f_runs = 5;
+    std::size_t                 f_workers = 1;
+    bool                        f_preflight = false;
+    std::string                 f_trace = std::string();
+};
+
+
+void usage()
+{
+    std::cerr << "Usage: load_benchmark [--opts] <plugin directory> ...\n"
+                 "where --opts is one or more of:\n"
+                 "  --help                 print out this help screen\n"
+                 "  --output <filename>    save the results in this file (default: stdout)\n"
+                 "  --preflight            read the ELF notes before loading the plugins\n"
+                 "  --runs <count>         number of runs per directory (default: 5)\n"
+                 "  --trace <filename>     save the Chrome trace of the last run of the last directory\n"
+                 "  --workers <count>      number of threads used to load the plugins (default: 1)\n";
+}
+
+
+bool parse_size(char const * value, std::size_t & result)
+{
+    char * end(nullptr);
+    unsigned long long const v(strtoull(value, &end, 10));
+    if(end == value
+    || *end != '\0'
+    || v == 0)
+    {
+        return false;
+    }
+    result = v;
+    return true;
+}
+
+
+/** \brief Load the plugins of one directory and print the results.
+ *
+ * This function runs in a child process. It searches the plugins in
+ * \p directory, loads all of them, and prints one line of JSON with
+ * the time spent in each phase.
+ *
+ * \param[in] opts  The command line options.
+ * \param[in] directory  The directory with the plugins to load.
+ * \param[in] run  The run number.
+ * \param[in] out  The output file descriptor.
+ *
+ * \return 0 on success, 1 on failure.
+ */
+int run_once(options_t const & opts, std::string const & directory, std::size_t run, int out)
+{
+    serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+    serverplugins::load_report::timestamp_t const start(serverplugins::load_report::now());
+
+    bench_server::pointer_t s(std::make_shared<bench_server>());
+    s->complete_plugin_initialization();
+
+    serverplugins::paths p;
+    p.add(directory);
+
+    serverplugins::names n(p);
+    n.set_load_report(report);
+    n.find_plugins();
+    std::size_t const count(n.map().size());
+
+    serverplugins::collection c(n);
+    c.set_load_workers(opts.f_workers);
+    c.set_preflight(opts.f_preflight);
+    bool const loaded(c.load_plugins(s));
+
+    serverplugins::load_report::timestamp_t const total(serverplugins::load_report::now() - start);
+
+    if(!loaded)
+    {
+        std::cerr << "error: could not load the plugins found in \"" << directory << "\".\n";
+        return 1;
+    }
+
+    serverplugins::load_report::phase_map_t phases(report->phases());
+
+    std::stringstream line;
+    line << "{\"benchmark\":\"load\""
+         << ",\"directory\":\"" << directory << '"'
+         << ",\"plugins\":" << count
+         << ",\"run\":" << run
+         << ",\"workers\":" << opts.f_workers
+         << ",\"preflight\":" << (opts.f_preflight ? "true" : "false")
+         << ",\"discovery_ns\":" << phases["find_plugins"]
+         << ",\"resolve_ns\":" << phases["resolve"]
+         << ",\"dlopen_ns\":" << phases["dlopen"]
+         << ",\"static_init_ns\":" << phases["static_init"]
+         << ",\"order_ns\":" << phases["order"]
+         << ",\"bootstrap_ns\":" << phases["bootstrap"]
+         << ",\"load_plugins_ns\":" << phases["load_plugins"]
+         << ",\"total_ns\":" << total
+         << "}\n";
+    std::string const result(line.str());
+    if(write(out, result.c_str(), result.length()) != static_cast<ssize_t>(result.length()))
+    {
+        return 1;
+    }
+
+    if(!opts.f_trace.empty()
+    && run + 1 == opts.f_runs
+    && directory == opts.f_directories.back())
+    {
+        if(!report->save_chrome_trace(opts.f_trace))
+        {
+            std::cerr << "error: could not save trace to \"" << opts.f_trace << "\".\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+} // namespace serverplugins_benchmark
+
+
+
+int main(int argc, char * argv[])
+{
+    serverplugins_benchmark::options_t opts;
+
+    for(int i(1); i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--help") == 0
+        || strcmp(argv[i], "-h") == 0)
+        {
+            serverplugins_benchmark::usage();
+            return 0;
+        }
+        if(strcmp(argv[i], "--preflight") == 0)
+        {
+            opts.f_preflight = true;
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--output") == 0)
+        {
+            ++i;
+            opts.f_output = argv[i];
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--trace") == 0)
+        {
+            ++i;
+            opts.f_trace = argv[i];
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--runs") == 0)
+        {
+            ++i;
+            if(!serverplugins_benchmark::parse_size(argv[i], opts.f_runs))
+            {
+                std::cerr << "error: invalid number of runs \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--workers") == 0)
+        {
+            ++i;
+            if(!serverplugins_benchmark::parse_size(argv[i], opts.f_workers))
+            {
+                std::cerr << "error: invalid number of workers \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-')
+        {
+            std::cerr << "error: unknown option \"" << argv[i] << "\".\n";
+            serverplugins_benchmark::usage();
+            return 1;
+        }
+        else
+        {
+            opts.f_directories.push_back(argv[i]);
+        }
+    }
+
+    if(opts.f_directories.empty())
+    {
+        std::cerr << "error: at least one plugin directory is required.\n";
+        serverplugins_benchmark::usage();
+        return 1;
+    }
+
+    int out(STDOUT_FILENO);
+    if(!opts.f_output.empty())
+    {
+        out = open(opts.f_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(out < 0)
+        {
+            std::cerr << "error: could not create \"" << opts.f_output << "\".\n";
+            return 1;
+        }
+    }
+
+    // each run happens in a child process so the plugins get loaded from
+    // disk each time; the results are written by the child directly
+    //
+    int exit_code(0);
+    for(auto const & directory : opts.f_directories)
+    {
+        for(std::size_t run(0); run < opts.f_runs; ++run)
+        {
+            std::cerr.flush();
+            pid_t const child(fork());
+            if(child < 0)
+            {
+                std::cerr << "error: fork() failed.\n";
+                return 1;
+            }
+            if(child == 0)
+            {
+                int const r(serverplugins_benchmark::run_once(opts, directory, run, out));
+                std::cerr.flush();
+                _exit(r);
+            }
+
+            int status(0);
+            if(waitpid(child, &status, 0) != child
+            || !WIFEXITED(status)
+            || WEXITSTATUS(status) != 0)
+            {
+                std::cerr << "error: run " << run << " of \"" << directory << "\" failed.\n";
+                exit_code = 1;
+                break;
+            }
+        }
+    }
+
+    if(out != STDOUT_FILENO)
+    {
+        close(out);
+    }
+
+    return exit_code;
+}
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,836 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Benchmark of the signal dispatch.
+ *
+ * This tool measures the cost of emitting a signal defined with the
+ * PLUGIN_SIGNAL_WITH_MODE() macro in each one of its modes (NEITHER,
+ * START, DONE, and START_AND_DONE), with a varying number of listeners
+ * and different types of arguments. The PARALLEL mode is measured with
+ * the "pod" argument; since the listeners do nothing, it shows the cost
+ * of the fan out itself. The "NEITHER_BATCH" entry emits the "pod"
+ * signal with its \<name>_batch() function, \c --batch items at a time,
+ * to show how much of the dispatch cost gets amortized. The "FILTERED"
+ * and "KEYED" entries give each listener its own key, a path, and emit
+ * the key of the first listener: with FILTERED all the listeners get
+ * called and compare the path with their own, with KEYED the signal is
+ * defined with PLUGIN_KEYED_SIGNAL_WITH_MODE() and only calls the
+ * listener of that path. The "FROZEN" entry emits the "pod" signal
+ * after freezing it (see serverplugins::signal::freeze()); it is not
+ * run with \c --churn since a frozen signal cannot change. The
+ * arguments are:
+ *
+ * \li "pod" -- an `int`;
+ * \li "shared_ptr" -- a `std::shared_ptr<>` passed by value;
+ * \li "large" -- a 256 byte structure passed by value;
+ * \li "string" -- a `std::string` passed by reference.
+ *
+ * Each configuration is run with a single emitting thread and then with
+ * several threads emitting the same signal simultaneously.
+ *
+ * The results are printed as one JSON object per line (JSON Lines):
+ *
+ * \code
+ *     {"benchmark":"signal","mode":"NEITHER","argument":"pod","listeners":10,"threads":1,...}
+ * \endcode
+ *
+ * The "ns_per_emit" value is the average latency of one emit as seen by
+ * one emitter. The "emits_per_second" value is the total throughput of
+ * all the emitting threads.
+ */
+
+// serverplugins
+//
+#include    <serverplugins/collection.h>
+#include    <serverplugins/load_report.h>
+#include    <serverplugins/server.h>
+#include    <serverplugins/signals.h>
+
+
+// cppthread
+//
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <array>
+#include    <atomic>
+#include    <cstring>
+#include    <iostream>
+#include    <sstream>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins_benchmark
+{
+
+
+
+struct payload_t
+{
+    std::uint64_t                       f_value = 0;
+};
+
+
+struct large_t
+{
+    std::array<std::uint64_t, 32>       f_data = {};
+};
+
+
+/** \brief The number of listener calls.
+ *
+ * The listeners increment this counter so the compiler cannot optimize
+ * the calls away. It is relaxed since we only read it at the end.
+ */
+std::atomic<std::uint64_t>  g_calls = 0;
+
+
+
+SERVERPLUGINS_VERSION(signal_server, 1, 0)
+
+
+class signal_server
+    : public serverplugins::server
+{
+public:
+    typedef std::shared_ptr<signal_server>  pointer_t;
+
+                        signal_server();
+
+    PLUGIN_SIGNAL_WITH_MODE(neither_pod, (int value), (value), NEITHER);
+    PLUGIN_SIGNAL_WITH_MODE(start_pod, (int value), (value), START);
+    PLUGIN_SIGNAL_WITH_MODE(done_pod, (int value), (value), DONE);
+    PLUGIN_SIGNAL_WITH_MODE(both_pod, (int value), (value), START_AND_DONE);
+    PLUGIN_SIGNAL_WITH_MODE(parallel_pod, (int value), (value), PARALLEL);
+
+    PLUGIN_SIGNAL_WITH_MODE(neither_shared_ptr, (std::shared_ptr<payload_t> value), (value), NEITHER);
+    PLUGIN_SIGNAL_WITH_MODE(start_shared_ptr, (std::shared_ptr<payload_t> value), (value), START);
+    PLUGIN_SIGNAL_WITH_MODE(done_shared_ptr, (std::shared_ptr<payload_t> value), (value), DONE);
+    PLUGIN_SIGNAL_WITH_MODE(both_shared_ptr, (std::shared_ptr<payload_t> value), (value), START_AND_DONE);
+
+    PLUGIN_SIGNAL_WITH_MODE(neither_large, (large_t value), (value), NEITHER);
+    PLUGIN_SIGNAL_WITH_MODE(start_large, (large_t value), (value), START);
+    PLUGIN_SIGNAL_WITH_MODE(done_large, (large_t value), (value), DONE);
+    PLUGIN_SIGNAL_WITH_MODE(both_large, (large_t value), (value), START_AND_DONE);
+
+    PLUGIN_SIGNAL_WITH_MODE(filtered_path, (std::string const & path), (path), NEITHER);
+    PLUGIN_KEYED_SIGNAL_WITH_MODE(keyed_path, (std::string const & path), (path), NEITHER);
+};
+
+
+SERVERPLUGINS_START_SERVER(signal_server)
+    , ::serverplugins::description("The server of the signal benchmark.")
+    , ::serverplugins::categorization_tag("server")
+SERVERPLUGINS_END_SERVER(signal_server)
+
+
+signal_server::signal_server()
+    : server(g_signal_server_factory)
+{
+}
+
+
+bool signal_server::start_pod_start(int value) { return value >= 0; }
+void signal_server::done_pod_done(int value) { static_cast<void>(value); }
+bool signal_server::both_pod_start(int value) { return value >= 0; }
+void signal_server::both_pod_done(int value) { static_cast<void>(value); }
+
+bool signal_server::start_shared_ptr_start(std::shared_ptr<payload_t> value) { return value != nullptr; }
+void signal_server::done_shared_ptr_done(std::shared_ptr<payload_t> value) { static_cast<void>(value); }
+bool signal_server::both_shared_ptr_start(std::shared_ptr<payload_t> value) { return value != nullptr; }
+void signal_server::both_shared_ptr_done(std::shared_ptr<payload_t> value) { static_cast<void>(value); }
+
+bool signal_server::start_large_start(large_t value) { return value.f_data[0] == 0; }
+void signal_server::done_large_done(large_t value) { static_cast<void>(value); }
+bool signal_server::both_large_start(large_t value) { return value.f_data[0] == 0; }
+void signal_server::both_large_done(large_t value) { static_cast<void>(value); }
+
+
+
+/** \brief A listener.
+ *
+ * The listeners are connected the same way the SERVERPLUGINS_LISTEN()
+ * macro connects a plugin: with a member function and placeholders.
+ *
+ * \tparam T  The type of the argument of the signal.
+ */
+template<typename T>
+class listener
+{
+public:
+    void on_signal(T value)
+    {
+        static_cast<void>(value);
+        g_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+
+/** \brief A listener which does not count its calls.
+ *
+ * This listener gets added and removed in a loop while the signal gets
+ * emitted to measure the effect of such changes on the emitters.
+ *
+ * \tparam T  The type of the argument of the signal.
+ */
+template<typename T>
+class churn_listener
+{
+public:
+    void on_signal(T value)
+    {
+        static_cast<void>(value);
+    }
+};
+
+
+/** \brief A listener checking the key itself.
+ *
+ * This is what a listener has to do when the signal is not keyed: it
+ * gets called for all the paths and only counts its own.
+ */
+class path_listener
+{
+public:
+    void on_signal(std::string const & path)
+    {
+        if(path == f_path)
+        {
+            g_calls.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::string             f_path = std::string();
+};
+
+
+/** \brief One signal to benchmark.
+ *
+ * The functions are lambdas hiding the type of the arguments so all the
+ * configurations can go through the same loop.
+ */
+struct signal_t
+{
+    char const *                        f_mode = nullptr;
+    char const *                        f_argument = nullptr;
+    std::function<void(std::size_t)>    f_listen = std::function<void(std::size_t)>();
+    std::function<void()>               f_unlisten = std::function<void()>();
+    std::function<void(std::size_t)>    f_emit = std::function<void(std::size_t)>();
+    std::function<void(std::atomic<bool> const &)>
+                                        f_churn = std::function<void(std::atomic<bool> const &)>();
+    bool                                f_one_match = false;    // only one listener counts each emit
+};
+
+
+/** \brief Create the benchmark entry of one signal.
+ *
+ * \tparam T  The type of the argument of the signal.
+ * \tparam M  The type of the signal (callback manager).
+ * \param[in] mode  The name of the mode of the signal.
+ * \param[in] argument  The name of the type of argument.
+ * \param[in] s  The server emitting the signal.
+ * \param[in] listen  The signal_listen_<name>() member function.
+ * \param[in] unlisten  The signal_unlisten_<name>() member function.
+ * \param[in] emit  The signal member function.
+ * \param[in] value  The value to pass to the signal.
+ *
+ * \return The signal entry.
+ */
+template<typename T, typename M>
+signal_t make_signal(
+      char const * mode
+    , char const * argument
+    , signal_server::pointer_t s
+    , typename M::callback_id_t (signal_server::*listen)(typename M::delegate_t const &, typename M::priority_t)
+    , bool (signal_server::*unlisten)(typename M::callback_id_t)
+    , void (signal_server::*emit)(T)
+    , T const & value)
+{
+    auto ids(std::make_shared<std::vector<typename M::callback_id_t>>());
+
+    signal_t result;
+    result.f_mode = mode;
+    result.f_argument = argument;
+    auto listeners(std::make_shared<std::vector<listener<T>>>());
+    result.f_listen = [s, listen, ids, listeners](std::size_t count)
+        {
+            // the vector must not be reallocated once the listeners are
+            // connected since the signal keeps a pointer to each one
+            //
+            listeners->clear();
+            listeners->resize(count);
+            for(auto & l : *listeners)
+            {
+                ids->push_back(((*s).*listen)(
+                      serverplugins::listener<&listener<T>::on_signal>(&l, std::placeholders::_1)
+                    , M::DEFAULT_PRIORITY));
+            }
+        };
+    result.f_unlisten = [s, unlisten, ids]()
+        {
+            for(auto const & id : *ids)
+            {
+                ((*s).*unlisten)(id);
+            }
+            ids->clear();
+        };
+    result.f_emit = [s, emit, value](std::size_t iterations)
+        {
+            for(std::size_t idx(0); idx < iterations; ++idx)
+            {
+                ((*s).*emit)(value);
+            }
+        };
+    result.f_churn = [s, listen, unlisten](std::atomic<bool> const & stop)
+        {
+            churn_listener<T> l;
+            while(!stop.load(std::memory_order_relaxed))
+            {
+                typename M::callback_id_t const id(((*s).*listen)(
+                      serverplugins::listener<&churn_listener<T>::on_signal>(&l, std::placeholders::_1)
+                    , M::DEFAULT_PRIORITY));
+                ((*s).*unlisten)(id);
+            }
+        };
+    return result;
+}
+
+
+/** \brief Runner emitting a signal in a loop.
+ *
+ * All the runners wait for the go flag so they start emitting at the
+ * same time.
+ */
+class emit_runner
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<emit_runner>    pointer_t;
+
+                            emit_runner(signal_t const & signal, std::size_t iterations, std::atomic<bool> & go);
+                            emit_runner(emit_runner const &) = delete;
+    emit_runner &           operator = (emit_runner const &) = delete;
+
+    virtual void            run() override;
+
+private:
+    signal_t const &        f_signal;
+    std::size_t const       f_iterations;
+    std::atomic<bool> &     f_go;
+};
+
+
+emit_runner::emit_runner(signal_t const & signal, std::size_t iterations, std::atomic<bool> & go)
+    : runner("signal_emitter")
+    , f_signal(signal)
+    , f_iterations(iterations)
+    , f_go(go)
+{
+}
+
+
+void emit_runner::run()
+{
+    while(!f_go.load(std::memory_order_acquire))
+    {
+    }
+    f_signal.f_emit(f_iterations);
+}
+
+
+/** \brief Runner adding and removing a listener in a loop.
+ *
+ * This runner runs until the stop flag is set.
+ */
+class churn_runner
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<churn_runner>   pointer_t;
+
+                            churn_runner(signal_t const & signal, std::atomic<bool> & stop);
+                            churn_runner(churn_runner const &) = delete;
+    churn_runner &          operator = (churn_runner const &) = delete;
+
+    virtual void            run() override;
+
+private:
+    signal_t const &        f_signal;
+    std::atomic<bool> &     f_stop;
+};
+
+
+churn_runner::churn_runner(signal_t const & signal, std::atomic<bool> & stop)
+    : runner("signal_churn")
+    , f_signal(signal)
+    , f_stop(stop)
+{
+}
+
+
+void churn_runner::run()
+{
+    f_signal.f_churn(f_stop);
+}
+
+
+
+struct options_t
+{
+    std::vector<std::size_t>    f_listeners = { 0, 1, 10, 100, 1000 };
+    std::size_t                 f_threads = 4;
+    std::size_t                 f_calls = 2'000'000;
+    std::string                 f_output = std::string();
+    bool                        f_churn = false;
+    std::size_t                 f_batch = 64;
+};
+
+
+void usage()
+{
+    std::cerr << "Usage: signal_benchmark [--opts]\n"
+                 "where --opts is one or more of:\n"
+                 "  --batch <size>         number of items per call of the NEITHER_BATCH entry, 0 to skip it (default: 64)\n"
+                 "  --calls <count>        approximate number of listener calls per measurement (default: 2000000)\n"
+                 "  --churn                also measure while another thread adds and removes listeners\n"
+                 "  --help                 print out this help screen\n"
+                 "  --listeners <list>     comma separated numbers of listeners (default: 0,1,10,100,1000)\n"
+                 "  --output <filename>    save the results in this file (default: stdout)\n"
+                 "  --threads <count>      number of emitting threads of the multi-threaded runs (default: 4)\n";
+}
+
+
+bool parse_size(char const * value, std::size_t & result)
+{
+    char * end(nullptr);
+    unsigned long long const v(strtoull(value, &end, 10));
+    if(end == value
+    || *end != '\0')
+    {
+        return false;
+    }
+    result = v;
+    return true;
+}
+
+
+bool parse_list(char const * value, std::vector<std::size_t> & result)
+{
+    result.clear();
+    std::stringstream ss(value);
+    std::string item;
+    while(std::getline(ss, item, ','))
+    {
+        std::size_t count(0);
+        if(!parse_size(item.c_str(), count))
+        {
+            return false;
+        }
+        result.push_back(count);
+    }
+    return !result.empty();
+}
+
+
+/** \brief Emit a signal from one or more threads.
+ *
+ * \param[in] signal  The signal to emit.
+ * \param[in] threads  The number of emitting threads.
+ * \param[in] iterations  The number of emits per thread.
+ *
+ * \return The elapsed time in nanoseconds.
+ */
+serverplugins::load_report::timestamp_t measure_emits(signal_t const & signal, std::size_t threads, std::size_t iterations)
+{
+    if(threads <= 1)
+    {
+        serverplugins::load_report::timestamp_t const start(serverplugins::load_report::now());
+        signal.f_emit(iterations);
+        return serverplugins::load_report::now() - start;
+    }
+
+    std::atomic<bool> go(false);
+    std::vector<emit_runner::pointer_t> runners;
+    std::vector<cppthread::thread::pointer_t> emitters;
+    for(std::size_t idx(0); idx < threads; ++idx)
+    {
+        runners.push_back(std::make_shared<emit_runner>(signal, iterations, go));
+        emitters.push_back(std::make_shared<cppthread::thread>("signal_emitter", runners.back().get()));
+        if(!emitters.back()->start())
+        {
+            throw std::runtime_error("could not start an emitter thread.");     // LCOV_EXCL_LINE
+        }
+    }
+
+    serverplugins::load_report::timestamp_t const start(serverplugins::load_report::now());
+    go.store(true, std::memory_order_release);
+    for(auto & t : emitters)
+    {
+        t->stop();
+    }
+    return serverplugins::load_report::now() - start;
+}
+
+
+/** \brief Emit a signal and measure the time it takes.
+ *
+ * When \p churn is true, another thread adds and removes a listener
+ * in a loop during the whole measurement.
+ *
+ * \param[in] signal  The signal to emit.
+ * \param[in] threads  The number of emitting threads.
+ * \param[in] iterations  The number of emits per thread.
+ * \param[in] churn  Whether to add and remove listeners simultaneously.
+ *
+ * \return The elapsed time in nanoseconds.
+ */
+serverplugins::load_report::timestamp_t measure(signal_t const & signal, std::size_t threads, std::size_t iterations, bool churn)
+{
+    std::atomic<bool> stop(false);
+    churn_runner::pointer_t churner;
+    cppthread::thread::pointer_t churner_thread;
+    if(churn)
+    {
+        churner = std::make_shared<churn_runner>(signal, stop);
+        churner_thread = std::make_shared<cppthread::thread>("signal_churn", churner.get());
+        if(!churner_thread->start())
+        {
+            throw std::runtime_error("could not start the churn thread.");     // LCOV_EXCL_LINE
+        }
+    }
+
+    serverplugins::load_report::timestamp_t const elapsed(measure_emits(signal, threads, iterations));
+
+    if(churner_thread != nullptr)
+    {
+        stop.store(true);
+        churner_thread->stop();
+    }
+
+    return elapsed;
+}
+
+
+
+} // namespace serverplugins_benchmark
+
+
+
+int main(int argc, char * argv[])
+{
+    using namespace serverplugins_benchmark;
+
+    options_t opts;
+
+    for(int i(1); i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--help") == 0
+        || strcmp(argv[i], "-h") == 0)
+        {
+            usage();
+            return 0;
+        }
+        if(strcmp(argv[i], "--churn") == 0)
+        {
+            opts.f_churn = true;
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--output") == 0)
+        {
+            ++i;
+            opts.f_output = argv[i];
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--listeners") == 0)
+        {
+            ++i;
+            if(!parse_list(argv[i], opts.f_listeners))
+            {
+                std::cerr << "error: invalid list of listeners \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--threads") == 0)
+        {
+            ++i;
+            if(!parse_size(argv[i], opts.f_threads)
+            || opts.f_threads == 0)
+            {
+                std::cerr << "error: invalid number of threads \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--batch") == 0)
+        {
+            ++i;
+            if(!parse_size(argv[i], opts.f_batch))
+            {
+                std::cerr << "error: invalid batch size \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else if(i + 1 < argc
+             && strcmp(argv[i], "--calls") == 0)
+        {
+            ++i;
+            if(!parse_size(argv[i], opts.f_calls)
+            || opts.f_calls == 0)
+            {
+                std::cerr << "error: invalid number of calls \"" << argv[i] << "\".\n";
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "error: unknown option \"" << argv[i] << "\".\n";
+            usage();
+            return 1;
+        }
+    }
+
+    int out(STDOUT_FILENO);
+    if(!opts.f_output.empty())
+    {
+        out = open(opts.f_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(out < 0)
+        {
+            std::cerr << "error: could not create \"" << opts.f_output << "\".\n";
+            return 1;
+        }
+    }
+
+    // the emitter is a server part of a collection so the signals go
+    // through the same code as in a real process
+    //
+    signal_server::pointer_t s(std::make_shared<signal_server>());
+    s->complete_plugin_initialization();
+    serverplugins::paths p;
+    serverplugins::names n(p);
+    serverplugins::collection c(n);
+    c.load_plugins(s);
+
+    std::shared_ptr<payload_t> const payload(std::make_shared<payload_t>());
+    large_t const large;
+
+    typedef signal_server S;
+    std::vector<signal_t> signals =
+    {
+        make_signal<int, S::signal_neither_pod_t>("NEITHER", "pod", s, &S::signal_listen_neither_pod, &S::signal_unlisten_neither_pod, &S::neither_pod, 0),
+        make_signal<int, S::signal_start_pod_t>("START", "pod", s, &S::signal_listen_start_pod, &S::signal_unlisten_start_pod, &S::start_pod, 0),
+        make_signal<int, S::signal_done_pod_t>("DONE", "pod", s, &S::signal_listen_done_pod, &S::signal_unlisten_done_pod, &S::done_pod, 0),
+        make_signal<int, S::signal_both_pod_t>("START_AND_DONE", "pod", s, &S::signal_listen_both_pod, &S::signal_unlisten_both_pod, &S::both_pod, 0),
+        make_signal<int, S::signal_parallel_pod_t>("PARALLEL", "pod", s, &S::signal_listen_parallel_pod, &S::signal_unlisten_parallel_pod, &S::parallel_pod, 0),
+
+        make_signal<std::shared_ptr<payload_t>, S::signal_neither_shared_ptr_t>("NEITHER", "shared_ptr", s, &S::signal_listen_neither_shared_ptr, &S::signal_unlisten_neither_shared_ptr, &S::neither_shared_ptr, payload),
+        make_signal<std::shared_ptr<payload_t>, S::signal_start_shared_ptr_t>("START", "shared_ptr", s, &S::signal_listen_start_shared_ptr, &S::signal_unlisten_start_shared_ptr, &S::start_shared_ptr, payload),
+        make_signal<std::shared_ptr<payload_t>, S::signal_done_shared_ptr_t>("DONE", "shared_ptr", s, &S::signal_listen_done_shared_ptr, &S::signal_unlisten_done_shared_ptr, &S::done_shared_ptr, payload),
+        make_signal<std::shared_ptr<payload_t>, S::signal_both_shared_ptr_t>("START_AND_DONE", "shared_ptr", s, &S::signal_listen_both_shared_ptr, &S::signal_unlisten_both_shared_ptr, &S::both_shared_ptr, payload),
+
+        make_signal<large_t, S::signal_neither_large_t>("NEITHER", "large", s, &S::signal_listen_neither_large, &S::signal_unlisten_neither_large, &S::neither_large, large),
+        make_signal<large_t, S::signal_start_large_t>("START", "large", s, &S::signal_listen_start_large, &S::signal_unlisten_start_large, &S::start_large, large),
+        make_signal<large_t, S::signal_done_large_t>("DONE", "large", s, &S::signal_listen_done_large, &S::signal_unlisten_done_large, &S::done_large, large),
+        make_signal<large_t, S::signal_both_large_t>("START_AND_DONE", "large", s, &S::signal_listen_both_large, &S::signal_unlisten_both_large, &S::both_large, large),
+    };
+
+    if(opts.f_batch > 0)
+    {
+        // each "emit" is one item, so the results compare with NEITHER/pod
+        //
+        signal_t batch(make_signal<int, S::signal_neither_pod_t>("NEITHER_BATCH", "pod", s, &S::signal_listen_neither_pod, &S::signal_unlisten_neither_pod, &S::neither_pod, 0));
+        std::size_t const size(opts.f_batch);
+        batch.f_emit = [s, size](std::size_t iterations)
+            {
+                std::vector<int> const values(size);
+                for(std::size_t idx(0); idx < iterations; idx += size)
+                {
+                    s->neither_pod_batch(S::signal_neither_pod_t::batch_t(values.data(), std::min(size, iterations - idx)));
+                }
+            };
+        signals.push_back(batch);
+    }
+
+    {
+        auto ids(std::make_shared<std::vector<S::signal_filtered_path_t::callback_id_t>>());
+        auto listeners(std::make_shared<std::vector<path_listener>>());
+        signal_t filtered(make_signal<std::string const &, S::signal_filtered_path_t>("FILTERED", "string", s, &S::signal_listen_filtered_path, &S::signal_unlisten_filtered_path, &S::filtered_path, std::string("/path/0")));
+        filtered.f_one_match = true;
+        filtered.f_listen = [s, ids, listeners](std::size_t count)
+            {
+                listeners->clear();
+                listeners->resize(count);
+                for(std::size_t idx(0); idx < count; ++idx)
+                {
+                    (*listeners)[idx].f_path = "/path/" + std::to_string(idx);
+                    ids->push_back(s->signal_listen_filtered_path(
+                          serverplugins::listener<&path_listener::on_signal>(&(*listeners)[idx], std::placeholders::_1)));
+                }
+            };
+        filtered.f_unlisten = [s, ids]()
+            {
+                for(auto const & id : *ids)
+                {
+                    s->signal_unlisten_filtered_path(id);
+                }
+                ids->clear();
+            };
+        signals.push_back(filtered);
+    }
+    {
+        auto ids(std::make_shared<std::vector<S::signal_keyed_path_t::callback_id_t>>());
+        auto listeners(std::make_shared<std::vector<listener<std::string const &>>>());
+        signal_t keyed(make_signal<std::string const &, S::signal_keyed_path_t>("KEYED", "string", s, &S::signal_listen_keyed_path, &S::signal_unlisten_keyed_path, &S::keyed_path, std::string("/path/0")));
+        keyed.f_one_match = true;
+        keyed.f_listen = [s, ids, listeners](std::size_t count)
+            {
+                listeners->clear();
+                listeners->resize(count);
+                for(std::size_t idx(0); idx < count; ++idx)
+                {
+                    ids->push_back(s->signal_listen_key_keyed_path(
+                          "/path/" + std::to_string(idx)
+                        , serverplugins::listener<&listener<std::string const &>::on_signal>(&(*listeners)[idx], std::placeholders::_1)));
+                }
+            };
+        keyed.f_unlisten = [s, ids]()
+            {
+                for(auto const & id : *ids)
+                {
+                    s->signal_unlisten_keyed_path(id);
+                }
+                ids->clear();
+            };
+        signals.push_back(keyed);
+    }
+
+    {
+        signal_t frozen(make_signal<int, S::signal_neither_pod_t>("FROZEN", "pod", s, &S::signal_listen_neither_pod, &S::signal_unlisten_neither_pod, &S::neither_pod, 0));
+        std::function<void(std::size_t)> const listen(frozen.f_listen);
+        std::function<void()> const unlisten(frozen.f_unlisten);
+        frozen.f_listen = [s, listen](std::size_t count)
+            {
+                listen(count);
+                s->signal_freeze_neither_pod();
+            };
+        frozen.f_unlisten = [s, unlisten]()
+            {
+                s->signal_thaw_neither_pod();
+                unlisten();
+            };
+        frozen.f_churn = nullptr;
+        signals.push_back(frozen);
+    }
+
+    std::vector<std::size_t> thread_counts = { 1 };
+    if(opts.f_threads > 1)
+    {
+        thread_counts.push_back(opts.f_threads);
+    }
+
+    std::vector<bool> churn_modes = { false };
+    if(opts.f_churn)
+    {
+        churn_modes.push_back(true);
+    }
+
+    for(auto const & signal : signals)
+    {
+        for(auto const listeners : opts.f_listeners)
+        {
+            signal.f_listen(listeners);
+
+            std::size_t const iterations(std::max(opts.f_calls / std::max(listeners, std::size_t(1)), std::size_t(100)));
+            for(auto const threads : thread_counts)
+            {
+                for(bool const churn : churn_modes)
+                {
+                    if(churn && !signal.f_churn)
+                    {
+                        continue;
+                    }
+
+                    // warm up the caches and the allocator
+                    //
+                    signal.f_emit(std::min(iterations, std::size_t(1000)));
+
+                    g_calls.store(0, std::memory_order_relaxed);
+                    serverplugins::load_report::timestamp_t const elapsed(measure(signal, threads, iterations, churn));
+                    std::uint64_t const calls(g_calls.load(std::memory_order_relaxed));
+                    std::size_t const matches(signal.f_one_match ? std::min(listeners, std::size_t(1)) : listeners);
+                    if(calls != iterations * threads * matches)
+                    {
+                        std::cerr << "error: expected "
+                                  << iterations * threads * matches
+                                  << " listener calls, got "
+                                  << calls
+                                  << ".\n";
+                        return 1;
+                    }
+
+                    double const emits(static_cast<double>(iterations * threads));
+                    std::stringstream line;
+                    line << "{\"benchmark\":\"signal\""
+                         << ",\"mode\":\"" << signal.f_mode << '"'
+                         << ",\"argument\":\"" << signal.f_argument << '"'
+                         << ",\"listeners\":" << listeners
+                         << ",\"threads\":" << threads
+                         << ",\"churn\":" << (churn ? "true" : "false")
+                         << ",\"emits\":" << iterations * threads
+                         << ",\"elapsed_ns\":" << elapsed
+                         << ",\"ns_per_emit\":" << static_cast<double>(elapsed) * static_cast<double>(threads) / emits
+                         << ",\"emits_per_second\":" << emits * 1e9 / static_cast<double>(std::max(elapsed, serverplugins::load_report::timestamp_t(1)))
+                         << "}\n";
+                    std::string const result(line.str());
+                    if(write(out, result.c_str(), result.length()) != static_cast<ssize_t>(result.length()))
+                    {
+                        std::cerr << "error: could not write the results.\n";
+                        return 1;
+                    }
+                }
+            }
+
+            signal.f_unlisten();
+        }
+    }
+
+    if(out != STDOUT_FILENO)
+    {
+        close(out);
+    }
+
+    return 0;
+}
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,96 @@
+# - Add a plugin to a server project
+#
+# ServerPluginsAddPlugin(<name>
+#     SOURCES <source> ...
+#     [SERVER <target>]
+#     [LIBRARIES <library> ...]
+#     [STATIC])
+#
+# By default the plugin is built as a shared library (lib<name>.so) which
+# the server loads with dlopen().
+#
+# When the SERVERPLUGINS_STATIC option is ON (or the STATIC flag is used),
+# the plugin sources are instead compiled with SERVERPLUGINS_STATIC defined
+# and linked directly in the SERVER executable. The SERVERPLUGINS_END()
+# macro then adds the plugin to the table of static plugins and the
+# collection creates it from there instead of searching for a .so file.
+# The plugin code is the same in both cases. Turn on the link time
+# optimization of the server (INTERPROCEDURAL_OPTIMIZATION) to get calls
+# between the server and its plugins inlined.
+#
+# In static mode, the <name> target is an OBJECT library so you can
+# still use target_include_directories() and target_compile_options()
+# on it.
+#
+# License:
+#
+# Copyright (c) 2011-2025  Made to Order Software Corp.  All Rights Reserved
+#
+# https://snapwebsites.org/project/serverplugins
+# contact@m2osw.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+option(SERVERPLUGINS_STATIC "Link the plugins in the server executable instead of loading them with dlopen()." OFF)
+
+function(ServerPluginsAddPlugin name)
+    cmake_parse_arguments(PLUGIN "STATIC" "SERVER" "SOURCES;LIBRARIES" ${ARGN})
+
+    if(NOT PLUGIN_SOURCES)
+        message(FATAL_ERROR "ServerPluginsAddPlugin(${name}) requires at least one source file.")
+    endif()
+
+    if(PLUGIN_STATIC OR SERVERPLUGINS_STATIC)
+        if(NOT PLUGIN_SERVER)
+            message(FATAL_ERROR "ServerPluginsAddPlugin(${name}) requires a SERVER target to be linked statically.")
+        endif()
+
+        add_library(${name} OBJECT
+            ${PLUGIN_SOURCES}
+        )
+
+        target_compile_definitions(${name}
+            PRIVATE
+                SERVERPLUGINS_STATIC
+        )
+
+        set_target_properties(${name} PROPERTIES
+            POSITION_INDEPENDENT_CODE
+                ON
+        )
+
+        target_sources(${PLUGIN_SERVER}
+            PRIVATE
+                $<TARGET_OBJECTS:${name}>
+        )
+
+        if(PLUGIN_LIBRARIES)
+            target_link_libraries(${PLUGIN_SERVER}
+                ${PLUGIN_LIBRARIES}
+            )
+        endif()
+    else()
+        add_library(${name} SHARED
+            ${PLUGIN_SOURCES}
+        )
+
+        if(PLUGIN_LIBRARIES)
+            target_link_libraries(${name}
+                ${PLUGIN_LIBRARIES}
+            )
+        endif()
+    endif()
+endfunction()
+
+# vim: ts=4 sw=4 et
@@ -59,4 +59,6 @@ find_package_handle_standard_args(
         SERVERPLUGINS_LIBRARY
 )
 
+include(${CMAKE_CURRENT_LIST_DIR}/ServerPluginsAddPlugin.cmake)
+
 # vim: ts=4 sw=4 et
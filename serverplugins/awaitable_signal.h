@@ -0,0 +1,904 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Signals with listeners which can be C++20 coroutines.
+ *
+ * A listener of a regular signal blocks the emitting thread while it
+ * waits for I/O. The PLUGIN_AWAITABLE_SIGNAL_WITH_MODE() macro defines
+ * a signal whose listeners may instead be coroutines returning a
+ * serverplugins::task. The emitter gets a task too and `co_await`s the
+ * emission:
+ *
+ * \code
+ *     serverplugins::task<bool> my_server::handle(request::pointer_t r)
+ *     {
+ *         if(!co_await lookup(r))
+ *         {
+ *             // a listener stopped the chain
+ *         }
+ *     }
+ * \endcode
+ *
+ * The listeners are still called one after the other, in priority
+ * order. A listener returning `task<bool>` (or `bool`) stops the chain
+ * by returning false; the following listeners and the \<name>_done()
+ * function are then not called. Listeners returning `task<void>` (or
+ * `void`) always let the chain continue.
+ *
+ * When a listener suspends, the emitter suspends too and the thread is
+ * free to handle other requests. Once the listener completes, the
+ * emission goes back to the executor of the collection (see
+ * collection::set_executor()) so the plugins only run in the threads
+ * of the server.
+ *
+ * A suspended listener resumes in the code of its plugin. So while an
+ * emission is not done, collection::unload_plugin() and
+ * collection::reload_plugin() fail.
+ *
+ * \warning
+ * The arguments are passed to the listeners by reference. The emitter
+ * must keep them alive until the emission completes, which is the case
+ * when the emission is awaited right away, as above.
+ *
+ * This header requires a compiler with coroutine support. When it is
+ * not available (i.e. when compiling in C++17), the header defines
+ * nothing and SERVERPLUGINS_COROUTINES remains undefined.
+ */
+
+// self
+//
+#include    <serverplugins/executor.h>
+#include    <serverplugins/signals.h>
+
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define SERVERPLUGINS_COROUTINES 1
+#endif
+#endif
+
+
+#ifdef SERVERPLUGINS_COROUTINES
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <coroutine>
+#include    <exception>
+#include    <optional>
+#include    <variant>
+
+
+
+namespace serverplugins
+{
+
+
+
+template<typename T = void>
+class task;
+
+
+
+namespace detail
+{
+
+
+
+/** \brief The part of the task promises which does not depend on T.
+ *
+ * A task starts suspended and runs when awaited. The awaiter and the
+ * end of the task race on f_ready: when the task completes before the
+ * awaiter finished suspending (i.e. it did not wait for anything), the
+ * awaiter simply does not suspend. Otherwise the end of the task resumes
+ * the awaiter, through the executor if one was specified.
+ */
+class promise_base
+{
+public:
+    class final_awaiter
+    {
+    public:
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            promise_base & p(h.promise());
+            if(!p.f_ready.exchange(true, std::memory_order_acq_rel))
+            {
+                // completed synchronously, the awaiter goes on by itself
+                //
+                return std::noop_coroutine();
+            }
+
+            // the awaiter may destroy this task as soon as it gets resumed
+            //
+            std::coroutine_handle<> const continuation(p.f_continuation);
+            executor::pointer_t const e(p.f_executor);
+            if(e != nullptr)
+            {
+                e->post([continuation]() { continuation.resume(); });
+                return std::noop_coroutine();
+            }
+            return continuation;
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always             initial_suspend() const noexcept { return {}; }
+    final_awaiter                   final_suspend() const noexcept { return {}; }
+    void                            unhandled_exception() noexcept { f_exception = std::current_exception(); }
+
+    std::coroutine_handle<>         f_continuation = std::coroutine_handle<>();
+    executor::pointer_t             f_executor = executor::pointer_t();
+    std::atomic<bool>               f_ready = false;
+    std::exception_ptr              f_exception = std::exception_ptr();
+};
+
+
+template<typename T>
+class promise
+    : public promise_base
+{
+public:
+    task<T>                         get_return_object() noexcept;
+
+    template<typename V>
+    void                            return_value(V && value)
+                                    {
+                                        f_value.emplace(std::forward<V>(value));
+                                    }
+
+    T                               result()
+                                    {
+                                        if(f_exception != nullptr)
+                                        {
+                                            std::rethrow_exception(f_exception);
+                                        }
+                                        return std::move(*f_value);
+                                    }
+
+private:
+    std::optional<T>                f_value = std::optional<T>();
+};
+
+
+template<>
+class promise<void>
+    : public promise_base
+{
+public:
+    task<void>                      get_return_object() noexcept;
+
+    void                            return_void() noexcept
+                                    {
+                                    }
+
+    void                            result()
+                                    {
+                                        if(f_exception != nullptr)
+                                        {
+                                            std::rethrow_exception(f_exception);
+                                        }
+                                    }
+};
+
+
+
+} // namespace detail
+
+
+
+/** \brief The result of a coroutine used with the awaitable signals.
+ *
+ * The coroutine starts when the task gets awaited, not when it gets
+ * created. A task can be awaited once. Use sync_wait() to run a task
+ * from a function which is not a coroutine.
+ *
+ * \tparam T  The type returned by the coroutine.
+ */
+template<typename T>
+class [[nodiscard]] task
+{
+public:
+    typedef detail::promise<T>                  promise_type;
+    typedef std::coroutine_handle<promise_type> handle_t;
+
+    class awaiter
+    {
+    public:
+        awaiter(handle_t h, executor::pointer_t e) noexcept
+            : f_handle(h)
+            , f_executor(std::move(e))
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> continuation)
+        {
+            promise_type & p(f_handle.promise());
+            p.f_continuation = continuation;
+            p.f_executor = f_executor;
+            f_handle.resume();
+            return !p.f_ready.exchange(true, std::memory_order_acq_rel);
+        }
+
+        T await_resume()
+        {
+            return f_handle.promise().result();
+        }
+
+    private:
+        handle_t                    f_handle;
+        executor::pointer_t         f_executor;
+    };
+
+    explicit                        task(handle_t h) noexcept
+                                        : f_handle(h)
+                                    {
+                                    }
+
+                                    task(task && rhs) noexcept
+                                        : f_handle(std::exchange(rhs.f_handle, nullptr))
+                                    {
+                                    }
+
+                                    task(task const &) = delete;
+
+                                    ~task()
+                                    {
+                                        if(f_handle)
+                                        {
+                                            f_handle.destroy();
+                                        }
+                                    }
+
+    task &                          operator = (task && rhs) noexcept
+                                    {
+                                        if(this != &rhs)
+                                        {
+                                            if(f_handle)
+                                            {
+                                                f_handle.destroy();
+                                            }
+                                            f_handle = std::exchange(rhs.f_handle, nullptr);
+                                        }
+                                        return *this;
+                                    }
+
+    task &                          operator = (task const &) = delete;
+
+    awaiter                         operator co_await () && noexcept
+                                    {
+                                        return awaiter(f_handle, executor::pointer_t());
+                                    }
+
+    /** \brief Await the task and resume through an executor.
+     *
+     * If the task suspends, the awaiting coroutine gets resumed by
+     * posting it to \p e instead of running in the thread which
+     * completed the task. If \p e is a null pointer, this is the same
+     * as a plain `co_await`.
+     *
+     * \param[in] e  The executor resuming the awaiting coroutine.
+     *
+     * \return The awaiter.
+     */
+    awaiter                         via(executor::pointer_t e) && noexcept
+                                    {
+                                        return awaiter(f_handle, std::move(e));
+                                    }
+
+private:
+    handle_t                        f_handle = handle_t();
+};
+
+
+
+namespace detail
+{
+
+
+
+template<typename T>
+task<T> promise<T>::get_return_object() noexcept
+{
+    return task<T>(task<T>::handle_t::from_promise(*this));
+}
+
+
+inline task<void> promise<void>::get_return_object() noexcept
+{
+    return task<void>(task<void>::handle_t::from_promise(*this));
+}
+
+
+/** \brief The state shared between sync_wait() and its coroutine.
+ */
+class sync_state
+{
+public:
+    void signal()
+    {
+        cppthread::guard lock(f_mutex);
+        f_done = true;
+        f_mutex.broadcast();
+    }
+
+    void wait()
+    {
+        cppthread::guard lock(f_mutex);
+        while(!f_done)
+        {
+            f_mutex.wait();
+        }
+    }
+
+private:
+    cppthread::mutex                f_mutex = cppthread::mutex();
+    bool                            f_done = false;
+};
+
+
+/** \brief The coroutine used by sync_wait() to await a task.
+ */
+class sync_waiter
+{
+public:
+    class promise_type
+    {
+    public:
+        class notify
+        {
+        public:
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) const noexcept { h.promise().f_state->signal(); }
+            void await_resume() const noexcept {}
+        };
+
+        sync_waiter                 get_return_object() noexcept { return sync_waiter(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always         initial_suspend() const noexcept { return {}; }
+        notify                      final_suspend() const noexcept { return {}; }
+        void                        return_void() const noexcept {}
+        void                        unhandled_exception() const noexcept { std::terminate(); }
+
+        sync_state *                f_state = nullptr;
+    };
+
+    explicit                        sync_waiter(std::coroutine_handle<promise_type> h) noexcept
+                                        : f_handle(h)
+                                    {
+                                    }
+
+                                    sync_waiter(sync_waiter const &) = delete;
+    sync_waiter &                   operator = (sync_waiter const &) = delete;
+
+                                    ~sync_waiter()
+                                    {
+                                        f_handle.destroy();
+                                    }
+
+    void                            run(sync_state & state)
+                                    {
+                                        f_handle.promise().f_state = &state;
+                                        f_handle.resume();
+                                        state.wait();
+                                    }
+
+private:
+    std::coroutine_handle<promise_type>
+                                    f_handle;
+};
+
+
+template<typename T>
+sync_waiter sync_wait_for(task<T> & t, std::optional<T> & result, std::exception_ptr & error)
+{
+    try
+    {
+        result.emplace(co_await std::move(t));
+    }
+    catch(...)
+    {
+        error = std::current_exception();
+    }
+}
+
+
+inline sync_waiter sync_wait_for(task<void> & t, std::exception_ptr & error)
+{
+    try
+    {
+        co_await std::move(t);
+    }
+    catch(...)
+    {
+        error = std::current_exception();
+    }
+}
+
+
+/** \brief The listeners of one emission, not started yet.
+ */
+class task_list
+{
+public:
+    typedef std::variant<task<void>, task<bool>>    entry_t;
+
+    void                            push(task<void> && t) { f_tasks.emplace_back(std::move(t)); }
+    void                            push(task<bool> && t) { f_tasks.emplace_back(std::move(t)); }
+
+    std::vector<entry_t>            f_tasks = std::vector<entry_t>();
+};
+
+
+/** \brief Call a listener which is not a coroutine.
+ *
+ * The call gets delayed until the listeners registered before it are
+ * done, as if it were a coroutine.
+ */
+template<typename F, typename ... A>
+task<bool> deferred(F f, A & ... args)
+{
+    if constexpr (std::is_same_v<std::invoke_result_t<F &, A &...>, bool>)
+    {
+        co_return f(args...);
+    }
+    else
+    {
+        f(args...);
+        co_return true;
+    }
+}
+
+
+/** \brief Add the task of one listener to an emission.
+ */
+template<typename F, typename ... A>
+void push_listener(task_list & tasks, F & f, A & ... args)
+{
+    typedef std::invoke_result_t<F &, A &...> result_t;
+    if constexpr (std::is_same_v<result_t, task<void>>
+               || std::is_same_v<result_t, task<bool>>)
+    {
+        tasks.push(f(args...));
+    }
+    else
+    {
+        tasks.push(deferred(f, args...));
+    }
+}
+
+
+/** \brief The \<name>_done() function of the modes without one.
+ */
+struct no_done
+{
+    template<typename ... A>
+    void operator () (A && ...) const
+    {
+    }
+};
+
+
+
+} // namespace detail
+
+
+
+/** \brief Run a task from a function which is not a coroutine.
+ *
+ * This function starts the task and blocks until it completes, then it
+ * returns its result or rethrows its exception.
+ *
+ * \warning
+ * If the task gets resumed through an executor, that executor must not
+ * need the calling thread to make progress.
+ *
+ * \param[in] t  The task to run.
+ *
+ * \return The value returned by the task.
+ */
+template<typename T>
+T sync_wait(task<T> && t)
+{
+    detail::sync_state state;
+    std::exception_ptr error;
+    if constexpr (std::is_void_v<T>)
+    {
+        detail::sync_waiter waiter(detail::sync_wait_for(t, error));
+        waiter.run(state);
+        if(error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    else
+    {
+        std::optional<T> result;
+        detail::sync_waiter waiter(detail::sync_wait_for(t, result, error));
+        waiter.run(state);
+        if(error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+        return std::move(*result);
+    }
+}
+
+
+
+/** \brief A listener of an awaitable signal.
+ *
+ * The listener can be a coroutine returning a `task<void>` or a
+ * `task<bool>`, or a plain function returning `void` or `bool`. The
+ * delegate creates the task of the listener when the signal gets
+ * emitted; the task runs once the previous listeners are done.
+ *
+ * \tparam Args  The types of the parameters of the signal.
+ */
+template<typename ... Args>
+class awaitable_delegate
+    : public delegate<detail::task_list &, Args...>
+{
+public:
+    typedef delegate<detail::task_list &, Args...>  base_t;
+
+                                awaitable_delegate() = default;
+
+    template<auto M, typename O, std::size_t N>
+                                awaitable_delegate(detail::member_listener<M, O, N> const & l)
+                                    : awaitable_delegate(detail::member_call<M, O, N>{ l.f_object })
+                                {
+                                }
+
+    template<typename F
+           , typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, awaitable_delegate>
+                                      && std::is_invocable_v<std::decay_t<F> &, detail::signal_argument_t<Args>...>>>
+                                awaitable_delegate(F && f)
+                                    : base_t([f = std::forward<F>(f)](detail::task_list & tasks, detail::signal_argument_t<Args>... args) mutable
+                                        {
+                                            detail::push_listener(tasks, f, args...);
+                                        })
+                                {
+                                }
+};
+
+
+
+/** \brief A signal whose listeners can be coroutines.
+ *
+ * The listeners are kept in a serverplugins::signal so adding and
+ * removing listeners works the same way, without locking the emitters.
+ * Emitting the signal creates the tasks of all the listeners at once,
+ * then awaits them one after the other.
+ *
+ * \tparam Args  The types of the parameters of the signal. The function
+ * type `void(Args...)` can also be used.
+ */
+template<typename ... Args>
+class awaitable_signal
+{
+public:
+    typedef awaitable_delegate<Args...>             delegate_t;
+    typedef signal<detail::task_list &, Args...>    signal_t;
+    typedef typename signal_t::callback_id_t        callback_id_t;
+    typedef typename signal_t::priority_t           priority_t;
+    typedef std::tuple<detail::signal_argument_t<Args>...>
+                                                    arguments_t;
+
+    static constexpr callback_id_t          NULL_CALLBACK_ID = signal_t::NULL_CALLBACK_ID;
+    static constexpr priority_t             DEFAULT_PRIORITY = signal_t::DEFAULT_PRIORITY;
+
+    /** \brief The function returned by on().
+     *
+     * The PLUGIN_AWAITABLE_SIGNAL_WITH_MODE() macro uses it since the
+     * arguments are defined as a list between parenthesis.
+     */
+    template<typename D>
+    class emitter
+    {
+    public:
+        emitter(awaitable_signal const * s, executor::pointer_t e, D const & done, detail::task_guard && guard)
+            : f_signal(s)
+            , f_executor(std::move(e))
+            , f_done(done)
+            , f_guard(std::move(guard))
+        {
+        }
+
+        task<bool> operator () (detail::signal_argument_t<Args>... args)
+        {
+            detail::task_list tasks;
+            f_signal->f_signal.call(tasks, args...);
+            return run(std::move(tasks), f_executor, f_done, arguments_t(args...), std::move(f_guard));
+        }
+
+    private:
+        awaitable_signal const *    f_signal;
+        executor::pointer_t         f_executor;
+        D                           f_done;
+        detail::task_guard          f_guard;
+    };
+
+    callback_id_t add_callback(delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        return f_signal.add_callback(callback, priority);
+    }
+
+    bool remove_callback(callback_id_t callback_id)
+    {
+        return f_signal.remove_callback(callback_id);
+    }
+
+    void clear()
+    {
+        f_signal.clear();
+    }
+
+    bool empty() const
+    {
+        return f_signal.empty();
+    }
+
+    std::size_t size() const
+    {
+        return f_signal.size();
+    }
+
+    void synchronize()
+    {
+        f_signal.synchronize();
+    }
+
+    void freeze()
+    {
+        f_signal.freeze();
+    }
+
+    void thaw()
+    {
+        f_signal.thaw();
+    }
+
+    bool is_frozen() const
+    {
+        return f_signal.is_frozen();
+    }
+
+    /** \brief Emit the signal.
+     *
+     * The tasks of the listeners get created immediately. They run when
+     * the returned task gets awaited.
+     *
+     * \param[in] e  The executor resuming the emission after a listener
+     * completed asynchronously, may be a null pointer.
+     * \param[in] args  The arguments of the signal.
+     *
+     * \return A task returning false if a listener stopped the chain.
+     */
+    task<bool> call(executor::pointer_t e, detail::signal_argument_t<Args>... args) const
+    {
+        return call_then(std::move(e), detail::no_done(), args...);
+    }
+
+    /** \brief Emit the signal and call \p done once all the listeners ran.
+     *
+     * \p done is not called when a listener stops the chain or throws.
+     *
+     * \param[in] e  The executor resuming the emission, may be nullptr.
+     * \param[in] done  The function to call after the last listener.
+     * \param[in] args  The arguments of the signal.
+     *
+     * \return A task returning false if a listener stopped the chain.
+     */
+    template<typename D>
+    task<bool> call_then(executor::pointer_t e, D done, detail::signal_argument_t<Args>... args) const
+    {
+        detail::task_list tasks;
+        f_signal.call(tasks, args...);
+        return run(std::move(tasks), std::move(e), std::move(done), arguments_t(args...), detail::task_guard());
+    }
+
+    /** \brief Get a function emitting the signal.
+     *
+     * The \p guard is kept by the task of the emission until it is
+     * done. The signal macros pass the one of the emitter collection
+     * so it does not unload a plugin while one of its coroutines may
+     * still be suspended.
+     *
+     * \param[in] e  The executor resuming the emission, may be nullptr.
+     * \param[in] guard  The guard to keep until the emission is done.
+     *
+     * \return The function emitting the signal.
+     */
+    emitter<detail::no_done> on(executor::pointer_t e, detail::task_guard && guard = detail::task_guard()) const
+    {
+        return emitter<detail::no_done>(this, std::move(e), detail::no_done(), std::move(guard));
+    }
+
+    template<typename D>
+    emitter<D> on(executor::pointer_t e, D const & done, detail::task_guard && guard = detail::task_guard()) const
+    {
+        return emitter<D>(this, std::move(e), done, std::move(guard));
+    }
+
+    /** \brief The result of an emission refused by \<name>_start().
+     *
+     * \return A task returning false.
+     */
+    static task<bool> refused()
+    {
+        co_return false;
+    }
+
+private:
+    template<typename D>
+    static task<bool> run(detail::task_list tasks, executor::pointer_t e, D done, arguments_t args, detail::task_guard guard)
+    {
+        // the guard lives in the frame of this coroutine until it is done
+        //
+        static_cast<void>(guard);
+
+        for(auto & t : tasks.f_tasks)
+        {
+            if(auto * b = std::get_if<task<bool>>(&t))
+            {
+                if(!co_await std::move(*b).via(e))
+                {
+                    co_return false;
+                }
+            }
+            else
+            {
+                co_await std::move(std::get<task<void>>(t)).via(e);
+            }
+        }
+        std::apply(done, args);
+        co_return true;
+    }
+
+    signal_t                        f_signal = signal_t();
+};
+
+
+template<typename ... Args>
+class awaitable_signal<void(Args...)>
+    : public awaitable_signal<Args...>
+{
+};
+
+
+
+} // namespace serverplugins
+
+
+
+#define     PLUGIN_AWAITABLE_SIGNAL_PROCESS_MODE_NEITHER(name, parameters, variables)   \
+    public: \
+        ::serverplugins::task<bool> name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.on( \
+                      signal_guard_##name.get_executor() \
+                    , signal_guard_##name.start_task()) variables; \
+        }
+
+#define     PLUGIN_AWAITABLE_SIGNAL_PROCESS_MODE_START(name, parameters, variables)   \
+        bool name##_start parameters; \
+    public: \
+        ::serverplugins::task<bool> name parameters { \
+            if(!name##_start variables) \
+            { \
+                return signal_##name##_t::refused(); \
+            } \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.on( \
+                      signal_guard_##name.get_executor() \
+                    , signal_guard_##name.start_task()) variables; \
+        }
+
+#define     PLUGIN_AWAITABLE_SIGNAL_PROCESS_MODE_DONE(name, parameters, variables)   \
+        void name##_done parameters; \
+    public: \
+        ::serverplugins::task<bool> name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.on( \
+                      signal_guard_##name.get_executor() \
+                    , [this](auto && ... a) { name##_done(a...); } \
+                    , signal_guard_##name.start_task()) variables; \
+        }
+
+#define     PLUGIN_AWAITABLE_SIGNAL_PROCESS_MODE_START_AND_DONE(name, parameters, variables)   \
+        bool name##_start parameters; \
+        void name##_done parameters; \
+    public: \
+        ::serverplugins::task<bool> name parameters { \
+            if(!name##_start variables) \
+            { \
+                return signal_##name##_t::refused(); \
+            } \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.on( \
+                      signal_guard_##name.get_executor() \
+                    , [this](auto && ... a) { name##_done(a...); } \
+                    , signal_guard_##name.start_task()) variables; \
+        }
+
+
+/** \brief Define a named awaitable signal.
+ *
+ * This macro works like PLUGIN_SIGNAL_WITH_MODE() except that the
+ * function emitting the signal returns a `serverplugins::task<bool>`
+ * which the emitter awaits, and the listeners can be coroutines. The
+ * listeners are connected with the usual SERVERPLUGINS_LISTEN() macros.
+ *
+ * The task returns false if \<name>_start() refused the emission or if
+ * a listener stopped the chain by returning false. In both cases, the
+ * \<name>_done() function does not get called.
+ *
+ * The \<name>_start() and \<name>_done() functions are not coroutines.
+ *
+ * The supported modes are NEITHER, START, DONE, and START_AND_DONE.
+ *
+ * \param[in] name  The name of the signal.
+ * \param[in] parameters  A list of parameters written between parenthesis.
+ * \param[in] variables  List the variable names as they appear in
+ *                       \p parameters, written between parenthesis.
+ * \param[in] mode  The mode used to call the various functions.
+ */
+#define    PLUGIN_AWAITABLE_SIGNAL_WITH_MODE(name, parameters, variables, mode) \
+    typedef ::serverplugins::awaitable_signal<void parameters> signal_##name##_t; \
+    signal_##name##_t::callback_id_t signal_listen_##name( \
+            signal_##name##_t::delegate_t const & callback, \
+            signal_##name##_t::priority_t priority = signal_##name##_t::DEFAULT_PRIORITY) \
+        { return f_signal_##name.add_callback(callback, priority); } \
+    bool signal_unlisten_##name(signal_##name##_t::callback_id_t callback_id) \
+        { return f_signal_##name.remove_callback(callback_id); } \
+    void signal_synchronize_##name() \
+        { f_signal_##name.synchronize(); } \
+    void signal_freeze_##name() \
+        { f_signal_##name.freeze(); } \
+    void signal_thaw_##name() \
+        { f_signal_##name.thaw(); } \
+    private: \
+        signal_##name##_t f_signal_##name = signal_##name##_t(); \
+        PLUGIN_AWAITABLE_SIGNAL_PROCESS_MODE_##mode(name, parameters, variables)
+
+
+#endif
+// vim: ts=4 sw=4 et
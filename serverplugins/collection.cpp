@@ -22,18 +22,24 @@
 #include    "serverplugins/collection.h"
 
 #include    "serverplugins/exception.h"
+#include    "serverplugins/load_plan.h"
+#include    "serverplugins/note.h"
 #include    "serverplugins/repository.h"
+#include    "serverplugins/static_plugin.h"
 
 
 // cppthread
 //
 #include    <cppthread/guard.h>
 #include    <cppthread/log.h>
+#include    <cppthread/thread.h>
 
 
 // C++
 //
 #include    <algorithm>
+#include    <queue>
+#include    <tuple>
 
 
 // last include
@@ -47,6 +53,25 @@ namespace serverplugins
 
 
 
+namespace
+{
+
+
+
+/** \brief Number of signals being emitted by this thread.
+ *
+ * A plugin cannot be unloaded from within a signal handler since the
+ * unload waits for all the signals in flight to be done. This counter
+ * is used to detect that situation.
+ */
+thread_local std::size_t    g_signal_depth = 0;
+
+
+
+} // no name namespace
+
+
+
 /** \class collection
  * \brief Handle a collection of plugins.
  *
@@ -134,6 +159,69 @@ collection::collection(names const & n)
 }
 
 
+/** \brief Clean up the collection.
+ *
+ * The listeners connected through this collection get disconnected. The
+ * emitters are still alive at this point since the collection holds a
+ * reference to all of its plugins. This way a server outliving its
+ * collection does not keep callbacks to plugins which may later get
+ * unloaded.
+ *
+ * The calls still waiting in the delivery pool get delivered and its
+ * threads get stopped, the listeners being plugins of this collection.
+ * Then the copies of the listeners the signals kept get released.
+ *
+ * The server keeps a pointer back to the collection so the signals it
+ * emits can load deferred plugins. That pointer gets reset here so the
+ * server can safely outlive its collection.
+ */
+collection::~collection()
+{
+    for(auto const & c : f_connections)
+    {
+        if(c.f_disconnect)
+        {
+            if(is_frozen())
+            {
+                auto const emitter(f_plugins_by_name.find(c.f_emitter));
+                if(emitter != f_plugins_by_name.end())
+                {
+                    c.f_freeze(*emitter->second, false);
+                }
+            }
+            c.f_disconnect();
+        }
+    }
+
+    if(f_delivery_pool != nullptr)
+    {
+        f_delivery_pool->stop();
+    }
+
+    // the signals keep the previous vectors of listeners until the next
+    // change; release them now, they may include code of a plugin which
+    // gets unloaded before the server is destroyed
+    //
+    for(auto const & c : f_connections)
+    {
+        if(c.f_disconnect)
+        {
+            auto const emitter(f_plugins_by_name.find(c.f_emitter));
+            if(emitter != f_plugins_by_name.end())
+            {
+                c.f_synchronize(*emitter->second);
+            }
+        }
+    }
+
+    if(f_server != nullptr
+    && f_server->f_collection == this)
+    {
+        f_server->f_collection = nullptr;
+    }
+}
+
+
 /** \brief Set user data for when the bootstrap function gets called.
  *
  * If you need a reference back to another object from your plugins, set
@@ -150,6 +238,425 @@ void collection::set_data(void * data)
 }
 
 
+/** \brief Define the number of threads used to load the plugins.
+ *
+ * By default, the load_plugins() function loads one plugin at a time.
+ * On a system with many plugins, and especially when the plugins are not
+ * yet in the disk cache, it is much faster to load them in parallel.
+ * This function defines the maximum number of threads to use to do so.
+ *
+ * The value 1 means that the plugins get loaded sequentially (the
+ * default). The value 0 means that the number of available processors
+ * is used.
+ *
+ * Only the dlopen() calls happen in parallel. The verification of the
+ * conflicts and dependencies and the calls to the plugin::bootstrap()
+ * functions still happen in the thread calling load_plugins().
+ *
+ * \param[in] workers  The number of threads to use to load plugins.
+ *
+ * \sa load_plugins()
+ */
+void collection::set_load_workers(std::size_t workers)
+{
+    if(workers == 0)
+    {
+        workers = std::max(1, cppthread::get_number_of_available_processors());
+    }
+    f_load_workers = workers;
+}
+
+
+/** \brief Retrieve the number of threads used to load the plugins.
+ *
+ * This function returns the number of threads that load_plugins() uses
+ * to load the plugins. By default this is 1.
+ *
+ * \return The number of threads used to load the plugins.
+ *
+ * \sa set_load_workers()
+ */
+std::size_t collection::get_load_workers() const
+{
+    return f_load_workers;
+}
+
+
+/** \brief Verify the plugins before loading them.
+ *
+ * When the preflight is turned on, the load_plugins() function first
+ * reads the definition of each plugin from the ELF note that the
+ * SERVERPLUGINS_END() macro creates. This gives us the name, the
+ * versions, the dependencies, and the conflicts of each plugin without
+ * having to load it.
+ *
+ * This means the entire set of plugins gets verified before any one
+ * of them is loaded. In particular, a plugin compiled against an
+ * incompatible version of the serverplugins library (different major
+ * version) is rejected without ever being loaded.
+ *
+ * By default the preflight is turned off.
+ *
+ * \param[in] preflight  Whether to verify the plugins before loading them.
+ *
+ * \sa read_definition_note()
+ */
+void collection::set_preflight(bool preflight)
+{
+    f_preflight = preflight;
+}
+
+
+/** \brief Check whether the preflight is turned on.
+ *
+ * This function returns true if the plugins get verified through their
+ * ELF note before being loaded.
+ *
+ * \return true if the preflight is turned on.
+ *
+ * \sa set_preflight()
+ */
+bool collection::get_preflight() const
+{
+    return f_preflight;
+}
+
+
+/** \brief Define the file used to cache the load plan.
+ *
+ * Resolving the list of plugins (dependencies, conflicts, and order) is
+ * repeated each time load_plugins() gets called. When a plan filename is
+ * defined, a successful load_plugins() saves the result in that file.
+ * The next time, if the same plugins are requested and none of the
+ * plugin files changed, the plan is used as is and the plugins get
+ * loaded directly in the saved order.
+ *
+ * If the plan does not match, the full resolution happens and a new
+ * plan gets saved.
+ *
+ * \param[in] filename  The name of the plan file or an empty string to
+ * not use a plan.
+ *
+ * \sa load_plan
+ */
+void collection::set_plan_filename(std::string const & filename)
+{
+    f_plan_filename = filename;
+}
+
+
+/** \brief Retrieve the name of the file used to cache the load plan.
+ *
+ * \return The filename defined with set_plan_filename().
+ */
+std::string const & collection::get_plan_filename() const
+{
+    return f_plan_filename;
+}
+
+
+/** \brief Check whether the plugins were loaded from the cached plan.
+ *
+ * After load_plugins() returns, this function tells you whether the
+ * cached plan was used (true) or the full resolution happened (false).
+ *
+ * \return true if the cached plan was used.
+ */
+bool collection::used_cached_plan() const
+{
+    return f_used_cached_plan;
+}
+
+
+/** \brief Load the plugins only when they get used.
+ *
+ * By default, load_plugins() loads and bootstraps all the plugins. With
+ * the lazy mode turned on, the plugins that include a definition note
+ * (see read_definition_note()) are only registered. Such a plugin gets
+ * loaded and bootstrapped the first time:
+ *
+ * \li get_plugin() is called with its name, or
+ * \li a signal it declared an interest in gets emitted; the plugin
+ *     declares such interests with
+ *     `::serverplugins::interest("<emitter>", "<signal>")` in its
+ *     SERVERPLUGINS_START() definition.
+ *
+ * Its dependencies are loaded first, the same way. Plugins without a
+ * note are loaded immediately as usual.
+ *
+ * The loading happens once, under the collection mutex, so it is safe
+ * to call get_plugin() from multiple threads. Once all the plugins are
+ * loaded, get_plugin() goes back to a simple lookup.
+ *
+ * The load plan (see set_plan_filename()) is not used in lazy mode.
+ *
+ * \param[in] lazy  Whether to defer the loading of the plugins.
+ *
+ * \sa get_lazy_counters()
+ */
+void collection::set_lazy(bool lazy)
+{
+    f_lazy = lazy;
+}
+
+
+/** \brief Check whether the plugins get loaded lazily.
+ *
+ * \return true if the lazy mode is turned on.
+ *
+ * \sa set_lazy()
+ */
+bool collection::get_lazy() const
+{
+    return f_lazy;
+}
+
+
+/** \brief Retrieve the lazy loading counters.
+ *
+ * This function returns the number of plugins that were deferred by
+ * load_plugins() and how many of them were loaded since, by reason.
+ * The f_untouched set lists the plugins that were never used and are
+ * still not loaded.
+ *
+ * \return A copy of the lazy loading counters.
+ */
+collection::lazy_counters_t collection::get_lazy_counters() const
+{
+    cppthread::guard lock(f_mutex);
+
+    lazy_counters_t counters(f_lazy_counters);
+    for(auto const & d : f_deferred)
+    {
+        counters.f_untouched.insert(d.first);
+    }
+    return counters;
+}
+
+
+/** \brief Load the deferred plugins interested in a signal.
+ *
+ * This function is called each time a plugin emits a signal. If some
+ * deferred plugins declared an interest in \p signal of \p emitter
+ * (see the interest class), they get loaded and bootstrapped so they
+ * can connect to the signal before it gets processed. A signal with
+ * the same name emitted by another plugin does not load them.
+ *
+ * When no plugins are deferred, the function returns immediately.
+ *
+ * \param[in] emitter  The name of the plugin emitting the signal.
+ * \param[in] signal  The name of the signal about to be emitted.
+ */
+void collection::materialize_listeners(std::string const & emitter, char const * signal)
+{
+    if(f_deferred_count.load(std::memory_order_acquire) == 0)
+    {
+        return;
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_interests.find(emitter + "::" + signal));
+    if(it == f_interests.end())
+    {
+        return;
+    }
+    string_set_t const listeners(it->second);
+    f_interests.erase(it);
+
+    for(auto const & name : listeners)
+    {
+        materialize(name, f_lazy_counters.f_materialized_by_signal);
+    }
+}
+
+
+/** \brief Attach a load report to this collection.
+ *
+ * The collection records the time spent in the different phases of
+ * load_plugins() and in the bootstrap() function of each plugin in
+ * this report. Plugins loaded later (lazy mode, reload_plugin()) also
+ * get recorded.
+ *
+ * By default, the collection uses the report attached to the names
+ * object passed to the constructor, if any.
+ *
+ * \param[in] report  The report or a null pointer to stop recording.
+ *
+ * \sa load_report
+ * \sa names::set_load_report()
+ */
+void collection::set_load_report(load_report::pointer_t report)
+{
+    cppthread::guard lock(f_mutex);
+    f_names.set_load_report(report);
+}
+
+
+/** \brief Get the load report attached to this collection.
+ *
+ * \return The load report or a null pointer.
+ */
+load_report::pointer_t collection::get_load_report() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_names.get_load_report();
+}
+
+
+/** \brief Set the number of threads running asynchronous listeners.
+ *
+ * The listeners connected with the SERVERPLUGINS_LISTEN_ASYNC() macros
+ * run in the threads of the collection delivery pool. This function
+ * sets the number of threads of that pool. It has to be called before
+ * the pool gets created, which happens the first time such a listener
+ * gets connected (see get_delivery_pool()).
+ *
+ * The default, 0, uses one thread per available processor.
+ *
+ * \param[in] workers  The number of threads of the delivery pool.
+ */
+void collection::set_delivery_workers(std::size_t workers)
+{
+    cppthread::guard lock(f_mutex);
+    f_delivery_workers = workers;
+}
+
+
+/** \brief Get the number of threads running asynchronous listeners.
+ *
+ * \return The number of threads as set by set_delivery_workers().
+ */
+std::size_t collection::get_delivery_workers() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_delivery_workers;
+}
+
+
+/** \brief Get the pool running the asynchronous listeners.
+ *
+ * The pool gets created the first time this function is called. Its
+ * threads are stopped when the collection gets destroyed. Before that,
+ * the delivery_pool::flush() function can be used to wait until all
+ * the asynchronous listeners were called, for example to shutdown
+ * cleanly.
+ *
+ * \return The delivery pool of this collection.
+ */
+delivery_pool::pointer_t collection::get_delivery_pool()
+{
+    cppthread::guard lock(f_mutex);
+    if(f_delivery_pool == nullptr)
+    {
+        std::size_t workers(f_delivery_workers);
+        if(workers == 0)
+        {
+            workers = cppthread::get_number_of_available_processors();
+        }
+        f_delivery_pool = std::make_shared<delivery_pool>(workers);
+        f_delivery_pool_ptr.store(f_delivery_pool.get(), std::memory_order_release);
+    }
+    return f_delivery_pool;
+}
+
+
+/** \brief Set the executor of the awaitable signals.
+ *
+ * The listeners of an awaitable signal (see awaitable_signal.h) may
+ * suspend while they wait for I/O. They then get resumed by whatever
+ * thread completed that I/O. When an executor is defined, the emission
+ * goes back to it before calling the next listener or returning to the
+ * emitter, so the plugins only run in the threads of the server.
+ *
+ * Without an executor, the emission continues in the thread which
+ * resumed the listener.
+ *
+ * \param[in] e  The executor or a null pointer.
+ */
+void collection::set_executor(executor::pointer_t e)
+{
+    cppthread::guard lock(f_mutex);
+    f_executor = e;
+}
+
+
+/** \brief Get the executor of the awaitable signals.
+ *
+ * \return The executor as set by set_executor() or a null pointer.
+ */
+executor::pointer_t collection::get_executor() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_executor;
+}
+
+
+/** \brief Get the statistics of each listener.
+ *
+ * When the plugins are compiled with SERVERPLUGINS_PROFILING, each call
+ * to a listener connected with the SERVERPLUGINS_LISTEN() macros gets
+ * measured. This function returns the statistics of all the connected
+ * listeners, sorted by emitter, signal, and listener name.
+ *
+ * The listeners of the awaitable signals are not measured. For the
+ * asynchronous listeners, the time measured is the time it takes to
+ * queue the call, not the call itself.
+ *
+ * Without SERVERPLUGINS_PROFILING, the returned vector is empty.
+ *
+ * \return The statistics of each listener.
+ */
+signal_profile_vector_t collection::get_signal_profiles() const
+{
+    signal_profile_vector_t result;
+
+    cppthread::guard lock(f_mutex);
+    for(auto const & c : f_connections)
+    {
+        if(c.f_profile == nullptr)
+        {
+            continue;
+        }
+        signal_profile_t profile;
+        profile.f_emitter = c.f_emitter;
+        profile.f_signal = c.f_signal;
+        profile.f_listener = c.f_listener->name();
+        c.f_profile->collect(profile);
+        result.push_back(profile);
+    }
+
+    std::stable_sort(
+          result.begin()
+        , result.end()
+        , [](signal_profile_t const & lhs, signal_profile_t const & rhs)
+          {
+              return std::tie(lhs.f_emitter, lhs.f_signal, lhs.f_listener)
+                   < std::tie(rhs.f_emitter, rhs.f_signal, rhs.f_listener);
+          });
+
+    return result;
+}
+
+
+/** \brief Reset the statistics of all the listeners.
+ *
+ * This is useful to measure a specific period of time, i.e. after the
+ * process is done initializing.
+ */
+void collection::reset_signal_profiles()
+{
+    cppthread::guard lock(f_mutex);
+    for(auto const & c : f_connections)
+    {
+        if(c.f_profile != nullptr)
+        {
+            c.f_profile->reset();
+        }
+    }
+}
+
+
 /** \brief Load all the plugins in this collection.
  *
  * When you create a collection, you pass a list of names (via the
@@ -168,7 +675,9 @@ void collection::set_data(void * data)
  * plugin dependency list (see plugin::dependencies() for details) and
  * the name of the plugin. If two plugins do not depend on each other,
  * then they get sorted alphabetically (so A always comes before B unless
- * A depends on B, then B would be initialized first).
+ * A depends on B, then B would be initialized first). The server is
+ * always bootstrapped first since all the plugins implicitly depend on
+ * it. See order_plugins() for details.
  *
  * The order in which the plugins get initialized is very important if
  * you use the signal system since it means that the order in which signals
@@ -183,12 +692,26 @@ void collection::set_data(void * data)
  * the state, you can have a second message A:S2 sent afterward, and
  * B:S2 can be ignored).
  *
+ * When the number of load workers is larger than 1 (see
+ * set_load_workers()), the plugins of each pass are first loaded in
+ * parallel. A new pass happens each time new dependencies are
+ * discovered.
+ *
+ * When a plan filename is defined (see set_plan_filename()) and the
+ * plan is still valid, the resolution is skipped and the plugins are
+ * loaded in the order saved in the plan.
+ *
+ * In lazy mode (see set_lazy()), the plugins with a definition note
+ * are only registered and get loaded on first use.
+ *
  * \param[in] s  The server, the "plugin" considered the root plugin.
  *
  * \return true if the loading worked on all the plugins, false otherwise.
  */
 bool collection::load_plugins(server::pointer_t s)
 {
+    load_report_scope const scope(f_names.get_load_report().get(), "load_plugins");
+
     cppthread::guard lock(f_mutex);
 
     if(!f_plugins_by_name.empty())
@@ -213,10 +736,13 @@ bool collection::load_plugins(server::pointer_t s)
     //   (1) create a server factory manually; and
     //   (2) register the server as f_server; and
     //   (3) and also register it as a plugin: f_plugins_by_name[s->name()]
+    //   (4) give the server access to the collection so signals it emits
+    //       can load deferred plugins (see set_lazy())
     //
     f_server = s;
     //detail::g_server_plugin_factory[id] = new detail::server_plugin_factory(s);
     f_plugins_by_name[s->name()] = s;
+    s->f_collection = this;
 
     cppthread::log << cppthread::log_level_t::debug
         << "registered your server as the root plugin named \""
@@ -224,24 +750,178 @@ bool collection::load_plugins(server::pointer_t s)
         << "\"."
         << cppthread::end;
 
-    detail::repository & repository(detail::repository::instance());
-    bool changed(true);
+    // resolve_plugins() adds the dependencies to f_names
+    //
+    names::names_t const requested(f_names.map());
+
     bool good(true);
-    while(changed)
+    bool const use_plan(!f_lazy && !f_plan_filename.empty());
+    {
+        load_report_scope const plan_scope(use_plan ? f_names.get_load_report().get() : nullptr, "load_plan");
+        f_used_cached_plan = use_plan
+                          && load_cached_plan(s, requested);
+    }
+    if(!f_used_cached_plan)
     {
-        changed = false;
-
-        names::names_t n(f_names.map());
-        for(auto const & name_filename : n)
         {
-            // make sure the plugins do not try to use the name of the server
-            // as their own name
-            //
-            // TODO: this was forced to "server" before, but that causes issues
-            //       in the macros (illogism); we may have to fix some other
-            //       sections that still use the hard coded name "server"
-            //
-            if(name_filename.first == s->name())
+            load_report_scope const resolve_scope(f_names.get_load_report().get(), "resolve");
+            good = resolve_plugins(s);
+        }
+        {
+            load_report_scope const order_scope(f_names.get_load_report().get(), "order");
+            if(!order_plugins(s))
+            {
+                good = false;
+            }
+        }
+        if(good
+        && use_plan)
+        {
+            save_plan(s, requested);
+        }
+    }
+
+    // from here on get_plugin() may have to load a deferred plugin
+    //
+    f_lazy_counters.f_deferred = f_deferred.size();
+    publish_plugins();
+    f_deferred_count.store(f_deferred.size(), std::memory_order_release);
+
+    // bootstrap() functions have to be called to get all the signals
+    // registered in order.
+    //
+    // This one for() loop makes all the signals work as expected by
+    // making sure they are in a very specific order as defined by
+    // your dependency list. Note, however, that a plugin may use
+    // the callback_manager priority to place its callback at a
+    // different location altogether.
+    //
+    // a bootstrap() function may load a deferred plugin (get_plugin() or
+    // a signal, see set_lazy()), which appends it to f_ordered_plugins
+    // and bootstraps it right away; so we cannot keep an iterator and we
+    // stop at the plugins that were there before the loop
+    //
+    std::size_t const max(f_ordered_plugins.size());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        plugin::pointer_t const p(f_ordered_plugins[idx]);
+        bootstrap_plugin(p);
+    }
+
+    return good;
+}
+
+
+/** \brief Load the plugins and their dependencies.
+ *
+ * This function loads all the plugins listed in the names object
+ * and all of their dependencies, recursively.
+ *
+ * The names are processed as a worklist: each plugin gets loaded and
+ * checked exactly once. Its dependencies that were not yet seen get
+ * added at the end of the worklist. When the number of load workers is
+ * larger than 1, the plugins found in the worklist are loaded in
+ * parallel, one batch per level of dependencies.
+ *
+ * The conflicts are verified in both directions as the plugins get
+ * added. Each check is a lookup, so the whole process is linear in the
+ * number of plugins, dependencies, and conflicts.
+ *
+ * When the preflight is turned on (see set_preflight()), the plugin
+ * definitions are first read from the ELF note of each file. The
+ * complete set of plugins gets validated that way and only the plugins
+ * that pass the verification get loaded, all in one batch. In
+ * particular, a plugin rejected because of a conflict never gets
+ * loaded. Plugins
+ * without a note (i.e. compiled against an older version of this
+ * library) are loaded as usual to read their definition.
+ *
+ * In lazy mode, the notes are always read and the plugins that pass the
+ * verification are saved in the list of deferred plugins instead of
+ * being loaded.
+ *
+ * \param[in] s  The server, the "plugin" considered the root plugin.
+ *
+ * \return true if all the plugins were loaded without conflicts.
+ */
+bool collection::resolve_plugins(server::pointer_t s)
+{
+    detail::repository & repository(detail::repository::instance());
+    bool good(true);
+
+    // the worklist starts with the names the user specified; the
+    // dependencies get appended as we discover them
+    //
+    names::names_t const & n(f_names.map());
+    std::vector<names::name_t> worklist;
+    worklist.reserve(n.size());
+    string_set_t queued;
+    for(auto const & name_filename : n)
+    {
+        worklist.push_back(name_filename.first);
+        queued.insert(name_filename.first);
+    }
+
+    // name of plugin -> plugins that declared a conflict with that name
+    //
+    std::map<names::name_t, string_set_t> conflicted_by;
+
+    // names of the plugins accepted so far
+    //
+    string_set_t accepted;
+
+    // plugins validated through their note and not yet loaded
+    //
+    std::vector<names::name_t> pending;
+
+    std::size_t pos(0);
+    while(pos < worklist.size())
+    {
+        std::size_t const end(worklist.size());
+
+        // read the definitions from the ELF notes first, this is much
+        // cheaper than a dlopen() and does not run any plugin code
+        //
+        std::map<names::name_t, definition> notes;
+        if(f_preflight
+        || f_lazy)
+        {
+            for(std::size_t idx(pos); idx < end; ++idx)
+            {
+                definition def;
+                if(read_definition_note(n.at(worklist[idx]), def))
+                {
+                    notes[worklist[idx]] = def;
+                }
+            }
+        }
+
+        if(f_load_workers > 1)
+        {
+            std::vector<names::filename_t> filenames;
+            filenames.reserve(end - pos);
+            for(std::size_t idx(pos); idx < end; ++idx)
+            {
+                if(notes.find(worklist[idx]) == notes.end())
+                {
+                    filenames.push_back(n.at(worklist[idx]));
+                }
+            }
+            repository.load_plugins(filenames, f_load_workers, f_names.get_load_report().get());
+        }
+
+        for(; pos < end; ++pos)
+        {
+            names::name_t const name(worklist[pos]);
+
+            // make sure the plugins do not try to use the name of the server
+            // as their own name
+            //
+            // TODO: this was forced to "server" before, but that causes issues
+            //       in the macros (illogism); we may have to fix some other
+            //       sections that still use the hard coded name "server"
+            //
+            if(name == s->name())
             {
                 cppthread::log << cppthread::log_level_t::error         // LCOV_EXCL_LINE
                     << "a plugin cannot be called like the server \""   // LCOV_EXCL_LINE
@@ -252,136 +932,1203 @@ bool collection::load_plugins(server::pointer_t s)
                 continue;                                               // LCOV_EXCL_LINE
             }
 
-            plugin::pointer_t p(repository.get_plugin(name_filename.second));
-            if(p == nullptr)
+            names::filename_t const & filename(n.at(name));
+            string_set_t conflicts;
+            string_set_t dependencies;
+            auto const note(notes.find(name));
+            if(note != notes.end())
+            {
+                if(note->second.f_name != name)
+                {
+                    cppthread::log << cppthread::log_level_t::fatal
+                        << "file \""
+                        << filename
+                        << "\" defines plugin \""
+                        << note->second.f_name
+                        << "\", expected \""
+                        << name
+                        << "\"."
+                        << cppthread::end;
+                    good = false;
+                    continue;
+                }
+                if(note->second.f_library_version.f_major != SERVERPLUGINS_VERSION_MAJOR)
+                {
+                    cppthread::log << cppthread::log_level_t::fatal
+                        << "plugin \""
+                        << name
+                        << "\" was compiled against serverplugins version "
+                        << note->second.f_library_version.f_major
+                        << "."
+                        << note->second.f_library_version.f_minor
+                        << ", which is not compatible with this version ("
+                        << SERVERPLUGINS_VERSION_STRING
+                        << ")."
+                        << cppthread::end;
+                    good = false;
+                    continue;
+                }
+                conflicts = note->second.f_conflicts;
+                dependencies = note->second.f_dependencies;
+            }
+            else
+            {
+                plugin::pointer_t p(repository.get_plugin(filename, f_names.get_load_report().get()));
+                if(p == nullptr)
+                {
+                    cppthread::log << cppthread::log_level_t::fatal
+                        << "loaded file \""
+                        << filename
+                        << "\" for plugin \""
+                        << name
+                        << "\", but the plugin was not found (name mismatch? plugin not installed?)."
+                        << cppthread::end;
+                    good = false;
+                    continue;
+                }
+
+                // give plugin access back to the collection and thus:
+                //
+                //  * the server
+                //  * the user data
+                //  * other plugins (useful to know whether a plugin exists)
+                //
+                p->f_collection = this;
+
+                conflicts = p->conflicts();
+                dependencies = p->dependencies();
+                f_plugins_by_name[name] = p;
+            }
+
+            // the conflicts can be indicated in either direction so we
+            // have to test both: the plugins this one says it is in
+            // conflict with and the plugins which said they are in
+            // conflict with this one
+            //
+            string_set_t in_conflict;
+            for(auto const & c : conflicts)
+            {
+                if(accepted.find(c) != accepted.end())
+                {
+                    in_conflict.insert(c);
+                }
+                conflicted_by[c].insert(name);
+            }
+            auto const cb(conflicted_by.find(name));
+            if(cb != conflicted_by.end())
+            {
+                for(auto const & c : cb->second)
+                {
+                    if(accepted.find(c) != accepted.end())
+                    {
+                        in_conflict.insert(c);
+                    }
+                }
+            }
+            for(auto const & c : in_conflict)
             {
                 cppthread::log << cppthread::log_level_t::fatal
-                    << "loaded file \""
-                    << name_filename.second
-                    << "\" for plugin \""
-                    << name_filename.first
-                    << "\", but the plugin was not found (name mismatch? plugin not installed?)."
+                    << "plugin \""
+                    << c
+                    << "\" is in conflict with \""
+                    << name
+                    << "\"."
                     << cppthread::end;
                 good = false;
-                continue;
             }
 
-            // give plugin access back to the collection and thus:
+            // a plugin validated through its note is only loaded (or
+            // deferred) once we know it is not in conflict; this way the
+            // rejected plugin never runs any code
             //
-            //  * the server
-            //  * the user data
-            //  * other plugins (useful to know whether a plugin exists)
-            //
-            p->f_collection = this;
-
-            string_set_t const conflicts1(p->conflicts());
-            for(auto & op : f_plugins_by_name)
+            if(note != notes.end())
             {
-                // the conflicts can be indicated in either direction so we
-                // have to test both unless one is true then we do not have to
-                // test the other
-                //
-                bool in_conflict(conflicts1.find(op.first) != conflicts1.end());
-                if(!in_conflict)
+                if(!in_conflict.empty())
                 {
-                    string_set_t const conflicts2(op.second->conflicts());
-                    in_conflict = conflicts2.find(op.first) != conflicts2.end();
+                    continue;
                 }
-                if(in_conflict)
+                if(f_lazy)
                 {
-                    cppthread::log << cppthread::log_level_t::fatal
-                        << "plugin \""
-                        << op.first
-                        << "\" is in conflict with \""
-                        << name_filename.first
-                        << "\"."
-                        << cppthread::end;
-                    good = false;
-                    continue;
+                    for(auto const & i : note->second.f_interests)
+                    {
+                        f_interests[i].insert(name);
+                    }
+                    deferred_t & d(f_deferred[name]);
+                    d.f_filename = filename;
+                    d.f_definition = std::move(note->second);
+                }
+                else
+                {
+                    pending.push_back(name);
                 }
             }
+            accepted.insert(name);
 
-            string_set_t const dependencies(p->dependencies());
-            for(auto & d : dependencies)
+            for(auto const & d : dependencies)
             {
-                if(n.find(d) == n.end()
-                && d != s->name())       // server dependency is implied
+                if(d != s->name()       // server dependency is implied
+                && queued.insert(d).second)
                 {
                     f_names.push(d);
-                    changed = true;
+                    worklist.push_back(d);
                 }
             }
+        }
+    }
+
+    // now load the plugins we validated through their ELF note
+    //
+    if(!pending.empty())
+    {
+        std::vector<names::filename_t> filenames;
+        filenames.reserve(pending.size());
+        for(auto const & name : pending)
+        {
+            filenames.push_back(n.at(name));
+        }
+        repository.load_plugins(filenames, f_load_workers, f_names.get_load_report().get());
 
-            f_plugins_by_name[name_filename.first] = p;
+        for(auto const & name : pending)
+        {
+            plugin::pointer_t p(repository.get_plugin(n.at(name), f_names.get_load_report().get()));
+            if(p == nullptr)
+            {
+                cppthread::log << cppthread::log_level_t::fatal
+                    << "loaded file \""
+                    << n.at(name)
+                    << "\" for plugin \""
+                    << name
+                    << "\", but the plugin was not found (name mismatch? plugin not installed?)."
+                    << cppthread::end;
+                good = false;
+                continue;
+            }
+            p->f_collection = this;
+            f_plugins_by_name[name] = p;
         }
     }
 
-    // set the f_ordered_plugins with the default order as alphabetical,
-    // although we check dependencies to properly reorder as expected
-    // by what each plugin tells us what its dependencies are
+    return good;
+}
+
+
+/** \brief Sort the plugins so dependencies come first.
+ *
+ * This function generates the f_ordered_plugins vector. The server
+ * always comes first. The other plugins are sorted with a topological
+ * sort (Kahn's algorithm) so a plugin always appears after all of its
+ * dependencies. When several plugins are ready at the same time, the
+ * one with the smallest name is picked first, so the order is always
+ * the same for a given set of plugins.
+ *
+ * Each plugin dependency list is read once, so the sort is
+ * O((V + E) log V) where V is the number of plugins and E the number
+ * of dependencies.
+ *
+ * If the dependencies form a cycle, the plugins part of or depending on
+ * the cycle cannot be sorted. An error listing those plugins is logged
+ * and they get added at the end of the list in alphabetical order so
+ * they still get bootstrapped.
+ *
+ * \param[in] s  The server, the "plugin" considered the root plugin.
+ *
+ * \return true if the plugins could be sorted, false if a cycle exists.
+ */
+bool collection::order_plugins(server::pointer_t s)
+{
+    // the map is sorted by name, so an index in this vector sorts
+    // alphabetically as well
     //
+    std::vector<plugin::pointer_t> plugins;
+    plugins.reserve(f_plugins_by_name.size());
+    std::map<names::name_t, std::size_t> index;
     for(auto const & p : f_plugins_by_name)
     {
-        auto it(std::find_if(
-                f_ordered_plugins.begin(),
-                f_ordered_plugins.end(),
-                [&p](auto const & plugin)
-                {
-                    return plugin->dependencies().find(p.first) != plugin->dependencies().end();
-                }));
-        if(it != f_ordered_plugins.end())
+        if(p.second != s)
         {
-            f_ordered_plugins.insert(it, p.second);
+            index[p.first] = plugins.size();
+            plugins.push_back(p.second);
         }
-        else
+    }
+
+    std::vector<std::size_t> in_degree(plugins.size(), 0);
+    std::vector<std::vector<std::size_t>> dependents(plugins.size());
+    for(std::size_t idx(0); idx < plugins.size(); ++idx)
+    {
+        string_set_t const dependencies(plugins[idx]->dependencies());
+        for(auto const & d : dependencies)
         {
-            f_ordered_plugins.push_back(p.second);
+            auto const it(index.find(d));
+            if(it != index.end())
+            {
+                dependents[it->second].push_back(idx);
+                ++in_degree[idx];
+            }
         }
     }
 
-    // bootstrap() functions have to be called to get all the signals
-    // registered in order.
-    //
-    // This one for() loop makes all the signals work as expected by
-    // making sure they are in a very specific order as defined by
-    // your dependency list. Note, however, that a plugin may use
-    // the callback_manager priority to place its callback at a
-    // different location altogether.
-    //
-    for(auto const & p : f_ordered_plugins)
+    std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<std::size_t>> ready;
+    for(std::size_t idx(0); idx < plugins.size(); ++idx)
     {
-        p->bootstrap();
+        if(in_degree[idx] == 0)
+        {
+            ready.push(idx);
+        }
     }
 
-    return good;
+    f_ordered_plugins.clear();
+    f_ordered_plugins.reserve(plugins.size() + 1);
+    f_ordered_plugins.push_back(s);
+    while(!ready.empty())
+    {
+        std::size_t const idx(ready.top());
+        ready.pop();
+        f_ordered_plugins.push_back(plugins[idx]);
+        for(auto const & d : dependents[idx])
+        {
+            --in_degree[d];
+            if(in_degree[d] == 0)
+            {
+                ready.push(d);
+            }
+        }
+    }
+
+    if(f_ordered_plugins.size() == plugins.size() + 1)
+    {
+        return true;
+    }
+
+    std::string cycle;
+    for(std::size_t idx(0); idx < plugins.size(); ++idx)
+    {
+        if(in_degree[idx] != 0)
+        {
+            if(!cycle.empty())
+            {
+                cycle += ", ";
+            }
+            cycle += plugins[idx]->name();
+            f_ordered_plugins.push_back(plugins[idx]);
+        }
+    }
+    cppthread::log << cppthread::log_level_t::fatal
+        << "circular dependencies detected between plugins: "
+        << cycle
+        << "."
+        << cppthread::end;
+
+    return false;
 }
 
 
-/** \brief Check whether a given plugin is already loaded.
+/** \brief Load the plugins using the cached plan.
  *
- * This function checks to see whether the named plugin was loaded. If so
- * the function returns true.
+ * This function loads the plan from the file defined with
+ * set_plan_filename(). The plan is used only if it was created for the
+ * same server and the same requested plugins and if none of the plugin
+ * files changed since.
  *
- * In your code or even scripts, this function can be very useful to check
- * whether a plugin is available before trying to access its functionality.
- * So in other words, you can make certain plugins optional and still have
- * a fully functional system, just with less capabilities.
+ * The plugins are then loaded in one batch and f_ordered_plugins is
+ * set to the saved order.
  *
- * \note
- * You may instead want to directly do a `get_plugin<type>()` and
- * test whether the pointer is nullptr or not. It would be faster.
- * Further, you can do that `get_plugin()` once at initialization
- * time and save the pointer in a variable member. Then in the
- * rest of your plugin, just use `if(other_plugin != nullptr)`
- * before making use of the plugin. You can do that initialization
- * in the plugin::bootstrap() function.
+ * If anything fails, the collection is reset to just the server and
+ * the function returns false so the caller can fall back to the full
+ * resolution.
  *
- * \param[in] name  The name of the plugin to check for.
+ * \param[in] s  The server, the "plugin" considered the root plugin.
+ * \param[in] requested  The names and filenames requested by the user.
  *
- * \return True if the plugin is found, false otherwise.
+ * \return true if the plugins were loaded from the plan.
  */
-bool collection::is_loaded(std::string const & name) const
+bool collection::load_cached_plan(server::pointer_t s, names::names_t const & requested)
 {
+    load_plan plan;
+    if(!plan.load(f_plan_filename)
+    || plan.get_server_name() != s->name()
+    || plan.get_requested() != requested
+    || !plan.is_current())
+    {
+        return false;
+    }
+
+    load_plan::entry_vector_t const & entries(plan.get_plugins());
+    string_set_t names;
+    std::vector<names::filename_t> filenames;
+    filenames.reserve(entries.size());
+    for(auto const & e : entries)
+    {
+        names.insert(e.f_name);
+        filenames.push_back(e.f_filename);
+    }
+
+    // the plan is only saved if there were no conflicts, this verifies
+    // that the file was not tampered with
+    //
+    for(auto const & c : plan.get_conflicts())
+    {
+        if(names.find(c.f_conflict) != names.end())
+        {
+            return false;
+        }
+    }
+
+    detail::repository & repository(detail::repository::instance());
+    repository.load_plugins(filenames, f_load_workers, f_names.get_load_report().get());
+
+    plugin::vector_t ordered;
+    ordered.reserve(entries.size() + 1);
+    ordered.push_back(s);
+    for(auto const & e : entries)
+    {
+        plugin::pointer_t p(repository.get_plugin(e.f_filename, f_names.get_load_report().get()));
+        if(p == nullptr
+        || p->name() != e.f_name)
+        {
+            cppthread::log << cppthread::log_level_t::warning
+                << "cached load plan \""
+                << f_plan_filename
+                << "\" does not match plugin \""
+                << e.f_name
+                << "\"; resolving the plugins again."
+                << cppthread::end;
+
+            f_plugins_by_name.clear();
+            f_plugins_by_name[s->name()] = s;
+            return false;
+        }
+        p->f_collection = this;
+        f_plugins_by_name[e.f_name] = p;
+        ordered.push_back(p);
+    }
+    f_ordered_plugins.swap(ordered);
+
+    // like resolve_plugins(), add the dependencies to f_names
+    //
+    for(auto const & e : entries)
+    {
+        if(requested.find(e.f_name) == requested.end())
+        {
+            f_names.push(static_plugin::is_static_filename(e.f_filename)
+                            ? e.f_name
+                            : e.f_filename);
+        }
+    }
+
+    cppthread::log << cppthread::log_level_t::debug
+        << "loaded "
+        << entries.size()
+        << " plugins using the cached load plan \""
+        << f_plan_filename
+        << "\"."
+        << cppthread::end;
+
+    return true;
+}
+
+
+/** \brief Save the resolved plugins as a load plan.
+ *
+ * This function saves the list of ordered plugins in the file defined
+ * with set_plan_filename(). It is called only after a successful
+ * resolution.
+ *
+ * Failing to save the plan is not an error. The next start will simply
+ * go through the full resolution again.
+ *
+ * \param[in] s  The server, the "plugin" considered the root plugin.
+ * \param[in] requested  The names and filenames requested by the user.
+ */
+void collection::save_plan(server::pointer_t s, names::names_t const & requested)
+{
+    names::names_t const & n(f_names.map());
+
+    load_plan plan;
+    plan.set_server_name(s->name());
+    plan.set_requested(requested);
+    for(auto const & p : f_ordered_plugins)
+    {
+        if(p == s)
+        {
+            continue;
+        }
+        auto const it(n.find(p->name()));
+        if(it == n.end())
+        {
+            return;     // LCOV_EXCL_LINE
+        }
+        if(!plan.add_plugin(p->name(), it->second))
+        {
+            cppthread::log << cppthread::log_level_t::warning
+                << "could not read the identity of \""
+                << it->second
+                << "\"; the load plan is not saved."
+                << cppthread::end;
+            return;
+        }
+        for(auto const & c : p->conflicts())
+        {
+            plan.add_conflict(p->name(), c);
+        }
+    }
+
+    if(!plan.save(f_plan_filename))
+    {
+        cppthread::log << cppthread::log_level_t::warning
+            << "could not save the load plan to \""
+            << f_plan_filename
+            << "\"."
+            << cppthread::end;
+    }
+}
+
+
+/** \brief Get the slot of a plugin for a handle.
+ *
+ * This function returns the slot holding a bare pointer to the named
+ * plugin, creating it on the first call. The slot lives as long as the
+ * collection. It gets cleared by unload_plugin() and updated by
+ * reload_plugin().
+ *
+ * \param[in] name  The name of the plugin.
+ *
+ * \return The slot or nullptr if the plugin is not part of this
+ * collection.
+ */
+plugin_handle<plugin>::slot_t const * collection::get_slot(std::string_view name)
+{
+    // load the plugin first in lazy mode
+    //
+    get_plugin<plugin>(name);
+
+    cppthread::guard lock(f_mutex);
+
+    auto const slot(f_slots.find(name));
+    if(slot != f_slots.end())
+    {
+        return slot->second.get();
+    }
+
+    auto const it(f_plugins_by_name.find(name));
+    if(it == f_plugins_by_name.end())
+    {
+        return nullptr;
+    }
+
+    return f_slots.emplace(
+                  std::string(name)
+                , std::make_unique<plugin_handle<plugin>::slot_t>(it->second.get())).first->second.get();
+}
+
+
+/** \brief Get a plugin, loading it if it was deferred.
+ *
+ * This function is used by get_plugin() while some plugins are still
+ * deferred. It searches the plugin and if not yet loaded, it loads it.
+ *
+ * \param[in] name  The name of the plugin.
+ *
+ * \return The plugin or nullptr if it is not part of this collection.
+ */
+plugin::pointer_t collection::get_deferred_plugin(std::string const & name)
+{
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_plugins_by_name.find(name));
+    if(it != f_plugins_by_name.end())
+    {
+        return it->second;
+    }
+
+    return materialize(name, f_lazy_counters.f_materialized_by_get);
+}
+
+
+/** \brief Load and bootstrap a deferred plugin.
+ *
+ * This function loads the named deferred plugin. Its deferred
+ * dependencies get loaded first. Then the plugin is added to the
+ * collection and its bootstrap() function gets called.
+ *
+ * The plugin is removed from the list of deferred plugins before
+ * anything else happens so it only gets loaded once even if its
+ * bootstrap() function ends up requesting it again.
+ *
+ * The f_mutex must be locked by the caller.
+ *
+ * \param[in] name  The name of the plugin to load.
+ * \param[in,out] counter  The counter to increment once loaded.
+ *
+ * \return The plugin or nullptr if it was not deferred or can't be loaded.
+ */
+plugin::pointer_t collection::materialize(std::string const & name, std::size_t & counter)
+{
+    auto it(f_deferred.find(name));
+    if(it == f_deferred.end())
+    {
+        auto const loaded(f_plugins_by_name.find(name));
+        return loaded == f_plugins_by_name.end() ? plugin::pointer_t() : loaded->second;
+    }
+    deferred_t const d(it->second);
+    f_deferred.erase(it);
+
+    for(auto const & dep : d.f_definition.f_dependencies)
+    {
+        if(f_deferred.find(dep) != f_deferred.end())
+        {
+            materialize(dep, f_lazy_counters.f_materialized_as_dependency);
+        }
+    }
+
+    plugin::pointer_t p(detail::repository::instance().get_plugin(d.f_filename, f_names.get_load_report().get()));
+    if(p == nullptr)
+    {
+        cppthread::log << cppthread::log_level_t::fatal
+            << "loaded file \""
+            << d.f_filename
+            << "\" for deferred plugin \""
+            << name
+            << "\", but the plugin was not found (name mismatch? plugin not installed?)."
+            << cppthread::end;
+        ++f_lazy_counters.f_failed;
+        publish_plugins();
+        f_deferred_count.fetch_sub(1, std::memory_order_release);
+        return p;
+    }
+
+    p->f_collection = this;
+    f_plugins_by_name[name] = p;
+    f_ordered_plugins.push_back(p);
+    ++counter;
+
+    bootstrap_plugin(p);
+
+    // only the plugins that were bootstrapped are visible without the lock
+    //
+    publish_plugins();
+
+    // decrement only once bootstrapped so get_plugin() does not return
+    // a plugin which is not yet ready without first locking the mutex
+    //
+    f_deferred_count.fetch_sub(1, std::memory_order_release);
+
+    return p;
+}
+
+
+/** \brief Publish the plugins for get_plugin() to search without a lock.
+ *
+ * While some plugins are deferred, get_plugin() first searches a copy
+ * of f_plugins_by_name published with read-copy-update. This function
+ * publishes a new copy each time the list of plugins changes. Once no
+ * plugins are deferred, the copy is not used anymore and gets released.
+ *
+ * The copy holds bare pointers so it does not add references to the
+ * plugins; a plugin being unloaded gets removed from the copy first
+ * (see detach_plugin()).
+ *
+ * The f_mutex must be locked by the caller, or no other thread can be
+ * using the collection (i.e. in load_plugins()).
+ */
+void collection::publish_plugins()
+{
+    cppthread::guard lock(f_loaded_plugins.get_mutex());
+
+    if(f_deferred.empty())
+    {
+        f_loaded_plugins.publish(nullptr);
+        return;
+    }
+
+    std::unique_ptr<loaded_map_t> loaded(std::make_unique<loaded_map_t>());
+    for(auto const & p : f_plugins_by_name)
+    {
+        loaded->emplace(p.first, p.second.get());
+    }
+    f_loaded_plugins.publish(loaded.release());
+}
+
+
+/** \brief Call the bootstrap() function of a plugin.
+ *
+ * This function calls the bootstrap() function of \p p and records the
+ * time it took in the load report, if one is attached.
+ *
+ * \param[in] p  The plugin to bootstrap.
+ */
+void collection::bootstrap_plugin(plugin::pointer_t p)
+{
+    load_report_scope const scope(f_names.get_load_report().get(), "bootstrap", p->name());
+    p->bootstrap();
+}
+
+
+/** \brief Record a connection between a listener and an emitter.
+ *
+ * This function connects the listener to the emitter and records the
+ * connection. See listen() for details.
+ *
+ * \param[in,out] c  The connection to record.
+ * \param[in] emitter  The plugin emitting the signal.
+ */
+void collection::add_connection(connection_t & c, plugin & emitter)
+{
+    cppthread::guard lock(f_mutex);
+
+    c.f_disconnect = c.f_connect(emitter);
+    f_connections.push_back(c);
+}
+
+
+/** \brief Mark the beginning of a signal emission.
+ *
+ * The signals in flight are counted in one of two counters. The epoch
+ * selects the counter. When wait_for_signals() increments the epoch,
+ * new signals use the other counter so it only has to wait for the
+ * first counter to go down to zero.
+ *
+ * If the epoch changes between the time we read it and the time we
+ * increment the counter, we try again so a signal is never counted in
+ * a counter that wait_for_signals() may already have checked.
+ *
+ * \return The epoch to pass to signal_leave().
+ */
+std::size_t collection::signal_enter()
+{
+    ++g_signal_depth;
+    for(;;)
+    {
+        std::size_t const idx(f_epoch.load() & 1);
+        f_signals_in_flight[idx].fetch_add(1);
+        if((f_epoch.load() & 1) == idx)
+        {
+            return idx;
+        }
+        f_signals_in_flight[idx].fetch_sub(1);
+    }
+}
+
+
+/** \brief Mark the end of a signal emission.
+ *
+ * If wait_for_signals() is waiting and this was the last signal in
+ * flight, it gets woken up.
+ *
+ * \param[in] epoch  The value returned by signal_enter().
+ */
+void collection::signal_leave(std::size_t epoch)
+{
+    if(f_signals_in_flight[epoch].fetch_sub(1) == 1
+    && f_draining.load() != 0)
+    {
+        cppthread::guard lock(f_drain_mutex);
+        f_drain_mutex.broadcast();
+    }
+    --g_signal_depth;
+}
+
+
+/** \brief Wait for the signals in flight to be done.
+ *
+ * This function switches the epoch and then waits until all the signals
+ * which started before the switch are done. Signals that start after
+ * the switch are not waited on. The function sleeps on the drain mutex
+ * until signal_leave() wakes it up.
+ *
+ * This is used by unload_plugin() once the listeners of the plugin
+ * were removed: a signal which started after that cannot call the
+ * plugin anymore, but one which started before may still be running
+ * one of its callbacks.
+ *
+ * Then the delivery pool gets flushed since those signals may have
+ * queued calls to the asynchronous listeners of the plugin.
+ *
+ * Finally, the signals the plugin was listening to delete the vectors
+ * of listeners that still reference it. This has to happen before the
+ * plugin gets unloaded since destroying a listener may run code of
+ * the plugin.
+ *
+ * \param[in,out] synchronize  The functions synchronizing the signals
+ * the plugin was listening to; the list gets cleared.
+ */
+void collection::wait_for_signals(synchronize_vector_t & synchronize)
+{
+    {
+        cppthread::guard lock(f_drain_mutex);
+
+        ++f_draining;
+        std::size_t const idx(f_epoch.fetch_add(1) & 1);
+        while(f_signals_in_flight[idx].load() != 0)
+        {
+            f_drain_mutex.wait();
+        }
+        --f_draining;
+    }
+
+    // the signals that were in flight may have queued asynchronous calls
+    //
+    delivery_pool::pointer_t pool;
+    {
+        cppthread::guard lock(f_mutex);
+        pool = f_delivery_pool;
+    }
+    if(pool != nullptr)
+    {
+        pool->flush();
+    }
+
+    for(auto const & sync : synchronize)
+    {
+        sync();
+    }
+    synchronize.clear();
+}
+
+
+/** \brief Check whether awaitable signals are still running.
+ *
+ * The listeners of an awaitable signal may be coroutines which are
+ * suspended. Such a coroutine resumes in the code of its plugin, so no
+ * plugin gets unloaded until all the emissions of awaitable signals
+ * are done (see detail::task_guard).
+ *
+ * \param[in] name  The name of the plugin to unload, for the log.
+ *
+ * \return true if at least one emission is not done yet.
+ */
+bool collection::tasks_pending(std::string const & name) const
+{
+    std::size_t const pending(f_tasks_in_flight.load());
+    if(pending == 0)
+    {
+        return false;
+    }
+
+    cppthread::log << cppthread::log_level_t::error
+        << "plugin \""
+        << name
+        << "\" cannot be unloaded while "
+        << pending
+        << " awaitable signal(s) are pending."
+        << cppthread::end;
+    return true;
+}
+
+
+/** \brief Remove a plugin from the collection.
+ *
+ * This function removes the named plugin from the collection:
+ *
+ * \li the callbacks it added to other plugins signals get removed;
+ * \li the connections other plugins have with its signals are marked
+ *     as disconnected (they get restored by attach_plugin());
+ * \li it is removed from the list of plugins.
+ *
+ * \param[in] name  The name of the plugin to detach.
+ * \param[out] p  The plugin that was detached.
+ * \param[out] position  The position of the plugin in the ordered list.
+ * \param[out] synchronize  The functions to call once the signals in
+ * flight are done, see wait_for_signals().
+ *
+ * \return true if the plugin was detached.
+ */
+bool collection::detach_plugin(std::string const & name, plugin::pointer_t & p, std::size_t & position, synchronize_vector_t & synchronize)
+{
+    if(g_signal_depth != 0)
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << name
+            << "\" cannot be unloaded from within a signal handler."
+            << cppthread::end;
+        return false;
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    if(is_frozen())
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << name
+            << "\" cannot be unloaded from a frozen collection."
+            << cppthread::end;
+        return false;
+    }
+
+    // the asynchronous and parallel listeners run in the delivery pool
+    // and the unload would wait for them
+    //
+    if(f_delivery_pool != nullptr
+    && f_delivery_pool->is_worker())
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << name
+            << "\" cannot be unloaded from a thread of the delivery pool."
+            << cppthread::end;
+        return false;
+    }
+
+    if(tasks_pending(name))
+    {
+        return false;
+    }
+
+    auto it(f_plugins_by_name.find(name));
+    if(it == f_plugins_by_name.end()
+    || it->second == f_server)
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << name
+            << "\" is not loaded in this collection or is the server; it cannot be unloaded."
+            << cppthread::end;
+        return false;
+    }
+    p = it->second;
+
+    // the collection owns the reference in f_plugins_by_name, the ones
+    // in f_ordered_plugins and `p`; the repository adds its own and the
+    // factory reference, anything else means someone is still using it
+    //
+    std::size_t const owners(
+              1
+            + std::count(f_ordered_plugins.begin(), f_ordered_plugins.end(), p)
+            + 1);
+    std::size_t const extra(detail::repository::instance().extra_references(p, owners));
+    if(extra != 0)
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << name
+            << "\" is still referenced ("
+            << extra
+            << " extra references) and cannot be unloaded."
+            << cppthread::end;
+        p.reset();
+        return false;
+    }
+
+    connection_vector_t connections;
+    connections.reserve(f_connections.size());
+    for(auto & c : f_connections)
+    {
+        if(c.f_listener == p.get())
+        {
+            if(c.f_disconnect)
+            {
+                c.f_disconnect();
+
+                plugin::pointer_t emitter(f_plugins_by_name[c.f_emitter]);
+                std::function<void(plugin &)> const sync(c.f_synchronize);
+                synchronize.push_back([emitter, sync]()
+                    {
+                        sync(*emitter);
+                    });
+            }
+            continue;
+        }
+        if(c.f_emitter == name)
+        {
+            // the callback goes away with the emitter
+            //
+            c.f_disconnect = nullptr;
+        }
+        connections.push_back(c);
+    }
+    f_connections.swap(connections);
+
+    f_plugins_by_name.erase(it);
+    auto const slot(f_slots.find(name));
+    if(slot != f_slots.end())
+    {
+        slot->second->store(nullptr, std::memory_order_release);
+    }
+    auto const o(std::find(f_ordered_plugins.begin(), f_ordered_plugins.end(), p));
+    position = o - f_ordered_plugins.begin();
+    if(o != f_ordered_plugins.end())
+    {
+        f_ordered_plugins.erase(o);
+    }
+
+    // the previous copies of the list point to the plugin, wait for
+    // them to be released
+    //
+    publish_plugins();
+    f_loaded_plugins.synchronize();
+
+    return true;
+}
+
+
+/** \brief Add a plugin to the collection and bootstrap it.
+ *
+ * This function loads the plugin from \p filename, adds it to the
+ * collection at the specified position, connects the listeners of the
+ * other plugins that were connected to a previous instance of this
+ * plugin, and finally calls its bootstrap() function.
+ *
+ * \param[in] name  The name of the plugin.
+ * \param[in] filename  The file to load the plugin from.
+ * \param[in] position  The position of the plugin in the ordered list.
+ *
+ * \return The plugin or nullptr if it could not be loaded.
+ */
+plugin::pointer_t collection::attach_plugin(std::string const & name, names::filename_t const & filename, std::size_t position)
+{
+    plugin::pointer_t p(detail::repository::instance().get_plugin(filename, f_names.get_load_report().get()));
+
+    cppthread::guard lock(f_mutex);
+
+    if(p == nullptr
+    || p->name() != name)
+    {
+        cppthread::log << cppthread::log_level_t::fatal
+            << "loaded file \""
+            << filename
+            << "\" for plugin \""
+            << name
+            << "\", but the plugin was not found (name mismatch? plugin not installed?)."
+            << cppthread::end;
+        return plugin::pointer_t();
+    }
+
+    p->f_collection = this;
+    f_plugins_by_name[name] = p;
+    auto const slot(f_slots.find(name));
+    if(slot != f_slots.end())
+    {
+        slot->second->store(p.get(), std::memory_order_release);
+    }
+    f_ordered_plugins.insert(
+              f_ordered_plugins.begin() + std::min(position, f_ordered_plugins.size())
+            , p);
+
+    for(auto & c : f_connections)
+    {
+        if(c.f_emitter == name
+        && !c.f_disconnect)
+        {
+            c.f_disconnect = c.f_connect(*p);
+        }
+    }
+
+    bootstrap_plugin(p);
+    publish_plugins();
+
+    return p;
+}
+
+
+/** \brief Unload a plugin.
+ *
+ * This function unloads the named plugin from memory:
+ *
+ * \li the plugin listeners get removed from the other plugins signals;
+ * \li the function waits for the signals in flight to be done (a
+ *     signal emitted before the listeners were removed may still be
+ *     calling the plugin);
+ * \li the plugin gets removed from the collection;
+ * \li its library gets unloaded with dlclose(), which destroys the
+ *     plugin instance.
+ *
+ * The other plugins which were listening to signals of this plugin get
+ * connected back if the plugin is loaded again with reload_plugin().
+ *
+ * The function fails if the plugin is still referenced elsewhere. For
+ * example, a plugin which saved a pointer to this plugin in its
+ * bootstrap() function or another collection using the same plugin.
+ * It also fails if called from within a signal handler, once the
+ * collection was frozen (see freeze()), or while the emission of an
+ * awaitable signal is not done (its listeners may be suspended
+ * coroutines).
+ *
+ * The callbacks can be removed while other threads emit the signals
+ * (see serverplugins::signal). The emissions which started before that
+ * may still call the plugin; the function waits for those to return
+ * before unloading it.
+ *
+ * \param[in] name  The name of the plugin to unload.
+ *
+ * \return true if the plugin was unloaded.
+ */
+bool collection::unload_plugin(std::string const & name)
+{
+    plugin::pointer_t p;
+    std::size_t position(0);
+    synchronize_vector_t synchronize;
+    if(!detach_plugin(name, p, position, synchronize))
+    {
+        return false;
+    }
+
+    wait_for_signals(synchronize);
+
+    // an emission which started before the listeners were removed may
+    // have created a coroutine of the plugin
+    //
+    names::filename_t const filename(p->filename());
+    if(tasks_pending(name)
+    || !detail::repository::instance().unload_plugin(p))
+    {
+        // the plugin is still in memory, put it back
+        //
+        p.reset();
+        attach_plugin(name, filename, position);
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Replace a plugin with the current version of its file.
+ *
+ * This function unloads the named plugin (see unload_plugin()) and then
+ * loads its file again. The new instance takes the same place in the
+ * list of ordered plugins, the listeners of the other plugins get
+ * connected to its signals, and its bootstrap() function gets called.
+ *
+ * This is used to deploy a new version of one plugin without having to
+ * restart the whole process.
+ *
+ * \param[in] name  The name of the plugin to reload.
+ *
+ * \return true if the plugin was reloaded.
+ */
+bool collection::reload_plugin(std::string const & name)
+{
+    plugin::pointer_t p;
+    std::size_t position(0);
+    synchronize_vector_t synchronize;
+    if(!detach_plugin(name, p, position, synchronize))
+    {
+        return false;
+    }
+
+    wait_for_signals(synchronize);
+
+    names::filename_t const filename(p->filename());
+    if(tasks_pending(name))
+    {
+        p.reset();
+        attach_plugin(name, filename, position);
+        return false;
+    }
+    bool const unloaded(detail::repository::instance().unload_plugin(p));
+    p.reset();
+
+    if(attach_plugin(name, filename, position) == nullptr)
+    {
+        return false;
+    }
+
+    return unloaded;
+}
+
+
+/** \brief Prevent any further changes to the signals listeners.
+ *
+ * Once all the plugins are loaded and bootstrapped, the listeners
+ * generally do not change anymore. This function makes that final:
+ *
+ * \li the deferred plugins, if any (see set_lazy()), get loaded now;
+ * \li each signal with at least one listener connected through this
+ *     collection gets frozen (see signal::freeze()); its listeners are
+ *     copied in a flat array, in priority order, and from then on
+ *     emitting the signal does not need to lock or register anything;
+ * \li unload_plugin() and reload_plugin() fail;
+ * \li the emissions stop checking for deferred plugins and are not
+ *     counted as signals in flight anymore.
+ *
+ * A signal with no listeners connected through listen() is not frozen.
+ * Trying to add a listener to a frozen signal throws a logic_error.
+ *
+ * There is no way to unfreeze a collection. The signals get thawed
+ * only when the collection gets destroyed, so its listeners can be
+ * removed. Calling this function more than once has no effect.
+ *
+ * \warning
+ * This function must not be called while signals are being emitted.
+ */
+void collection::freeze()
+{
+    cppthread::guard lock(f_mutex);
+
+    if(is_frozen())
+    {
+        return;
+    }
+
+    while(!f_deferred.empty())
+    {
+        // materialize() erases the entry so pass a copy of its name
+        //
+        std::string const name(f_deferred.begin()->first);
+        materialize(name, f_lazy_counters.f_materialized_by_freeze);
+    }
+    f_interests.clear();
+
+    for(auto const & c : f_connections)
+    {
+        auto const emitter(f_plugins_by_name.find(c.f_emitter));
+        if(emitter != f_plugins_by_name.end())
+        {
+            c.f_freeze(*emitter->second, true);
+        }
+    }
+
+    f_frozen.store(true, std::memory_order_release);
+}
+
+
+/** \brief Check whether the collection was frozen.
+ *
+ * \return true if freeze() was called.
+ */
+bool collection::is_frozen() const
+{
+    return f_frozen.load(std::memory_order_acquire);
+}
+
+
+/** \brief Check whether a given plugin is already loaded.
+ *
+ * This function checks to see whether the named plugin was loaded. If so
+ * the function returns true.
+ *
+ * In your code or even scripts, this function can be very useful to check
+ * whether a plugin is available before trying to access its functionality.
+ * So in other words, you can make certain plugins optional and still have
+ * a fully functional system, just with less capabilities.
+ *
+ * \note
+ * You may instead want to directly do a `get_plugin<type>()` and
+ * test whether the pointer is nullptr or not. It would be faster.
+ * Further, you can do that `get_plugin()` once at initialization
+ * time and save the pointer in a variable member. Then in the
+ * rest of your plugin, just use `if(other_plugin != nullptr)`
+ * before making use of the plugin. You can do that initialization
+ * in the plugin::bootstrap() function.
+ *
+ * \note
+ * In lazy mode, a deferred plugin is considered loaded since it is
+ * available. This function does not force it to be loaded.
+ *
+ * \param[in] name  The name of the plugin to check for.
+ *
+ * \return True if the plugin is found, false otherwise.
+ */
+bool collection::is_loaded(std::string const & name) const
+{
+    if(f_deferred_count.load(std::memory_order_acquire) != 0)
+    {
+        cppthread::guard lock(f_mutex);
+        return f_plugins_by_name.find(name) != f_plugins_by_name.end()
+            || f_deferred.find(name) != f_deferred.end();
+    }
+
     return f_plugins_by_name.find(name) != f_plugins_by_name.end();
 }
 
@@ -20,8 +20,13 @@
 
 // self
 //
+#include    <serverplugins/config.h>
+#include    <serverplugins/delivery_pool.h>
+#include    <serverplugins/executor.h>
 #include    <serverplugins/names.h>
+#include    <serverplugins/plugin_handle.h>
 #include    <serverplugins/server.h>
+#include    <serverplugins/signal_profile.h>
 
 
 // cppthread
@@ -31,7 +36,10 @@
 
 // C++
 //
+#include    <atomic>
+#include    <functional>
 #include    <memory>
+#include    <string_view>
 
 
 
@@ -39,18 +47,61 @@ namespace serverplugins
 {
 
 
+namespace detail
+{
+class signal_guard;
+class task_guard;
+} // namespace detail
+
+
 
 class collection
 {
 public:
     typedef std::shared_ptr<collection>  pointer_t;
 
+    struct lazy_counters_t
+    {
+        std::size_t                     f_deferred = 0;
+        std::size_t                     f_materialized_by_get = 0;
+        std::size_t                     f_materialized_by_signal = 0;
+        std::size_t                     f_materialized_as_dependency = 0;
+        std::size_t                     f_materialized_by_freeze = 0;
+        std::size_t                     f_failed = 0;
+        string_set_t                    f_untouched = string_set_t();
+    };
+
                                         collection(names const & n);
                                         collection(collection const &) = delete;
+                                        ~collection();
     collection &                        operator = (collection const &) = delete;
 
+    void                                set_load_workers(std::size_t workers);
+    std::size_t                         get_load_workers() const;
+    void                                set_preflight(bool preflight = true);
+    bool                                get_preflight() const;
+    void                                set_plan_filename(std::string const & filename);
+    std::string const &                 get_plan_filename() const;
+    bool                                used_cached_plan() const;
+    void                                set_lazy(bool lazy = true);
+    bool                                get_lazy() const;
+    lazy_counters_t                     get_lazy_counters() const;
+    void                                materialize_listeners(std::string const & emitter, char const * signal);
+    void                                set_load_report(load_report::pointer_t report);
+    load_report::pointer_t              get_load_report() const;
+    void                                set_delivery_workers(std::size_t workers);
+    std::size_t                         get_delivery_workers() const;
+    delivery_pool::pointer_t            get_delivery_pool();
+    void                                set_executor(executor::pointer_t e);
+    executor::pointer_t                 get_executor() const;
+    signal_profile_vector_t             get_signal_profiles() const;
+    void                                reset_signal_profiles();
     bool                                load_plugins(server::pointer_t s);
     bool                                is_loaded(std::string const & name) const;
+    bool                                unload_plugin(std::string const & name);
+    bool                                reload_plugin(std::string const & name);
+    void                                freeze();
+    bool                                is_frozen() const;
 
     /** \brief Specifically retrieve the server.
      *
@@ -61,7 +112,8 @@ public:
      *
      * The function is much faster than get_plugin() since the collection
      * keeps a direct pointer to the server plugin (i.e. there is no need
-     * to search for the pointer).
+     * to search for the pointer). It still does a dynamic cast on each
+     * call; on hot paths, use get_server_handle() instead.
      *
      * \tparam T  The type of the server (i.e. sitter, communicatord, ...)
      *
@@ -83,13 +135,41 @@ public:
      * offer a direct access to the global list so you can't determine whether
      * a specific plugin is loaded through a collection.
      *
+     * When the plugins are loaded lazily (see set_lazy()) and the named
+     * plugin was not yet loaded, this call loads it and calls its
+     * bootstrap() function first.
+     *
+     * Each call searches the collection and copies a shared pointer. To
+     * access a plugin repeatedly, resolve a handle once with get_handle().
+     * While some plugins are still deferred, the plugins already loaded
+     * are searched in a read-copy-update snapshot so the lookup does not
+     * lock the collection; only a plugin which is not yet loaded
+     * requires the lock.
+     *
      * \param[in] name  The name of the plugin to search.
      *
      * \return The pointer to the plugin if found, nullptr otherwise.
      */
     template<typename T>
-    typename T::pointer_t get_plugin(std::string const & name)
+    typename T::pointer_t get_plugin(std::string_view name)
     {
+        if(f_deferred_count.load(std::memory_order_acquire) != 0)
+        {
+            {
+                detail::rcu<loaded_map_t>::reader const loaded(f_loaded_plugins);
+                loaded_map_t const * plugins(loaded.get());
+                if(plugins != nullptr)
+                {
+                    auto it(plugins->find(name));
+                    if(it != plugins->end())
+                    {
+                        return std::static_pointer_cast<T>(it->second->shared_from_this());
+                    }
+                }
+            }
+            return std::static_pointer_cast<T>(get_deferred_plugin(std::string(name)));
+        }
+
         auto it(f_plugins_by_name.find(name));
         if(it != f_plugins_by_name.end())
         {
@@ -99,6 +179,136 @@ public:
         return typename T::pointer_t();
     }
 
+    /** \brief Retrieve a handle to a plugin of this collection.
+     *
+     * The handle gives direct access to the plugin for the lifetime of
+     * this collection (see plugin_handle). The plugin is searched once,
+     * by this call, so it is best done in the bootstrap() function of
+     * the plugin which needs the handle.
+     *
+     * When the plugins are loaded lazily (see set_lazy()) and the named
+     * plugin was not yet loaded, this call loads it first.
+     *
+     * \tparam T  The type of the plugin.
+     * \param[in] name  The name of the plugin.
+     *
+     * \return The handle to the plugin or an empty handle if the plugin
+     * is not part of this collection.
+     */
+    template<typename T>
+    plugin_handle<T> get_handle(std::string_view name)
+    {
+        return plugin_handle<T>(get_slot(name));
+    }
+
+    /** \brief Retrieve a handle to the server.
+     *
+     * The type of the server is verified once, by this call, instead of
+     * each time the server is accessed as with get_server().
+     *
+     * \tparam T  The type of the server.
+     *
+     * \return The handle to the server or an empty handle if the server
+     * is not of type T.
+     */
+    template<typename T>
+    plugin_handle<T> get_server_handle()
+    {
+        if(dynamic_cast<T *>(f_server.get()) == nullptr)
+        {
+            return plugin_handle<T>();
+        }
+        return get_handle<T>(f_server->name());
+    }
+
+    /** \brief Connect a listener to a signal and record the connection.
+     *
+     * This function is used by the SERVERPLUGINS_LISTEN() macros. It
+     * searches the emitter plugin and, if present, adds the callback to
+     * its signal.
+     *
+     * The connection is recorded so it can be removed when the listener
+     * gets unloaded and restored when the emitter gets reloaded (see
+     * unload_plugin() and reload_plugin()).
+     *
+     * When compiled with SERVERPLUGINS_PROFILING, the callback gets
+     * wrapped so each call is measured (see get_signal_profiles()).
+     *
+     * \tparam T  The type of the emitter plugin.
+     * \param[in] listener  The plugin listening to the signal.
+     * \param[in] emitter_name  The name of the emitter plugin.
+     * \param[in] signal_name  The name of the signal.
+     * \param[in] callback  The callback to add to the signal.
+     * \param[in] priority  The priority of the callback.
+     * \param[in] listen  The emitter signal_listen_\<signal>() function, or
+     *                    a function calling one of the other functions
+     *                    of a keyed signal, called as
+     *                    `listen(emitter, callback, priority)`.
+     * \param[in] unlisten  The emitter signal_unlisten_\<signal>() function.
+     * \param[in] synchronize  The emitter signal_synchronize_\<signal>() function.
+     * \param[in] freeze  The emitter signal_freeze_\<signal>() function.
+     * \param[in] thaw  The emitter signal_thaw_\<signal>() function.
+     */
+    template<typename T, typename C, typename P, typename L, typename U, typename S, typename F, typename H>
+    void listen(
+          plugin * listener
+        , std::string_view emitter_name
+        , char const * signal_name
+        , C const & listener_callback
+        , P priority
+        , L listen
+        , U unlisten
+        , S synchronize
+        , F freeze
+        , H thaw)
+    {
+        typename T::pointer_t emitter(get_plugin<T>(emitter_name));
+        if(emitter == nullptr)
+        {
+            return;
+        }
+
+        connection_t c;
+        c.f_listener = listener;
+        c.f_emitter = emitter_name;
+        c.f_signal = signal_name;
+
+        C callback(listener_callback);
+#ifdef SERVERPLUGINS_PROFILING
+        if constexpr (detail::is_profiled_delegate<C>::value)
+        {
+            c.f_profile = std::make_shared<listener_profile>();
+            callback = C(detail::make_profiled_delegate(listener_callback, c.f_profile));
+        }
+#endif
+
+        c.f_connect = [callback, priority, listen, unlisten](plugin & p)
+            {
+                T & e(static_cast<T &>(p));
+                auto const callback_id(std::invoke(listen, e, callback, priority));
+                return std::function<void()>([&e, callback_id, unlisten]()
+                    {
+                        (e.*unlisten)(callback_id);
+                    });
+            };
+        c.f_synchronize = [synchronize](plugin & p)
+            {
+                (static_cast<T &>(p).*synchronize)();
+            };
+        c.f_freeze = [freeze, thaw](plugin & p, bool frozen)
+            {
+                if(frozen)
+                {
+                    (static_cast<T &>(p).*freeze)();
+                }
+                else
+                {
+                    (static_cast<T &>(p).*thaw)();
+                }
+            };
+        add_connection(c, *emitter);
+    }
+
     // TBD: I think I prefer to use the get_server() rather than the data pointer
     //      but in the Snap! C++ plugins we have a server and a snap_child...
     //
@@ -107,12 +317,83 @@ public:
     void                                set_data(void * data);
 
 private:
-    cppthread::mutex                    f_mutex = cppthread::mutex();
+    friend class detail::signal_guard;
+    friend class detail::task_guard;
+
+    struct connection_t
+    {
+        plugin *                        f_listener = nullptr;
+        std::string                     f_emitter = std::string();
+        std::string                     f_signal = std::string();
+        listener_profile::pointer_t     f_profile = listener_profile::pointer_t();
+        std::function<std::function<void()>(plugin &)>
+                                        f_connect = std::function<std::function<void()>(plugin &)>();
+        std::function<void()>           f_disconnect = std::function<void()>();
+        std::function<void(plugin &)>   f_synchronize = std::function<void(plugin &)>();
+        std::function<void(plugin &, bool)>
+                                        f_freeze = std::function<void(plugin &, bool)>();
+    };
+    typedef std::vector<connection_t>   connection_vector_t;
+    typedef std::vector<std::function<void()>>
+                                        synchronize_vector_t;
+
+    void                                add_connection(connection_t & c, plugin & emitter);
+    bool                                tasks_pending(std::string const & name) const;
+    bool                                detach_plugin(std::string const & name, plugin::pointer_t & p, std::size_t & position, synchronize_vector_t & synchronize);
+    plugin::pointer_t                   attach_plugin(std::string const & name, names::filename_t const & filename, std::size_t position);
+    std::size_t                         signal_enter();
+    void                                signal_leave(std::size_t epoch);
+    void                                wait_for_signals(synchronize_vector_t & synchronize);
+    bool                                resolve_plugins(server::pointer_t s);
+    bool                                order_plugins(server::pointer_t s);
+    bool                                load_cached_plan(server::pointer_t s, names::names_t const & requested);
+    void                                save_plan(server::pointer_t s, names::names_t const & requested);
+    plugin::pointer_t                   get_deferred_plugin(std::string const & name);
+    plugin_handle<plugin>::slot_t const *
+                                        get_slot(std::string_view name);
+    plugin::pointer_t                   materialize(std::string const & name, std::size_t & counter);
+    void                                publish_plugins();
+    void                                bootstrap_plugin(plugin::pointer_t p);
+
+    struct deferred_t
+    {
+        names::filename_t               f_filename = names::filename_t();
+        definition                      f_definition = definition();
+    };
+    typedef std::map<names::name_t, deferred_t>
+                                        deferred_map_t;
+    typedef std::map<std::string, plugin *, std::less<>>
+                                        loaded_map_t;
+
+    mutable cppthread::mutex            f_mutex = cppthread::mutex();
     names                               f_names;
     plugin::map_t                       f_plugins_by_name = plugin::map_t();        // plugins sorted by name only
     plugin::vector_t                    f_ordered_plugins = plugin::vector_t();     // sorted plugins
     void *                              f_data = nullptr;
     server::pointer_t                   f_server = server::pointer_t();
+    std::size_t                         f_load_workers = 1;
+    bool                                f_preflight = false;
+    bool                                f_used_cached_plan = false;
+    bool                                f_lazy = false;
+    std::string                         f_plan_filename = std::string();
+    deferred_map_t                      f_deferred = deferred_map_t();
+    std::map<std::string, string_set_t> f_interests = std::map<std::string, string_set_t>();    // "<emitter>::<signal>" -> plugins
+    std::atomic<std::size_t>            f_deferred_count = 0;
+    detail::rcu<loaded_map_t>           f_loaded_plugins = detail::rcu<loaded_map_t>();     // f_plugins_by_name while some plugins are deferred
+    lazy_counters_t                     f_lazy_counters = lazy_counters_t();
+    connection_vector_t                 f_connections = connection_vector_t();
+    std::size_t                         f_delivery_workers = 0;
+    delivery_pool::pointer_t            f_delivery_pool = delivery_pool::pointer_t();
+    std::atomic<delivery_pool *>        f_delivery_pool_ptr = nullptr;      // f_delivery_pool, read without locking by the signals
+    executor::pointer_t                 f_executor = executor::pointer_t();
+    cppthread::mutex                    f_drain_mutex = cppthread::mutex();
+    std::atomic<std::size_t>            f_epoch = 0;
+    std::atomic<std::size_t>            f_signals_in_flight[2] = {};
+    std::atomic<std::size_t>            f_draining = 0;
+    std::atomic<std::size_t>            f_tasks_in_flight = 0;
+    std::atomic<bool>                   f_frozen = false;
+    std::map<std::string, std::unique_ptr<plugin_handle<plugin>::slot_t>, std::less<>>
+                                        f_slots = std::map<std::string, std::unique_ptr<plugin_handle<plugin>::slot_t>, std::less<>>();
 };
 
 
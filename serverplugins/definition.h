@@ -29,9 +29,12 @@
 #include    <snapdev/not_used.h>
 
 
-// C++ set
+// C++
 //
+#include    <array>
+#include    <cstdint>
 #include    <set>
+#include    <string>
 
 
 
@@ -58,6 +61,7 @@ struct definition
     string_set_t                        f_conflicts = string_set_t();
     string_set_t                        f_suggestions = string_set_t();
     std::string                         f_settings_path = std::string();
+    string_set_t                        f_interests = string_set_t();
 };
 
 
@@ -248,6 +252,46 @@ public:
 };
 
 
+// a signal this plugin listens to, named by the plugin emitting it and
+// the name of the signal; when plugins are loaded lazily, emitting that
+// signal loads the plugin first
+//
+// the interest is saved as "<emitter>::<signal>" so two plugins emitting
+// a signal with the same name do not load each other's listeners
+//
+class interest
+{
+public:
+    typedef std::string     value_t;
+
+    template<int N, int M>
+    constexpr interest(char const (&emitter)[N], char const (&signal)[M])
+        : f_emitter(validate_name(emitter))
+        , f_signal(validate_name(signal))
+    {
+    }
+
+    constexpr char const * emitter() const
+    {
+        return f_emitter;
+    }
+
+    constexpr char const * signal() const
+    {
+        return f_signal;
+    }
+
+    value_t get() const
+    {
+        return std::string(f_emitter) + "::" + f_signal;
+    }
+
+private:
+    char const *            f_emitter = nullptr;
+    char const *            f_signal = nullptr;
+};
+
+
 class settings_path
     : public definition_value<char const *>
 {
@@ -340,6 +384,7 @@ constexpr definition define_plugin(ARGS ...args)
         .f_conflicts =              find_plugin_set<conflict>(args...),
         .f_suggestions =            find_plugin_set<suggestion>(args...),
         .f_settings_path =          find_plugin_information<settings_path>(args..., settings_path()),
+        .f_interests =              find_plugin_set<interest>(args...),
     };
 
     // TODO: add verifications to make sure parameters are consistent
@@ -348,6 +393,270 @@ constexpr definition define_plugin(ARGS ...args)
 }
 
 
+namespace detail
+{
+
+
+/** \brief The name of the ELF note holding the plugin definition.
+ *
+ * The SERVERPLUGINS_END() macro saves the plugin definition in an ELF
+ * note so the definition can be read without loading the plugin. This is
+ * the name of that note. The ELF section is named ".note.serverplugins".
+ *
+ * \sa read_definition_note()
+ */
+constexpr char const        DEFINITION_NOTE_NAME[] = "serverplugins";
+
+
+/** \brief The type of the ELF note holding the plugin definition.
+ *
+ * The note type is specific to the note name. At the moment we only have
+ * one type of note.
+ */
+constexpr std::uint32_t     DEFINITION_NOTE_TYPE = 1;
+
+
+/** \brief Write the ELF note of a plugin definition.
+ * \private
+ *
+ * This class is used at compile time to generate the ELF note saved in
+ * the plugin. When created with a null pointer, it only counts the
+ * number of bytes necessary to save the note.
+ *
+ * The description of the note is a list of "<field>=<value>" strings,
+ * each one terminated by a '\0'. Sets (such as the dependencies) repeat
+ * the same field once per value.
+ */
+class note_writer
+{
+public:
+    constexpr note_writer(char * buffer)
+        : f_buffer(buffer)
+    {
+    }
+
+    constexpr void put(char c)
+    {
+        if(f_buffer != nullptr)
+        {
+            f_buffer[f_size] = c;
+        }
+        ++f_size;
+    }
+
+    constexpr void put_string(char const * s)
+    {
+        while(*s != '\0')
+        {
+            put(*s);
+            ++s;
+        }
+    }
+
+    constexpr void put_number(std::int64_t n)
+    {
+        if(n < 0)
+        {
+            put('-');
+            n = -n;
+        }
+        char digits[20] = {};
+        int count(0);
+        do
+        {
+            digits[count] = static_cast<char>('0' + n % 10);
+            ++count;
+            n /= 10;
+        }
+        while(n != 0);
+        while(count > 0)
+        {
+            --count;
+            put(digits[count]);
+        }
+    }
+
+    constexpr void put_version(version_t const & v)
+    {
+        put_number(v.f_major);
+        put('.');
+        put_number(v.f_minor);
+        put('.');
+        put_number(v.f_patch);
+    }
+
+    constexpr void put_field(char const * field, char const * value)
+    {
+        put_string(field);
+        put('=');
+        put_string(value);
+        put('\0');
+    }
+
+    constexpr void put_uint32(std::uint32_t v)
+    {
+        // ELF notes use the byte order of the target
+        //
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        put(static_cast<char>(v & 0xFF));
+        put(static_cast<char>((v >> 8) & 0xFF));
+        put(static_cast<char>((v >> 16) & 0xFF));
+        put(static_cast<char>((v >> 24) & 0xFF));
+#else
+        put(static_cast<char>((v >> 24) & 0xFF));
+        put(static_cast<char>((v >> 16) & 0xFF));
+        put(static_cast<char>((v >> 8) & 0xFF));
+        put(static_cast<char>(v & 0xFF));
+#endif
+    }
+
+    constexpr void align()
+    {
+        while(f_size % 4 != 0)
+        {
+            put('\0');
+        }
+    }
+
+    constexpr std::size_t size() const
+    {
+        return f_size;
+    }
+
+private:
+    char *              f_buffer = nullptr;
+    std::size_t         f_size = 0;
+};
+
+
+constexpr void write_note_field(note_writer & w, plugin_version const & v)
+{
+    w.put_string("version=");
+    w.put_version(v.get());
+    w.put('\0');
+}
+
+
+constexpr void write_note_field(note_writer & w, library_version const & v)
+{
+    w.put_string("library_version=");
+    w.put_version(v.get());
+    w.put('\0');
+}
+
+
+constexpr void write_note_field(note_writer & w, last_modification const & v)
+{
+    w.put_string("last_modification=");
+    w.put_number(v.get());
+    w.put('\0');
+}
+
+
+constexpr void write_note_field(note_writer & w, plugin_name const & v)
+{
+    w.put_field("name", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, description const & v)
+{
+    w.put_field("description", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, help_uri const & v)
+{
+    w.put_field("help_uri", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, icon const & v)
+{
+    w.put_field("icon", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, categorization_tag const & v)
+{
+    w.put_field("categorization_tag", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, dependency const & v)
+{
+    w.put_field("dependency", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, conflict const & v)
+{
+    w.put_field("conflict", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, suggestion const & v)
+{
+    w.put_field("suggestion", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, settings_path const & v)
+{
+    w.put_field("settings_path", v.get());
+}
+
+
+constexpr void write_note_field(note_writer & w, interest const & v)
+{
+    w.put_string("interest=");
+    w.put_string(v.emitter());
+    w.put_string("::");
+    w.put_string(v.signal());
+    w.put('\0');
+}
+
+
+template<class ...ARGS>
+constexpr void write_note(note_writer & w, ARGS ...args)
+{
+    note_writer description(nullptr);
+    (write_note_field(description, args), ...);
+
+    w.put_uint32(sizeof(DEFINITION_NOTE_NAME));
+    w.put_uint32(static_cast<std::uint32_t>(description.size()));
+    w.put_uint32(DEFINITION_NOTE_TYPE);
+    w.put_string(DEFINITION_NOTE_NAME);
+    w.put('\0');
+    w.align();
+    (write_note_field(w, args), ...);
+    w.align();
+}
+
+
+template<class ...ARGS>
+constexpr std::size_t definition_note_size(ARGS ...args)
+{
+    note_writer w(nullptr);
+    write_note(w, args...);
+    return w.size();
+}
+
+
+template<std::size_t N, class ...ARGS>
+constexpr std::array<char, N> definition_note(ARGS ...args)
+{
+    std::array<char, N> note = {};
+    note_writer w(note.data());
+    write_note(w, args...);
+    return note;
+}
+
+
+} // namespace detail
+
+
+
 #define SERVERPLUGINS_VERSION(name, major, minor) \
     constexpr ::serverplugins::version_t::number_t g_##name##_version_major = major; \
     constexpr ::serverplugins::version_t::number_t g_##name##_version_minor = minor;
@@ -355,25 +664,61 @@ constexpr definition define_plugin(ARGS ...args)
 
 // helper macros to create a plugin definition structure
 //
+// the definition values are captured in a lambda so we can use them
+// twice: once to create the definition structure and once to create
+// the ELF note (see read_definition_note()); this means the values
+// must all be constant expressions
+//
 #define SERVERPLUGINS_START(name) \
-    ::serverplugins::definition const g_##name##_definition = ::serverplugins::define_plugin( \
+    constexpr auto g_##name##_definition_values = [](auto f) { return f( \
           ::serverplugins::plugin_version(::serverplugins::version_t(g_##name##_version_major, g_##name##_version_minor, 0)) \
         , ::serverplugins::library_version(::serverplugins::version_t(SERVERPLUGINS_VERSION_MAJOR, SERVERPLUGINS_VERSION_MINOR, SERVERPLUGINS_VERSION_PATCH)) \
         , ::serverplugins::last_modification(UTC_BUILD_TIME_STAMP) \
         , ::serverplugins::plugin_name(#name)
 
 
-#define SERVERPLUGINS_END(name) \
-    ); \
+#define SERVERPLUGINS_DEFINITION_END(name) \
+    ); }; \
+    ::serverplugins::definition const g_##name##_definition = g_##name##_definition_values( \
+            [](auto ...args) { return ::serverplugins::define_plugin(args...); }); \
+    constexpr std::size_t g_##name##_definition_note_size = g_##name##_definition_values( \
+            [](auto ...args) { return ::serverplugins::detail::definition_note_size(args...); }); \
+    __attribute__((section(".note.serverplugins"), used, aligned(4))) \
+    constexpr std::array<char, g_##name##_definition_note_size> g_##name##_definition_note = g_##name##_definition_values( \
+            [](auto ...args) { return ::serverplugins::detail::definition_note<g_##name##_definition_note_size>(args...); });
+
+
+#define SERVERPLUGINS_FACTORY(name) \
     class plugin_##name##_factory : public ::serverplugins::factory { \
     public: plugin_##name##_factory() \
         : factory(g_##name##_definition, std::make_shared<name>(*this)) \
         { register_plugin(#name, get_plugin()); } \
     plugin_##name##_factory(plugin_##name##_factory const &) = delete; \
     plugin_##name##_factory & operator = (plugin_##name##_factory const &) = delete; \
-    } g_##name##_factory; \
+    }
+
+
+// in static mode the plugin is linked in the executable; the factory
+// only gets created when the collection loads the plugin, until then
+// the plugin is only an entry in the table of static plugins
+//
+// see the ServerPluginsAddPlugin() function in ServerPluginsConfig.cmake
+//
+#ifdef SERVERPLUGINS_STATIC
+#define SERVERPLUGINS_END(name) \
+    SERVERPLUGINS_DEFINITION_END(name) \
+    SERVERPLUGINS_FACTORY(name); \
+    ::serverplugins::static_plugin const g_##name##_static_plugin( \
+            #name, g_##name##_definition, []() { static plugin_##name##_factory g_##name##_factory; }); \
+    name::name(::serverplugins::factory const & f) : plugin(f) {} \
+    name::~name() {}
+#else
+#define SERVERPLUGINS_END(name) \
+    SERVERPLUGINS_DEFINITION_END(name) \
+    SERVERPLUGINS_FACTORY(name) g_##name##_factory; \
     name::name(::serverplugins::factory const & f) : plugin(f) {} \
     name::~name() {}
+#endif
 
     //name::pointer_t name::instance() { return std::static_pointer_cast<name>(g_##name##_factory.instance()); }
 
@@ -392,7 +737,7 @@ constexpr definition define_plugin(ARGS ...args)
 
 
 #define SERVERPLUGINS_END_SERVER(name) \
-    ); \
+    SERVERPLUGINS_DEFINITION_END(name) \
     class server_##name##_factory : public ::serverplugins::factory { \
     public: server_##name##_factory() \
         : factory(g_##name##_definition, nullptr) {} \
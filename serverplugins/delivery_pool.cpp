@@ -0,0 +1,856 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Asynchronous delivery of signals.
+ *
+ * By default, a signal calls all of its listeners in the thread emitting
+ * the signal. A listener which takes time (i.e. it sends an email, saves
+ * a log to a database, etc.) adds that time to everything the emitter
+ * does.
+ *
+ * A listener connected with one of the SERVERPLUGINS_LISTEN_ASYNC()
+ * macros instead gets a delivery_queue. Emitting the signal copies the
+ * arguments in that queue and returns immediately. The threads of the
+ * delivery_pool then call the listener.
+ *
+ * Each queue is bounded. When a queue is full, its backpressure policy
+ * decides whether the emitter waits, the oldest call gets dropped, or
+ * the new call gets rejected. The queue counts each case.
+ */
+
+// self
+//
+#include    "serverplugins/delivery_pool.h"
+
+#include    "serverplugins/exception.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/log.h>
+#include    <cppthread/runner.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <exception>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+namespace detail
+{
+
+
+
+/** \brief A function being called in parallel.
+ *
+ * This object lives on the stack of the thread calling
+ * delivery_pool::fan_out(). That thread does not return before
+ * f_done reaches f_count and the indexes are claimed with the mutex
+ * locked, so the other threads never access it after that.
+ */
+struct fanout_t
+{
+    std::size_t                     f_count = 0;
+    std::size_t                     f_next = 0;                 // next index to claim
+    std::size_t                     f_done = 0;
+    void const *                    f_context = nullptr;
+    void                            (*f_call)(void const *, std::size_t) = nullptr;
+    std::size_t                     f_error_index = 0;
+    std::exception_ptr              f_error = std::exception_ptr();
+};
+
+
+/** \brief The state shared by a delivery pool and its queues.
+ *
+ * The queues and the threads of the pool keep a reference to this
+ * state, not to the pool itself. This way the pool gets destroyed by
+ * its owner, which stops its threads, and a queue or a thread releasing
+ * the last reference to the state never has to join a thread.
+ *
+ * The f_mutex protects the list of ready queues and the parallel calls.
+ * Each queue protects its calls and counters with its own mutex so
+ * emitters pushing to different queues do not wait on each other. When
+ * both are needed, the mutex of the queue gets locked first.
+ */
+class delivery_state
+{
+public:
+    bool                            is_worker() const;
+    void                            flush();
+    bool                            run_next();
+    bool                            claim(fanout_t & job, std::size_t & idx);
+    void                            execute(fanout_t & job, std::size_t idx);
+
+    mutable cppthread::mutex        f_mutex = cppthread::mutex();
+    std::deque<delivery_queue::pointer_t>
+                                    f_ready = std::deque<delivery_queue::pointer_t>();
+    std::deque<fanout_t *>          f_fanouts = std::deque<fanout_t *>();
+    std::atomic<std::size_t>        f_pending = 0;              // queued + running tasks
+    std::size_t                     f_idle = 0;                 // threads waiting for a task
+    std::size_t                     f_waiters = 0;              // threads in flush() or fan_out()
+    std::atomic<bool>               f_stopping = false;
+};
+
+
+
+} // namespace detail
+
+
+
+namespace
+{
+
+
+
+/** \brief The pool the current thread works for.
+ *
+ * This is set in the threads of a delivery pool. A listener running in
+ * one of those threads must not wait on that same pool since the pool
+ * may need that very thread to make progress.
+ */
+thread_local detail::delivery_state const * g_current_state = nullptr;
+
+
+
+/** \brief The runner of the delivery pool threads.
+ *
+ * Each thread of the pool runs the next listener which has calls
+ * waiting until the pool gets stopped.
+ */
+class worker
+    : public cppthread::runner
+{
+public:
+                            worker(std::shared_ptr<detail::delivery_state> state);
+                            worker(worker const &) = delete;
+    worker &                operator = (worker const &) = delete;
+
+    virtual void            enter() override;
+    virtual void            run() override;
+
+private:
+    std::shared_ptr<detail::delivery_state>
+                            f_state = std::shared_ptr<detail::delivery_state>();
+};
+
+
+worker::worker(std::shared_ptr<detail::delivery_state> state)
+    : runner("plugin_delivery")
+    , f_state(state)
+{
+}
+
+
+void worker::enter()
+{
+    g_current_state = f_state.get();
+}
+
+
+void worker::run()
+{
+    while(f_state->run_next())
+    {
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Check whether the current thread is one of ours.
+ *
+ * \return true if the calling thread is a thread of this pool.
+ */
+bool delivery_state::is_worker() const
+{
+    return g_current_state == this;
+}
+
+
+/** \brief Wait until no call is pending.
+ *
+ * \exception logic_error
+ * This function cannot be called from a thread of the pool.
+ */
+void delivery_state::flush()
+{
+    if(is_worker())
+    {
+        throw logic_error("a delivery pool cannot be flushed from one of its own threads.");
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    ++f_waiters;
+    while(f_pending != 0)
+    {
+        f_mutex.wait();
+    }
+    --f_waiters;
+}
+
+
+/** \brief Claim the next index of a parallel call.
+ *
+ * The f_mutex must be locked by the caller. Once the last index was
+ * claimed, the job gets removed from the list of parallel calls.
+ *
+ * \param[in,out] job  The parallel call.
+ * \param[out] idx  The claimed index.
+ *
+ * \return false if all the indexes were already claimed.
+ */
+bool delivery_state::claim(fanout_t & job, std::size_t & idx)
+{
+    if(job.f_next >= job.f_count)
+    {
+        return false;
+    }
+
+    idx = job.f_next;
+    ++job.f_next;
+    if(job.f_next == job.f_count)
+    {
+        auto it(std::find(f_fanouts.begin(), f_fanouts.end(), &job));
+        if(it != f_fanouts.end())
+        {
+            f_fanouts.erase(it);
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Run one call of a parallel call.
+ *
+ * The exception with the smallest index is kept so the same exception
+ * is rethrown whatever the timing of the threads. The others are
+ * logged.
+ *
+ * \param[in,out] job  The parallel call.
+ * \param[in] idx  The index to call the function with.
+ */
+void delivery_state::execute(fanout_t & job, std::size_t idx)
+{
+    std::exception_ptr error;
+    try
+    {
+        job.f_call(job.f_context, idx);
+    }
+    catch(...)
+    {
+        error = std::current_exception();
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    if(error != nullptr)
+    {
+        if(job.f_error == nullptr
+        || idx < job.f_error_index)
+        {
+            std::swap(error, job.f_error);
+            job.f_error_index = idx;
+        }
+        if(error != nullptr)
+        {
+            cppthread::log << cppthread::log_level_t::error
+                << "a parallel listener raised an exception which was superseded by the exception of a listener with a higher priority."
+                << cppthread::end;
+        }
+    }
+
+    ++job.f_done;
+    if(job.f_done == job.f_count
+    && f_waiters != 0)
+    {
+        f_mutex.broadcast();
+    }
+}
+
+
+/** \brief Run the next call.
+ *
+ * The parallel calls are served first since their emitter is waiting
+ * for them. Otherwise this function waits for a queue with calls, runs
+ * its first call, and puts the queue back at the end of the ready list
+ * if it has more calls. This way each queue gets one thread at most,
+ * which keeps its calls in order, and a busy listener does not starve
+ * the others.
+ *
+ * An exception raised by a listener is logged and counted. It does not
+ * stop the pool.
+ *
+ * \return false once the pool is stopping and no work is left.
+ */
+bool delivery_state::run_next()
+{
+    delivery_queue::pointer_t queue;
+    delivery_queue::task_t task;
+    {
+        cppthread::guard lock(f_mutex);
+
+        while(f_ready.empty()
+           && f_fanouts.empty())
+        {
+            if(f_stopping)
+            {
+                return false;
+            }
+            ++f_idle;
+            f_mutex.wait();
+            --f_idle;
+        }
+
+        if(!f_fanouts.empty())
+        {
+            fanout_t * job(f_fanouts.front());
+            std::size_t idx(0);
+            claim(*job, idx);
+            lock.unlock();
+
+            execute(*job, idx);
+            return true;
+        }
+
+        queue = f_ready.front();
+        f_ready.pop_front();
+    }
+
+    {
+        cppthread::guard lock(queue->f_mutex);
+
+        task = std::move(queue->f_tasks.front());
+        queue->f_tasks.pop_front();
+
+        // the emitter may be waiting for room in this queue
+        //
+        if(queue->f_waiters != 0)
+        {
+            queue->f_mutex.broadcast();
+        }
+    }
+
+    bool failed(false);
+    try
+    {
+        task();
+    }
+    catch(std::exception const & e)
+    {
+        failed = true;
+        cppthread::log << cppthread::log_level_t::error
+            << "an asynchronous listener raised an exception: "
+            << e.what()
+            << cppthread::end;
+    }
+    catch(...)
+    {
+        failed = true;
+        cppthread::log << cppthread::log_level_t::error
+            << "an asynchronous listener raised an unknown exception."
+            << cppthread::end;
+    }
+
+    // release the copies of the arguments before locking
+    //
+    task = delivery_queue::task_t();
+
+    bool more(false);
+    {
+        cppthread::guard lock(queue->f_mutex);
+
+        if(failed)
+        {
+            ++queue->f_counters.f_failed;
+        }
+        else
+        {
+            ++queue->f_counters.f_delivered;
+        }
+
+        if(queue->f_tasks.empty())
+        {
+            queue->f_scheduled = false;
+            if(queue->f_waiters != 0)
+            {
+                queue->f_mutex.broadcast();
+            }
+        }
+        else
+        {
+            // still scheduled, push() does not add it to the ready list
+            //
+            more = true;
+        }
+    }
+
+    std::size_t const left(f_pending.fetch_sub(1) - 1);
+    if(more || left == 0)
+    {
+        cppthread::guard lock(f_mutex);
+
+        if(more)
+        {
+            f_ready.push_back(queue);
+        }
+
+        if(left == 0
+        && f_waiters != 0)
+        {
+            f_mutex.broadcast();
+        }
+    }
+
+    return true;
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Initialize a delivery queue.
+ *
+ * Queues are created by delivery_pool::create_queue().
+ *
+ * \param[in] state  The state of the pool running the calls of this queue.
+ * \param[in] capacity  The maximum number of calls in the queue.
+ * \param[in] backpressure  What to do when the queue is full.
+ */
+delivery_queue::delivery_queue(
+          std::shared_ptr<detail::delivery_state> state
+        , std::size_t capacity
+        , backpressure_t backpressure)
+    : f_state(state)
+    , f_capacity(std::max(capacity, static_cast<std::size_t>(1)))
+    , f_backpressure(backpressure)
+{
+}
+
+
+/** \brief Get the maximum number of calls this queue accepts.
+ *
+ * \return The capacity of the queue.
+ */
+std::size_t delivery_queue::get_capacity() const
+{
+    return f_capacity;
+}
+
+
+/** \brief Get the policy used when the queue is full.
+ *
+ * \return The backpressure policy of the queue.
+ */
+backpressure_t delivery_queue::get_backpressure() const
+{
+    return f_backpressure;
+}
+
+
+/** \brief Get the number of calls waiting in this queue.
+ *
+ * The call currently running, if any, is not included.
+ *
+ * \return The number of calls in the queue.
+ */
+std::size_t delivery_queue::size() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_tasks.size();
+}
+
+
+/** \brief Get the counters of this queue.
+ *
+ * The counters tell how many calls were delivered, how many threw an
+ * exception, and how many times the backpressure policy was applied
+ * (blocked, dropped, rejected).
+ *
+ * \return A copy of the counters.
+ */
+delivery_queue::counters_t delivery_queue::get_counters() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_counters;
+}
+
+
+/** \brief Add a call to the queue.
+ *
+ * If the queue is full, the backpressure policy is applied:
+ *
+ * \li BACKPRESSURE_BLOCK -- wait until one of the calls is done; a
+ *     thread of the pool itself never waits since that could dead lock
+ *     the pool, the call gets added over capacity instead;
+ * \li BACKPRESSURE_DROP_OLDEST -- the oldest call in the queue is
+ *     discarded and the new call gets added;
+ * \li BACKPRESSURE_REJECT -- the new call is discarded.
+ *
+ * A call pushed once the pool was stopped is rejected.
+ *
+ * Only the mutex of this queue gets locked, unless the queue has to be
+ * added to the list of ready queues of the pool.
+ *
+ * \param[in] task  The call to add.
+ *
+ * \return true if the call was added to the queue.
+ */
+bool delivery_queue::push(task_t && task)
+{
+    detail::delivery_state & state(*f_state);
+    cppthread::guard lock(f_mutex);
+
+    bool replaced(false);
+    if(!state.f_stopping.load()
+    && f_tasks.size() >= f_capacity)
+    {
+        switch(f_backpressure)
+        {
+        case backpressure_t::BACKPRESSURE_BLOCK:
+            if(!state.is_worker())
+            {
+                // the threads of the pool keep running the calls of the
+                // queues in the ready list, even while stopping, so the
+                // queue always gets room
+                //
+                ++f_counters.f_blocked;
+                ++f_waiters;
+                while(f_tasks.size() >= f_capacity)
+                {
+                    f_mutex.wait();
+                }
+                --f_waiters;
+            }
+            break;
+
+        case backpressure_t::BACKPRESSURE_DROP_OLDEST:
+            // the queue is full so it is scheduled and the new call
+            // takes the place of the dropped one in f_pending
+            //
+            f_tasks.pop_front();
+            ++f_counters.f_dropped;
+            replaced = true;
+            break;
+
+        case backpressure_t::BACKPRESSURE_REJECT:
+            ++f_counters.f_rejected;
+            return false;
+
+        }
+    }
+
+    if(state.f_stopping.load()
+    && !replaced)
+    {
+        ++f_counters.f_rejected;
+        return false;
+    }
+
+    if(f_scheduled)
+    {
+        f_tasks.push_back(std::move(task));
+        if(!replaced)
+        {
+            ++state.f_pending;
+        }
+        return true;
+    }
+
+    // the threads of the pool exit once stopping and the ready list is
+    // empty; check again with the mutex of the pool locked
+    //
+    cppthread::guard state_lock(state.f_mutex);
+
+    if(state.f_stopping.load())
+    {
+        ++f_counters.f_rejected;
+        return false;
+    }
+
+    f_tasks.push_back(std::move(task));
+    ++state.f_pending;
+    f_scheduled = true;
+    state.f_ready.push_back(shared_from_this());
+    if(state.f_idle != 0)
+    {
+        state.f_mutex.broadcast();
+    }
+
+    return true;
+}
+
+
+/** \brief Wait until all the calls in this queue were delivered.
+ *
+ * This function blocks until the queue is empty and its last call
+ * returned.
+ *
+ * \exception logic_error
+ * This function cannot be called from a thread of the pool.
+ */
+void delivery_queue::flush()
+{
+    detail::delivery_state & state(*f_state);
+    if(state.is_worker())
+    {
+        throw logic_error("a delivery queue cannot be flushed from one of the threads of its pool.");
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    ++f_waiters;
+    while(f_scheduled)
+    {
+        f_mutex.wait();
+    }
+    --f_waiters;
+}
+
+
+
+/** \brief Create a delivery pool.
+ *
+ * The pool starts \p workers threads which call the asynchronous
+ * listeners. At least one thread is created.
+ *
+ * Calls of one listener are always made one after the other, in the
+ * order in which the signal was emitted. Calls of different listeners
+ * can run in parallel.
+ *
+ * \param[in] workers  The number of threads to start.
+ */
+delivery_pool::delivery_pool(std::size_t workers)
+    : f_state(std::make_shared<detail::delivery_state>())
+{
+    workers = std::max(workers, static_cast<std::size_t>(1));
+    for(std::size_t idx(0); idx < workers; ++idx)
+    {
+        f_workers.push_back(std::make_shared<worker>(f_state));
+        f_threads.push_back(std::make_shared<cppthread::thread>("plugin_delivery", f_workers.back().get()));
+        f_threads.back()->start();
+    }
+}
+
+
+/** \brief Stop the pool.
+ *
+ * The calls still in the queues get delivered first (see stop()).
+ */
+delivery_pool::~delivery_pool()
+{
+    try
+    {
+        stop();
+    }
+    catch(...)                                                  // LCOV_EXCL_LINE
+    {
+    }
+}
+
+
+/** \brief Get the number of threads of this pool.
+ *
+ * \return The number of worker threads.
+ */
+std::size_t delivery_pool::get_workers() const
+{
+    return f_workers.size();
+}
+
+
+/** \brief Create a queue for one listener.
+ *
+ * \param[in] capacity  The maximum number of calls waiting in the queue.
+ * \param[in] backpressure  What to do when the queue is full.
+ *
+ * \return The new queue.
+ */
+delivery_queue::pointer_t delivery_pool::create_queue(
+      std::size_t capacity
+    , backpressure_t backpressure)
+{
+    return delivery_queue::pointer_t(new delivery_queue(f_state, capacity, backpressure));
+}
+
+
+/** \brief Get the number of calls not yet delivered.
+ *
+ * This includes the calls waiting in a queue and the calls running.
+ *
+ * \return The number of pending calls.
+ */
+std::size_t delivery_pool::pending() const
+{
+    return f_state->f_pending.load();
+}
+
+
+/** \brief Wait until all the calls were delivered.
+ *
+ * This function blocks until all the queues of the pool are empty and
+ * no listener is running. Calls pushed while waiting are waited on too.
+ *
+ * The collection calls this function before unloading a plugin so no
+ * call to that plugin is left in a queue.
+ *
+ * \exception logic_error
+ * This function cannot be called from a thread of the pool.
+ */
+void delivery_pool::flush()
+{
+    f_state->flush();
+}
+
+
+/** \brief Check whether the current thread is one of this pool.
+ *
+ * \return true if the calling thread is a thread of this pool.
+ */
+bool delivery_pool::is_worker() const
+{
+    return f_state->is_worker();
+}
+
+
+/** \brief Call a function in parallel.
+ *
+ * This is the implementation of the fan_out() template.
+ *
+ * \param[in] count  The number of calls.
+ * \param[in] context  The function object.
+ * \param[in] call  The function calling the function object.
+ */
+void delivery_pool::fan_out(
+      std::size_t count
+    , void const * context
+    , void (*call)(void const *, std::size_t))
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    detail::fanout_t job;
+    job.f_count = count;
+    job.f_context = context;
+    job.f_call = call;
+
+    detail::delivery_state & state(*f_state);
+    {
+        cppthread::guard lock(state.f_mutex);
+        state.f_fanouts.push_back(&job);
+        if(state.f_idle != 0)
+        {
+            state.f_mutex.broadcast();
+        }
+    }
+
+    // this thread does its share instead of waiting
+    //
+    for(;;)
+    {
+        std::size_t idx(0);
+        {
+            cppthread::guard lock(state.f_mutex);
+            if(!state.claim(job, idx))
+            {
+                break;
+            }
+        }
+        state.execute(job, idx);
+    }
+
+    {
+        cppthread::guard lock(state.f_mutex);
+        ++state.f_waiters;
+        while(job.f_done != job.f_count)
+        {
+            state.f_mutex.wait();
+        }
+        --state.f_waiters;
+    }
+
+    if(job.f_error != nullptr)
+    {
+        std::rethrow_exception(job.f_error);
+    }
+}
+
+
+/** \brief Deliver the pending calls and stop the threads.
+ *
+ * This function flushes the pool and then stops its threads. Calls
+ * pushed after this function was called are rejected.
+ *
+ * Calling stop() more than once has no effect.
+ *
+ * \exception logic_error
+ * This function cannot be called from a thread of the pool.
+ */
+void delivery_pool::stop()
+{
+    if(f_threads.empty())
+    {
+        return;
+    }
+
+    f_state->flush();
+
+    {
+        cppthread::guard lock(f_state->f_mutex);
+        f_state->f_stopping = true;
+        f_state->f_mutex.broadcast();
+    }
+
+    for(auto & t : f_threads)
+    {
+        t->stop();
+    }
+    f_threads.clear();
+    f_workers.clear();
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,260 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/typed_signal.h>
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <deque>
+#include    <functional>
+#include    <memory>
+#include    <tuple>
+#include    <type_traits>
+#include    <vector>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace detail
+{
+class delivery_state;
+} // namespace detail
+
+
+enum class backpressure_t
+{
+    BACKPRESSURE_BLOCK,             // wait until the queue has room
+    BACKPRESSURE_DROP_OLDEST,       // discard the oldest call in the queue
+    BACKPRESSURE_REJECT,            // discard the new call
+};
+
+
+constexpr std::size_t const         DEFAULT_DELIVERY_QUEUE_CAPACITY = 1000;
+
+
+class delivery_queue
+    : public std::enable_shared_from_this<delivery_queue>
+{
+public:
+    typedef std::shared_ptr<delivery_queue>     pointer_t;
+    typedef std::function<void()>               task_t;
+
+    struct counters_t
+    {
+        std::size_t                 f_delivered = 0;
+        std::size_t                 f_failed = 0;
+        std::size_t                 f_blocked = 0;
+        std::size_t                 f_dropped = 0;
+        std::size_t                 f_rejected = 0;
+    };
+
+                                    delivery_queue(delivery_queue const &) = delete;
+    delivery_queue &                operator = (delivery_queue const &) = delete;
+
+    std::size_t                     get_capacity() const;
+    backpressure_t                  get_backpressure() const;
+    std::size_t                     size() const;
+    counters_t                      get_counters() const;
+    bool                            push(task_t && task);
+    void                            flush();
+
+private:
+    friend class delivery_pool;
+    friend class detail::delivery_state;
+
+                                    delivery_queue(
+                                          std::shared_ptr<detail::delivery_state> state
+                                        , std::size_t capacity
+                                        , backpressure_t backpressure);
+
+    std::shared_ptr<detail::delivery_state>
+                                    f_state = std::shared_ptr<detail::delivery_state>();
+    std::size_t const               f_capacity = DEFAULT_DELIVERY_QUEUE_CAPACITY;
+    backpressure_t const            f_backpressure = backpressure_t::BACKPRESSURE_BLOCK;
+    mutable cppthread::mutex        f_mutex = cppthread::mutex();
+    std::deque<task_t>              f_tasks = std::deque<task_t>();
+    bool                            f_scheduled = false;        // in the ready list or running
+    std::size_t                     f_waiters = 0;              // threads in push() or flush()
+    counters_t                      f_counters = counters_t();
+};
+
+
+class delivery_pool
+{
+public:
+    typedef std::shared_ptr<delivery_pool>      pointer_t;
+
+                                    delivery_pool(std::size_t workers);
+                                    delivery_pool(delivery_pool const &) = delete;
+                                    ~delivery_pool();
+    delivery_pool &                 operator = (delivery_pool const &) = delete;
+
+    std::size_t                     get_workers() const;
+    delivery_queue::pointer_t       create_queue(
+                                          std::size_t capacity = DEFAULT_DELIVERY_QUEUE_CAPACITY
+                                        , backpressure_t backpressure = backpressure_t::BACKPRESSURE_BLOCK);
+    std::size_t                     pending() const;
+    void                            flush();
+    void                            stop();
+    bool                            is_worker() const;
+
+    /** \brief Call a function \p count times in parallel.
+     *
+     * This function calls \p f with each index from 0 to \p count - 1.
+     * The calls run in the threads of the pool and in the calling thread,
+     * which takes the indexes not yet picked up by the pool instead of
+     * just waiting. The function returns once all the calls returned.
+     *
+     * If some of the calls throw, the exception of the call with the
+     * smallest index is rethrown once all the calls are done. The other
+     * exceptions are logged.
+     *
+     * \tparam F  The type of the function, called as `f(index)`.
+     * \param[in] count  The number of calls.
+     * \param[in] f  The function to call.
+     */
+    template<typename F>
+    void                            fan_out(std::size_t count, F const & f)
+                                    {
+                                        fan_out(
+                                              count
+                                            , &f
+                                            , [](void const * context, std::size_t idx)
+                                              {
+                                                  (*static_cast<F const *>(context))(idx);
+                                              });
+                                    }
+
+private:
+    void                            fan_out(
+                                          std::size_t count
+                                        , void const * context
+                                        , void (*call)(void const *, std::size_t));
+
+    std::shared_ptr<detail::delivery_state>
+                                    f_state = std::shared_ptr<detail::delivery_state>();
+    cppthread::runner::vector_t     f_workers = cppthread::runner::vector_t();
+    cppthread::thread::vector_t     f_threads = cppthread::thread::vector_t();
+};
+
+
+namespace detail
+{
+
+
+/** \brief A listener running on a delivery pool.
+ *
+ * The signal calls this object as any other listener. It copies the
+ * arguments and pushes a call to the actual listener in its queue.
+ * The call happens later, in one of the threads of the delivery pool.
+ *
+ * Since the listener runs after the signal returned, it cannot return
+ * anything through a reference.
+ */
+template<typename ... Args>
+class async_listener
+{
+public:
+    static_assert(((!std::is_lvalue_reference_v<Args>
+                        || std::is_const_v<std::remove_reference_t<Args>>) && ...)
+                , "a listener of a signal with a non-const reference parameter cannot be asynchronous");
+
+    async_listener(delegate<Args...> const & d, delivery_queue::pointer_t queue)
+        : f_delegate(d)
+        , f_queue(queue)
+    {
+    }
+
+    void operator () (signal_argument_t<Args>... args) const
+    {
+        f_queue->push([d = f_delegate, values = std::make_tuple(std::decay_t<Args>(args)...)]()
+            {
+                std::apply(d, values);
+            });
+    }
+
+private:
+    delegate<Args...>               f_delegate;
+    delivery_queue::pointer_t       f_queue;
+};
+
+
+template<typename ... Args>
+delegate<Args...> make_async_delegate(
+      delegate<Args...> const & d
+    , delivery_queue::pointer_t queue)
+{
+    return async_listener<Args...>(d, queue);
+}
+
+
+} // namespace detail
+
+
+
+/** \brief Make a listener asynchronous.
+ *
+ * This function transforms a listener in a delegate which pushes the
+ * calls to a queue of the \p pool instead of running the listener
+ * immediately. The queue is specific to this listener, so one slow
+ * listener does not delay the others, and the listener gets called in
+ * the same order as the signal was emitted.
+ *
+ * This is what the SERVERPLUGINS_LISTEN_ASYNC() macros use.
+ *
+ * \tparam S  The type of the signal.
+ * \tparam L  The type of the listener (see listener()).
+ * \param[in] pool  The pool running the listener.
+ * \param[in] capacity  The maximum number of calls waiting in the queue.
+ * \param[in] backpressure  What to do when the queue is full.
+ * \param[in] l  The listener.
+ *
+ * \return The delegate to add to the signal.
+ */
+template<typename S, typename L>
+typename S::delegate_t asynchronous(
+      delivery_pool::pointer_t pool
+    , std::size_t capacity
+    , backpressure_t backpressure
+    , L const & l)
+{
+    return detail::make_async_delegate(
+                  typename S::delegate_t(l)
+                , pool->create_queue(capacity, backpressure));
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
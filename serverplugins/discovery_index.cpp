@@ -0,0 +1,574 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Persistent index of the plugins found on disk.
+ *
+ * The names::find_plugins() function searches the plugin paths for
+ * all the available plugins. On network or overlay filesystems, the
+ * many glob() and stat() calls it requires are slow. The discovery
+ * index saves the result to a file so the next search only has to
+ * check the modification time of the directories.
+ */
+
+// self
+//
+#include    "serverplugins/discovery_index.h"
+
+#include    "serverplugins/note.h"
+
+
+// snapdev
+//
+#include    <snapdev/pathinfo.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <fstream>
+#include    <sstream>
+
+
+// C
+//
+#include    <dirent.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The magic string found on the first line of the index.
+ *
+ * The index file is a text file. Its first line must match this string.
+ * The number at the end is the version of the format.
+ */
+constexpr char const * const    g_index_magic = "serverplugins-discovery-index 1";
+
+
+bool operator == (timespec const & lhs, timespec const & rhs)
+{
+    return lhs.tv_sec == rhs.tv_sec
+        && lhs.tv_nsec == rhs.tv_nsec;
+}
+
+
+bool ends_with_so(std::string const & filename)
+{
+    return filename.length() > 3
+        && filename.compare(filename.length() - 3, 3, ".so") == 0;
+}
+
+
+discovery_index::file_t const * find_file(
+          discovery_index::file_vector_t const & files
+        , names::filename_t const & filename)
+{
+    auto const it(std::lower_bound(
+              files.begin()
+            , files.end()
+            , filename
+            , [](discovery_index::file_t const & lhs, names::filename_t const & rhs)
+            {
+                return lhs.f_filename < rhs;
+            }));
+    if(it == files.end()
+    || it->f_filename != filename)
+    {
+        return nullptr;
+    }
+    return &*it;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class discovery_index
+ * \brief A persistent index of the plugins available on disk.
+ *
+ * This class keeps a list of the directories searched for plugins and
+ * the plugin files found in each one of them. For each file, the index
+ * saves the inode, size, and modification time as well as the digest of
+ * its definition note (see read_definition_note()).
+ *
+ * The index is validated using the modification time of the directories.
+ * Adding, removing, or renaming a file in a directory changes its
+ * modification time, so a directory with the same modification time
+ * still has the same list of files. Only directories that changed get
+ * read again.
+ *
+ * The names::find_plugins() function uses this index when a filename
+ * was defined with names::set_index_filename().
+ *
+ * \note
+ * A plugin overwritten in place (opposed to being replaced with a new
+ * file) does not change the directory modification time. Install your
+ * plugins with a rename, as package managers do, to make sure the index
+ * sees the change.
+ */
+
+
+
+/** \brief Load the index from a file.
+ *
+ * This function loads the index from the specified file. If the file
+ * does not exist or is not a valid index, the function returns false
+ * and the index is left empty. The next refresh() will then read all
+ * the directories.
+ *
+ * \param[in] filename  The name of the index file.
+ *
+ * \return true if the index was loaded.
+ */
+bool discovery_index::load(std::string const & filename)
+{
+    f_directories.clear();
+    f_saved = timespec();
+
+    std::ifstream in(filename);
+    if(!in.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    if(!std::getline(in, line)
+    || line != g_index_magic)
+    {
+        return false;
+    }
+
+    directory_map_t directories;
+    directory_t * dir(nullptr);
+    while(std::getline(in, line))
+    {
+        std::istringstream ss(line);
+        std::string type;
+        ss >> type;
+        if(type == "saved")
+        {
+            ss >> f_saved.tv_sec >> f_saved.tv_nsec;
+        }
+        else if(type == "dir")
+        {
+            timespec mtime = {};
+            ss >> mtime.tv_sec >> mtime.tv_nsec;
+            ss.get();
+            std::string path;
+            std::getline(ss, path);
+            if(path.empty())
+            {
+                return false;
+            }
+            dir = &directories[path];
+            dir->f_mtime = mtime;
+        }
+        else if(type == "subdir" && dir != nullptr)
+        {
+            ss.get();
+            std::string path;
+            std::getline(ss, path);
+            dir->f_subdirectories.push_back(path);
+        }
+        else if(type == "file" && dir != nullptr)
+        {
+            file_t file;
+            ss >> file.f_inode
+               >> file.f_size
+               >> file.f_mtime.tv_sec
+               >> file.f_mtime.tv_nsec
+               >> std::hex >> file.f_digest >> std::dec;
+            ss.get();
+            std::getline(ss, file.f_filename);
+            dir->f_files.push_back(file);
+        }
+        else
+        {
+            return false;
+        }
+        if(ss.fail())
+        {
+            return false;
+        }
+    }
+
+    f_directories.swap(directories);
+    return true;
+}
+
+
+/** \brief Save the index to a file.
+ *
+ * This function saves the index to the specified file. The data is first
+ * written to a temporary file which then gets renamed so a concurrent
+ * reader never sees a partial index.
+ *
+ * \param[in] filename  The name of the index file.
+ *
+ * \return true if the index was saved.
+ */
+bool discovery_index::save(std::string const & filename) const
+{
+    std::string const tmp(filename + ".tmp" + std::to_string(getpid()));
+    {
+        std::ofstream out(tmp);
+        if(!out.is_open())
+        {
+            return false;
+        }
+
+        timespec now = {};
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        out << g_index_magic << '\n'
+            << "saved " << now.tv_sec << ' ' << now.tv_nsec << '\n';
+        for(auto const & d : f_directories)
+        {
+            out << "dir "
+                << d.second.f_mtime.tv_sec << ' '
+                << d.second.f_mtime.tv_nsec << ' '
+                << d.first << '\n';
+            for(auto const & s : d.second.f_subdirectories)
+            {
+                out << "subdir " << s << '\n';
+            }
+            for(auto const & f : d.second.f_files)
+            {
+                out << "file "
+                    << f.f_inode << ' '
+                    << f.f_size << ' '
+                    << f.f_mtime.tv_sec << ' '
+                    << f.f_mtime.tv_nsec << ' '
+                    << std::hex << f.f_digest << std::dec << ' '
+                    << f.f_filename << '\n';
+            }
+        }
+        if(!out)
+        {
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Bring the index up to date.
+ *
+ * This function checks each one of the paths in \p p and their
+ * sub-directories. Directories with a modification time different from
+ * the one saved in the index are read again. The others are kept as is.
+ *
+ * Directories that are not part of \p p anymore are removed from the
+ * index.
+ *
+ * \param[in] p  The list of paths to search for plugins.
+ *
+ * \return true if the index changed and should be saved.
+ */
+bool discovery_index::refresh(paths const & p)
+{
+    f_rescanned = 0;
+    f_read_definitions = 0;
+
+    directory_map_t updated;
+    std::size_t const max(p.size());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        refresh_directory(p.at(idx), true, updated);
+    }
+
+    bool const changed(f_rescanned != 0 || updated.size() != f_directories.size());
+    f_directories.swap(updated);
+    return changed;
+}
+
+
+/** \brief Check whether a directory in the index is still current.
+ *
+ * A directory is current if its modification time did not change.
+ *
+ * However, a directory modified during the same second as the index was
+ * saved cannot be trusted: a file may have been added right after we
+ * read the directory without a visible change of its modification time.
+ * Such directories are always read again.
+ *
+ * \param[in] dir  The directory as found in the index.
+ * \param[in] mtime  The current modification time of the directory.
+ *
+ * \return true if the directory does not need to be read again.
+ */
+bool discovery_index::is_current(directory_t const & dir, timespec const & mtime) const
+{
+    return dir.f_mtime == mtime
+        && mtime.tv_sec < f_saved.tv_sec;
+}
+
+
+/** \brief Refresh one directory.
+ *
+ * If the directory did not change, its entry is copied as is to the
+ * \p updated map. Otherwise the directory is read again: the plugin files
+ * (`*.so`) are saved along their identity and definition digest and,
+ * for a top level directory, the list of sub-directories is saved too.
+ *
+ * A file which was already in the index with the same identity (inode,
+ * size, and modification time) keeps its digest. Only new or modified
+ * files get their definition note read again.
+ *
+ * The sub-directories of a top level directory are then refreshed
+ * separately (a change in a sub-directory does not change the
+ * modification time of its parent).
+ *
+ * \param[in] path  The path to the directory.
+ * \param[in] top_level  Whether this is one of the search paths.
+ * \param[in,out] updated  The new map of directories.
+ */
+void discovery_index::refresh_directory(
+          std::string const & path
+        , bool top_level
+        , directory_map_t & updated)
+{
+    struct stat st = {};
+    if(stat(path.c_str(), &st) != 0
+    || !S_ISDIR(st.st_mode))
+    {
+        return;
+    }
+
+    auto const existing(f_directories.find(path));
+    if(existing != f_directories.end()
+    && is_current(existing->second, st.st_mtim))
+    {
+        updated[path] = existing->second;
+    }
+    else
+    {
+        ++f_rescanned;
+
+        directory_t dir;
+        dir.f_mtime = st.st_mtim;
+
+        DIR * d(opendir(path.c_str()));
+        if(d != nullptr)
+        {
+            for(;;)
+            {
+                struct dirent * e(readdir(d));
+                if(e == nullptr)
+                {
+                    break;
+                }
+                std::string const name(e->d_name);
+                if(name == "."
+                || name == ".."
+                || name.find('\n') != std::string::npos)
+                {
+                    continue;
+                }
+
+                std::string const filename(path + '/' + name);
+                struct stat fst = {};
+                if(stat(filename.c_str(), &fst) != 0)
+                {
+                    continue;
+                }
+                if(S_ISDIR(fst.st_mode))
+                {
+                    if(top_level)
+                    {
+                        dir.f_subdirectories.push_back(filename);
+                    }
+                }
+                else if(S_ISREG(fst.st_mode)
+                     && ends_with_so(name)
+                     && access(filename.c_str(), R_OK) == 0)
+                {
+                    file_t file;
+                    file.f_filename = filename;
+                    file.f_inode = fst.st_ino;
+                    file.f_size = fst.st_size;
+                    file.f_mtime = fst.st_mtim;
+                    file_t const * const previous(existing == f_directories.end()
+                                ? nullptr
+                                : find_file(existing->second.f_files, filename));
+                    if(previous != nullptr
+                    && previous->f_inode == file.f_inode
+                    && previous->f_size == file.f_size
+                    && previous->f_mtime == file.f_mtime)
+                    {
+                        file.f_digest = previous->f_digest;
+                    }
+                    else
+                    {
+                        ++f_read_definitions;
+                        definition def;
+                        read_definition_note(filename, def, &file.f_digest);
+                    }
+                    dir.f_files.push_back(file);
+                }
+            }
+            closedir(d);
+        }
+
+        std::sort(
+                  dir.f_files.begin()
+                , dir.f_files.end()
+                , [](file_t const & lhs, file_t const & rhs)
+                {
+                    return lhs.f_filename < rhs.f_filename;
+                });
+        std::sort(dir.f_subdirectories.begin(), dir.f_subdirectories.end());
+
+        updated[path] = dir;
+    }
+
+    if(top_level)
+    {
+        // copy because updated[...] may be modified by the recursive calls
+        //
+        std::vector<std::string> const subdirectories(updated[path].f_subdirectories);
+        for(auto const & s : subdirectories)
+        {
+            refresh_directory(s, false, updated);
+        }
+    }
+}
+
+
+/** \brief Get the list of plugin files found in a search path.
+ *
+ * This function returns the plugin files found directly in \p path
+ * followed by the plugin files found in its sub-directories. Within each
+ * directory, the files are sorted by name.
+ *
+ * The refresh() function must be called first.
+ *
+ * \param[in] path  One of the search paths.
+ *
+ * \return The list of plugin files found in \p path.
+ */
+discovery_index::file_vector_t discovery_index::files(paths::path_t const & path) const
+{
+    file_vector_t result;
+
+    auto const top(f_directories.find(path));
+    if(top == f_directories.end())
+    {
+        return result;
+    }
+    result = top->second.f_files;
+
+    for(auto const & s : top->second.f_subdirectories)
+    {
+        auto const sub(f_directories.find(s));
+        if(sub != f_directories.end())
+        {
+            result.insert(result.end(), sub->second.f_files.begin(), sub->second.f_files.end());
+        }
+    }
+
+    return result;
+}
+
+
+/** \brief Search a file in the index.
+ *
+ * This function searches the index for the specified plugin file and,
+ * if found, returns its identity as it was last read from disk.
+ *
+ * \param[in] filename  The full filename of the plugin.
+ * \param[out] file  The file identity if found.
+ *
+ * \return true if the file was found.
+ */
+bool discovery_index::find(names::filename_t const & filename, file_t & file) const
+{
+    auto const dir(f_directories.find(snapdev::pathinfo::dirname(filename)));
+    if(dir == f_directories.end())
+    {
+        return false;
+    }
+    file_t const * const f(find_file(dir->second.f_files, filename));
+    if(f == nullptr)
+    {
+        return false;
+    }
+    file = *f;
+    return true;
+}
+
+
+/** \brief Get the number of directories read by the last refresh().
+ *
+ * This function returns the number of directories that the last call to
+ * refresh() had to read again because they changed or were not yet
+ * part of the index. When the index is current, this is 0.
+ *
+ * \return The number of directories read again.
+ */
+std::size_t discovery_index::rescanned_directories() const
+{
+    return f_rescanned;
+}
+
+
+/** \brief Get the number of definition notes read by the last refresh().
+ *
+ * This function returns the number of plugin files that the last call
+ * to refresh() had to open to read their definition note. Files already
+ * found in the index with the same identity are not read again, so
+ * adding one plugin to a directory reads just that one plugin.
+ *
+ * \return The number of definition notes read.
+ */
+std::size_t discovery_index::read_definitions() const
+{
+    return f_read_definitions;
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,91 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/names.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
+#include    <time.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+class discovery_index
+{
+public:
+    struct file_t
+    {
+        names::filename_t           f_filename = names::filename_t();
+        ino_t                       f_inode = 0;
+        off_t                       f_size = 0;
+        timespec                    f_mtime = timespec();
+        std::uint64_t               f_digest = 0;
+    };
+    typedef std::vector<file_t>     file_vector_t;
+
+    struct directory_t
+    {
+        timespec                    f_mtime = timespec();
+        file_vector_t               f_files = file_vector_t();                  // sorted by filename
+        std::vector<std::string>    f_subdirectories = std::vector<std::string>();  // top level directories only
+    };
+    typedef std::map<std::string, directory_t>
+                                    directory_map_t;
+
+    bool                            load(std::string const & filename);
+    bool                            save(std::string const & filename) const;
+    bool                            refresh(paths const & p);
+    file_vector_t                   files(paths::path_t const & path) const;
+    bool                            find(names::filename_t const & filename, file_t & file) const;
+    std::size_t                     rescanned_directories() const;
+    std::size_t                     read_definitions() const;
+
+private:
+    bool                            is_current(directory_t const & dir, timespec const & mtime) const;
+    void                            refresh_directory(
+                                          std::string const & path
+                                        , bool top_level
+                                        , directory_map_t & updated);
+
+    directory_map_t                 f_directories = directory_map_t();
+    timespec                        f_saved = timespec();
+    std::size_t                     f_rescanned = 0;
+    std::size_t                     f_read_definitions = 0;
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,82 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief The scheduler of the awaitable signals.
+ *
+ * The awaitable signals (see awaitable_signal.h) let listeners suspend
+ * while they wait for I/O. Such a listener usually gets resumed by
+ * whatever thread completed the I/O. Before the emission goes on with
+ * the next listener, it moves back to the executor of the collection,
+ * so the server decides which threads run the plugins.
+ */
+
+// self
+//
+#include    "serverplugins/executor.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+/** \class executor
+ * \brief The interface of the scheduler supplied by the server.
+ *
+ * A server which uses awaitable signals implements this interface on
+ * top of its own event loop or thread pool and attaches it to the
+ * collection with collection::set_executor().
+ *
+ * The post() function must run the \p work later, in one of the threads
+ * managed by the server. It must not run it immediately, in the calling
+ * thread, since the caller may still be in the middle of suspending a
+ * coroutine.
+ */
+
+
+/** \brief Clean up the executor.
+ *
+ * The destructor is virtual since the executor is implemented by
+ * the server.
+ */
+executor::~executor()
+{
+}
+
+
+/** \fn void executor::post(work_t && work)
+ * \brief Run a function in one of the threads of the server.
+ *
+ * The awaitable signals call this function to resume an emission once
+ * a listener completed asynchronously.
+ *
+ * \param[in] work  The function to run.
+ */
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
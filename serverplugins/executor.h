@@ -0,0 +1,47 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// C++
+//
+#include    <functional>
+#include    <memory>
+
+
+
+namespace serverplugins
+{
+
+
+
+class executor
+{
+public:
+    typedef std::shared_ptr<executor>   pointer_t;
+    typedef std::function<void()>       work_t;
+
+    virtual                     ~executor();
+
+    virtual void                post(work_t && work) = 0;
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
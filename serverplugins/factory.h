@@ -21,6 +21,7 @@
 // self
 //
 #include    <serverplugins/definition.h>
+#include    <serverplugins/static_plugin.h>
 
 
 // C++
@@ -30,6 +30,13 @@
 #include    <cppthread/mutex.h>
 
 
+// C++
+//
+#include    <atomic>
+#include    <memory>
+#include    <vector>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -44,43 +51,108 @@ namespace serverplugins
 namespace
 {
 
-/** \brief The list of identifiers.
+
+
+/** \brief The number of identifiers per chunk, as a power of 2.
+ *
+ * The names are saved in chunks of 256 entries. A chunk never moves
+ * once allocated so a reader can access an entry without locking.
+ */
+constexpr std::size_t           ID_CHUNK_BITS = 8;
+constexpr std::size_t           ID_CHUNK_SIZE = 1 << ID_CHUNK_BITS;
+constexpr std::size_t           ID_CHUNK_COUNT = (MAX_ID + 1) / ID_CHUNK_SIZE;
+
+static_assert(ID_CHUNK_SIZE * ID_CHUNK_COUNT == MAX_ID + 1, "MAX_ID + 1 must be a multiple of ID_CHUNK_SIZE");
+
+
+/** \brief One registered identifier.
+ *
+ * The hash is saved along the name so the hash table can be grown
+ * without hashing the names again and most mismatches are detected
+ * without comparing strings.
+ */
+struct entry_t
+{
+    std::string                 f_name = std::string();
+    id_hash_t                   f_hash = 0;
+};
+
+
+/** \brief The chunks of entries.
  *
- * This maps registers all the identifiers by name. This is used by the
- * get_id() function to convert a name to an identifier.
+ * The entry of identifier `id` is found in chunk `id / ID_CHUNK_SIZE`
+ * at position `id % ID_CHUNK_SIZE`. This is how get_name() finds the
+ * name of an identifier in constant time.
  *
- * The first time get_id() is called with a new name, it allocates a
- * new identifier. It uses g_next_identifier to know what the next
- * identifier is.
+ * The array is constant initialized (all null pointers) so it can be
+ * used at any time, including by the static initializers of other
+ * compilation units.
  */
-std::map<std::string, id_t>     g_identifiers = {};
+std::atomic<entry_t *>          g_chunks[ID_CHUNK_COUNT] = {};
 
 
-/** \brief The next identifier.
+/** \brief The last identifier allocated.
  *
- * We allocate a new identifier each time the get_id() function is called
- * with a new name. That new identifier is generated using this global
- * variable.
+ * The identifiers are allocated in order, from MIN_ID to MAX_ID. This
+ * counter is incremented only once the new entry is complete.
+ */
+std::atomic<std::size_t>        g_count = 0;
+
+
+/** \brief A hash table from names to identifiers.
+ *
+ * The table uses open addressing with linear probing. The slots hold
+ * the identifiers; the names and hashes are read from the entries.
+ * The table is never more than half full so a search always ends on
+ * an empty slot.
+ *
+ * Once published, a table is only modified by adding identifiers to
+ * empty slots. When it gets too full, a new table twice the size gets
+ * published and the old one is kept until the process exits since
+ * readers may still be searching it.
+ */
+struct table_t
+{
+    explicit                    table_t(std::size_t size)
+                                    : f_mask(size - 1)
+                                    , f_slots(new std::atomic<id_t>[size]())
+                                {
+                                }
+
+    std::size_t const           f_mask;
+    std::unique_ptr<std::atomic<id_t>[]>
+                                f_slots;
+};
+
+
+/** \brief The current hash table.
+ *
+ * The find_id() function reads this pointer without locking.
+ */
+std::atomic<table_t const *>    g_table = nullptr;
+
+
+/** \brief The memory of the chunks and tables.
  *
- * Note that the id_t type is an 8 bit value. You are limited to identifiers
- * from 1 to 255. We do not foresee a program that require that many plugin
- * collections. At the moment we have about 5 processes that make use of
- * plugins and 3 of them are separate programs. So collections used in
- * parallel are currently limited to about 2 (logger and tools that make
- * use of their own plugins). This limit may change in the future, but it
- * is never likely to ever approach 255.
+ * These vectors own the chunks and tables. They are only accessed with
+ * the id_mutex() locked.
  */
-id_t                            g_next_identifier = NULL_ID;
+std::vector<std::unique_ptr<entry_t[]>>
+                                g_owned_chunks = {};
+std::vector<std::unique_ptr<table_t>>
+                                g_owned_tables = {};
 
 
 /** \brief A mutex to protect the identifier variables.
  *
  * The identifier variables are globals so we need to protect them with
- * a guard when being accessed. This mutex is used when doing so. This
+ * a guard when being modified. This mutex is used when doing so. This
  * is a global mutex with a static scope so it is safe to use at any
  * time (i.e. the variable will always safely be initialized when the
  * function returns.)
  *
+ * Searching for an existing identifier does not require the mutex.
+ *
  * \return The identifier variables mutex.
  */
 cppthread::mutex & id_mutex()
@@ -90,9 +162,71 @@ cppthread::mutex & id_mutex()
 }
 
 
+/** \brief Get the entry of an identifier.
+ *
+ * \param[in] id  A valid identifier.
+ *
+ * \return The entry of \p id.
+ */
+entry_t const & get_entry(id_t id)
+{
+    return g_chunks[id >> ID_CHUNK_BITS].load(std::memory_order_acquire)[id & (ID_CHUNK_SIZE - 1)];
+}
+
+
+/** \brief Search a table for a name.
+ *
+ * \param[in] table  The table to search, may be nullptr.
+ * \param[in] name  The name to search.
+ * \param[in] hash  The hash of \p name.
+ *
+ * \return The identifier or NULL_ID if \p name is not in \p table.
+ */
+id_t find_in_table(table_t const * table, std::string_view name, id_hash_t hash)
+{
+    if(table == nullptr)
+    {
+        return NULL_ID;
+    }
+
+    for(std::size_t idx(hash & table->f_mask);; idx = (idx + 1) & table->f_mask)
+    {
+        id_t const id(table->f_slots[idx].load(std::memory_order_acquire));
+        if(id == NULL_ID)
+        {
+            return NULL_ID;
+        }
+        entry_t const & e(get_entry(id));
+        if(e.f_hash == hash
+        && e.f_name == name)
+        {
+            return id;
+        }
+    }
+}
+
 
+/** \brief Add an identifier to a table.
+ *
+ * The id_mutex() must be locked by the caller.
+ *
+ * \param[in,out] table  The table where \p id gets added.
+ * \param[in] id  The identifier to add.
+ * \param[in] hash  The hash of the name of \p id.
+ */
+void add_to_table(table_t & table, id_t id, id_hash_t hash)
+{
+    std::size_t idx(hash & table.f_mask);
+    while(table.f_slots[idx].load(std::memory_order_relaxed) != NULL_ID)
+    {
+        idx = (idx + 1) & table.f_mask;
+    }
+    table.f_slots[idx].store(id, std::memory_order_release);
 }
-// no name namespace
+
+
+
+} // no name namespace
 
 
 
@@ -104,45 +238,114 @@ cppthread::mutex & id_mutex()
  * be returned. However, the identifier may change between runs. So do not
  * try to record such an identifier.
  *
+ * Searching an existing identifier does not lock anything. A mutex is
+ * only used when a new identifier gets created.
+ *
  * \note
  * You are expected to use this function once and then use the returned
- * id_t for all your other calls, making things go a lot faster.
+ * id_t for all your other calls, making things go a lot faster. With a
+ * constant name, use the SERVERPLUGINS_ID() macro which does exactly that.
  *
  * \exception name_mismatch
  * This exception is raised if the input name is an empty string.
  *
  * \exception out_of_range
- * This exception is raised if this new name is the 256th name being
- * registered. The limit number of server identifiers is 255.
+ * This exception is raised if all the identifiers from MIN_ID to MAX_ID
+ * were already allocated.
  *
  * \param[in] name  The name of the identifier as a string.
  *
  * \return The identifier number to use in the collection and plugins.
  */
-id_t get_id(std::string const & name)
+id_t get_id(std::string_view name)
+{
+    return get_id(name, id_hash(name));
+}
+
+
+/** \brief Determine the identifier of a name with a known hash.
+ *
+ * This function is the same as get_id(std::string_view) except that
+ * the hash of \p name was already computed, generally at compile time
+ * (see SERVERPLUGINS_ID()).
+ *
+ * \exception name_mismatch
+ * This exception is raised if the input name is an empty string.
+ *
+ * \exception out_of_range
+ * This exception is raised if all the identifiers from MIN_ID to MAX_ID
+ * were already allocated.
+ *
+ * \param[in] name  The name of the identifier as a string.
+ * \param[in] hash  The hash of \p name as returned by id_hash().
+ *
+ * \return The identifier number to use in the collection and plugins.
+ */
+id_t get_id(std::string_view name, id_hash_t hash)
 {
     if(name.empty())
     {
         throw name_mismatch("serverplugins: an identifier cannot be an empty string.");
     }
 
+    id_t id(find_in_table(g_table.load(std::memory_order_acquire), name, hash));
+    if(id != NULL_ID)
+    {
+        return id;
+    }
+
     cppthread::guard lock(id_mutex());
 
-    auto it(g_identifiers.find(name));
-    if(it != g_identifiers.end())
+    // another thread may have added it in the meantime
+    //
+    table_t * table(g_owned_tables.empty() ? nullptr : g_owned_tables.back().get());
+    id = find_in_table(table, name, hash);
+    if(id != NULL_ID)
     {
-        return it->second;
+        return id;
     }
 
-    if(g_next_identifier == MAX_ID) // MAX_ID is inclusive
+    std::size_t const count(g_count.load(std::memory_order_relaxed));
+    if(count == MAX_ID) // MAX_ID is inclusive
     {
         throw out_of_range("serverplugins: too many identifiers created.");
     }
+    id = static_cast<id_t>(count + 1);
 
-    ++g_next_identifier;
-    g_identifiers[name] = g_next_identifier;
+    std::atomic<entry_t *> & chunk(g_chunks[id >> ID_CHUNK_BITS]);
+    entry_t * entries(chunk.load(std::memory_order_relaxed));
+    if(entries == nullptr)
+    {
+        g_owned_chunks.push_back(std::make_unique<entry_t[]>(ID_CHUNK_SIZE));
+        entries = g_owned_chunks.back().get();
+        chunk.store(entries, std::memory_order_release);
+    }
+    entry_t & e(entries[id & (ID_CHUNK_SIZE - 1)]);
+    e.f_name = name;
+    e.f_hash = hash;
+
+    // keep the table at most half full
+    //
+    if(table == nullptr
+    || (count + 1) * 2 > table->f_mask + 1)
+    {
+        g_owned_tables.push_back(std::make_unique<table_t>(table == nullptr ? 64 : (table->f_mask + 1) * 2));
+        table = g_owned_tables.back().get();
+        for(std::size_t idx(MIN_ID); idx <= count; ++idx)
+        {
+            add_to_table(*table, static_cast<id_t>(idx), get_entry(static_cast<id_t>(idx)).f_hash);
+        }
+        add_to_table(*table, id, hash);
+        g_table.store(table, std::memory_order_release);
+    }
+    else
+    {
+        add_to_table(*table, id, hash);
+    }
 
-    return g_next_identifier;
+    g_count.store(id, std::memory_order_release);
+
+    return id;
 }
 
 
@@ -160,6 +363,8 @@ id_t get_id(std::string const & name)
  * but the calls to find_id() followed by get_id() would not be without
  * your own proper locking mechanism.)
  *
+ * This function never locks.
+ *
  * \exception name_mismatch
  * This exception is raised if the input name is an empty string.
  *
@@ -167,22 +372,33 @@ id_t get_id(std::string const & name)
  *
  * \return The found identifier or NULL_ID.
  */
-id_t find_id(std::string const & name)
+id_t find_id(std::string_view name)
 {
-    if(name.empty())
-    {
-        throw name_mismatch("serverplugins: an identifier cannot be an empty string.");
-    }
+    return find_id(name, id_hash(name));
+}
 
-    cppthread::guard lock(id_mutex());
 
-    auto it(g_identifiers.find(name));
-    if(it != g_identifiers.end())
+/** \brief Retrieve an identifier with a known hash.
+ *
+ * This function is the same as find_id(std::string_view) except that
+ * the hash of \p name was already computed.
+ *
+ * \exception name_mismatch
+ * This exception is raised if the input name is an empty string.
+ *
+ * \param[in] name  The server name collection to search.
+ * \param[in] hash  The hash of \p name as returned by id_hash().
+ *
+ * \return The found identifier or NULL_ID.
+ */
+id_t find_id(std::string_view name, id_hash_t hash)
+{
+    if(name.empty())
     {
-        return it->second;
+        throw name_mismatch("serverplugins: an identifier cannot be an empty string.");
     }
 
-    return NULL_ID;
+    return find_in_table(g_table.load(std::memory_order_acquire), name, hash);
 }
 
 
@@ -193,6 +409,10 @@ id_t find_id(std::string const & name)
  * to print messages with the name rather than an identifier which could
  * vary between runs.
  *
+ * The names are saved in a dense array so the conversion is done in
+ * constant time and without locking. The returned reference remains
+ * valid until the process exits.
+ *
  * The function returns an empty string if the specified identifier was not
  * yet registered.
  *
@@ -200,19 +420,16 @@ id_t find_id(std::string const & name)
  *
  * \return The name of this identifier or an empty string if not found.
  */
-std::string get_name(id_t id)
+std::string const & get_name(id_t id)
 {
-    cppthread::guard lock(id_mutex());
-
-    for(const auto & [key, value] : g_identifiers)
+    if(id == NULL_ID
+    || id > g_count.load(std::memory_order_acquire))
     {
-        if(value == id)
-        {
-            return key;
-        }
+        static std::string const g_empty = std::string();
+        return g_empty;
     }
 
-    return std::string();
+    return get_entry(id).f_name;
 }
 
 
@@ -230,9 +447,9 @@ std::string get_name(id_t id)
  * that function with the same identifier more than once always returns
  * the same number. The number may change between runs.
  *
- * \note
- * The identifier is limited to 255 numbers (1 to 255). It is not expected
- * that you would create more than 255 collections of plugins.
+ * The identifiers are allocated from MIN_ID to MAX_ID (1 to 1,048,575)
+ * so they can also be used for names used in hot paths, such as the
+ * signals and plugins names.
  */
 
 
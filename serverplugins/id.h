@@ -21,9 +21,8 @@
 // C++
 //
 #include    <cstdint>
-#include    <limits>
-#include    <map>
 #include    <string>
+#include    <string_view>
 
 
 
@@ -32,18 +31,67 @@ namespace serverplugins
 
 
 
-typedef std::uint8_t        id_t;
+typedef std::uint32_t       id_t;
+typedef std::uint64_t       id_hash_t;
 
 constexpr id_t              NULL_ID = 0;
 
-id_t                        get_id(std::string const & name);
-id_t                        find_id(std::string const & name);
-std::string                 get_name(id_t id);
-
 constexpr std::size_t       MIN_ID = static_cast<id_t>(1);
-constexpr std::size_t       MAX_ID = std::numeric_limits<id_t>::max();
+constexpr std::size_t       MAX_ID = static_cast<id_t>((1 << 20) - 1);
+
+
+/** \brief Compute the hash of an identifier name.
+ *
+ * This is the 64 bit FNV-1a hash of \p name. The function is constexpr
+ * so the hash of a constant name gets computed by the compiler (see
+ * SERVERPLUGINS_ID()).
+ *
+ * \param[in] name  The name to hash.
+ *
+ * \return The hash of \p name.
+ */
+constexpr id_hash_t id_hash(std::string_view name)
+{
+    id_hash_t hash(0xcbf29ce484222325ULL);
+    for(char const c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+id_t                        get_id(std::string_view name);
+id_t                        get_id(std::string_view name, id_hash_t hash);
+id_t                        find_id(std::string_view name);
+id_t                        find_id(std::string_view name, id_hash_t hash);
+std::string const &         get_name(id_t id);
 
 
 
 } // namespace serverplugins
+
+
+/** \brief Convert a constant name to an identifier.
+ *
+ * The hash of \p name is computed at compile time and the identifier
+ * is retrieved once, the first time the expression gets evaluated. After
+ * that, the expression costs about as much as reading a static variable.
+ *
+ * \code
+ *     serverplugins::id_t const id(SERVERPLUGINS_ID("daemon"));
+ * \endcode
+ *
+ * \param[in] name  A string literal.
+ */
+#define SERVERPLUGINS_ID(name) \
+    ([]() \
+    { \
+        constexpr ::serverplugins::id_hash_t hash(::serverplugins::id_hash(name)); \
+        static ::serverplugins::id_t const id(::serverplugins::get_id(name, hash)); \
+        return id; \
+    }())
+
+
 // vim: ts=4 sw=4 et
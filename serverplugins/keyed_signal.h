@@ -0,0 +1,623 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Signals dispatched by key.
+ *
+ * A keyed signal is a signal whose first parameter is a key, such as
+ * the path of a request or the identifier of a message. The listeners
+ * choose the keys they are interested in: one exact key, all the keys
+ * starting with a prefix (string keys only), or all the keys. Emitting
+ * the signal only calls the listeners matching its key, found with one
+ * hash table lookup, instead of calling every listener and letting each
+ * one check the key.
+ */
+
+// self
+//
+#include    <serverplugins/typed_signal.h>
+
+
+// C++
+//
+#include    <map>
+#include    <string>
+#include    <unordered_map>
+
+
+
+namespace serverplugins
+{
+
+
+
+/** \brief A signal calling the listeners of its key.
+ *
+ * This class offers the same interface as serverplugins::signal, plus
+ * the add_key_callback() and add_prefix_callback() functions. The
+ * add_callback() function adds a listener called for all the keys, so
+ * a keyed signal can be listened to with the SERVERPLUGINS_LISTEN()
+ * macros. The listeners always receive the key as their first argument.
+ *
+ * The listeners get called in priority order, whatever the way they
+ * match the key, then in the order they were added.
+ *
+ * The lists of listeners of each key are computed when a listener gets
+ * added or removed, which is rare, so an emission only looks up its key:
+ *
+ * \li the keys with at least one listener of their own are found in a
+ *     hash table giving all their listeners (including the prefix and
+ *     wildcard ones);
+ * \li the other keys walk a trie of the prefixes, whose deepest matching
+ *     node gives the prefix and wildcard listeners;
+ * \li for keys which are not strings, the wildcard listeners are used.
+ *
+ * As with serverplugins::signal, these tables are never modified once
+ * published (see detail::rcu) so the signal can be emitted by any number
+ * of threads while listeners get added or removed. Once frozen (see
+ * freeze()), the emissions do not register themselves as readers.
+ *
+ * \tparam K  The type of the key, a std::string or an integer type.
+ * \tparam Args  The types of the other parameters of the signal. The
+ * function type `void(K, Args...)` can also be used.
+ */
+template<typename K, typename ... Args>
+class keyed_signal
+{
+public:
+    typedef std::decay_t<K>                 key_t;
+    typedef std::function<void(K, Args...)> value_type;
+    typedef delegate<K, Args...>            delegate_t;
+    typedef typename delegate_t::item_t     item_t;
+    typedef typename delegate_t::batch_t    batch_t;
+    typedef int                             callback_id_t;
+    typedef int                             priority_t;
+
+    static constexpr callback_id_t          NULL_CALLBACK_ID = 0;
+    static constexpr priority_t             DEFAULT_PRIORITY = 0;
+    static constexpr bool                   HAS_PREFIX = std::is_same_v<key_t, std::string>;
+
+    static_assert(!std::is_lvalue_reference_v<K>
+                    || std::is_const_v<std::remove_reference_t<K>>
+                , "the key of a keyed signal cannot be a non-const reference");
+
+                                keyed_signal() = default;
+                                keyed_signal(keyed_signal const &) = delete;
+    keyed_signal &              operator = (keyed_signal const &) = delete;
+
+    /** \brief Add a listener called for all the keys.
+     *
+     * \param[in] callback  The listener.
+     * \param[in] priority  The priority of the listener.
+     *
+     * \return The identifier used to remove the listener.
+     */
+    callback_id_t add_callback(delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        return add(match_t::MATCH_ANY, key_t(), callback, priority);
+    }
+
+    /** \brief Add a listener called for one key.
+     *
+     * \param[in] key  The key the listener is interested in.
+     * \param[in] callback  The listener.
+     * \param[in] priority  The priority of the listener.
+     *
+     * \return The identifier used to remove the listener.
+     */
+    callback_id_t add_key_callback(key_t const & key, delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        return add(match_t::MATCH_KEY, key, callback, priority);
+    }
+
+    /** \brief Add a listener called for the keys starting with \p prefix.
+     *
+     * This function is only available when the key is a std::string.
+     *
+     * \param[in] prefix  The prefix of the keys the listener is interested in.
+     * \param[in] callback  The listener.
+     * \param[in] priority  The priority of the listener.
+     *
+     * \return The identifier used to remove the listener.
+     */
+    callback_id_t add_prefix_callback(key_t const & prefix, delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        static_assert(HAS_PREFIX, "only the keyed signals with a std::string key support prefixes");
+
+        return add(match_t::MATCH_PREFIX, prefix, callback, priority);
+    }
+
+    bool remove_callback(callback_id_t callback_id)
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        verify_not_frozen();
+
+        table_t const * current(f_table.current());
+        if(current == nullptr)
+        {
+            return false;
+        }
+        auto it(std::find_if(
+                  current->f_listeners.begin()
+                , current->f_listeners.end()
+                , [callback_id](listener_t const & item)
+                  {
+                      return item.f_id == callback_id;
+                  }));
+        if(it == current->f_listeners.end())
+        {
+            return false;
+        }
+
+        listener_vector_t listeners;
+        listeners.reserve(current->f_listeners.size() - 1);
+        listeners.insert(listeners.end(), current->f_listeners.begin(), it);
+        listeners.insert(listeners.end(), it + 1, current->f_listeners.end());
+        f_table.publish(listeners.empty() ? nullptr : build(std::move(listeners)));
+
+        return true;
+    }
+
+    void clear()
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        verify_not_frozen();
+        f_table.publish(nullptr);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    std::size_t size() const
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        table_t const * current(f_table.current());
+        return current == nullptr ? 0 : current->f_listeners.size();
+    }
+
+    /** \brief Prevent any further changes to the listeners.
+     *
+     * The tables of listeners are already computed for each key, so
+     * freezing the signal only means that they cannot be replaced
+     * anymore and the emissions do not have to register as readers.
+     *
+     * See signal::freeze() for details.
+     */
+    void freeze()
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        f_table.freeze();
+    }
+
+    /** \brief Allow changes to the listeners again.
+     *
+     * See signal::thaw() for details.
+     */
+    void thaw()
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        f_table.thaw();
+    }
+
+    bool is_frozen() const
+    {
+        return f_table.is_frozen();
+    }
+
+    /** \brief Delete the replaced tables of listeners.
+     *
+     * See signal::synchronize() for details.
+     */
+    void synchronize()
+    {
+        f_table.synchronize();
+    }
+
+    void call(detail::signal_argument_t<K> key, detail::signal_argument_t<Args>... args) const
+    {
+        typename detail::rcu<table_t>::reader const r(f_table);
+        table_t const * table(r.get());
+        if(table != nullptr)
+        {
+            for(auto const & d : table->find(key))
+            {
+                d(key, args...);
+            }
+        }
+    }
+
+    /** \brief Call the listeners of \p key in parallel.
+     *
+     * See signal::call_parallel() for details.
+     *
+     * \tparam P  The type of the pool.
+     * \param[in] pool  The pool running the listeners.
+     * \param[in] key  The key of this emission.
+     * \param[in] args  The other arguments of the signal.
+     */
+    template<typename P>
+    void call_parallel(P * pool, detail::signal_argument_t<K> key, detail::signal_argument_t<Args>... args) const
+    {
+        static_assert(!detail::has_mutable_reference<Args...>
+                    , "a signal with a non-const reference parameter cannot call its listeners in parallel");
+
+        typename detail::rcu<table_t>::reader const r(f_table);
+        table_t const * table(r.get());
+        if(table == nullptr)
+        {
+            return;
+        }
+        delegate_vector_t const & delegates(table->find(key));
+        auto const f([&delegates, &key, &args...](std::size_t idx)
+              {
+                  delegates[idx](key, args...);
+              });
+        if(pool == nullptr
+        || delegates.size() <= 1)
+        {
+            detail::call_each(delegates.size(), f);
+            return;
+        }
+
+        pool->fan_out(delegates.size(), f);
+    }
+
+    /** \brief Call the listeners of each item of a batch.
+     *
+     * The consecutive items sharing the same listeners, which is always
+     * the case of consecutive items with the same key, are sent to each
+     * listener as one batch. So a listener created with batch_listener()
+     * receives spans as large as possible.
+     *
+     * \param[in] items  The items, one set of arguments each.
+     */
+    void call_batch(batch_t items) const
+    {
+        typename detail::rcu<table_t>::reader const r(f_table);
+        table_t const * table(r.get());
+        if(table != nullptr)
+        {
+            for_each_run(*table, items, [](delegate_vector_t const & delegates, batch_t run)
+                {
+                    for(auto const & d : delegates)
+                    {
+                        d.call_batch(run);
+                    }
+                });
+        }
+    }
+
+    /** \brief Call the listeners of each item of a batch in parallel.
+     *
+     * This function is to call_batch() what call_parallel() is to call().
+     *
+     * \tparam P  The type of the pool.
+     * \param[in] pool  The pool running the listeners.
+     * \param[in] items  The items, one set of arguments each.
+     */
+    template<typename P>
+    void call_parallel_batch(P * pool, batch_t items) const
+    {
+        static_assert(!detail::has_mutable_reference<Args...>
+                    , "a signal with a non-const reference parameter cannot call its listeners in parallel");
+
+        typename detail::rcu<table_t>::reader const r(f_table);
+        table_t const * table(r.get());
+        if(table != nullptr)
+        {
+            for_each_run(*table, items, [pool](delegate_vector_t const & delegates, batch_t run)
+                {
+                    auto const f([&delegates, run](std::size_t idx)
+                          {
+                              delegates[idx].call_batch(run);
+                          });
+                    if(pool == nullptr
+                    || delegates.size() <= 1)
+                    {
+                        detail::call_each(delegates.size(), f);
+                        return;
+                    }
+                    pool->fan_out(delegates.size(), f);
+                });
+        }
+    }
+
+    template<typename F, typename I>
+    static decltype(auto) apply_item(F && f, I & item)
+    {
+        return detail::apply_item<sizeof...(Args) + 1>(std::forward<F>(f), item);
+    }
+
+    template<typename P>
+    auto parallel(P * pool) const
+    {
+        return [this, pool](detail::signal_argument_t<K> key, detail::signal_argument_t<Args>... args)
+            {
+                call_parallel(pool, key, args...);
+            };
+    }
+
+private:
+    enum class match_t
+    {
+        MATCH_ANY,
+        MATCH_KEY,
+        MATCH_PREFIX,
+    };
+
+    struct listener_t
+    {
+        callback_id_t               f_id = NULL_CALLBACK_ID;
+        priority_t                  f_priority = DEFAULT_PRIORITY;
+        match_t                     f_match = match_t::MATCH_ANY;
+        key_t                       f_key = key_t();
+        delegate_t                  f_delegate = delegate_t();
+    };
+    typedef std::vector<listener_t> listener_vector_t;
+    typedef std::vector<delegate_t> delegate_vector_t;
+
+    /** \brief One node of the trie of prefixes.
+     *
+     * The node holds the listeners of all the keys starting with the
+     * characters leading to that node and not found in the hash table:
+     * the wildcard listeners and the listeners of this prefix and of all
+     * the shorter prefixes.
+     */
+    struct node_t
+    {
+        delegate_vector_t           f_delegates = delegate_vector_t();
+        std::map<char, std::unique_ptr<node_t>>
+                                    f_children = std::map<char, std::unique_ptr<node_t>>();
+    };
+
+    /** \brief The hash of the keys.
+     *
+     * This is std::hash. Using our own type prevents the standard library
+     * from comparing the key with each entry of small tables instead of
+     * hashing it, which it does with std::string keys and costs one string
+     * comparison per listened key.
+     */
+    struct key_hash
+    {
+        std::size_t                 operator () (key_t const & key) const
+                                    {
+                                        return std::hash<key_t>()(key);
+                                    }
+    };
+
+    struct table_t
+    {
+        delegate_vector_t const &   find(key_t const & key) const
+                                    {
+                                        auto it(f_keys.find(key));
+                                        if(it != f_keys.end())
+                                        {
+                                            return it->second;
+                                        }
+                                        node_t const * node(&f_root);
+                                        if constexpr (HAS_PREFIX)
+                                        {
+                                            for(char const c : key)
+                                            {
+                                                auto child(node->f_children.find(c));
+                                                if(child == node->f_children.end())
+                                                {
+                                                    break;
+                                                }
+                                                node = child->second.get();
+                                            }
+                                        }
+                                        return node->f_delegates;
+                                    }
+
+        listener_vector_t           f_listeners = listener_vector_t();
+        std::unordered_map<key_t, delegate_vector_t, key_hash>
+                                    f_keys = std::unordered_map<key_t, delegate_vector_t, key_hash>();
+        node_t                      f_root = node_t();
+    };
+
+    callback_id_t add(match_t match, key_t const & key, delegate_t const & callback, priority_t priority)
+    {
+        cppthread::guard lock(f_table.get_mutex());
+        verify_not_frozen();
+
+        listener_t l;
+        l.f_id = ++f_next_id;
+        l.f_priority = priority;
+        l.f_match = match;
+        l.f_key = key;
+        l.f_delegate = callback;
+
+        listener_vector_t listeners;
+        table_t const * current(f_table.current());
+        if(current != nullptr)
+        {
+            listeners.reserve(current->f_listeners.size() + 1);
+            listeners = current->f_listeners;
+        }
+        auto it(std::find_if(
+                  listeners.begin()
+                , listeners.end()
+                , [priority](listener_t const & item)
+                  {
+                      return item.f_priority < priority;
+                  }));
+        listeners.insert(it, l);
+        f_table.publish(build(std::move(listeners)));
+
+        return l.f_id;
+    }
+
+    /** \brief Check whether a listener gets called for \p key.
+     *
+     * When \p exact is false, \p key is the path of a node of the trie
+     * and the listeners of exact keys never match since those keys are
+     * found in the hash table.
+     */
+    static bool matches(listener_t const & l, key_t const & key, bool exact)
+    {
+        switch(l.f_match)
+        {
+        case match_t::MATCH_ANY:
+            return true;
+
+        case match_t::MATCH_KEY:
+            return exact && l.f_key == key;
+
+        case match_t::MATCH_PREFIX:
+            if constexpr (HAS_PREFIX)
+            {
+                return key.compare(0, l.f_key.length(), l.f_key) == 0;
+            }
+            break;
+
+        }
+
+        return false;
+    }
+
+    static void fill(node_t & node, key_t const & path, listener_vector_t const & listeners)
+    {
+        for(auto const & l : listeners)
+        {
+            if(matches(l, path, false))
+            {
+                node.f_delegates.push_back(l.f_delegate);
+            }
+        }
+        if constexpr (HAS_PREFIX)
+        {
+            for(auto & child : node.f_children)
+            {
+                fill(*child.second, path + child.first, listeners);
+            }
+        }
+    }
+
+    /** \brief Compute the listeners of each key.
+     *
+     * The \p listeners vector is sorted by priority, so are the vectors
+     * of delegates created from it.
+     */
+    static table_t const * build(listener_vector_t && listeners)
+    {
+        auto table(std::make_unique<table_t>());
+        table->f_listeners = std::move(listeners);
+
+        for(auto const & l : table->f_listeners)
+        {
+            if(l.f_match == match_t::MATCH_KEY)
+            {
+                table->f_keys[l.f_key];
+            }
+            else if constexpr (HAS_PREFIX)
+            {
+                if(l.f_match == match_t::MATCH_PREFIX)
+                {
+                    node_t * node(&table->f_root);
+                    for(char const c : l.f_key)
+                    {
+                        std::unique_ptr<node_t> & child(node->f_children[c]);
+                        if(child == nullptr)
+                        {
+                            child = std::make_unique<node_t>();
+                        }
+                        node = child.get();
+                    }
+                }
+            }
+        }
+
+        for(auto & k : table->f_keys)
+        {
+            for(auto const & l : table->f_listeners)
+            {
+                if(matches(l, k.first, true))
+                {
+                    k.second.push_back(l.f_delegate);
+                }
+            }
+        }
+        fill(table->f_root, key_t(), table->f_listeners);
+
+        return table.release();
+    }
+
+    static key_t const & item_key(item_t const & item)
+    {
+        if constexpr (sizeof...(Args) == 0)
+        {
+            return item;
+        }
+        else
+        {
+            return std::get<0>(item);
+        }
+    }
+
+    /** \brief Call \p f with each run of items sharing the same listeners.
+     */
+    template<typename F>
+    static void for_each_run(table_t const & table, batch_t items, F const & f)
+    {
+        std::size_t const size(items.size());
+        std::size_t idx(0);
+        while(idx < size)
+        {
+            std::size_t const first(idx);
+            delegate_vector_t const & delegates(table.find(item_key(items[idx])));
+            ++idx;
+            while(idx < size
+               && &table.find(item_key(items[idx])) == &delegates)
+            {
+                ++idx;
+            }
+            if(!delegates.empty())
+            {
+                f(delegates, items.subspan(first, idx - first));
+            }
+        }
+    }
+
+    void verify_not_frozen() const
+    {
+        if(f_table.is_frozen())
+        {
+            throw logic_error("the listeners of a frozen signal cannot be changed.");
+        }
+    }
+
+    detail::rcu<table_t>            f_table = detail::rcu<table_t>();
+    callback_id_t                   f_next_id = NULL_CALLBACK_ID;
+};
+
+
+template<typename K, typename ... Args>
+class keyed_signal<void(K, Args...)>
+    : public keyed_signal<K, Args...>
+{
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,557 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Save and restore the resolved list of plugins to load.
+ *
+ * The collection::load_plugins() function computes the closure of the
+ * dependencies, verifies the conflicts, and sorts the plugins. The
+ * result only changes when the set of plugin files changes. The load
+ * plan saves that result in a small binary file so the next start can
+ * skip the resolution altogether.
+ */
+
+// self
+//
+#include    "serverplugins/load_plan.h"
+
+#include    "serverplugins/static_plugin.h"
+#include    "serverplugins/version.h"
+
+
+// C++
+//
+#include    <cstring>
+#include    <fstream>
+#include    <iterator>
+
+
+// C
+//
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The magic at the start of a load plan file.
+ *
+ * The file is written in the native byte order. The magic also includes
+ * the version of the format.
+ */
+constexpr char const        g_plan_magic[8] = { 'S', 'P', 'P', 'L', 'A', 'N', '\0', '\1' };
+
+
+/** \brief Value used to detect a file written with another byte order.
+ */
+constexpr std::uint32_t     g_plan_byte_order = 0x01020304;
+
+
+class plan_writer
+{
+public:
+    template<typename T>
+    void put(T value)
+    {
+        char const * ptr(reinterpret_cast<char const *>(&value));
+        f_buffer.insert(f_buffer.end(), ptr, ptr + sizeof(value));
+    }
+
+    void put_string(std::string const & s)
+    {
+        put(static_cast<std::uint32_t>(s.length()));
+        f_buffer.insert(f_buffer.end(), s.begin(), s.end());
+    }
+
+    std::vector<char> const & buffer() const
+    {
+        return f_buffer;
+    }
+
+private:
+    std::vector<char>       f_buffer = std::vector<char>();
+};
+
+
+class plan_reader
+{
+public:
+    plan_reader(std::vector<char> const & buffer)
+        : f_buffer(buffer)
+    {
+    }
+
+    template<typename T>
+    bool get(T & value)
+    {
+        if(f_pos + sizeof(value) > f_buffer.size())
+        {
+            return false;
+        }
+        memcpy(&value, f_buffer.data() + f_pos, sizeof(value));
+        f_pos += sizeof(value);
+        return true;
+    }
+
+    bool get_string(std::string & s)
+    {
+        std::uint32_t length(0);
+        if(!get(length)
+        || f_pos + length > f_buffer.size())
+        {
+            return false;
+        }
+        s.assign(f_buffer.data() + f_pos, length);
+        f_pos += length;
+        return true;
+    }
+
+    bool at_end() const
+    {
+        return f_pos == f_buffer.size();
+    }
+
+private:
+    std::vector<char> const &   f_buffer;
+    std::size_t                 f_pos = 0;
+};
+
+
+
+} // no name namespace
+
+
+
+/** \class load_plan
+ * \brief The resolved list of plugins of a collection.
+ *
+ * A load plan is the result of a successful collection::load_plugins():
+ * the names requested by the user, the complete list of plugins in the
+ * order in which they get bootstrapped, and the conflicts that were
+ * verified.
+ *
+ * Each plugin file is saved along its identity: device, inode, size, and
+ * modification time. A plan is current only if all the files still have
+ * the same identity. Installing a new version of any one plugin changes
+ * its identity and the plan gets ignored.
+ *
+ * \sa collection::set_plan_filename()
+ */
+
+
+
+/** \brief Compare two identities.
+ *
+ * \param[in] rhs  The other identity.
+ *
+ * \return true if both identities are equal.
+ */
+bool load_plan::identity_t::operator == (identity_t const & rhs) const
+{
+    return f_device == rhs.f_device
+        && f_inode == rhs.f_inode
+        && f_size == rhs.f_size
+        && f_mtime_sec == rhs.f_mtime_sec
+        && f_mtime_nsec == rhs.f_mtime_nsec;
+}
+
+
+/** \brief Compare two identities.
+ *
+ * \param[in] rhs  The other identity.
+ *
+ * \return true if the identities are different.
+ */
+bool load_plan::identity_t::operator != (identity_t const & rhs) const
+{
+    return !operator == (rhs);
+}
+
+
+/** \brief Retrieve the identity of a file.
+ *
+ * This function runs stat() on \p filename and saves the information
+ * used to detect changes in \p identity.
+ *
+ * A plugin linked in the executable (see static_plugin) only changes
+ * when the executable changes so its identity is the one of the
+ * executable.
+ *
+ * \param[in] filename  The name of the file.
+ * \param[out] identity  The identity of the file.
+ *
+ * \return true if the file exists, false otherwise.
+ */
+bool load_plan::get_identity(names::filename_t const & filename, identity_t & identity)
+{
+    struct stat st = {};
+    if(stat(static_plugin::is_static_filename(filename) ? "/proc/self/exe" : filename.c_str(), &st) != 0)
+    {
+        return false;
+    }
+
+    identity.f_device = st.st_dev;
+    identity.f_inode = st.st_ino;
+    identity.f_size = st.st_size;
+    identity.f_mtime_sec = st.st_mtim.tv_sec;
+    identity.f_mtime_nsec = st.st_mtim.tv_nsec;
+
+    return true;
+}
+
+
+/** \brief Set the name of the server.
+ *
+ * A plan is only valid for the server it was created for.
+ *
+ * \param[in] name  The name of the server.
+ */
+void load_plan::set_server_name(std::string const & name)
+{
+    f_server_name = name;
+}
+
+
+/** \brief Get the name of the server.
+ *
+ * \return The name of the server this plan was created for.
+ */
+std::string const & load_plan::get_server_name() const
+{
+    return f_server_name;
+}
+
+
+/** \brief Set the names requested by the user.
+ *
+ * The plan is only valid if the user requests the exact same list of
+ * plugins. This is the list of names before the dependencies were added.
+ *
+ * \param[in] requested  The map of names and filenames requested.
+ */
+void load_plan::set_requested(names::names_t const & requested)
+{
+    f_requested = requested;
+}
+
+
+/** \brief Get the names requested by the user.
+ *
+ * \return The map of names and filenames requested.
+ */
+names::names_t const & load_plan::get_requested() const
+{
+    return f_requested;
+}
+
+
+/** \brief Add a plugin to the plan.
+ *
+ * The plugins must be added in the order in which they get bootstrapped.
+ * The server itself is not part of the list.
+ *
+ * The identity of the file is read immediately. If that fails (i.e. the
+ * file was removed since it was loaded), the plugin is not added and the
+ * function returns false. Such a plan would never be current so it
+ * should not be saved.
+ *
+ * \param[in] name  The name of the plugin.
+ * \param[in] filename  The filename of the plugin.
+ *
+ * \return true if the plugin was added to the plan.
+ */
+bool load_plan::add_plugin(names::name_t const & name, names::filename_t const & filename)
+{
+    entry_t e;
+    e.f_name = name;
+    e.f_filename = filename;
+    if(!get_identity(filename, e.f_identity))
+    {
+        return false;
+    }
+    f_plugins.push_back(e);
+    return true;
+}
+
+
+/** \brief Get the ordered list of plugins.
+ *
+ * \return The list of plugins in the order they get bootstrapped.
+ */
+load_plan::entry_vector_t const & load_plan::get_plugins() const
+{
+    return f_plugins;
+}
+
+
+/** \brief Add a verified conflict.
+ *
+ * A conflict declared by \p plugin against \p conflict. Since the plan
+ * is only saved when no conflict was found, \p conflict is not part of
+ * the plan.
+ *
+ * \param[in] plugin  The plugin declaring the conflict.
+ * \param[in] conflict  The name of the plugin it is in conflict with.
+ */
+void load_plan::add_conflict(names::name_t const & plugin, names::name_t const & conflict)
+{
+    f_conflicts.push_back({ plugin, conflict });
+}
+
+
+/** \brief Get the list of verified conflicts.
+ *
+ * \return The list of conflicts declared by the plugins in the plan.
+ */
+load_plan::conflict_vector_t const & load_plan::get_conflicts() const
+{
+    return f_conflicts;
+}
+
+
+/** \brief Check whether all the files in the plan are unchanged.
+ *
+ * This function verifies the identity of each plugin file. If any one
+ * file changed or disappeared, the plan is not current anymore.
+ *
+ * \return true if all the files still have the same identity.
+ */
+bool load_plan::is_current() const
+{
+    for(auto const & e : f_plugins)
+    {
+        identity_t identity;
+        if(!get_identity(e.f_filename, identity)
+        || identity != e.f_identity)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Load a plan from a file.
+ *
+ * This function reads a plan saved with save(). If the file does not
+ * exist, was written by a different version of the library, or is
+ * invalid, the function returns false and the plan is left empty.
+ *
+ * \param[in] filename  The name of the plan file.
+ *
+ * \return true if the plan was loaded.
+ */
+bool load_plan::load(std::string const & filename)
+{
+    f_server_name.clear();
+    f_requested.clear();
+    f_plugins.clear();
+    f_conflicts.clear();
+
+    std::ifstream in(filename, std::ios::binary);
+    if(!in.is_open())
+    {
+        return false;
+    }
+    std::vector<char> const buffer(
+              (std::istreambuf_iterator<char>(in))
+            , std::istreambuf_iterator<char>());
+    plan_reader r(buffer);
+
+    char magic[sizeof(g_plan_magic)];
+    std::uint32_t byte_order(0);
+    std::uint32_t major(0);
+    std::uint32_t minor(0);
+    std::uint32_t patch(0);
+    for(auto & c : magic)
+    {
+        if(!r.get(c))
+        {
+            return false;
+        }
+    }
+    if(memcmp(magic, g_plan_magic, sizeof(magic)) != 0
+    || !r.get(byte_order)
+    || byte_order != g_plan_byte_order
+    || !r.get(major)
+    || !r.get(minor)
+    || !r.get(patch)
+    || major != SERVERPLUGINS_VERSION_MAJOR
+    || minor != SERVERPLUGINS_VERSION_MINOR
+    || patch != SERVERPLUGINS_VERSION_PATCH)
+    {
+        return false;
+    }
+
+    load_plan plan;
+    std::uint32_t count(0);
+    if(!r.get_string(plan.f_server_name)
+    || !r.get(count))
+    {
+        return false;
+    }
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        names::name_t name;
+        names::filename_t fn;
+        if(!r.get_string(name)
+        || !r.get_string(fn))
+        {
+            return false;
+        }
+        plan.f_requested[name] = fn;
+    }
+
+    if(!r.get(count))
+    {
+        return false;
+    }
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        entry_t e;
+        if(!r.get_string(e.f_name)
+        || !r.get_string(e.f_filename)
+        || !r.get(e.f_identity.f_device)
+        || !r.get(e.f_identity.f_inode)
+        || !r.get(e.f_identity.f_size)
+        || !r.get(e.f_identity.f_mtime_sec)
+        || !r.get(e.f_identity.f_mtime_nsec))
+        {
+            return false;
+        }
+        plan.f_plugins.push_back(e);
+    }
+
+    if(!r.get(count))
+    {
+        return false;
+    }
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        conflict_t c;
+        if(!r.get_string(c.f_plugin)
+        || !r.get_string(c.f_conflict))
+        {
+            return false;
+        }
+        plan.f_conflicts.push_back(c);
+    }
+
+    if(!r.at_end())
+    {
+        return false;
+    }
+
+    *this = plan;
+    return true;
+}
+
+
+/** \brief Save the plan to a file.
+ *
+ * This function saves the plan to \p filename. The data is first written
+ * to a temporary file which then gets renamed so a process starting at
+ * the same time never reads a partial plan.
+ *
+ * \param[in] filename  The name of the plan file.
+ *
+ * \return true if the plan was saved.
+ */
+bool load_plan::save(std::string const & filename) const
+{
+    plan_writer w;
+    for(auto const c : g_plan_magic)
+    {
+        w.put(c);
+    }
+    w.put(g_plan_byte_order);
+    w.put(static_cast<std::uint32_t>(SERVERPLUGINS_VERSION_MAJOR));
+    w.put(static_cast<std::uint32_t>(SERVERPLUGINS_VERSION_MINOR));
+    w.put(static_cast<std::uint32_t>(SERVERPLUGINS_VERSION_PATCH));
+    w.put_string(f_server_name);
+
+    w.put(static_cast<std::uint32_t>(f_requested.size()));
+    for(auto const & r : f_requested)
+    {
+        w.put_string(r.first);
+        w.put_string(r.second);
+    }
+
+    w.put(static_cast<std::uint32_t>(f_plugins.size()));
+    for(auto const & e : f_plugins)
+    {
+        w.put_string(e.f_name);
+        w.put_string(e.f_filename);
+        w.put(e.f_identity.f_device);
+        w.put(e.f_identity.f_inode);
+        w.put(e.f_identity.f_size);
+        w.put(e.f_identity.f_mtime_sec);
+        w.put(e.f_identity.f_mtime_nsec);
+    }
+
+    w.put(static_cast<std::uint32_t>(f_conflicts.size()));
+    for(auto const & c : f_conflicts)
+    {
+        w.put_string(c.f_plugin);
+        w.put_string(c.f_conflict);
+    }
+
+    std::string const tmp(filename + ".tmp" + std::to_string(getpid()));
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if(!out.is_open())
+        {
+            return false;
+        }
+        out.write(w.buffer().data(), w.buffer().size());
+        if(!out)
+        {
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
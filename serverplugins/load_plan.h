@@ -0,0 +1,93 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/names.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <vector>
+
+
+
+namespace serverplugins
+{
+
+
+
+class load_plan
+{
+public:
+    struct identity_t
+    {
+        std::uint64_t               f_device = 0;
+        std::uint64_t               f_inode = 0;
+        std::uint64_t               f_size = 0;
+        std::int64_t                f_mtime_sec = 0;
+        std::int64_t                f_mtime_nsec = 0;
+
+        bool                        operator == (identity_t const & rhs) const;
+        bool                        operator != (identity_t const & rhs) const;
+    };
+
+    struct entry_t
+    {
+        names::name_t               f_name = names::name_t();
+        names::filename_t           f_filename = names::filename_t();
+        identity_t                  f_identity = identity_t();
+    };
+    typedef std::vector<entry_t>    entry_vector_t;
+
+    struct conflict_t
+    {
+        names::name_t               f_plugin = names::name_t();
+        names::name_t               f_conflict = names::name_t();
+    };
+    typedef std::vector<conflict_t> conflict_vector_t;
+
+    static bool                     get_identity(names::filename_t const & filename, identity_t & identity);
+
+    void                            set_server_name(std::string const & name);
+    std::string const &             get_server_name() const;
+    void                            set_requested(names::names_t const & requested);
+    names::names_t const &          get_requested() const;
+    bool                            add_plugin(names::name_t const & name, names::filename_t const & filename);
+    entry_vector_t const &          get_plugins() const;
+    void                            add_conflict(names::name_t const & plugin, names::name_t const & conflict);
+    conflict_vector_t const &       get_conflicts() const;
+
+    bool                            is_current() const;
+    bool                            load(std::string const & filename);
+    bool                            save(std::string const & filename) const;
+
+private:
+    std::string                     f_server_name = std::string();
+    names::names_t                  f_requested = names::names_t();
+    entry_vector_t                  f_plugins = entry_vector_t();
+    conflict_vector_t               f_conflicts = conflict_vector_t();
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
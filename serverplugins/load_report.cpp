@@ -0,0 +1,359 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Timing of the different phases of loading plugins.
+ *
+ * The load report records when each phase of the startup begins and
+ * ends: the search for plugins, the resolution of the dependencies,
+ * the dlopen() of each plugin, its static initialization, and its
+ * bootstrap() call.
+ */
+
+// self
+//
+#include    "serverplugins/load_report.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <iomanip>
+#include    <sstream>
+
+
+// C
+//
+#include    <time.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Write a string as a JSON string.
+ *
+ * The phase and plugin names are expected to be simple identifiers,
+ * but a filename could include anything so we escape the characters
+ * that JSON requires us to escape.
+ *
+ * \param[in,out] out  The stream where the string gets written.
+ * \param[in] s  The string to write.
+ */
+void json_string(std::ostream & out, std::string const & s)
+{
+    out << '"';
+    for(auto const c : s)
+    {
+        switch(c)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+
+        case '\\':
+            out << "\\\\";
+            break;
+
+        case '\n':
+            out << "\\n";
+            break;
+
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                out << "\\u"
+                    << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(c)
+                    << std::dec << std::setfill(' ');
+            }
+            else
+            {
+                out << c;
+            }
+            break;
+
+        }
+    }
+    out << '"';
+}
+
+
+/** \brief Write a timestamp in microseconds.
+ *
+ * The Chrome trace format expects microseconds. We keep the nanoseconds
+ * as a fraction.
+ *
+ * \param[in,out] out  The stream where the number gets written.
+ * \param[in] ns  The timestamp in nanoseconds.
+ */
+void json_microseconds(std::ostream & out, load_report::timestamp_t ns)
+{
+    out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class load_report
+ * \brief Record the time spent in each phase of the startup.
+ *
+ * To know where the time goes when the plugins get loaded, create a
+ * load report and attach it to the names and/or the collection:
+ *
+ * \code
+ *     serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+ *     serverplugins::names n(p);
+ *     n.set_load_report(report);
+ *     n.find_plugins();
+ *     serverplugins::collection c(n);      // inherits the report
+ *     c.load_plugins(server);
+ *     report->save_chrome_trace("/tmp/startup.json");
+ * \endcode
+ *
+ * The phases recorded are:
+ *
+ * \li "find_plugins" -- names::find_plugins();
+ * \li "load_plugins" -- the whole collection::load_plugins() call;
+ * \li "load_plan" -- loading the plugins from a cached load plan;
+ * \li "resolve" -- loading the plugins and resolving their dependencies
+ *     and conflicts;
+ * \li "order" -- sorting the plugins;
+ * \li "dlopen" -- per plugin, from the start of dlopen() to the time the
+ *     plugin factory registers the plugin; this includes reading the
+ *     file, the relocations, and the construction of the plugin object;
+ * \li "static_init" -- per plugin, from the registration to the time
+ *     dlopen() returns; this is the rest of the static initializers;
+ * \li "bootstrap" -- per plugin, its bootstrap() call.
+ *
+ * The time is taken from CLOCK_MONOTONIC in nanoseconds.
+ *
+ * The functions are thread safe. Plugins loaded in parallel (see
+ * collection::set_load_workers()) get their events recorded with the
+ * identifier of the thread which loaded them.
+ */
+
+
+
+/** \brief Duration of the event.
+ *
+ * \return The duration of the event in nanoseconds.
+ */
+load_report::timestamp_t load_report::event_t::duration() const
+{
+    return f_end - f_start;
+}
+
+
+/** \brief Get the current monotonic time.
+ *
+ * \return The current time in nanoseconds.
+ */
+load_report::timestamp_t load_report::now()
+{
+    timespec t = {};
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return static_cast<timestamp_t>(t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+}
+
+
+/** \brief Add an event to the report.
+ *
+ * \param[in] phase  The name of the phase.
+ * \param[in] plugin  The name of the plugin or an empty string for a
+ * phase which is not specific to one plugin.
+ * \param[in] start  The time when the phase started.
+ * \param[in] end  The time when the phase ended.
+ */
+void load_report::add(
+      std::string const & phase
+    , std::string const & plugin
+    , timestamp_t start
+    , timestamp_t end)
+{
+    event_t e;
+    e.f_phase = phase;
+    e.f_plugin = plugin;
+    e.f_start = start;
+    e.f_end = end;
+    e.f_thread = cppthread::gettid();
+
+    cppthread::guard lock(f_mutex);
+    f_events.push_back(e);
+}
+
+
+/** \brief Retrieve a copy of all the events.
+ *
+ * \return The events in the order they were recorded.
+ */
+load_report::event_vector_t load_report::events() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_events;
+}
+
+
+/** \brief Get the time spent in each phase of each plugin.
+ *
+ * The events that are specific to a plugin are summed per plugin and
+ * phase. For example, this gives you the time spent in dlopen() and in
+ * bootstrap() for each plugin.
+ *
+ * \return A map of plugin names to a map of phases and durations.
+ */
+load_report::plugin_map_t load_report::plugins() const
+{
+    cppthread::guard lock(f_mutex);
+
+    plugin_map_t result;
+    for(auto const & e : f_events)
+    {
+        if(!e.f_plugin.empty())
+        {
+            result[e.f_plugin][e.f_phase] += e.duration();
+        }
+    }
+    return result;
+}
+
+
+/** \brief Get the time spent in each phase.
+ *
+ * All the events of one phase are summed, whether specific to a plugin
+ * or not. Note that phases include each others (i.e. "load_plugins"
+ * includes "resolve" which includes "dlopen") and the plugins loaded
+ * in parallel get their time added, so the sum can be larger than the
+ * elapsed time.
+ *
+ * \return A map of phases and durations.
+ */
+load_report::phase_map_t load_report::phases() const
+{
+    cppthread::guard lock(f_mutex);
+
+    phase_map_t result;
+    for(auto const & e : f_events)
+    {
+        result[e.f_phase] += e.duration();
+    }
+    return result;
+}
+
+
+/** \brief Remove all the events.
+ */
+void load_report::clear()
+{
+    cppthread::guard lock(f_mutex);
+    f_events.clear();
+}
+
+
+/** \brief Convert the report to the Chrome trace event format.
+ *
+ * This function generates a JSON document which can be loaded in
+ * `chrome://tracing`, Perfetto, or any other viewer supporting the
+ * trace event format. Each event is a "complete" event (`"ph":"X"`)
+ * named "<plugin> <phase>" (i.e. "testme bootstrap") with the phase as
+ * its category and the name of the plugin in its arguments. Events
+ * which are not specific to a plugin use the phase as their name.
+ *
+ * \return The JSON document.
+ */
+std::string load_report::to_chrome_trace() const
+{
+    event_vector_t const list(events());
+    pid_t const pid(getpid());
+
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char const * sep("");
+    for(auto const & e : list)
+    {
+        out << sep << "{\"name\":";
+        json_string(out, e.f_plugin.empty() ? e.f_phase : e.f_plugin + ' ' + e.f_phase);
+        out << ",\"cat\":";
+        json_string(out, e.f_phase);
+        out << ",\"ph\":\"X\",\"ts\":";
+        json_microseconds(out, e.f_start);
+        out << ",\"dur\":";
+        json_microseconds(out, e.duration());
+        out << ",\"pid\":" << pid
+            << ",\"tid\":" << e.f_thread;
+        if(!e.f_plugin.empty())
+        {
+            out << ",\"args\":{\"plugin\":";
+            json_string(out, e.f_plugin);
+            out << '}';
+        }
+        out << '}';
+        sep = ",";
+    }
+    out << "]}\n";
+
+    return out.str();
+}
+
+
+/** \brief Save the report in a file in the Chrome trace event format.
+ *
+ * \param[in] filename  The name of the output file.
+ *
+ * \return true if the file was written.
+ *
+ * \sa to_chrome_trace()
+ */
+bool load_report::save_chrome_trace(std::string const & filename) const
+{
+    std::ofstream out(filename);
+    if(!out.is_open())
+    {
+        return false;
+    }
+    out << to_chrome_trace();
+    return static_cast<bool>(out);
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
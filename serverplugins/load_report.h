@@ -0,0 +1,127 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <memory>
+#include    <string>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+class load_report
+{
+public:
+    typedef std::shared_ptr<load_report>    pointer_t;
+    typedef std::int64_t                    timestamp_t;    // nanoseconds, CLOCK_MONOTONIC
+
+    struct event_t
+    {
+        std::string                 f_phase = std::string();
+        std::string                 f_plugin = std::string();
+        timestamp_t                 f_start = 0;
+        timestamp_t                 f_end = 0;
+        pid_t                       f_thread = 0;
+
+        timestamp_t                 duration() const;
+    };
+    typedef std::vector<event_t>    event_vector_t;
+    typedef std::map<std::string, timestamp_t>
+                                    phase_map_t;            // phase -> duration
+    typedef std::map<std::string, phase_map_t>
+                                    plugin_map_t;           // plugin -> phases
+
+    static timestamp_t              now();
+
+    void                            add(
+                                          std::string const & phase
+                                        , std::string const & plugin
+                                        , timestamp_t start
+                                        , timestamp_t end = now());
+    event_vector_t                  events() const;
+    plugin_map_t                    plugins() const;
+    phase_map_t                     phases() const;
+    void                            clear();
+
+    std::string                     to_chrome_trace() const;
+    bool                            save_chrome_trace(std::string const & filename) const;
+
+private:
+    mutable cppthread::mutex        f_mutex = cppthread::mutex();
+    event_vector_t                  f_events = event_vector_t();
+};
+
+
+/** \brief Time a phase for a load report.
+ *
+ * This object records the time when it gets created and adds an event
+ * to the load report when destroyed. If the report pointer is null,
+ * nothing happens, so the cost when no report is attached is a test.
+ */
+class load_report_scope
+{
+public:
+    load_report_scope(load_report * report, char const * phase, std::string const & plugin = std::string())
+        : f_report(report)
+        , f_phase(phase)
+        , f_plugin(report == nullptr ? std::string() : plugin)
+        , f_start(report == nullptr ? 0 : load_report::now())
+    {
+    }
+
+    load_report_scope(load_report_scope const &) = delete;
+    load_report_scope & operator = (load_report_scope const &) = delete;
+
+    ~load_report_scope()
+    {
+        if(f_report != nullptr)
+        {
+            f_report->add(f_phase, f_plugin, f_start);
+        }
+    }
+
+private:
+    load_report *                   f_report = nullptr;
+    char const *                    f_phase = nullptr;
+    std::string                     f_plugin = std::string();
+    load_report::timestamp_t        f_start = 0;
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -21,19 +21,35 @@
 //
 #include    "serverplugins/names.h"
 
+#include    "serverplugins/discovery_index.h"
 #include    "serverplugins/exception.h"
+#include    "serverplugins/static_plugin.h"
+
+
+// cppthread
+//
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
 
 
 // snapdev
 //
-#include    <snapdev/glob_to_list.h>
 #include    <snapdev/pathinfo.h>
 #include    <snapdev/tokenize_string.h>
 
 
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+
+
 // C
 //
+#include    <dirent.h>
+#include    <fcntl.h>
 #include    <unistd.h>
+#include    <sys/stat.h>
 
 
 // last include
@@ -47,6 +63,293 @@ namespace serverplugins
 
 
 
+namespace
+{
+
+
+
+/** \brief One entry of a directory.
+ *
+ * The f_directory flag is only set when list_directory() is asked to
+ * determine the type of the entries.
+ */
+struct dir_entry_t
+{
+    std::string                 f_name = std::string();
+    bool                        f_directory = false;
+};
+
+typedef std::vector<dir_entry_t>    dir_entry_vector_t;
+
+
+/** \brief Read all the entries of a directory.
+ *
+ * The directory is opened with openat() and read with getdents64() in
+ * a large buffer so most directories are read with two calls (the
+ * second one returns 0). The "." and ".." entries are skipped.
+ *
+ * When \p with_types is true, the entries of an unknown type and the
+ * symbolic links are checked with fstatat() so f_directory is set
+ * for the sub-directories, including the ones reached through a link.
+ *
+ * \param[in] path  The path to the directory.
+ * \param[out] entries  The entries found in the directory.
+ * \param[in] with_types  Whether f_directory has to be set.
+ * \param[in,out] syscalls  Incremented by the number of system calls.
+ *
+ * \return true if the directory could be opened.
+ */
+bool list_directory(std::string const & path, dir_entry_vector_t & entries, bool with_types, std::size_t & syscalls)
+{
+    ++syscalls;
+    int const fd(openat(AT_FDCWD, path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    alignas(struct dirent64) char buffer[32 * 1024];
+    for(;;)
+    {
+        ++syscalls;
+        ssize_t const size(getdents64(fd, buffer, sizeof(buffer)));
+        if(size <= 0)
+        {
+            break;
+        }
+        for(ssize_t pos(0); pos < size;)
+        {
+            struct dirent64 const * e(reinterpret_cast<struct dirent64 const *>(buffer + pos));
+            pos += e->d_reclen;
+
+            dir_entry_t entry;
+            entry.f_name = e->d_name;
+            if(entry.f_name == "."
+            || entry.f_name == "..")
+            {
+                continue;
+            }
+            if(with_types)
+            {
+                if(e->d_type == DT_DIR)
+                {
+                    entry.f_directory = true;
+                }
+                else if(e->d_type == DT_LNK
+                     || e->d_type == DT_UNKNOWN)
+                {
+                    ++syscalls;
+                    struct stat st = {};
+                    entry.f_directory = fstatat(fd, e->d_name, &st, 0) == 0
+                                     && S_ISDIR(st.st_mode);
+                }
+            }
+            entries.push_back(entry);
+        }
+    }
+
+    ++syscalls;
+    close(fd);
+
+    return true;
+}
+
+
+/** \brief The result of the scan of one plugin path.
+ *
+ * The four vectors of files match the four glob() patterns that
+ * find_plugins() used before: `<prefix>*<suffix>.so`,
+ * `lib<prefix>*<suffix>.so`, `*\/<prefix>*<suffix>.so`, and
+ * `*\/lib<prefix>*<suffix>.so`, each sorted as glob() does.
+ *
+ * The listings of the directories that were read are kept so
+ * to_filename() can reuse them.
+ */
+struct scan_t
+{
+    std::vector<names::filename_t>  f_files[4] = {};
+    std::map<std::string, std::unordered_set<std::string>>
+                                    f_listings = std::map<std::string, std::unordered_set<std::string>>();
+    std::size_t                     f_syscalls = 0;
+    std::size_t                     f_previous_syscalls = 0;
+};
+
+
+/** \brief Scan one plugin path.
+ *
+ * The path is read once and each of its sub-directories once. The
+ * names are matched against the prefix and suffix in memory.
+ *
+ * The f_previous_syscalls counter estimates what the four glob() calls
+ * and the push() of each file would have cost: the path was read four
+ * times, each sub-directory twice, and each file found was checked
+ * once more.
+ *
+ * \param[in] path  The plugin path to scan.
+ * \param[in] prefix  The prefix of the plugin names.
+ * \param[in] suffix  The suffix of the plugin names.
+ * \param[out] scan  The result of the scan.
+ */
+void scan_path(std::string const & path, std::string const & prefix, std::string const & suffix, scan_t & scan)
+{
+    std::string const lib_prefix("lib" + prefix);
+    std::string const extension(suffix + ".so");
+    auto matches = [&extension](std::string const & basename, std::string const & start)
+    {
+        return basename.length() >= start.length() + extension.length()
+            && basename.compare(0, start.length(), start) == 0
+            && basename.compare(basename.length() - extension.length(), extension.length(), extension) == 0;
+    };
+
+    std::string const top(path + '/');
+    dir_entry_vector_t entries;
+    std::size_t syscalls(0);
+    list_directory(top, entries, true, syscalls);
+    scan.f_syscalls += syscalls;
+    scan.f_previous_syscalls += syscalls * 4;
+
+    std::sort(
+          entries.begin()
+        , entries.end()
+        , [](dir_entry_t const & lhs, dir_entry_t const & rhs)
+        {
+            return lhs.f_name < rhs.f_name;
+        });
+
+    std::unordered_set<std::string> & listing(scan.f_listings[top]);
+    for(auto const & e : entries)
+    {
+        listing.insert(e.f_name);
+
+        // glob() does not match hidden files with "*"
+        //
+        if(e.f_name[0] == '.')
+        {
+            continue;
+        }
+        if(matches(e.f_name, prefix))
+        {
+            scan.f_files[0].push_back(top + e.f_name);
+        }
+        if(matches(e.f_name, lib_prefix))
+        {
+            scan.f_files[1].push_back(top + e.f_name);
+        }
+    }
+
+    for(auto const & e : entries)
+    {
+        if(!e.f_directory
+        || e.f_name[0] == '.')
+        {
+            continue;
+        }
+
+        std::string const subdir(top + e.f_name + '/');
+        dir_entry_vector_t files;
+        syscalls = 0;
+        list_directory(subdir, files, false, syscalls);
+        scan.f_syscalls += syscalls;
+        scan.f_previous_syscalls += syscalls * 2;
+
+        std::unordered_set<std::string> & sublisting(scan.f_listings[subdir]);
+        for(auto const & f : files)
+        {
+            sublisting.insert(f.f_name);
+            if(f.f_name[0] == '.')
+            {
+                continue;
+            }
+            if(matches(f.f_name, prefix))
+            {
+                scan.f_files[2].push_back(subdir + f.f_name);
+            }
+            if(matches(f.f_name, lib_prefix))
+            {
+                scan.f_files[3].push_back(subdir + f.f_name);
+            }
+        }
+    }
+
+    // glob() sorts the whole paths
+    //
+    std::sort(scan.f_files[2].begin(), scan.f_files[2].end());
+    std::sort(scan.f_files[3].begin(), scan.f_files[3].end());
+
+    for(auto const & files : scan.f_files)
+    {
+        scan.f_previous_syscalls += files.size();
+    }
+}
+
+
+/** \brief Runner used to scan plugin paths in parallel.
+ *
+ * Each runner picks the next path to scan until all the paths are
+ * done. The results are saved in the slot of each path so they can
+ * be merged in order.
+ */
+class scan_runner
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<scan_runner>    pointer_t;
+
+                            scan_runner(
+                                  paths const & p
+                                , std::string const & prefix
+                                , std::string const & suffix
+                                , std::vector<scan_t> & scans
+                                , std::atomic<std::size_t> & next);
+                            scan_runner(scan_runner const &) = delete;
+    scan_runner &           operator = (scan_runner const &) = delete;
+
+    virtual void            run() override;
+
+private:
+    paths const &               f_paths;
+    std::string const &         f_prefix;
+    std::string const &         f_suffix;
+    std::vector<scan_t> &       f_scans;
+    std::atomic<std::size_t> &  f_next;
+};
+
+
+scan_runner::scan_runner(
+          paths const & p
+        , std::string const & prefix
+        , std::string const & suffix
+        , std::vector<scan_t> & scans
+        , std::atomic<std::size_t> & next)
+    : runner("plugin_scanner")
+    , f_paths(p)
+    , f_prefix(prefix)
+    , f_suffix(suffix)
+    , f_scans(scans)
+    , f_next(next)
+{
+}
+
+
+void scan_runner::run()
+{
+    for(;;)
+    {
+        std::size_t const idx(f_next.fetch_add(1));
+        if(idx >= f_scans.size())
+        {
+            return;
+        }
+        scan_path(f_paths.at(idx), f_prefix, f_suffix, f_scans[idx]);
+    }
+}
+
+
+
+} // no name namespace
+
+
+
 /** \class names
  * \brief Manage a list of plugins to be loaded.
  *
@@ -315,6 +618,14 @@ bool names::is_emcascript_reserved(std::string const & word)
  * If no such plugin is found, the function returns an empty string. Whether
  * to generate an error on such is your responsibility.
  *
+ * A plugin linked in the executable (see static_plugin) has priority
+ * over the plugin files. In that case the function returns its pseudo
+ * filename (i.e. "static:<name>") without searching the paths.
+ *
+ * Each directory gets read once and its list of entries is cached (see
+ * clear_directory_cache()). The function only calls access() on the
+ * files found in those lists.
+ *
  * \note
  * This function is used by add_name() which adds the name and the path in
  * the list of plugin names.
@@ -325,54 +636,75 @@ bool names::is_emcascript_reserved(std::string const & word)
  */
 names::filename_t names::to_filename(name_t const & name)
 {
-    auto check = [&name](paths::path_t const & path)
+    static_plugin const * const sp(static_plugin::find(name));
+    if(sp != nullptr)
+    {
+        return sp->filename();
+    }
+
+    // the listing tells us whether a file exists; access() still
+    // verifies that it is readable but only for the files found
+    //
+    auto found = [this](filename_t const & path, filename_t const & basename)
+    {
+        // without the cache, each candidate was an access() call
+        //
+        ++f_scan_counters.f_previous_syscalls;
+
+        directory_t const & dir(read_directory(path));
+        if(dir.f_entries.find(basename) == dir.f_entries.end())
+        {
+            return filename_t();
+        }
+        filename_t const filename(path + basename);
+        ++f_scan_counters.f_syscalls;
+        if(access(filename.c_str(), R_OK) != 0)
+        {
+            return filename_t();
+        }
+        return filename;
+    };
+
+    filename_t const so(name + ".so");
+    filename_t const libso("lib" + so);
+    auto check = [this, &name, &so, &libso, &found](paths::path_t const & path)
     {
         // "path/<name>.so"
         //
-        filename_t filename(path);
-        filename += name;
-        filename += ".so";
-        if(access(filename.c_str(), R_OK) == 0)
+        filename_t filename(found(path, so));
+        if(!filename.empty())
         {
             return filename;
         }
 
         // "path/lib<name>.so"
         //
-        filename = path;
-        filename += "lib";
-        filename += name;
-        filename += ".so";
-        if(access(filename.c_str(), R_OK) == 0)
+        filename = found(path, libso);
+        if(!filename.empty())
         {
             return filename;
         }
 
-        // "path/<name>/<name>.so"
+        // no need to read "path/<name>/" if it does not exist
         //
-        filename = path;
-        filename += name;
-        filename += '/';
-        filename += name;
-        filename += ".so";
-        if(access(filename.c_str(), R_OK) == 0)
+        directory_t const & dir(read_directory(path));
+        if(dir.f_entries.find(name) == dir.f_entries.end())
         {
-            return filename;
+            return filename_t();
         }
+        paths::path_t const subdir(path + name + '/');
 
-        // "path/<name>/lib<name>.so"
+        // "path/<name>/<name>.so"
         //
-        filename = path;
-        filename += name;
-        filename += "/lib";
-        filename += name;
-        filename += ".so";
-        if(access(filename.c_str(), R_OK) == 0)
+        filename = found(subdir, so);
+        if(!filename.empty())
         {
             return filename;
         }
 
-        return filename_t();
+        // "path/<name>/lib<name>.so"
+        //
+        return found(subdir, libso);
     };
 
     std::size_t const max(f_paths.size());
@@ -398,6 +730,56 @@ names::filename_t names::to_filename(name_t const & name)
 }
 
 
+/** \brief Forget the directory listings read by to_filename().
+ *
+ * The to_filename() function reads each directory once and keeps the
+ * list of its entries, including the fact that a directory does not
+ * exist. A plugin installed after that is not seen by to_filename()
+ * until this function gets called.
+ */
+void names::clear_directory_cache()
+{
+    f_directory_cache.clear();
+}
+
+
+/** \brief Get the list of entries of a directory.
+ *
+ * The first time a directory is requested, this function reads all of
+ * its entries at once (see list_directory()). The result is cached,
+ * including when the directory cannot be opened, so the following
+ * searches in that directory do not require any system call.
+ *
+ * \param[in] path  The path to the directory, ending with a '/'.
+ *
+ * \return The cached directory entries.
+ */
+names::directory_t const & names::read_directory(std::string const & path)
+{
+    auto const it(f_directory_cache.find(path));
+    if(it != f_directory_cache.end())
+    {
+        return it->second;
+    }
+
+    directory_t & dir(f_directory_cache[path]);
+
+    dir_entry_vector_t entries;
+    std::size_t syscalls(0);
+    if(list_directory(path, entries, false, syscalls))
+    {
+        ++f_scan_counters.f_directories;
+    }
+    f_scan_counters.f_syscalls += syscalls;
+    for(auto const & e : entries)
+    {
+        dir.f_entries.insert(e.f_name);
+    }
+
+    return dir;
+}
+
+
 /** \brief Add the name of a plugin to be loaded.
  *
  * The function adds a plugin name which the load function will load once
@@ -426,80 +808,104 @@ names::filename_t names::to_filename(name_t const & name)
  */
 void names::push(name_t const & name)
 {
-    name_t n;
-    filename_t fn;
-
-    std::string::size_type pos(name.rfind('/'));
+    std::string::size_type const pos(name.rfind('/'));
     if(pos != std::string::npos)
     {
         // we already received a path, extract the name and avoid calling
         // to_filename()
         //
-        ++pos;
-        if(name[pos + 0] == 'l'
-        && name[pos + 1] == 'i'
-        && name[pos + 2] == 'b')
-        {
-            pos += 3;
-        }
-        name_t::size_type l(name.length());
-        if(l >= 3
-        && name[l - 1] == 'o'
-        && name[l - 2] == 's'
-        && name[l - 3] == '.')
-        {
-            l -= 3;
-        }
-        n = name.substr(pos, l - pos);
-        if(!validate(n))
-        {
-            throw invalid_error(
-                      "invalid plugin name in \""
-                    + n
-                    + "\" (from path \""
-                    + name
-                    + "\").");
-        }
-        fn = name;
+        push_filename(name, true);
+        return;
+    }
 
-        // strangely enough, the .so files do not get the execute bit set
-        //
-        if(!snapdev::pathinfo::file_exists(fn, R_OK))
-        {
-            throw not_found(
-                      "plugin named \""
-                    + n
-                    + "\" not available at \""
-                    + fn
-                    + "\".");
-        }
+    if(!validate(name))
+    {
+        throw invalid_error(
+                  "invalid plugin name in \""
+                + name
+                + "\".");
     }
-    else
+    filename_t const fn(to_filename(name));
+    if(fn.empty())
     {
-        if(!validate(name))
-        {
-            throw invalid_error(
-                      "invalid plugin name in \""
-                    + name
-                    + "\".");
-        }
-        fn = to_filename(name);
-        if(fn.empty())
-        {
-            throw not_found(
-                      "plugin named \""
-                    + name
-                    + "\" not found in any of the specified paths.");
-        }
-        n = name;
+        throw not_found(
+                  "plugin named \""
+                + name
+                + "\" not found in any of the specified paths.");
     }
 
-    //if(n == "server")
+    //if(name == "server")
     //{
     //    throw invalid_error("the name \"server\" is reserved for the main running process.");
     //}
 
-    f_names[n] = fn;
+    f_names[name] = fn;
+}
+
+
+/** \brief Add a plugin by filename.
+ *
+ * This function extracts the name of the plugin from \p filename (i.e.
+ * the basename without the "lib" prefix and ".so" extension) and adds
+ * that name/filename pair to the map.
+ *
+ * \exception invalid_error
+ * The name extracted from \p filename is not a valid plugin name.
+ *
+ * \exception not_found
+ * The \p check_exists parameter is true and the file can't be read.
+ *
+ * \param[in] filename  The full filename of the plugin.
+ * \param[in] check_exists  Whether to verify that the file exists.
+ */
+void names::push_filename(filename_t const & filename, bool check_exists)
+{
+    std::string::size_type pos(filename.rfind('/'));
+    if(pos == std::string::npos)
+    {
+        pos = 0;
+    }
+    else
+    {
+        ++pos;
+    }
+    if(filename.compare(pos, 3, "lib") == 0)
+    {
+        pos += 3;
+    }
+    name_t::size_type l(filename.length());
+    if(l >= 3
+    && filename[l - 1] == 'o'
+    && filename[l - 2] == 's'
+    && filename[l - 3] == '.')
+    {
+        l -= 3;
+    }
+    name_t const n(l > pos ? filename.substr(pos, l - pos) : name_t());
+    if(!validate(n))
+    {
+        throw invalid_error(
+                  "invalid plugin name in \""
+                + n
+                + "\" (from path \""
+                + filename
+                + "\").");
+    }
+
+    // strangely enough, the .so files do not get the execute bit set
+    //
+    if(check_exists
+    && !snapdev::pathinfo::file_exists(filename, R_OK))
+    {
+        throw not_found(
+                  "plugin named \""
+                + n
+                + "\" not available at \""
+                + filename
+                + "\".");
+    }
+
+    f_names[n] = filename;
 }
 
 
@@ -527,9 +933,13 @@ void names::add(std::string const & set)
 
 /** \brief Retrieve the map of name/filename.
  *
- * This function is used to retrieve a copy of the map storing the plugin
- * name and filename pairs. This represents the complete list of plugins
- * to be loaded.
+ * This function is used to retrieve a reference to the map storing the
+ * plugin name and filename pairs. This represents the complete list of
+ * plugins to be loaded.
+ *
+ * \warning
+ * The reference remains valid as long as this names object exists.
+ * Calling push(), add(), or find_plugins() modifies the map.
  *
  * \note
  * When the find_plugins() function was called to generate the list of
@@ -544,12 +954,163 @@ void names::add(std::string const & set)
  *
  * \return The map of name/filename pairs.
  */
-names::names_t names::map() const
+names::names_t const & names::map() const
 {
     return f_names;
 }
 
 
+/** \brief Define the filename of the discovery index.
+ *
+ * By default, the find_plugins() function reads each one of the plugin
+ * paths and their sub-directories. When many paths are defined or the filesystem is slow
+ * (NFS, overlay filesystems in containers, etc.), that search can take
+ * a noticeable amount of time.
+ *
+ * When an index filename is defined, find_plugins() instead uses a
+ * discovery_index saved in that file. Only the directories which changed
+ * since the index was saved get read again. The index is then saved back
+ * if it changed.
+ *
+ * The file must be writable by the process for the index to be saved.
+ * If not, the index still gets used but the directories are read each
+ * time.
+ *
+ * \param[in] filename  The name of the index file or an empty string to
+ * not use an index.
+ */
+void names::set_index_filename(std::string const & filename)
+{
+    f_index_filename = filename;
+}
+
+
+/** \brief Get the filename of the discovery index.
+ *
+ * This function returns the filename defined with set_index_filename().
+ *
+ * \return The filename of the index or an empty string.
+ */
+std::string const & names::get_index_filename() const
+{
+    return f_index_filename;
+}
+
+
+/** \brief Attach a load report to these names.
+ *
+ * When a load report is attached, the time spent in find_plugins() gets
+ * recorded in it. The collection created from these names also inherits
+ * the report so the rest of the startup gets recorded in the same report.
+ *
+ * \param[in] report  The report or a null pointer to stop recording.
+ *
+ * \sa load_report
+ */
+void names::set_load_report(load_report::pointer_t report)
+{
+    f_load_report = report;
+}
+
+
+/** \brief Get the load report attached to these names.
+ *
+ * \return The load report or a null pointer.
+ */
+load_report::pointer_t names::get_load_report() const
+{
+    return f_load_report;
+}
+
+
+/** \brief Define the number of threads used to scan the plugin paths.
+ *
+ * By default, find_plugins() reads the plugin paths one after the other.
+ * When several paths are defined and the filesystem has a high latency
+ * (NFS, overlay filesystems in containers, etc.), reading them in
+ * parallel reduces the time spent in find_plugins().
+ *
+ * The number of threads used is limited to the number of paths. A value
+ * of 0 or 1 means the paths are read by the calling thread.
+ *
+ * \param[in] workers  The maximum number of threads to use.
+ */
+void names::set_scan_workers(std::size_t workers)
+{
+    f_scan_workers = workers;
+}
+
+
+/** \brief Get the number of threads used to scan the plugin paths.
+ *
+ * \return The number of threads defined with set_scan_workers().
+ */
+std::size_t names::get_scan_workers() const
+{
+    return f_scan_workers;
+}
+
+
+/** \brief Whether find_plugins() also adds the static plugins.
+ *
+ * By default, find_plugins() only searches the plugin paths (or the
+ * discovery index). A server which links some of its plugins in the
+ * executable (see static_plugin) calls this function with true to get
+ * those plugins added too. This is not the default since the static
+ * plugins would otherwise get loaded by any server using the same
+ * executable or library, whatever its paths say.
+ *
+ * The static plugins are always found by to_filename(), so this is only
+ * necessary when loading all the available plugins.
+ *
+ * \param[in] find  Whether find_plugins() adds the static plugins.
+ */
+void names::set_find_static_plugins(bool find)
+{
+    f_find_static_plugins = find;
+}
+
+
+/** \brief Check whether find_plugins() adds the static plugins.
+ *
+ * \return The flag defined with set_find_static_plugins().
+ */
+bool names::get_find_static_plugins() const
+{
+    return f_find_static_plugins;
+}
+
+
+/** \brief Get the directory scanning counters.
+ *
+ * The find_plugins() and to_filename() functions count the number of
+ * directories they read and the number of system calls they make. They
+ * also estimate the number of system calls the previous implementation
+ * (one glob() per layout and one access() per candidate) would have
+ * made so the saving can be reported.
+ *
+ * The counters are cumulative.
+ *
+ * \return A copy of the counters.
+ */
+names::scan_counters_t names::get_scan_counters() const
+{
+    return f_scan_counters;
+}
+
+
+/** \brief Compute the number of system calls saved.
+ *
+ * \return The difference between the estimated and actual number of
+ * system calls. It may be negative when very few plugins are searched.
+ */
+std::int64_t names::scan_counters_t::saved() const
+{
+    return static_cast<std::int64_t>(f_previous_syscalls)
+         - static_cast<std::int64_t>(f_syscalls);
+}
+
+
 /** \brief Read all the available plugins in the specified paths.
  *
  * There are two ways that this class can be used:
@@ -559,8 +1120,7 @@ names::names_t names::map() const
  *
  * * Second, the user adds the plugins to a directory and the idea is to
  * have all of them loaded. In this second case, you use the find_plugins()
- * which runs glob() in those paths to retrieve all the plugins that can
- * be loaded.
+ * which reads those paths to retrieve all the plugins that can be loaded.
  *
  * Note that this function only finds the plugins. It doesn't load them. To
  * then load all of these plugins, use the load_plugins() function.
@@ -585,41 +1145,199 @@ names::names_t names::map() const
  * words, the "lib" prefix and ".so" suffix are already handled by this
  * function. You do not need to specify these at all.
  *
+ * Each path and each of its sub-directories is read once and the four
+ * possible layouts (`<name>.so`, `lib<name>.so`, `<name>/<name>.so`, and
+ * `<name>/lib<name>.so`) are matched in memory. The results are the same
+ * as with one glob() per layout. The paths can be read in parallel (see
+ * set_scan_workers()). The directory listings are kept for
+ * to_filename().
+ *
+ * If an index filename was defined with set_index_filename(), the
+ * function uses the discovery index instead.
+ *
+ * If set_find_static_plugins() was called with true, the plugins linked
+ * in the executable (see static_plugin) which match the prefix and suffix
+ * are also added. They replace plugin files with the same name.
+ *
  * \warning
  * You must call the add_path() function with all the paths that you want
  * to support before calling this function.
  *
  * \param[in] prefix  The prefix used to search the plugins.
  * \param[in] suffix  The suffix used to search the plugins.
+ *
+ * \sa set_index_filename()
+ * \sa set_find_static_plugins()
  */
 void names::find_plugins(name_t const & prefix, name_t const & suffix)
 {
-    snapdev::glob_to_list<std::vector<std::string>> glob;
+    load_report_scope const scope(f_load_report.get(), "find_plugins");
+
+    if(!f_index_filename.empty())
+    {
+        find_indexed_plugins(prefix, suffix);
+        if(f_find_static_plugins)
+        {
+            find_static_plugins(prefix, suffix);
+        }
+        return;
+    }
 
     std::size_t const max(f_paths.size());
-    for(std::size_t idx(0); idx < max; ++idx)
+    std::vector<scan_t> scans(max);
+    std::atomic<std::size_t> next(0);
+    std::size_t const workers(std::min(f_scan_workers, max));
+    if(workers <= 1)
     {
-        glob.read_path<
-                  snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_EMPTY
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_PERIOD>(f_paths.at(idx) + "/" + prefix + "*" + suffix + ".so");
-        glob.read_path<
-                  snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_EMPTY
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_PERIOD>(f_paths.at(idx) + "/lib" + prefix + "*" + suffix + ".so");
-        glob.read_path<
-                  snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_EMPTY
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_PERIOD>(f_paths.at(idx) + "/*/" + prefix + "*" + suffix + ".so");
-        glob.read_path<
-                  snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_EMPTY
-                , snapdev::glob_to_list_flag_t::GLOB_FLAG_PERIOD>(f_paths.at(idx) + "/*/lib" + prefix + "*" + suffix + ".so");
-    }
-
-    for(auto const & n : glob)
+        scan_runner(f_paths, prefix, suffix, scans, next).run();
+    }
+    else
     {
-        push(n);
+        std::vector<scan_runner::pointer_t> runners;
+        std::vector<cppthread::thread::pointer_t> threads;
+        for(std::size_t idx(0); idx < workers; ++idx)
+        {
+            runners.push_back(std::make_shared<scan_runner>(f_paths, prefix, suffix, scans, next));
+            threads.push_back(std::make_shared<cppthread::thread>("plugin_scanner", runners.back().get()));
+            if(!threads.back()->start())
+            {
+                threads.pop_back();             // LCOV_EXCL_LINE
+                runners.pop_back();             // LCOV_EXCL_LINE
+            }
+        }
+
+        // scan what the threads did not pick up, if any
+        //
+        scan_runner(f_paths, prefix, suffix, scans, next).run();
+
+        for(auto & t : threads)
+        {
+            t->stop();
+        }
+    }
+
+    // merge in the same order as the glob() results were pushed so the
+    // same file wins when a name is found more than once
+    //
+    for(auto & scan : scans)
+    {
+        for(auto const & files : scan.f_files)
+        {
+            for(auto const & filename : files)
+            {
+                push_filename(filename, false);
+            }
+        }
+        for(auto & l : scan.f_listings)
+        {
+            f_directory_cache[l.first].f_entries = std::move(l.second);
+        }
+        f_scan_counters.f_directories += scan.f_listings.size();
+        f_scan_counters.f_syscalls += scan.f_syscalls;
+        f_scan_counters.f_previous_syscalls += scan.f_previous_syscalls;
+    }
+
+    if(f_find_static_plugins)
+    {
+        find_static_plugins(prefix, suffix);
+    }
+}
+
+
+/** \brief Add the static plugins matching the prefix and suffix.
+ *
+ * This function goes through the table of plugins linked in the
+ * executable and adds the ones which names start with \p prefix and
+ * end with \p suffix.
+ *
+ * \param[in] prefix  The prefix used to search the plugins.
+ * \param[in] suffix  The suffix used to search the plugins.
+ */
+void names::find_static_plugins(name_t const & prefix, name_t const & suffix)
+{
+    for(static_plugin const * sp(static_plugin::first()); sp != nullptr; sp = sp->next())
+    {
+        name_t const name(sp->name());
+        if(name.length() >= prefix.length() + suffix.length()
+        && name.compare(0, prefix.length(), prefix) == 0
+        && name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0)
+        {
+            f_names[name] = sp->filename();
+        }
+    }
+}
+
+
+/** \brief Find the plugins using the discovery index.
+ *
+ * This function loads the discovery index, refreshes it, and then
+ * searches the files it lists. The files are filtered in memory in the
+ * same order as the glob() patterns used by find_plugins() so the
+ * results are the same.
+ *
+ * The files listed in the index were found on disk by refresh() so the
+ * function does not verify their existence again.
+ *
+ * \param[in] prefix  The prefix used to search the plugins.
+ * \param[in] suffix  The suffix used to search the plugins.
+ */
+void names::find_indexed_plugins(name_t const & prefix, name_t const & suffix)
+{
+    discovery_index index;
+    index.load(f_index_filename);
+    if(index.refresh(f_paths))
+    {
+        // not being able to save is not an error, we just lose the cache
+        //
+        index.save(f_index_filename);
+    }
+
+    std::string const lib_prefix("lib" + prefix);
+    std::string const extension(suffix + ".so");
+    auto matches = [&extension](std::string const & basename, std::string const & start)
+    {
+        return basename.length() >= start.length() + extension.length()
+            && basename.compare(0, start.length(), start) == 0
+            && basename.compare(basename.length() - extension.length(), extension.length(), extension) == 0;
+    };
+
+    std::size_t const max(f_paths.size());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        paths::path_t const path(f_paths.at(idx));
+        discovery_index::file_vector_t const files(index.files(path));
+
+        // same order as the glob() patterns: top directory first then
+        // sub-directories, in each case without and then with "lib"; and
+        // like glob(), each pattern result is sorted by whole path (the
+        // index sorts the sub-directory names, which is not the same:
+        // "a-b/x.so" comes before "a/x.so")
+        //
+        for(int sub(0); sub < 2; ++sub)
+        {
+            for(auto const & start : { prefix, lib_prefix })
+            {
+                std::vector<filename_t> found;
+                for(auto const & f : files)
+                {
+                    std::string::size_type const pos(f.f_filename.rfind('/'));
+                    bool const in_subdirectory(pos != path.length());
+                    if(in_subdirectory != (sub == 1))
+                    {
+                        continue;
+                    }
+                    if(matches(f.f_filename.substr(pos + 1), start))
+                    {
+                        found.push_back(f.f_filename);
+                    }
+                }
+                std::sort(found.begin(), found.end());
+                for(auto const & filename : found)
+                {
+                    push_filename(filename, false);
+                }
+            }
+        }
     }
 }
 
@@ -20,12 +20,15 @@
 
 // self
 //
+#include    <serverplugins/load_report.h>
 #include    <serverplugins/paths.h>
 
 
 // C++
 //
+#include    <cstdint>
 #include    <map>
+#include    <unordered_set>
 
 
 
@@ -41,22 +44,60 @@ public:
     typedef std::string                     filename_t;
     typedef std::map<name_t, filename_t>    names_t;
 
+    struct scan_counters_t
+    {
+        std::size_t                     f_directories = 0;
+        std::size_t                     f_syscalls = 0;
+        std::size_t                     f_previous_syscalls = 0;
+
+        std::int64_t                    saved() const;
+    };
+
                                         names(paths const & paths, bool script_names = false);
 
     bool                                validate(name_t const & name);
     bool                                is_emcascript_reserved(std::string const & word);
 
     filename_t                          to_filename(name_t const & name);
+    void                                clear_directory_cache();
     void                                push(name_t const & name);
     void                                add(std::string const & set);
-    names_t                             map() const;
+    names_t const &                     map() const;
 
+    void                                set_index_filename(std::string const & filename);
+    std::string const &                 get_index_filename() const;
     void                                find_plugins(name_t const & prefix = name_t(), name_t const & suffix = name_t());
+    void                                set_scan_workers(std::size_t workers);
+    std::size_t                         get_scan_workers() const;
+    void                                set_find_static_plugins(bool find);
+    bool                                get_find_static_plugins() const;
+    scan_counters_t                     get_scan_counters() const;
+
+    void                                set_load_report(load_report::pointer_t report);
+    load_report::pointer_t              get_load_report() const;
 
 private:
+    struct directory_t
+    {
+        std::unordered_set<std::string> f_entries = std::unordered_set<std::string>();
+    };
+    typedef std::map<std::string, directory_t>
+                                        directory_cache_t;
+
+    directory_t const &                 read_directory(std::string const & path);
+    void                                push_filename(filename_t const & filename, bool check_exists);
+    void                                find_indexed_plugins(name_t const & prefix, name_t const & suffix);
+    void                                find_static_plugins(name_t const & prefix, name_t const & suffix);
+
     paths const                         f_paths;
     bool const                          f_prevent_script_keywords = false;
     names_t                             f_names = names_t();
+    std::string                         f_index_filename = std::string();
+    load_report::pointer_t              f_load_report = load_report::pointer_t();
+    directory_cache_t                   f_directory_cache = directory_cache_t();
+    std::size_t                         f_scan_workers = 1;
+    bool                                f_find_static_plugins = false;
+    scan_counters_t                     f_scan_counters = scan_counters_t();
 };
 
 
@@ -0,0 +1,450 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Read the plugin definition without loading the plugin.
+ *
+ * The SERVERPLUGINS_END() macro saves a copy of the plugin definition in
+ * an ELF note named "serverplugins". The functions defined here read that
+ * note directly from the file. This gives us access to the name, versions,
+ * dependencies, conflicts, etc. of a plugin without having to dlopen() it
+ * which means we can verify a complete set of plugins before running any
+ * of their code.
+ */
+
+// self
+//
+#include    "serverplugins/note.h"
+
+#include    "serverplugins/static_plugin.h"
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#include    <elf.h>
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Parse a number.
+ *
+ * This function parses a decimal number. The number may be negative.
+ *
+ * \param[in] s  The string to parse.
+ * \param[out] value  The resulting value.
+ *
+ * \return true if the whole string was a valid number.
+ */
+bool parse_number(std::string const & s, std::int64_t & value)
+{
+    value = 0;
+    if(s.empty())
+    {
+        return false;
+    }
+    std::string::size_type pos(0);
+    bool const negative(s[0] == '-');
+    if(negative)
+    {
+        ++pos;
+        if(pos == s.length())
+        {
+            return false;
+        }
+    }
+    for(; pos < s.length(); ++pos)
+    {
+        if(s[pos] < '0' || s[pos] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + s[pos] - '0';
+    }
+    if(negative)
+    {
+        value = -value;
+    }
+    return true;
+}
+
+
+/** \brief Parse a version.
+ *
+ * The versions are saved as "<major>.<minor>.<patch>" in the note.
+ *
+ * \param[in] s  The string to parse.
+ * \param[out] version  The resulting version.
+ *
+ * \return true if the version was valid.
+ */
+bool parse_version(std::string const & s, version_t & version)
+{
+    std::string::size_type const p1(s.find('.'));
+    if(p1 == std::string::npos)
+    {
+        return false;
+    }
+    std::string::size_type const p2(s.find('.', p1 + 1));
+    if(p2 == std::string::npos)
+    {
+        return false;
+    }
+    std::int64_t major(0);
+    std::int64_t minor(0);
+    std::int64_t patch(0);
+    if(!parse_number(s.substr(0, p1), major)
+    || !parse_number(s.substr(p1 + 1, p2 - p1 - 1), minor)
+    || !parse_number(s.substr(p2 + 1), patch))
+    {
+        return false;
+    }
+    version.f_major = static_cast<version_t::number_t>(major);
+    version.f_minor = static_cast<version_t::number_t>(minor);
+    version.f_patch = static_cast<version_t::number_t>(patch);
+    return true;
+}
+
+
+/** \brief Search the ELF file for our note.
+ *
+ * This function goes through the section headers of an ELF file and
+ * searches the SHT_NOTE sections for the "serverplugins" note. All the
+ * offsets and sizes are verified against the size of the file before use.
+ *
+ * \tparam EHDR  The ELF header structure (32 or 64 bits).
+ * \tparam SHDR  The ELF section header structure (32 or 64 bits).
+ * \tparam NHDR  The ELF note header structure (32 or 64 bits).
+ * \param[in] data  The file data.
+ * \param[in] size  The size of the file.
+ * \param[out] def  The definition to fill.
+ * \param[out] digest  If not nullptr, receives the digest of the note.
+ *
+ * \return true if the note was found and valid.
+ */
+template<typename EHDR, typename SHDR, typename NHDR>
+bool find_note(char const * data, std::size_t size, definition & def, std::uint64_t * digest)
+{
+    if(size < sizeof(EHDR))
+    {
+        return false;
+    }
+    EHDR ehdr;
+    memcpy(&ehdr, data, sizeof(ehdr));
+    if(ehdr.e_shoff == 0
+    || ehdr.e_shentsize != sizeof(SHDR)
+    || ehdr.e_shoff > size
+    || static_cast<std::size_t>(ehdr.e_shnum) * sizeof(SHDR) > size - ehdr.e_shoff)
+    {
+        return false;
+    }
+
+    for(std::size_t idx(0); idx < ehdr.e_shnum; ++idx)
+    {
+        SHDR shdr;
+        memcpy(&shdr, data + ehdr.e_shoff + idx * sizeof(SHDR), sizeof(shdr));
+        if(shdr.sh_type != SHT_NOTE
+        || shdr.sh_offset > size
+        || shdr.sh_size > size - shdr.sh_offset)
+        {
+            continue;
+        }
+
+        std::size_t pos(shdr.sh_offset);
+        std::size_t const end(shdr.sh_offset + shdr.sh_size);
+        while(end - pos >= sizeof(NHDR))
+        {
+            NHDR nhdr;
+            memcpy(&nhdr, data + pos, sizeof(nhdr));
+            pos += sizeof(NHDR);
+            std::size_t const name_size((nhdr.n_namesz + 3) & ~3);
+            std::size_t const desc_size((nhdr.n_descsz + 3) & ~3);
+            if(name_size > end - pos
+            || desc_size > end - pos - name_size)
+            {
+                break;
+            }
+            if(nhdr.n_type == detail::DEFINITION_NOTE_TYPE
+            && nhdr.n_namesz == sizeof(detail::DEFINITION_NOTE_NAME)
+            && memcmp(data + pos, detail::DEFINITION_NOTE_NAME, sizeof(detail::DEFINITION_NOTE_NAME)) == 0)
+            {
+                if(digest != nullptr)
+                {
+                    *digest = definition_digest(data + pos + name_size, nhdr.n_descsz);
+                }
+                return parse_definition_note(data + pos + name_size, nhdr.n_descsz, def);
+            }
+            pos += name_size + desc_size;
+        }
+    }
+
+    return false;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Compute the digest of a plugin definition note.
+ *
+ * This function computes a 64 bit FNV-1a hash of the description of a
+ * plugin definition note. This is used to quickly detect whether the
+ * definition of a plugin changed (see discovery_index).
+ *
+ * The digest is never 0 so 0 can be used to represent "no digest".
+ *
+ * \param[in] data  The description of the note.
+ * \param[in] size  The size of the description in bytes.
+ *
+ * \return The digest of the note.
+ */
+std::uint64_t definition_digest(char const * data, std::size_t size)
+{
+    std::uint64_t digest(0xcbf29ce484222325ULL);
+    for(std::size_t idx(0); idx < size; ++idx)
+    {
+        digest ^= static_cast<unsigned char>(data[idx]);
+        digest *= 0x100000001b3ULL;
+    }
+    return digest == 0 ? 1 : digest;
+}
+
+
+/** \brief Parse the description of a plugin definition note.
+ *
+ * This function parses the list of "<field>=<value>" strings saved in
+ * the definition note by the SERVERPLUGINS_END() macro and saves the
+ * values in \p def.
+ *
+ * Unknown fields are ignored so newer plugins can add fields without
+ * breaking older readers.
+ *
+ * \param[in] data  The description of the note.
+ * \param[in] size  The size of the description in bytes.
+ * \param[out] def  The definition to fill.
+ *
+ * \return true if the description was valid and included a name.
+ */
+bool parse_definition_note(char const * data, std::size_t size, definition & def)
+{
+    def = definition();
+
+    std::size_t pos(0);
+    while(pos < size)
+    {
+        char const * s(data + pos);
+        char const * e(static_cast<char const *>(memchr(s, '\0', size - pos)));
+        if(e == nullptr)
+        {
+            return false;
+        }
+        pos += e - s + 1;
+
+        char const * equal(static_cast<char const *>(memchr(s, '=', e - s)));
+        if(equal == nullptr)
+        {
+            return false;
+        }
+        std::string const field(s, equal - s);
+        std::string const value(equal + 1, e - equal - 1);
+
+        if(field == "version")
+        {
+            if(!parse_version(value, def.f_version))
+            {
+                return false;
+            }
+        }
+        else if(field == "library_version")
+        {
+            if(!parse_version(value, def.f_library_version))
+            {
+                return false;
+            }
+        }
+        else if(field == "last_modification")
+        {
+            std::int64_t t(0);
+            if(!parse_number(value, t))
+            {
+                return false;
+            }
+            def.f_last_modification = static_cast<time_t>(t);
+        }
+        else if(field == "name")
+        {
+            def.f_name = value;
+        }
+        else if(field == "description")
+        {
+            def.f_description = value;
+        }
+        else if(field == "help_uri")
+        {
+            def.f_help_uri = value;
+        }
+        else if(field == "icon")
+        {
+            def.f_icon = value;
+        }
+        else if(field == "categorization_tag")
+        {
+            def.f_categorization_tags.insert(value);
+        }
+        else if(field == "dependency")
+        {
+            def.f_dependencies.insert(value);
+        }
+        else if(field == "conflict")
+        {
+            def.f_conflicts.insert(value);
+        }
+        else if(field == "suggestion")
+        {
+            def.f_suggestions.insert(value);
+        }
+        else if(field == "settings_path")
+        {
+            def.f_settings_path = value;
+        }
+        else if(field == "interest")
+        {
+            def.f_interests.insert(value);
+        }
+    }
+
+    return !def.f_name.empty();
+}
+
+
+/** \brief Read the definition of a plugin without loading it.
+ *
+ * This function memory maps the specified file and searches its ELF
+ * sections for the note created by the SERVERPLUGINS_END() macro. If
+ * found, the note gets parsed and the result is saved in \p def.
+ *
+ * No code from the plugin is executed and the file is not dlopen()'ed.
+ * Only the ELF headers, the section headers, and the notes get read.
+ *
+ * The function returns false if the file cannot be opened, is not an
+ * ELF file of the same byte order as this process, or does not include
+ * the note (i.e. a plugin compiled with an older version of this library).
+ *
+ * When \p filename is the pseudo filename of a plugin linked in the
+ * executable (see static_plugin), the definition is copied from the
+ * table of static plugins. There is no note to compute a digest from
+ * so \p digest is set to 0.
+ *
+ * \param[in] filename  The name of the plugin file.
+ * \param[out] def  The definition to fill.
+ * \param[out] digest  If not nullptr, receives the digest of the note
+ * (see definition_digest()).
+ *
+ * \return true if the definition was found and \p def was set.
+ */
+bool read_definition_note(names::filename_t const & filename, definition & def, std::uint64_t * digest)
+{
+    static_plugin const * const sp(static_plugin::find_by_filename(filename));
+    if(sp != nullptr)
+    {
+        def = sp->plugin_definition();
+        if(digest != nullptr)
+        {
+            *digest = 0;
+        }
+        return true;
+    }
+
+    int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st = {};
+    if(fstat(fd, &st) != 0
+    || st.st_size < static_cast<off_t>(EI_NIDENT))
+    {
+        close(fd);
+        return false;
+    }
+
+    std::size_t const size(st.st_size);
+    void * ptr(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if(ptr == MAP_FAILED)
+    {
+        return false;
+    }
+    char const * data(static_cast<char const *>(ptr));
+
+    bool result(false);
+    if(memcmp(data, ELFMAG, SELFMAG) == 0)
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        bool const native(data[EI_DATA] == ELFDATA2LSB);
+#else
+        bool const native(data[EI_DATA] == ELFDATA2MSB);
+#endif
+        if(native)
+        {
+            if(data[EI_CLASS] == ELFCLASS64)
+            {
+                result = find_note<Elf64_Ehdr, Elf64_Shdr, Elf64_Nhdr>(data, size, def, digest);
+            }
+            else if(data[EI_CLASS] == ELFCLASS32)
+            {
+                result = find_note<Elf32_Ehdr, Elf32_Shdr, Elf32_Nhdr>(data, size, def, digest);
+            }
+        }
+    }
+
+    munmap(ptr, size);
+
+    return result;
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,40 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/definition.h>
+#include    <serverplugins/names.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+bool                    read_definition_note(names::filename_t const & filename, definition & def, std::uint64_t * digest = nullptr);
+std::uint64_t           definition_digest(char const * data, std::size_t size);
+bool                    parse_definition_note(char const * data, std::size_t size, definition & def);
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
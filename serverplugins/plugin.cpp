@@ -21,7 +21,14 @@
 //
 #include    "serverplugins/plugin.h"
 
+#include    "serverplugins/collection.h"
 #include    "serverplugins/factory.h"
+#include    "serverplugins/signals.h"
+
+
+// C++
+//
+#include    <utility>
 
 
 // last include
@@ -82,12 +89,13 @@ plugin::plugin(factory const & f)
  * destructor.
  *
  * \note
- * At the moment this destructor is never called. We'll want to look into
- * a proper way to dlclose() plugins at some point.
+ * This destructor only gets called when the plugin is unloaded with
+ * collection::unload_plugin() or collection::reload_plugin(). Otherwise
+ * the plugins remain in memory until the process exits.
  */
-plugin::~plugin()           // LCOV_EXCL_LINE
-{                           // LCOV_EXCL_LINE
-}                           // LCOV_EXCL_LINE
+plugin::~plugin()
+{
+}
 
 
 /** \brief Initialize the f_plugin pointer in the plugin factory.
@@ -305,6 +313,25 @@ std::string plugin::settings_path() const
 }
 
 
+/** \brief List of signals this plugin listens to.
+ *
+ * This function returns the signals this plugin declared an interest
+ * in with `::serverplugins::interest("<emitter>", "<signal>")` in its
+ * definition. Each one is named `<emitter>::<signal>`. When the
+ * collection loads plugins lazily, the first emission of one of these
+ * signals by that emitter loads this plugin so it can connect to it in
+ * its bootstrap() function.
+ *
+ * \return The set of signals this plugin listens to.
+ *
+ * \sa collection::set_lazy()
+ */
+string_set_t plugin::interests() const
+{
+    return f_factory->plugin_definition().f_interests;
+}
+
+
 /** \brief Give the plugin a chance to properly initialize itself.
  *
  * The order in which plugins are loaded is generally just alphabetical
@@ -366,5 +393,146 @@ time_t plugin::do_update(time_t last_updated, unsigned int phase)
 
 
 
+namespace detail
+{
+
+
+/** \brief Start tracking a signal emitted by a plugin.
+ * \private
+ *
+ * If the plugin emitting the signal is part of a collection, the deferred
+ * plugins interested in \p signal of \p emitter get loaded first and then the signal
+ * is marked as in flight until the guard is destroyed.
+ *
+ * Once the collection is frozen, the guard does neither.
+ *
+ * \param[in] emitter  The plugin emitting the signal.
+ * \param[in] signal  The name of the signal.
+ */
+signal_guard::signal_guard(plugin const * emitter, char const * signal)
+    : f_collection(emitter->plugins())
+{
+    // a frozen collection has no deferred plugins and cannot unload
+    // any plugin so there is nothing to track
+    //
+    if(f_collection != nullptr
+    && !f_collection->is_frozen())
+    {
+        f_collection->materialize_listeners(emitter->name(), signal);
+        f_epoch = f_collection->signal_enter();
+        f_in_flight = true;
+    }
+}
+
+
+/** \brief Get the delivery pool of the emitter collection.
+ * \private
+ *
+ * Once created, the pool is never replaced and it lives as long as the
+ * collection. So the collection keeps a plain pointer to it which the
+ * signals read without locking the collection.
+ *
+ * \return The delivery pool or nullptr if the emitter is not part of
+ * a collection.
+ */
+delivery_pool * signal_guard::get_delivery_pool() const
+{
+    if(f_collection == nullptr)
+    {
+        return nullptr;
+    }
+
+    delivery_pool * pool(f_collection->f_delivery_pool_ptr.load(std::memory_order_acquire));
+    if(pool == nullptr)
+    {
+        pool = f_collection->get_delivery_pool().get();
+    }
+    return pool;
+}
+
+
+/** \brief Get the executor of the emitter collection.
+ * \private
+ *
+ * \return The executor or nullptr if the emitter is not part of a
+ * collection or the collection has no executor.
+ */
+executor::pointer_t signal_guard::get_executor() const
+{
+    if(f_collection == nullptr)
+    {
+        return executor::pointer_t();
+    }
+    return f_collection->get_executor();
+}
+
+
+/** \brief Get a guard tracking the task of an awaitable signal.
+ * \private
+ *
+ * A frozen collection cannot unload plugins so its tasks do not need
+ * to be tracked.
+ *
+ * \return A guard to keep until the task of the emission is done.
+ */
+task_guard signal_guard::start_task() const
+{
+    if(f_collection == nullptr
+    || f_collection->is_frozen())
+    {
+        return task_guard();
+    }
+    return task_guard(f_collection);
+}
+
+
+/** \brief Mark the signal as done.
+ * \private
+ */
+void signal_guard::leave()
+{
+    f_collection->signal_leave(f_epoch);
+}
+
+
+/** \brief Count one more pending task in \p c.
+ * \private
+ *
+ * \param[in] c  The collection of the emitter.
+ */
+task_guard::task_guard(collection * c)
+    : f_collection(c)
+{
+    f_collection->f_tasks_in_flight.fetch_add(1);
+}
+
+
+/** \brief Move the tracking of a task to a new guard.
+ * \private
+ *
+ * \param[in,out] rhs  The guard to move; it tracks nothing afterward.
+ */
+task_guard::task_guard(task_guard && rhs) noexcept
+    : f_collection(std::exchange(rhs.f_collection, nullptr))
+{
+}
+
+
+/** \brief Mark the task as done.
+ * \private
+ */
+task_guard::~task_guard()
+{
+    if(f_collection != nullptr)
+    {
+        f_collection->f_tasks_in_flight.fetch_sub(1);
+    }
+}
+
+
+} // namespace detail
+
+
+
 } // namespace serverplugins
 // vim: ts=4 sw=4 et
@@ -22,6 +22,7 @@
 //
 #include    <serverplugins/names.h>
 #include    <serverplugins/definition.h>
+#include    <serverplugins/typed_signal.h>
 
 
 // C++
@@ -51,7 +52,7 @@ class plugin
 public:
     typedef std::shared_ptr<plugin>     pointer_t;
     typedef std::vector<pointer_t>      vector_t;       // sorted by dependencies & then by name
-    typedef std::map<std::string, pointer_t>
+    typedef std::map<std::string, pointer_t, std::less<>>
                                         map_t;          // sorted by name
 
                                         plugin();       // for the server
@@ -77,6 +78,7 @@ public:
     string_set_t                        conflicts() const;
     string_set_t                        suggestions() const;
     std::string                         settings_path() const;
+    string_set_t                        interests() const;
 
     virtual void                        bootstrap();
     virtual time_t                      do_update(time_t last_updated, unsigned int phase = 0);
@@ -152,15 +154,42 @@ constexpr char const * name_without_namespace(char const * fullname)
  *     useful to have the callback of certain plugins called earlier (large
  *     priority) or later (smaller priority, possibly negative);
  * \li the \p callback gives you the ability to enter your own callback method
- *     which could be something other than an std::bind() such as a lambda or
- *     a static function; in this case, the signal does not need to be named
- *     `<name>::on_<signal>()`;
+ *     which could be something other than the default member function such
+ *     as a lambda or a static function; in this case, the signal does not
+ *     need to be named `<name>::on_<signal>()`;
  * \li the \p args are arguments that the emitter pass to the listener; there
  *     must be at least one to use the `SERVERPLUGINS_LISTEN()` macro; if the
  *     signal does not use any parameter, use the `SERVERPLUGINS_LISTEN0()`
  *     instead; in most cases, these are `std::placeholders::_1` and 2, 3,
  *     etc. although it can be a hard coded value as well.
  *
+ * When the \p args are placeholders in order (`_1`, `_2`, ...), the
+ * listener gets called directly through a serverplugins::delegate.
+ * Nothing gets allocated and the arguments are passed by reference.
+ * Otherwise the macro falls back to std::bind(). See
+ * serverplugins::listener() for details.
+ *
+ * The `SERVERPLUGINS_LISTEN_ASYNC()` and `SERVERPLUGINS_LISTEN0_ASYNC()`
+ * macros connect the listener so it runs in a thread of the collection
+ * delivery pool instead of the thread emitting the signal (see
+ * collection::get_delivery_pool()). The emitter copies the arguments
+ * in a queue of at most \p capacity calls and returns immediately. The
+ * \p backpressure parameter defines what happens when that queue is
+ * full (see serverplugins::backpressure_t). The listener is called in
+ * the order the signal was emitted, never by two threads at once.
+ *
+ * The `SERVERPLUGINS_LISTEN_BATCH()` macro connects a listener which also
+ * has a function `void on_\<name of signal>_batch(batch_t items)` where
+ * `batch_t` is the `batch_t` of the signal type. That function receives
+ * all the items when the emitter uses `\<name of signal>_batch()`. The
+ * other listeners get called once per item of the batch.
+ *
+ * The `SERVERPLUGINS_LISTEN_KEY()` and `SERVERPLUGINS_LISTEN_PREFIX()`
+ * macros connect to a signal defined with
+ * `PLUGIN_KEYED_SIGNAL_WITH_MODE()`. The listener only gets called when
+ * the key of the signal is equal to \p key or starts with \p prefix.
+ * The other macros connect to all the keys of such a signal.
+ *
  * The listener must have a function `void on_\<name of signal>(args...)`,
  * unless you use the CALLBACK macros.
  *
@@ -180,47 +209,95 @@ constexpr char const * name_without_namespace(char const * fullname)
  * ensures that the order does not change over time except when new plugins
  * are added and old ones removed.
  *
- * \todo
- * The `signal_listen_\<signal-name>()` function returns a callback
- * identifier which can be used later to remove the callback. I do not
- * think that would be useful in plugins, but it would be great if we
- * could somehow record those. At the moment, you'd have to copy the
- * code from one of these macros and save the identifier on your own.
+ * The collection records each connection along the identifier returned
+ * by `signal_listen_\<signal-name>()`. This is how
+ * collection::unload_plugin() removes the listeners of a plugin and
+ * how collection::reload_plugin() connects the listeners of the other
+ * plugins back to the newly loaded plugin.
  *
  * \param[in] name  The name of the plugin connecting.
  * \param[in] emitter_class  The class with qualifiers if necessary of the plugin emitting this signal.
  * \param[in] signal  The name of the signal to listen to.
  * \param[in] priority  The priority of the signal listener.
- * \param[in] callback  The callback instead of the auto-generated std::bind().
+ * \param[in] callback  The callback instead of the on_\<signal>() member function.
  * \param[in] args  The list of arguments to that signal.
  */
 #define SERVERPLUGINS_LISTEN(name, emitter_class, signal, args...) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal( \
-                        std::bind(&name::on_##signal, this, ##args)); } while(false)
+    SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, \
+                        ::serverplugins::listener<&name::on_##signal>(this, ##args))
 
 #define SERVERPLUGINS_LISTEN0(name, emitter_class, signal) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal( \
-                        std::bind(&name::on_##signal, this)); } while (false)
+    SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, \
+                        ::serverplugins::listener<&name::on_##signal>(this))
 
 #define SERVERPLUGINS_LISTEN_WITH_PRIORITY(name, emitter_class, signal, priority, args...) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal( \
-                        std::bind(&name::on_##signal, this, ##args), priority); } while(false)
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_PRIORITY(name, emitter_class, signal, priority, \
+                        ::serverplugins::listener<&name::on_##signal>(this, ##args))
 
 #define SERVERPLUGINS_LISTEN0_WITH_PRIORITY(name, emitter_class, signal, priority) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal( \
-                        std::bind(&name::on_##signal, this), priority); } while (false)
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_PRIORITY(name, emitter_class, signal, priority, \
+                        ::serverplugins::listener<&name::on_##signal>(this))
+
+#define SERVERPLUGINS_LISTEN_ASYNC(name, emitter_class, signal, capacity, backpressure, args...) \
+    SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, \
+                        ::serverplugins::asynchronous<emitter_class::signal_##signal##_t>( \
+                                  plugins()->get_delivery_pool() \
+                                , capacity \
+                                , backpressure \
+                                , ::serverplugins::listener<&name::on_##signal>(this, ##args)))
+
+#define SERVERPLUGINS_LISTEN0_ASYNC(name, emitter_class, signal, capacity, backpressure) \
+    SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, \
+                        ::serverplugins::asynchronous<emitter_class::signal_##signal##_t>( \
+                                  plugins()->get_delivery_pool() \
+                                , capacity \
+                                , backpressure \
+                                , ::serverplugins::listener<&name::on_##signal>(this)))
+
+#define SERVERPLUGINS_LISTEN_BATCH(name, emitter_class, signal, args...) \
+    SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, \
+                        (::serverplugins::batch_listener<&name::on_##signal, &name::on_##signal##_batch>(this, ##args)))
 
 #define SERVERPLUGINS_LISTEN_CALLBACK(name, emitter_class, signal, callback) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal(callback); } while(false)
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_PRIORITY(name, emitter_class, signal, \
+                        emitter_class::signal_##signal##_t::DEFAULT_PRIORITY, callback)
+
+#define SERVERPLUGINS_LISTEN_KEY(name, emitter_class, signal, key, args...) \
+    SERVERPLUGINS_LISTEN_KEY_WITH_PRIORITY(name, emitter_class, signal, key, \
+                        emitter_class::signal_##signal##_t::DEFAULT_PRIORITY, ##args)
+
+#define SERVERPLUGINS_LISTEN_KEY_WITH_PRIORITY(name, emitter_class, signal, key, priority, args...) \
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_FUNCTION(name, emitter_class, signal, priority, \
+                        ([k = emitter_class::signal_##signal##_t::key_t(key)](emitter_class & e, auto const & callback, auto p) \
+                            { return e.signal_listen_key_##signal(k, callback, p); }), \
+                        ::serverplugins::listener<&name::on_##signal>(this, ##args))
+
+#define SERVERPLUGINS_LISTEN_PREFIX(name, emitter_class, signal, prefix, args...) \
+    SERVERPLUGINS_LISTEN_PREFIX_WITH_PRIORITY(name, emitter_class, signal, prefix, \
+                        emitter_class::signal_##signal##_t::DEFAULT_PRIORITY, ##args)
+
+#define SERVERPLUGINS_LISTEN_PREFIX_WITH_PRIORITY(name, emitter_class, signal, prefix, priority, args...) \
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_FUNCTION(name, emitter_class, signal, priority, \
+                        ([k = emitter_class::signal_##signal##_t::key_t(prefix)](emitter_class & e, auto const & callback, auto p) \
+                            { return e.signal_listen_prefix_##signal(k, callback, p); }), \
+                        ::serverplugins::listener<&name::on_##signal>(this, ##args))
 
 #define SERVERPLUGINS_LISTEN_CALLBACK_WITH_PRIORITY(name, emitter_class, signal, priority, callback) \
-    do { emitter_class::pointer_t plugin_pointer(plugins()->get_plugin<emitter_class>(::serverplugins::name_without_namespace(#emitter_class))); \
-        if(plugin_pointer != nullptr) plugin_pointer->signal_listen_##signal(callback, priority); } while(false)
+    SERVERPLUGINS_LISTEN_CALLBACK_WITH_FUNCTION(name, emitter_class, signal, priority, \
+                        &emitter_class::signal_listen_##signal, callback)
+
+#define SERVERPLUGINS_LISTEN_CALLBACK_WITH_FUNCTION(name, emitter_class, signal, priority, listen_function, callback) \
+    plugins()->listen<emitter_class>( \
+              this \
+            , ::serverplugins::name_without_namespace(#emitter_class) \
+            , #signal \
+            , emitter_class::signal_##signal##_t::delegate_t(callback) \
+            , priority \
+            , listen_function \
+            , &emitter_class::signal_unlisten_##signal \
+            , &emitter_class::signal_synchronize_##signal \
+            , &emitter_class::signal_freeze_##signal \
+            , &emitter_class::signal_thaw_##signal)
 
 
 
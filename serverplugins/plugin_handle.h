@@ -0,0 +1,119 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Non-owning handles to the plugins of a collection.
+ *
+ * A handle gives access to a plugin without searching the collection
+ * by name and without copying a shared pointer. It is resolved once,
+ * generally in the bootstrap() function of a plugin, with
+ * collection::get_handle() or collection::get_server_handle().
+ */
+
+// self
+//
+#include    <serverplugins/plugin.h>
+
+
+// C++
+//
+#include    <atomic>
+
+
+
+namespace serverplugins
+{
+
+
+
+/** \brief A non-owning reference to a plugin of a collection.
+ *
+ * The handle points to a slot owned by the collection. The slot holds
+ * a bare pointer to the plugin, so accessing the plugin is one atomic
+ * load and no reference counter gets touched.
+ *
+ * The slot remains valid for the lifetime of the collection. When the
+ * plugin gets unloaded, the slot is cleared and get() returns nullptr.
+ * When it gets reloaded, the slot points to the new instance.
+ *
+ * \warning
+ * The handle does not keep the plugin alive. A plugin must not be
+ * unloaded while another thread is using it through a handle. Once
+ * the collection is frozen (see collection::freeze()), the plugins
+ * cannot be unloaded anymore.
+ *
+ * \tparam T  The type of the plugin.
+ */
+template<typename T>
+class plugin_handle
+{
+public:
+    typedef std::atomic<plugin *>   slot_t;
+
+                                    plugin_handle() = default;
+
+    /** \brief Create a handle to a collection slot.
+     *
+     * The collection creates the handles; see collection::get_handle().
+     *
+     * \param[in] slot  The slot of the plugin or nullptr.
+     */
+    explicit                        plugin_handle(slot_t const * slot)
+                                        : f_slot(slot)
+                                    {
+                                    }
+
+    /** \brief Get a bare pointer to the plugin.
+     *
+     * \return The plugin or nullptr if the handle is empty or the plugin
+     * was unloaded.
+     */
+    T *                             get() const
+                                    {
+                                        if(f_slot == nullptr)
+                                        {
+                                            return nullptr;
+                                        }
+                                        return static_cast<T *>(f_slot->load(std::memory_order_acquire));
+                                    }
+
+    T *                             operator -> () const
+                                    {
+                                        return get();
+                                    }
+
+    T &                             operator * () const
+                                    {
+                                        return *get();
+                                    }
+
+    explicit                        operator bool () const
+                                    {
+                                        return get() != nullptr;
+                                    }
+
+private:
+    slot_t const *                  f_slot = nullptr;
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -21,16 +21,29 @@
 //
 #include    "serverplugins/repository.h"
 
+#include    "serverplugins/factory.h"
+#include    "serverplugins/static_plugin.h"
+
 
 // cppthread
 //
 #include    <cppthread/guard.h>
 #include    <cppthread/log.h>
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
 
 
 // C
 //
 #include    <dlfcn.h>
+#include    <fcntl.h>
+#include    <unistd.h>
 
 
 // last include
@@ -46,6 +59,118 @@ namespace detail
 
 
 
+namespace
+{
+
+
+
+/** \brief The filename of the plugin being registered.
+ *
+ * The dlopen() function runs the static constructors of the plugin in
+ * the thread calling dlopen(). This is where the plugin factory calls
+ * the register_plugin() function. The filename is not available to
+ * the factory so we save it in this variable just before calling
+ * dlopen() and pick it up in register_plugin().
+ *
+ * Since several plugins can be loaded simultaneously by different
+ * threads (see repository::load_plugins()), this variable is defined
+ * per thread.
+ */
+thread_local names::filename_t  g_register_filename = names::filename_t();
+
+
+/** \brief The time when the plugin got registered.
+ *
+ * When a load report is attached, the dlopen() is split in two phases:
+ * the loading and relocation of the library up to the construction of
+ * the plugin object, which registers itself, and the rest of the static
+ * initialization. These variables hold the time of the registration
+ * and the name of the plugin which registered itself.
+ */
+thread_local load_report::timestamp_t   g_register_time = 0;
+thread_local std::string                g_register_name = std::string();
+
+
+
+/** \brief Runner used to load plugins in parallel.
+ *
+ * This runner is used by the repository::load_plugins() function to
+ * load a list of plugins using multiple threads. Each runner picks the
+ * next filename in the shared list and loads it through the
+ * repository::get_plugin() function until the list is exhausted.
+ */
+class load_runner
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<load_runner>    pointer_t;
+
+                            load_runner(
+                                  repository & r
+                                , std::vector<names::filename_t> const & filenames
+                                , std::atomic<std::size_t> & next
+                                , load_report * report);
+                            load_runner(load_runner const &) = delete;
+    load_runner &           operator = (load_runner const &) = delete;
+
+    virtual void            run() override;
+
+private:
+    repository &                            f_repository;
+    std::vector<names::filename_t> const &  f_filenames;
+    std::atomic<std::size_t> &              f_next;
+    load_report *                           f_report = nullptr;
+};
+
+
+load_runner::load_runner(
+          repository & r
+        , std::vector<names::filename_t> const & filenames
+        , std::atomic<std::size_t> & next
+        , load_report * report)
+    : runner("plugin_loader")
+    , f_repository(r)
+    , f_filenames(filenames)
+    , f_next(next)
+    , f_report(report)
+{
+}
+
+
+void load_runner::run()
+{
+    for(;;)
+    {
+        std::size_t const idx(f_next.fetch_add(1));
+        if(idx >= f_filenames.size())
+        {
+            return;
+        }
+
+        // the dlopen() itself is partly serialized by the dynamic loader
+        // lock; however, reading the file from disk is the expensive part
+        // on a cold system and that we can do in parallel
+        //
+        int const fd(open(f_filenames[idx].c_str(), O_RDONLY | O_CLOEXEC));
+        if(fd >= 0)
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+
+        // errors are logged by get_plugin() and the collection reports
+        // them again when it does not find the plugin
+        //
+        f_repository.get_plugin(f_filenames[idx], f_report);
+    }
+}
+
+
+
+} // no name namespace
+
+
+
 /** \class repository
  * \brief The global Plugin Repository.
  *
@@ -105,25 +230,52 @@ repository & repository::instance()
  * second point, the linker is used lazily so in most cases you detect
  * those errors later when you call functions in your plugins.
  *
+ * When \p filename is the pseudo filename of a plugin linked in the
+ * executable (see static_plugin), the function creates the plugin
+ * factory instead of calling dlopen().
+ *
  * \note
- * This function, by itself, is expected to be thread safe although it is
- * suggested that you consider loading your plugins before creating threads.
+ * This function is thread safe. The repository lock is not held while
+ * dlopen() runs so different plugins can be loaded simultaneously. If
+ * two threads try to load the same plugin, the second one waits for the
+ * first one to be done and then returns the same pointer.
+ *
+ * When \p report is not null, the time spent in dlopen() gets recorded
+ * in that report as the "dlopen" and "static_init" phases of the plugin.
+ * Nothing gets recorded when the plugin was already loaded.
  *
  * \param[in] filename  The name of the file that corresponds to a plugin.
+ * \param[in] report  A load report or nullptr.
  *
  * \return The pointer to the plugin.
  */
-plugin::pointer_t repository::get_plugin(names::filename_t const & filename)
+plugin::pointer_t repository::get_plugin(names::filename_t const & filename, load_report * report)
 {
-    cppthread::guard lock(f_mutex);
-
-    // first check whether it was already loaded, if so, just return the
-    // existing plugin (no need to re-load it)
-    //
-    auto it(f_plugins.find(filename));
-    if(it != f_plugins.end())
     {
-        return it->second;
+        cppthread::guard lock(f_mutex);
+
+        for(;;)
+        {
+            // first check whether it was already loaded, if so, just return
+            // the existing plugin (no need to re-load it)
+            //
+            auto it(f_plugins.find(filename));
+            if(it != f_plugins.end())
+            {
+                return it->second;
+            }
+
+            // another thread may be loading that very plugin right now,
+            // if so wait for it to be done
+            //
+            if(f_loading.find(filename) == f_loading.end())
+            {
+                break;
+            }
+            f_mutex.wait();
+        }
+
+        f_loading.insert(filename);
     }
 
     // TBD: Use RTLD_NOW instead of RTLD_LAZY in DEBUG mode
@@ -140,11 +292,58 @@ plugin::pointer_t repository::get_plugin(names::filename_t const & filename)
     // time we register it so we save it here and pick it up at the time the
     // registration function gets called
     //
-    f_register_filename = filename;
-    void const * const h(dlopen(filename.c_str(), RTLD_LAZY | RTLD_GLOBAL));
+    // a plugin linked in the executable is already in memory, creating
+    // its factory has the same effect as the dlopen() of a plugin file
+    //
+    static_plugin const * const sp(static_plugin::find_by_filename(filename));
+    load_report::timestamp_t const start(report == nullptr ? 0 : load_report::now());
+    g_register_filename = filename;
+    g_register_time = 0;
+    g_register_name.clear();
+    void * h(nullptr);
+    int e(0);
+    if(sp != nullptr)
+    {
+        sp->create();
+    }
+    else
+    {
+        h = dlopen(filename.c_str(), RTLD_LAZY | RTLD_GLOBAL);
+        e = errno;
+    }
+    g_register_filename.clear();
+    if(report != nullptr)
+    {
+        load_report::timestamp_t const end(load_report::now());
+        load_report::timestamp_t const registered(g_register_time == 0 ? end : g_register_time);
+        std::string const & name(g_register_name.empty() ? filename : g_register_name);
+        report->add("dlopen", name, start, registered);
+        report->add("static_init", name, registered, end);
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    f_loading.erase(filename);
+    f_mutex.broadcast();
+
+    if(sp != nullptr)
+    {
+        cppthread::log << cppthread::log_level_t::debug
+            << "created static plugin: \""
+            << sp->name()
+            << "\"."
+            << cppthread::end;
+
+        auto it(f_plugins.find(filename));
+        if(it == f_plugins.end())
+        {
+            return plugin::pointer_t();     // LCOV_EXCL_LINE
+        }
+        return it->second;
+    }
+
     if(h == nullptr)
     {
-        int const e(errno);
         cppthread::log << cppthread::log_level_t::error
             << "cannot load plugin file \""
             << filename
@@ -156,7 +355,6 @@ plugin::pointer_t repository::get_plugin(names::filename_t const & filename)
             << cppthread::end;
         return plugin::pointer_t();
     }
-    f_register_filename.clear();
 
     cppthread::log << cppthread::log_level_t::debug
         << "loaded plugin: \""
@@ -164,7 +362,77 @@ plugin::pointer_t repository::get_plugin(names::filename_t const & filename)
         << "\"."
         << cppthread::end;
 
-    return f_plugins[filename];
+    auto it(f_plugins.find(filename));
+    if(it == f_plugins.end())
+    {
+        return plugin::pointer_t();
+    }
+    f_handles[filename] = h;
+    return it->second;
+}
+
+
+/** \brief Load a list of plugins using multiple threads.
+ *
+ * This function loads all the plugins listed in \p filenames. When
+ * \p workers is larger than 1, that many threads are created and each
+ * one loads plugins through the get_plugin() function until all the
+ * plugins were loaded. The function returns once all the threads are
+ * done.
+ *
+ * Plugins that were already loaded are not loaded again. Plugins that
+ * fail loading are ignored here; the error is logged by get_plugin()
+ * and the caller is expected to call get_plugin() again to retrieve
+ * the results (it returns immediately once a plugin is loaded).
+ *
+ * The static constructors of a plugin run in the thread that loads it.
+ * Your plugin constructors must therefore not depend on other plugins
+ * being constructed first. This was already a requirement since the
+ * order in which the dlopen() happen is not otherwise defined.
+ *
+ * \param[in] filenames  The list of plugins to load.
+ * \param[in] workers  The maximum number of threads to use.
+ * \param[in] report  A load report or nullptr.
+ */
+void repository::load_plugins(std::vector<names::filename_t> const & filenames, std::size_t workers, load_report * report)
+{
+    workers = std::min(workers, filenames.size());
+    if(workers <= 1)
+    {
+        for(auto const & f : filenames)
+        {
+            get_plugin(f, report);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::vector<load_runner::pointer_t> runners;
+    std::vector<cppthread::thread::pointer_t> threads;
+    for(std::size_t idx(0); idx < workers; ++idx)
+    {
+        runners.push_back(std::make_shared<load_runner>(*this, filenames, next, report));
+        threads.push_back(std::make_shared<cppthread::thread>("plugin_loader", runners.back().get()));
+        if(!threads.back()->start())
+        {
+            // this thread did not start, the others (or the loop below)
+            // will handle its share of the load
+            //
+            threads.pop_back();             // LCOV_EXCL_LINE
+            runners.pop_back();             // LCOV_EXCL_LINE
+        }
+    }
+
+    // if no threads could be started, make sure the plugins get loaded
+    // anyway; otherwise this returns immediately since all the filenames
+    // were already picked up by the threads
+    //
+    load_runner(*this, filenames, next, report).run();
+
+    for(auto & t : threads)
+    {
+        t->stop();
+    }
 }
 
 
@@ -189,9 +457,165 @@ plugin::pointer_t repository::get_plugin(names::filename_t const & filename)
  */
 void repository::register_plugin(plugin::pointer_t p)
 {
-    p->f_filename = f_register_filename;
+    p->f_filename = g_register_filename;
+    g_register_time = load_report::now();
+    g_register_name = p->name();
+
+    cppthread::guard lock(f_mutex);
+    f_plugins[g_register_filename] = p;
+}
+
+
+/** \brief Count the references to a plugin not held by a known owner.
+ *
+ * A plugin can only be unloaded once nothing uses it anymore. This
+ * function counts the references held by the known owners of the
+ * plugin:
+ *
+ * \li the repository, if \p p is the plugin registered for its file;
+ * \li the factory which created the plugin;
+ * \li the \p owners references of the caller (i.e. \p p itself and
+ *     whatever other pointers the caller holds).
+ *
+ * Any other reference, such as a pointer a plugin saved in its
+ * bootstrap() function, is an extra reference.
+ *
+ * \param[in] p  The plugin to check.
+ * \param[in] owners  The number of references held by the caller.
+ *
+ * \return The number of references held by someone else.
+ */
+std::size_t repository::extra_references(plugin::pointer_t const & p, std::size_t owners)
+{
+    cppthread::guard lock(f_mutex);
+
+    auto const it(f_plugins.find(p->filename()));
+    if(it != f_plugins.end()
+    && it->second == p)
+    {
+        ++owners;
+    }
+
+    if(p->f_factory != nullptr
+    && p->f_factory->get_plugin() == p)
+    {
+        ++owners;
+    }
+
+    std::size_t const count(p.use_count());
+    return count > owners ? count - owners : 0;
+}
+
+
+/** \brief Unload a plugin from memory.
+ *
+ * This function removes the plugin from the repository and calls
+ * dlclose() on its library. The static destructors of the library run,
+ * which destroys the plugin factory and with it the last reference to
+ * the plugin, so the plugin destructor gets called.
+ *
+ * The plugin must not be referenced by anything other than the
+ * repository, its factory, and \p p. Otherwise the function fails and
+ * nothing happens. On success, \p p is reset.
+ *
+ * Some libraries cannot be unloaded. For example, the dynamic loader
+ * never unloads a library with `STB_GNU_UNIQUE` symbols (compile your
+ * plugins with `-fno-gnu-unique` to avoid those). In that case the
+ * plugin is registered back and the function returns false.
+ *
+ * A plugin linked in the executable (see static_plugin) cannot be
+ * unloaded either. The function returns false without doing anything.
+ *
+ * \param[in,out] p  The plugin to unload.
+ *
+ * \return true if the plugin was unloaded.
+ */
+bool repository::unload_plugin(plugin::pointer_t & p)
+{
+    names::filename_t const filename(p->filename());
+
+    if(static_plugin::is_static_filename(filename))
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << p->name()
+            << "\" is linked in the executable and cannot be unloaded."
+            << cppthread::end;
+        return false;
+    }
+
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_plugins.find(filename));
+    auto h(f_handles.find(filename));
+    if(it == f_plugins.end()
+    || it->second != p
+    || h == f_handles.end())
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << p->name()
+            << "\" was not loaded by the repository and cannot be unloaded."
+            << cppthread::end;
+        return false;
+    }
+
+    std::size_t const extra(extra_references(p, 1));
+    if(extra != 0)
+    {
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin \""
+            << p->name()
+            << "\" is still referenced ("
+            << extra
+            << " extra references) and cannot be unloaded."
+            << cppthread::end;
+        return false;
+    }
+
+    factory const * const f(p->f_factory);
+    f_plugins.erase(it);
+    p.reset();
+
+    void * const handle(h->second);
+    f_handles.erase(h);
+    if(dlclose(handle) != 0)
+    {
+        cppthread::log << cppthread::log_level_t::error     // LCOV_EXCL_LINE
+            << "dlclose() of \""                            // LCOV_EXCL_LINE
+            << filename                                     // LCOV_EXCL_LINE
+            << "\" failed ("                                // LCOV_EXCL_LINE
+            << dlerror()                                    // LCOV_EXCL_LINE
+            << ")."                                         // LCOV_EXCL_LINE
+            << cppthread::end;                              // LCOV_EXCL_LINE
+    }
+
+    // verify that the library is really gone
+    //
+    void * const still_loaded(dlopen(filename.c_str(), RTLD_LAZY | RTLD_NOLOAD));
+    if(still_loaded != nullptr)
+    {
+        // the static destructors did not run, the factory still exists
+        //
+        f_handles[filename] = still_loaded;
+        p = f->get_plugin();
+        f_plugins[filename] = p;
+
+        cppthread::log << cppthread::log_level_t::error
+            << "plugin file \""
+            << filename
+            << "\" cannot be unloaded from memory (does it include STB_GNU_UNIQUE symbols?)."
+            << cppthread::end;
+        return false;
+    }
+
+    cppthread::log << cppthread::log_level_t::debug
+        << "unloaded plugin: \""
+        << filename
+        << "\"."
+        << cppthread::end;
 
-    f_plugins[f_register_filename] = p;
+    return true;
 }
 
 
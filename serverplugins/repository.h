@@ -19,6 +19,7 @@
 
 // self
 //
+#include    <serverplugins/load_report.h>
 #include    <serverplugins/plugin.h>
 
 
@@ -27,6 +28,11 @@
 #include    <cppthread/mutex.h>
 
 
+// C++
+//
+#include    <set>
+
+
 
 namespace serverplugins
 {
@@ -39,13 +45,18 @@ class repository
 {
 public:
     static repository &         instance();
-    plugin::pointer_t           get_plugin(names::filename_t const & filename);
+    plugin::pointer_t           get_plugin(names::filename_t const & filename, load_report * report = nullptr);
+    void                        load_plugins(std::vector<names::filename_t> const & filenames, std::size_t workers, load_report * report = nullptr);
     void                        register_plugin(plugin::pointer_t p);
+    bool                        unload_plugin(plugin::pointer_t & p);
+    std::size_t                 extra_references(plugin::pointer_t const & p, std::size_t owners);
 
 private:
     cppthread::mutex            f_mutex = cppthread::mutex();
     plugin::map_t               f_plugins = plugin::map_t();        // WARNING: this map is sorted by filename
-    names::filename_t           f_register_filename = names::filename_t();
+    std::set<names::filename_t> f_loading = std::set<names::filename_t>();
+    std::map<names::filename_t, void *>
+                                f_handles = std::map<names::filename_t, void *>();
 };
 
 
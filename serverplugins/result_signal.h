@@ -0,0 +1,516 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Signals returning the results of their listeners.
+ *
+ * The PLUGIN_RESULT_SIGNAL_WITH_MODE() macro defines a signal whose
+ * listeners return a value. A combiner merges those values in the
+ * result of the emission and decides whether the remaining listeners
+ * still need to be called. For example, a lookup signal using the
+ * combiner::first combiner stops as soon as one listener found the
+ * answer:
+ *
+ * \code
+ *     PLUGIN_RESULT_SIGNAL_WITH_MODE(
+ *               find_user
+ *             , ::serverplugins::combiner::first<user::pointer_t>
+ *             , (std::string const & name)
+ *             , (name)
+ *             , NEITHER);
+ *
+ *     std::optional<user::pointer_t> u(find_user("alexis"));
+ * \endcode
+ *
+ * A combiner is a class with:
+ *
+ * \li a `value_type` typedef, the type returned by the listeners;
+ * \li a `result_type` typedef, the type returned by the emission;
+ * \li a `bool add(value_type && value)` function called with the value
+ *     returned by each listener, returning false to stop the emission;
+ * \li a `result_type result()` function called once the emission is over.
+ *
+ * A new combiner gets created for each emission.
+ */
+
+// self
+//
+#include    <serverplugins/signal_profile.h>
+#include    <serverplugins/signals.h>
+
+
+// C++
+//
+#include    <optional>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace combiner
+{
+
+
+
+/** \brief Keep the first value returned by a listener.
+ *
+ * The listeners return an std::optional<T>. The first one which returns
+ * a value stops the emission. The result is that value, or an empty
+ * std::optional if no listener returned a value.
+ *
+ * \tparam T  The type of the value.
+ */
+template<typename T>
+class first
+{
+public:
+    typedef std::optional<T>        value_type;
+    typedef std::optional<T>        result_type;
+
+    bool add(value_type && value)
+    {
+        if(!value.has_value())
+        {
+            return true;
+        }
+        f_result = std::move(value);
+        return false;
+    }
+
+    result_type result()
+    {
+        return std::move(f_result);
+    }
+
+private:
+    result_type                     f_result = result_type();
+};
+
+
+/** \brief Check whether any listener returns true.
+ *
+ * The first listener returning true stops the emission. Without any
+ * listener, the result is false.
+ */
+class any_true
+{
+public:
+    typedef bool                    value_type;
+    typedef bool                    result_type;
+
+    bool add(value_type && value)
+    {
+        f_result = value;
+        return !value;
+    }
+
+    result_type result()
+    {
+        return f_result;
+    }
+
+private:
+    result_type                     f_result = false;
+};
+
+
+/** \brief Check whether all the listeners return true.
+ *
+ * The first listener returning false stops the emission. Without any
+ * listener, the result is true.
+ */
+class all_true
+{
+public:
+    typedef bool                    value_type;
+    typedef bool                    result_type;
+
+    bool add(value_type && value)
+    {
+        f_result = value;
+        return value;
+    }
+
+    result_type result()
+    {
+        return f_result;
+    }
+
+private:
+    result_type                     f_result = true;
+};
+
+
+/** \brief Add the values returned by all the listeners.
+ *
+ * All the listeners get called. Without any listener, the result is
+ * `T()`.
+ *
+ * \tparam T  The type of the values.
+ */
+template<typename T>
+class sum
+{
+public:
+    typedef T                       value_type;
+    typedef T                       result_type;
+
+    bool add(value_type && value)
+    {
+        f_result += value;
+        return true;
+    }
+
+    result_type result()
+    {
+        return std::move(f_result);
+    }
+
+private:
+    result_type                     f_result = result_type();
+};
+
+
+
+} // namespace combiner
+
+
+
+namespace detail
+{
+
+
+/** \brief The combiner of one emission.
+ *
+ * The delegates of a result signal receive this object as their first
+ * argument and add the value returned by their listener to it.
+ */
+template<typename C>
+class combine_state
+{
+public:
+    void add(typename C::value_type && value)
+    {
+        if(!f_combiner.add(std::move(value)))
+        {
+            f_done = true;
+        }
+    }
+
+    bool done() const
+    {
+        return f_done;
+    }
+
+    typename C::result_type result()
+    {
+        return f_combiner.result();
+    }
+
+private:
+    C                               f_combiner = C();
+    bool                            f_done = false;
+};
+
+
+} // namespace detail
+
+
+
+/** \brief A listener of a result signal.
+ *
+ * The listener returns a value which gets converted to the value_type
+ * of the combiner \p C.
+ *
+ * \tparam C  The combiner of the signal.
+ * \tparam Args  The types of the parameters of the signal.
+ */
+template<typename C, typename ... Args>
+class result_delegate
+    : public delegate<detail::combine_state<C> &, Args...>
+{
+public:
+    typedef delegate<detail::combine_state<C> &, Args...>
+                                    base_t;
+
+                                result_delegate() = default;
+
+    /** \brief Wrap a delegate created by a previous result_delegate.
+     *
+     * This is used by the collection to profile the listeners.
+     */
+    explicit                    result_delegate(base_t const & d)
+                                    : base_t(d)
+                                {
+                                }
+
+    template<auto M, typename O, std::size_t N>
+                                result_delegate(detail::member_listener<M, O, N> const & l)
+                                    : base_t(wrap(detail::member_call<M, O, N>{ l.f_object }))
+                                {
+                                }
+
+    template<typename F
+           , typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, result_delegate>
+                                      && std::is_invocable_v<std::decay_t<F> &, detail::signal_argument_t<Args>...>>>
+                                result_delegate(F && f)
+                                    : base_t(wrap(std::forward<F>(f)))
+                                {
+                                }
+
+private:
+    template<typename F>
+    static auto                 wrap(F && f)
+                                {
+                                    return [f = std::forward<F>(f)](detail::combine_state<C> & state, detail::signal_argument_t<Args>... args) mutable
+                                        {
+                                            state.add(typename C::value_type(f(args...)));
+                                        };
+                                }
+};
+
+
+
+/** \brief A signal combining the values returned by its listeners.
+ *
+ * The listeners are kept in a serverplugins::signal so adding and
+ * removing listeners works the same way, without locking the emitters.
+ * The listeners are called in priority order until the combiner
+ * refuses more values.
+ *
+ * \tparam C  The combiner (see combiner::first, combiner::any_true,
+ * combiner::all_true, and combiner::sum).
+ * \tparam Args  The types of the parameters of the signal. The function
+ * type `void(Args...)` can also be used.
+ */
+template<typename C, typename ... Args>
+class result_signal
+{
+public:
+    typedef C                                       combiner_t;
+    typedef typename C::value_type                  value_t;
+    typedef typename C::result_type                 result_t;
+    typedef result_delegate<C, Args...>             delegate_t;
+    typedef signal<detail::combine_state<C> &, Args...>
+                                                    signal_t;
+    typedef typename signal_t::callback_id_t        callback_id_t;
+    typedef typename signal_t::priority_t           priority_t;
+
+    static constexpr callback_id_t          NULL_CALLBACK_ID = signal_t::NULL_CALLBACK_ID;
+    static constexpr priority_t             DEFAULT_PRIORITY = signal_t::DEFAULT_PRIORITY;
+
+    callback_id_t add_callback(delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        return f_signal.add_callback(callback, priority);
+    }
+
+    bool remove_callback(callback_id_t callback_id)
+    {
+        return f_signal.remove_callback(callback_id);
+    }
+
+    void clear()
+    {
+        f_signal.clear();
+    }
+
+    bool empty() const
+    {
+        return f_signal.empty();
+    }
+
+    std::size_t size() const
+    {
+        return f_signal.size();
+    }
+
+    void synchronize()
+    {
+        f_signal.synchronize();
+    }
+
+    void freeze()
+    {
+        f_signal.freeze();
+    }
+
+    void thaw()
+    {
+        f_signal.thaw();
+    }
+
+    bool is_frozen() const
+    {
+        return f_signal.is_frozen();
+    }
+
+    /** \brief Emit the signal.
+     *
+     * The listeners get called until the combiner refuses more values.
+     *
+     * \param[in] args  The arguments of the signal.
+     *
+     * \return The result of the combiner.
+     */
+    result_t call(detail::signal_argument_t<Args>... args) const
+    {
+        detail::combine_state<C> state;
+        f_signal.call_while(
+              [&state]()
+              {
+                  return !state.done();
+              }
+            , state
+            , args...);
+        return state.result();
+    }
+
+    /** \brief The result of an emission refused by \<name>_start().
+     *
+     * \return The result of a combiner which did not receive any value.
+     */
+    static result_t refused()
+    {
+        return C().result();
+    }
+
+private:
+    signal_t                        f_signal = signal_t();
+};
+
+
+template<typename C, typename ... Args>
+class result_signal<C, void(Args...)>
+    : public result_signal<C, Args...>
+{
+};
+
+
+
+namespace detail
+{
+
+
+template<typename C, typename ... Args>
+struct is_profiled_delegate<result_delegate<C, Args...>>
+    : std::true_type
+{
+};
+
+
+} // namespace detail
+
+
+
+} // namespace serverplugins
+
+
+
+#define     PLUGIN_RESULT_SIGNAL_PROCESS_MODE_NEITHER(name, parameters, variables)   \
+    public: \
+        signal_##name##_t::result_t name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.call variables; \
+        }
+
+#define     PLUGIN_RESULT_SIGNAL_PROCESS_MODE_START(name, parameters, variables)   \
+        bool name##_start parameters; \
+    public: \
+        signal_##name##_t::result_t name parameters { \
+            if(!name##_start variables) \
+            { \
+                return signal_##name##_t::refused(); \
+            } \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            return f_signal_##name.call variables; \
+        }
+
+#define     PLUGIN_RESULT_SIGNAL_PROCESS_MODE_DONE(name, parameters, variables)   \
+        void name##_done parameters; \
+    public: \
+        signal_##name##_t::result_t name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            signal_##name##_t::result_t result(f_signal_##name.call variables); \
+            name##_done variables; \
+            return result; \
+        }
+
+#define     PLUGIN_RESULT_SIGNAL_PROCESS_MODE_START_AND_DONE(name, parameters, variables)   \
+        bool name##_start parameters; \
+        void name##_done parameters; \
+    public: \
+        signal_##name##_t::result_t name parameters { \
+            if(!name##_start variables) \
+            { \
+                return signal_##name##_t::refused(); \
+            } \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            signal_##name##_t::result_t result(f_signal_##name.call variables); \
+            name##_done variables; \
+            return result; \
+        }
+
+
+/** \brief Define a named signal returning a result.
+ *
+ * This macro works like PLUGIN_SIGNAL_WITH_MODE() except that the
+ * listeners return a value and the function emitting the signal returns
+ * the values of the listeners merged by \p combiner. The listeners are
+ * connected with the usual SERVERPLUGINS_LISTEN() macros.
+ *
+ * The combiner can stop the emission early, for example once a listener
+ * answered a lookup. When \<name>_start() refuses the emission, the
+ * result is the one of a combiner which did not receive any value. The
+ * \<name>_done() function gets called even if the combiner stopped the
+ * emission early.
+ *
+ * The supported modes are NEITHER, START, DONE, and START_AND_DONE.
+ *
+ * \param[in] name  The name of the signal.
+ * \param[in] combiner  The type of the combiner, such as
+ *                      serverplugins::combiner::first<T>.
+ * \param[in] parameters  A list of parameters written between parenthesis.
+ * \param[in] variables  List the variable names as they appear in
+ *                       \p parameters, written between parenthesis.
+ * \param[in] mode  The mode used to call the various functions.
+ */
+#define    PLUGIN_RESULT_SIGNAL_WITH_MODE(name, combiner, parameters, variables, mode) \
+    typedef ::serverplugins::result_signal<combiner, void parameters> signal_##name##_t; \
+    signal_##name##_t::callback_id_t signal_listen_##name( \
+            signal_##name##_t::delegate_t const & callback, \
+            signal_##name##_t::priority_t priority = signal_##name##_t::DEFAULT_PRIORITY) \
+        { return f_signal_##name.add_callback(callback, priority); } \
+    bool signal_unlisten_##name(signal_##name##_t::callback_id_t callback_id) \
+        { return f_signal_##name.remove_callback(callback_id); } \
+    void signal_synchronize_##name() \
+        { f_signal_##name.synchronize(); } \
+    void signal_freeze_##name() \
+        { f_signal_##name.freeze(); } \
+    void signal_thaw_##name() \
+        { f_signal_##name.thaw(); } \
+    private: \
+        signal_##name##_t f_signal_##name = signal_##name##_t(); \
+        PLUGIN_RESULT_SIGNAL_PROCESS_MODE_##mode(name, parameters, variables)
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,192 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Statistics about the time spent in each listener.
+ *
+ * When the plugins are compiled with SERVERPLUGINS_PROFILING defined
+ * (see the SERVERPLUGINS_PROFILING option of cmake), the collection
+ * measures each call of each listener it connects. The results can be
+ * retrieved with collection::get_signal_profiles() to find out which
+ * plugin makes a signal slow.
+ *
+ * Without SERVERPLUGINS_PROFILING, the listeners get connected as is and
+ * emitting a signal costs exactly the same as before.
+ */
+
+// self
+//
+#include    "serverplugins/signal_profile.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The next shard to give to a thread.
+ */
+std::atomic<std::size_t>    g_next_shard = 0;
+
+
+/** \brief The shard used by this thread.
+ *
+ * The shards get assigned round robin the first time a thread records
+ * a call. This is not a per thread counter: with more than
+ * SIGNAL_PROFILE_SHARDS threads, several threads share the same shard,
+ * and two threads may share one even with fewer threads if others came
+ * and went before them. The counters remain exact since they are atomic;
+ * only the cache lines get shared.
+ */
+thread_local std::size_t const  g_shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) % SIGNAL_PROFILE_SHARDS;
+
+
+
+} // no name namespace
+
+
+
+/** \struct signal_profile_t
+ * \brief The statistics of one listener of one signal.
+ *
+ * This is what collection::get_signal_profiles() returns for each
+ * listener. The histogram counts the calls per power of two of
+ * nanoseconds: f_histogram[i] is the number of calls which lasted
+ * from 2^i to 2^(i+1)-1 nanoseconds. The last bucket also counts the
+ * longer calls and the first one the calls under 2 nanoseconds.
+ */
+
+
+/** \class listener_profile
+ * \brief The counters of one listener.
+ *
+ * The counters are split in SIGNAL_PROFILE_SHARDS shards, each on its
+ * own cache line, and each thread writes to one of them. This way,
+ * emitting a signal from a few threads does not make them fight over
+ * the same cache line. With more threads than shards, the threads
+ * share the shards, which remains correct, only slower. The collect()
+ * function adds up all the shards.
+ */
+
+
+/** \brief Record one call of the listener.
+ *
+ * \param[in] duration  The time the listener took to return.
+ */
+void listener_profile::record(clock_t::duration duration)
+{
+    std::uint64_t const ns(static_cast<std::uint64_t>(
+            std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()
+                   , static_cast<std::chrono::nanoseconds::rep>(0))));
+
+    shard_t & s(f_shards[g_shard]);
+    s.f_calls.fetch_add(1, std::memory_order_relaxed);
+    s.f_total_ns.fetch_add(ns, std::memory_order_relaxed);
+    s.f_histogram[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t max(s.f_max_ns.load(std::memory_order_relaxed));
+    while(ns > max
+       && !s.f_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+
+/** \brief Add up the counters of all the shards.
+ *
+ * The counters keep changing while signals get emitted, so the result
+ * is not an atomic snapshot: the number of calls may not exactly match
+ * the sum of the histogram.
+ *
+ * \param[in,out] profile  The profile receiving the counters.
+ */
+void listener_profile::collect(signal_profile_t & profile) const
+{
+    profile.f_calls = 0;
+    profile.f_total_ns = 0;
+    profile.f_max_ns = 0;
+    profile.f_histogram.fill(0);
+    for(auto const & s : f_shards)
+    {
+        profile.f_calls += s.f_calls.load(std::memory_order_relaxed);
+        profile.f_total_ns += s.f_total_ns.load(std::memory_order_relaxed);
+        profile.f_max_ns = std::max(profile.f_max_ns, s.f_max_ns.load(std::memory_order_relaxed));
+        for(std::size_t idx(0); idx < SIGNAL_PROFILE_BUCKETS; ++idx)
+        {
+            profile.f_histogram[idx] += s.f_histogram[idx].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+
+/** \brief Reset all the counters to zero.
+ */
+void listener_profile::reset()
+{
+    for(auto & s : f_shards)
+    {
+        s.f_calls.store(0, std::memory_order_relaxed);
+        s.f_total_ns.store(0, std::memory_order_relaxed);
+        s.f_max_ns.store(0, std::memory_order_relaxed);
+        for(auto & h : s.f_histogram)
+        {
+            h.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+/** \brief Get the histogram bucket of a duration.
+ *
+ * \param[in] ns  The duration in nanoseconds.
+ *
+ * \return The index of the bucket, the position of the most significant
+ * bit of \p ns, limited to the last bucket.
+ */
+std::size_t listener_profile::bucket(std::uint64_t ns)
+{
+    if(ns < 2)
+    {
+        return 0;
+    }
+    return std::min(
+              static_cast<std::size_t>(63 - __builtin_clzll(ns))
+            , SIGNAL_PROFILE_BUCKETS - 1);
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,182 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/typed_signal.h>
+
+
+// C++
+//
+#include    <array>
+#include    <atomic>
+#include    <chrono>
+#include    <cstdint>
+#include    <memory>
+#include    <string>
+#include    <vector>
+
+
+
+namespace serverplugins
+{
+
+
+
+constexpr std::size_t const         SIGNAL_PROFILE_BUCKETS = 32;
+constexpr std::size_t const         SIGNAL_PROFILE_SHARDS = 8;
+
+
+struct signal_profile_t
+{
+    typedef std::array<std::uint64_t, SIGNAL_PROFILE_BUCKETS>
+                                    histogram_t;
+
+    std::string                     f_emitter = std::string();
+    std::string                     f_signal = std::string();
+    std::string                     f_listener = std::string();
+    std::uint64_t                   f_calls = 0;
+    std::uint64_t                   f_total_ns = 0;
+    std::uint64_t                   f_max_ns = 0;
+    histogram_t                     f_histogram = histogram_t();
+};
+typedef std::vector<signal_profile_t>   signal_profile_vector_t;
+
+
+class listener_profile
+{
+public:
+    typedef std::shared_ptr<listener_profile>   pointer_t;
+    typedef std::chrono::steady_clock           clock_t;
+
+    class timer
+    {
+    public:
+                                    timer(listener_profile & profile)
+                                        : f_profile(profile)
+                                        , f_start(clock_t::now())
+                                    {
+                                    }
+
+                                    timer(timer const &) = delete;
+        timer &                     operator = (timer const &) = delete;
+
+                                    ~timer()
+                                    {
+                                        f_profile.record(clock_t::now() - f_start);
+                                    }
+
+    private:
+        listener_profile &          f_profile;
+        clock_t::time_point const   f_start;
+    };
+
+    void                            record(clock_t::duration duration);
+    void                            collect(signal_profile_t & profile) const;
+    void                            reset();
+
+    static std::size_t              bucket(std::uint64_t ns);
+
+private:
+    struct alignas(64) shard_t
+    {
+        std::atomic<std::uint64_t>  f_calls = 0;
+        std::atomic<std::uint64_t>  f_total_ns = 0;
+        std::atomic<std::uint64_t>  f_max_ns = 0;
+        std::atomic<std::uint64_t>  f_histogram[SIGNAL_PROFILE_BUCKETS] = {};
+    };
+
+    shard_t                         f_shards[SIGNAL_PROFILE_SHARDS] = {};
+};
+
+
+
+namespace detail
+{
+
+
+/** \brief A listener measuring the time spent in another listener.
+ *
+ * The collection wraps the delegates of the listeners with this object
+ * when the library is compiled with SERVERPLUGINS_PROFILING. A batch
+ * (see signal::call_batch()) counts as one call.
+ */
+template<typename ... Args>
+class profiled_listener
+{
+public:
+    profiled_listener(delegate<Args...> const & d, listener_profile::pointer_t profile)
+        : f_delegate(d)
+        , f_profile(profile)
+    {
+    }
+
+    void operator () (signal_argument_t<Args>... args) const
+    {
+        listener_profile::timer const t(*f_profile);
+        f_delegate(args...);
+    }
+
+    void call_batch(typename delegate<Args...>::batch_t items) const
+    {
+        listener_profile::timer const t(*f_profile);
+        f_delegate.call_batch(items);
+    }
+
+private:
+    delegate<Args...>               f_delegate;
+    listener_profile::pointer_t     f_profile;
+};
+
+
+/** \brief Whether \p C is a delegate which can be profiled.
+ *
+ * The delegates of the awaitable signals only create the tasks of the
+ * listeners, so timing them would not mean much.
+ */
+template<typename C>
+struct is_profiled_delegate
+    : std::false_type
+{
+};
+
+
+template<typename ... Args>
+struct is_profiled_delegate<delegate<Args...>>
+    : std::true_type
+{
+};
+
+
+template<typename ... Args>
+delegate<Args...> make_profiled_delegate(
+      delegate<Args...> const & d
+    , listener_profile::pointer_t profile)
+{
+    return profiled_listener<Args...>(d, profile);
+}
+
+
+} // namespace detail
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
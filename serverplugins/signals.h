@@ -45,16 +45,154 @@
  */
 
 
-// snapdev
+// self
 //
-#include    <snapdev/callback_manager.h>
+#include    <serverplugins/delivery_pool.h>
+#include    <serverplugins/executor.h>
+#include    <serverplugins/keyed_signal.h>
+#include    <serverplugins/typed_signal.h>
+
+
+
+namespace serverplugins
+{
+class collection;
+class plugin;
+namespace detail
+{
+
+
+/** \brief Track the emission of an awaitable signal until it completes.
+ * \private
+ *
+ * The listeners of an awaitable signal may be coroutines which resume
+ * long after the signal_guard of the emission was destroyed. The task
+ * of the emission keeps this guard until it completes (or gets
+ * destroyed without completing) and, while any such guard exists,
+ * collection::unload_plugin() refuses to unload a plugin, since that
+ * plugin may have a suspended coroutine.
+ *
+ * A default guard tracks nothing.
+ */
+class task_guard
+{
+public:
+                        task_guard() = default;
+                        task_guard(collection * c);
+                        task_guard(task_guard && rhs) noexcept;
+                        task_guard(task_guard const &) = delete;
+                        ~task_guard();
+    task_guard &        operator = (task_guard const &) = delete;
+    task_guard &        operator = (task_guard &&) = delete;
+
+private:
+    collection *        f_collection = nullptr;
+};
+
+
+/** \brief Track a signal while it gets emitted.
+ * \private
+ *
+ * The signal macros create one of these guards with `this` each time
+ * a signal gets emitted. When the emitter is a plugin that is part of
+ * a collection, the guard:
+ *
+ * \li loads the deferred plugins which declared an interest in the
+ *     signal (see collection::set_lazy()), and
+ * \li marks the emission as in flight until the guard is destroyed, so
+ *     collection::unload_plugin() can wait for all the signals that may
+ *     still be calling the plugin being unloaded.
+ *
+ * When the class using the macros is not a plugin, the `void const *`
+ * constructor is selected and the guard does nothing.
+ *
+ * The guard also gives the PARALLEL modes access to the delivery pool
+ * of the collection. Without a collection, the listeners of those
+ * signals are called one after the other. Similarly, it gives the
+ * awaitable signals access to the executor of the collection.
+ */
+class signal_guard
+{
+public:
+    signal_guard(void const * emitter, char const * signal)
+    {
+        static_cast<void>(emitter);
+        static_cast<void>(signal);
+    }
+
+    signal_guard(plugin const * emitter, char const * signal);
+    signal_guard(signal_guard const &) = delete;
+    signal_guard & operator = (signal_guard const &) = delete;
+
+    ~signal_guard()
+    {
+        if(f_in_flight)
+        {
+            leave();
+        }
+    }
+
+    delivery_pool *     get_delivery_pool() const;
+    executor::pointer_t get_executor() const;
+    task_guard          start_task() const;
+
+private:
+    void                leave();
+
+    collection *        f_collection = nullptr;
+    std::size_t         f_epoch = 0;
+    bool                f_in_flight = false;
+};
+
+
+/** \brief Emit the items of a batch accepted by \<name>_start().
+ * \private
+ *
+ * The START modes call \p start on each item. The consecutive items
+ * it accepts are emitted together with \p emit so the items never get
+ * copied; the refused items are skipped.
+ *
+ * \tparam S  The type of the signal.
+ * \param[in] items  The batch of items.
+ * \param[in] start  The function calling \<name>_start().
+ * \param[in] emit  The function emitting a run of accepted items.
+ */
+template<typename S, typename F, typename E>
+void emit_accepted(typename S::batch_t items, F const & start, E const & emit)
+{
+    std::size_t const size(items.size());
+    std::size_t idx(0);
+    while(idx < size)
+    {
+        std::size_t const first(idx);
+        while(idx < size
+           && S::apply_item(start, items[idx]))
+        {
+            ++idx;
+        }
+        if(idx > first)
+        {
+            emit(items.subspan(first, idx - first));
+        }
+        ++idx;
+    }
+}
+
+
+} // namespace detail
+} // namespace serverplugins
 
 
 
 #define     PLUGIN_SIGNAL_PROCESS_MODE_NEITHER(name, parameters, variables)   \
     public: \
         void name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
             f_signal_##name.call variables; \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.call_batch(items); \
         }
 
 #define     PLUGIN_SIGNAL_PROCESS_MODE_START(name, parameters, variables)   \
@@ -63,16 +201,36 @@
         void name parameters { \
             if(name##_start variables) \
             { \
+                ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
                 f_signal_##name.call variables; \
             } \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            ::serverplugins::detail::emit_accepted<signal_##name##_t>( \
+                  items \
+                , [this](auto && ... a) { return name##_start(a...); } \
+                , [this](signal_##name##_t::batch_t accepted) \
+                  { \
+                      f_signal_##name.call_batch(accepted); \
+                  }); \
         }
 
 #define     PLUGIN_SIGNAL_PROCESS_MODE_DONE(name, parameters, variables)   \
         void name##_done parameters; \
     public: \
         void name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
             f_signal_##name.call variables; \
             name##_done variables; \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.call_batch(items); \
+            for(auto & item : items) \
+            { \
+                signal_##name##_t::apply_item([this](auto && ... a) { name##_done(a...); }, item); \
+            } \
         }
 
 #define     PLUGIN_SIGNAL_PROCESS_MODE_START_AND_DONE(name, parameters, variables)   \
@@ -82,9 +240,53 @@
         void name parameters { \
             if(name##_start variables) \
             { \
+                ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
                 f_signal_##name.call variables; \
                 name##_done variables; \
             } \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            ::serverplugins::detail::emit_accepted<signal_##name##_t>( \
+                  items \
+                , [this](auto && ... a) { return name##_start(a...); } \
+                , [this](signal_##name##_t::batch_t accepted) \
+                  { \
+                      f_signal_##name.call_batch(accepted); \
+                      for(auto & item : accepted) \
+                      { \
+                          signal_##name##_t::apply_item([this](auto && ... a) { name##_done(a...); }, item); \
+                      } \
+                  }); \
+        }
+
+
+#define     PLUGIN_SIGNAL_PROCESS_MODE_PARALLEL(name, parameters, variables)   \
+    public: \
+        void name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.parallel(signal_guard_##name.get_delivery_pool()) variables; \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.call_parallel_batch(signal_guard_##name.get_delivery_pool(), items); \
+        }
+
+#define     PLUGIN_SIGNAL_PROCESS_MODE_PARALLEL_DONE(name, parameters, variables)   \
+        void name##_done parameters; \
+    public: \
+        void name parameters { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.parallel(signal_guard_##name.get_delivery_pool()) variables; \
+            name##_done variables; \
+        } \
+        void name##_batch(signal_##name##_t::batch_t items) { \
+            ::serverplugins::detail::signal_guard const signal_guard_##name(this, #name); \
+            f_signal_##name.call_parallel_batch(signal_guard_##name.get_delivery_pool(), items); \
+            for(auto & item : items) \
+            { \
+                signal_##name##_t::apply_item([this](auto && ... a) { name##_done(a...); }, item); \
+            } \
         }
 
 
@@ -95,10 +297,21 @@
  *
  * The first macro parameter is the signal name. The macro creates:
  *
- * \li typedef ... signal_\<name>_t; -- the signal type
- * \li signal_listen_\<name>(signal_\<name>_t::slot_type const& slot);
- *     -- the function used to register a plugin as a listener
+ * \li typedef ... signal_\<name>_t; -- the signal type, a
+ *     serverplugins::signal
+ * \li signal_listen_\<name>(signal_\<name>_t::delegate_t const & callback);
+ *     -- the function used to register a plugin as a listener; any
+ *     callable can be converted to a delegate_t
+ * \li signal_unlisten_\<name>(signal_\<name>_t::callback_id_t id);
+ *     -- the function used to remove a listener
+ * \li signal_synchronize_\<name>(); -- wait until the removed listeners
+ *     are not referenced by the signal anymore
+ * \li signal_freeze_\<name>(); -- prevent any further changes to the
+ *     listeners (see collection::freeze())
+ * \li signal_thaw_\<name>(); -- allow changes to the listeners again
  * \li void \<name>(\<parameters>) -- the function used to trigger the signal
+ * \li void \<name>_batch(signal_\<name>_t::batch_t items) -- the function
+ *     used to trigger the signal once per item of a batch (see below)
  *
  * This macro also expects a couple of functions named:
  *
@@ -129,6 +342,38 @@
  * \li START -- only the \<name>_start is called
  * \li DONE -- only the \<name>_done function is called
  * \li START_AND_DONE -- both the functions get called
+ * \li PARALLEL -- like NEITHER, but the listeners get called in parallel
+ *     using the delivery pool of the collection
+ * \li PARALLEL_DONE -- like DONE, but the listeners get called in
+ *     parallel; the \<name>_done function gets called once all of them
+ *     returned
+ *
+ * The PARALLEL modes are for signals with independent listeners which
+ * take time, such as indexing or validating a document. The signal then
+ * lasts about as long as its slowest listener. If listeners throw, the
+ * exception of the one with the highest priority is rethrown once they
+ * all returned, so \<name>_done does not get called.
+ *
+ * The \<name>_batch() function emits the signal for a whole batch of
+ * items at once. Each item holds the arguments of one emission: the
+ * decayed type of the parameter when the signal has exactly one, a
+ * std::tuple otherwise (see signal_\<name>_t::item_t). The items can
+ * be passed as a std::vector or an array:
+ *
+ * \code
+ *     std::vector<std::string> records(...);
+ *     emitter->record_batch(records);
+ * \endcode
+ *
+ * The \<name>_start() function is called on each item and the refused
+ * items are skipped. Then each listener receives all the accepted
+ * items, in one call if it was connected with SERVERPLUGINS_LISTEN_BATCH()
+ * and once per item otherwise. Finally \<name>_done() is called on each
+ * accepted item. When \<name>_start() refuses an item in the middle of
+ * the batch, the items before and after it are emitted as two batches.
+ * So the order of the calls differs from emitting the items one by one:
+ * a listener sees all the items before the next listener sees the first
+ * one.
  *
  * \param[in] name  The name of the signal.
  * \param[in] parameters  A list of parameters written between parenthesis.
@@ -137,11 +382,19 @@
  * \param[in] mode  The mode used to call the various functions.
  */
 #define    PLUGIN_SIGNAL_WITH_MODE(name, parameters, variables, mode) \
-    typedef snapdev::callback_manager<std::function<void parameters>> signal_##name##_t; \
+    typedef ::serverplugins::signal<void parameters> signal_##name##_t; \
     signal_##name##_t::callback_id_t signal_listen_##name( \
-            signal_##name##_t::value_type const & callback, \
+            signal_##name##_t::delegate_t const & callback, \
             signal_##name##_t::priority_t priority = signal_##name##_t::DEFAULT_PRIORITY) \
         { return f_signal_##name.add_callback(callback, priority); } \
+    bool signal_unlisten_##name(signal_##name##_t::callback_id_t callback_id) \
+        { return f_signal_##name.remove_callback(callback_id); } \
+    void signal_synchronize_##name() \
+        { f_signal_##name.synchronize(); } \
+    void signal_freeze_##name() \
+        { f_signal_##name.freeze(); } \
+    void signal_thaw_##name() \
+        { f_signal_##name.thaw(); } \
     private: \
         signal_##name##_t f_signal_##name = signal_##name##_t(); \
         PLUGIN_SIGNAL_PROCESS_MODE_##mode(name, parameters, variables)
@@ -162,5 +415,64 @@
     PLUGIN_SIGNAL_WITH_MODE(name, parameters, variables, START)
 
 
+/** \brief Define a named signal dispatched by key.
+ *
+ * This macro works like PLUGIN_SIGNAL_WITH_MODE() except that the
+ * signal is a serverplugins::keyed_signal. The first parameter of the
+ * signal is its key, a std::string or an integer. On top of the
+ * functions created by PLUGIN_SIGNAL_WITH_MODE(), this macro creates:
+ *
+ * \li signal_listen_key_\<name>(key, callback, priority); -- register
+ *     a listener only called when the signal is emitted with \p key
+ * \li signal_listen_prefix_\<name>(prefix, callback, priority); --
+ *     register a listener only called when the key starts with \p prefix
+ *     (std::string keys only)
+ *
+ * The signal_listen_\<name>() function registers a listener called for
+ * all the keys. The SERVERPLUGINS_LISTEN_KEY() and
+ * SERVERPLUGINS_LISTEN_PREFIX() macros are used to connect to the other
+ * two.
+ *
+ * \code
+ *     PLUGIN_KEYED_SIGNAL_WITH_MODE(request, (std::string const & url, int method), (url, method), NEITHER);
+ * \endcode
+ *
+ * \param[in] name  The name of the signal.
+ * \param[in] parameters  A list of parameters written between parenthesis,
+ *                        starting with the key.
+ * \param[in] variables  List the variable names as they appear in
+ *                       \p parameters, written between parenthesis.
+ * \param[in] mode  The mode used to call the various functions.
+ */
+#define    PLUGIN_KEYED_SIGNAL_WITH_MODE(name, parameters, variables, mode) \
+    typedef ::serverplugins::keyed_signal<void parameters> signal_##name##_t; \
+    signal_##name##_t::callback_id_t signal_listen_##name( \
+            signal_##name##_t::delegate_t const & callback, \
+            signal_##name##_t::priority_t priority = signal_##name##_t::DEFAULT_PRIORITY) \
+        { return f_signal_##name.add_callback(callback, priority); } \
+    signal_##name##_t::callback_id_t signal_listen_key_##name( \
+            signal_##name##_t::key_t const & key, \
+            signal_##name##_t::delegate_t const & callback, \
+            signal_##name##_t::priority_t priority = signal_##name##_t::DEFAULT_PRIORITY) \
+        { return f_signal_##name.add_key_callback(key, callback, priority); } \
+    template<typename T = signal_##name##_t> \
+    typename T::callback_id_t signal_listen_prefix_##name( \
+            typename T::key_t const & prefix, \
+            typename T::delegate_t const & callback, \
+            typename T::priority_t priority = T::DEFAULT_PRIORITY) \
+        { return f_signal_##name.add_prefix_callback(prefix, callback, priority); } \
+    bool signal_unlisten_##name(signal_##name##_t::callback_id_t callback_id) \
+        { return f_signal_##name.remove_callback(callback_id); } \
+    void signal_synchronize_##name() \
+        { f_signal_##name.synchronize(); } \
+    void signal_freeze_##name() \
+        { f_signal_##name.freeze(); } \
+    void signal_thaw_##name() \
+        { f_signal_##name.thaw(); } \
+    private: \
+        signal_##name##_t f_signal_##name = signal_##name##_t(); \
+        PLUGIN_SIGNAL_PROCESS_MODE_##mode(name, parameters, variables)
+
+
 
 // vim: ts=4 sw=4 et
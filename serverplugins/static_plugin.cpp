@@ -0,0 +1,242 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Plugins linked directly in the server executable.
+ *
+ * When a plugin is compiled with `SERVERPLUGINS_STATIC` defined, the
+ * SERVERPLUGINS_END() macro does not create the plugin on load. Instead,
+ * it adds an entry to the table of static plugins. The collection then
+ * finds the plugin in that table instead of searching for a `.so` file
+ * and calling dlopen() on it.
+ */
+
+// self
+//
+#include    "serverplugins/static_plugin.h"
+
+
+// C++
+//
+#include    <atomic>
+#include    <cstring>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The head of the list of static plugins.
+ *
+ * Each static_plugin object adds itself at the front of this list on
+ * construction. The pointer is constant initialized so the list is
+ * valid whatever the order in which the static objects get constructed.
+ *
+ * Entries are never removed.
+ */
+std::atomic<static_plugin const *>  g_static_plugins = nullptr;
+
+
+
+} // no name namespace
+
+
+
+/** \class static_plugin
+ * \brief One entry of the table of static plugins.
+ *
+ * The SERVERPLUGINS_END() macro creates one of these objects per plugin
+ * when `SERVERPLUGINS_STATIC` is defined. The object only holds the name
+ * of the plugin, a reference to its definition, and a function which
+ * creates the plugin factory. Nothing else happens until the collection
+ * loads the plugin.
+ *
+ * The plugins found in this table are given a pseudo filename of the
+ * form `static:<name>`. That filename is returned by names::to_filename()
+ * and plugin::filename().
+ *
+ * \warning
+ * A plugin compiled for static mode must be linked in the executable.
+ * If such a plugin was loaded with dlopen() and then unloaded, its
+ * entry would point to unmapped memory.
+ */
+
+
+
+/** \brief Add a plugin to the table of static plugins.
+ *
+ * \param[in] name  The name of the plugin.
+ * \param[in] def  The definition of the plugin.
+ * \param[in] create  The function creating the plugin factory.
+ */
+static_plugin::static_plugin(char const * name, definition const & def, create_t create)
+    : f_name(name)
+    , f_definition(def)
+    , f_create(create)
+{
+    static_plugin const * head(g_static_plugins.load(std::memory_order_relaxed));
+    do
+    {
+        f_next = head;
+    }
+    while(!g_static_plugins.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+/** \brief Get the name of the plugin.
+ *
+ * \return The name of the plugin as defined in SERVERPLUGINS_END().
+ */
+char const * static_plugin::name() const
+{
+    return f_name;
+}
+
+
+/** \brief Get the definition of the plugin.
+ *
+ * The definition is available without creating the plugin. It is used
+ * in place of the ELF note of a plugin file (see read_definition_note()).
+ *
+ * \warning
+ * The definition is initialized along the other static objects. It is
+ * not valid until main() gets called.
+ *
+ * \return A reference to the plugin definition.
+ */
+definition const & static_plugin::plugin_definition() const
+{
+    return f_definition;
+}
+
+
+/** \brief Get the pseudo filename of this plugin.
+ *
+ * \return The name of the plugin prefixed with "static:".
+ */
+names::filename_t static_plugin::filename() const
+{
+    return STATIC_PLUGIN_FILENAME_PREFIX + names::filename_t(f_name);
+}
+
+
+/** \brief Create the plugin.
+ *
+ * This function creates the plugin factory, which creates the plugin
+ * and registers it with the repository, exactly like the static
+ * initialization of a plugin loaded with dlopen().
+ *
+ * The factory is a function static object so calling this function
+ * more than once creates the plugin only once.
+ */
+void static_plugin::create() const
+{
+    f_create();
+}
+
+
+/** \brief Get the next static plugin.
+ *
+ * \return The next plugin or nullptr at the end of the table.
+ */
+static_plugin const * static_plugin::next() const
+{
+    return f_next;
+}
+
+
+/** \brief Get the first static plugin.
+ *
+ * The table is not sorted. Use next() to go through all the entries.
+ *
+ * \return The first plugin or nullptr if no plugins were linked in the
+ * executable.
+ */
+static_plugin const * static_plugin::first()
+{
+    return g_static_plugins.load(std::memory_order_acquire);
+}
+
+
+/** \brief Search the table for a plugin by name.
+ *
+ * \param[in] name  The name of the plugin to search.
+ *
+ * \return The plugin or nullptr if no plugin with that name was linked
+ * in the executable.
+ */
+static_plugin const * static_plugin::find(names::name_t const & name)
+{
+    for(static_plugin const * p(first()); p != nullptr; p = p->f_next)
+    {
+        if(name == p->f_name)
+        {
+            return p;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/** \brief Search the table for a plugin by pseudo filename.
+ *
+ * \param[in] filename  The filename as returned by filename().
+ *
+ * \return The plugin or nullptr if \p filename does not represent a
+ * static plugin.
+ */
+static_plugin const * static_plugin::find_by_filename(names::filename_t const & filename)
+{
+    if(!is_static_filename(filename))
+    {
+        return nullptr;
+    }
+
+    return find(filename.substr(sizeof(STATIC_PLUGIN_FILENAME_PREFIX) - 1));
+}
+
+
+/** \brief Check whether a filename represents a static plugin.
+ *
+ * \param[in] filename  The filename to check.
+ *
+ * \return true if \p filename starts with "static:".
+ */
+bool static_plugin::is_static_filename(names::filename_t const & filename)
+{
+    return filename.compare(0, sizeof(STATIC_PLUGIN_FILENAME_PREFIX) - 1, STATIC_PLUGIN_FILENAME_PREFIX) == 0;
+}
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
@@ -0,0 +1,66 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    <serverplugins/definition.h>
+#include    <serverplugins/names.h>
+
+
+
+namespace serverplugins
+{
+
+
+
+constexpr char const        STATIC_PLUGIN_FILENAME_PREFIX[] = "static:";
+
+
+class static_plugin
+{
+public:
+    typedef void (*create_t)();
+
+                                    static_plugin(char const * name, definition const & def, create_t create);
+                                    static_plugin(static_plugin const &) = delete;
+    static_plugin &                 operator = (static_plugin const &) = delete;
+
+    char const *                    name() const;
+    definition const &              plugin_definition() const;
+    names::filename_t               filename() const;
+    void                            create() const;
+    static_plugin const *           next() const;
+
+    static static_plugin const *    first();
+    static static_plugin const *    find(names::name_t const & name);
+    static static_plugin const *    find_by_filename(names::filename_t const & filename);
+    static bool                     is_static_filename(names::filename_t const & filename);
+
+private:
+    char const *                    f_name = nullptr;
+    definition const &              f_definition;
+    create_t                        f_create = nullptr;
+    static_plugin const *           f_next = nullptr;
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
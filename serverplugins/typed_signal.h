@@ -0,0 +1,1334 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+/** \file
+ * \brief Template implementation of the plugin signals.
+ *
+ * The PLUGIN_SIGNAL_WITH_MODE() macro defines its signals with the
+ * serverplugins::signal template defined here. The signal keeps its
+ * listeners in a vector sorted by priority and calls them through
+ * a delegate, a pointer to the object and a pointer to a function
+ * which calls the member function of the listener.
+ *
+ * The SERVERPLUGINS_LISTEN() macros create such delegates with the
+ * serverplugins::listener() function. When the arguments are the
+ * placeholders in order (`std::placeholders::_1`, `_2`, etc.), no
+ * std::bind() or std::function is created. The arguments are passed
+ * down to the listeners by reference, so an argument passed by value
+ * to the signal only gets copied if the listener itself takes it by
+ * value.
+ *
+ * Any other callable (a lambda, a std::function, the result of a
+ * std::bind() with hard coded arguments, etc.) can still be used. It
+ * gets allocated once, when added to the signal.
+ *
+ * A signal can also be emitted with a batch of items at once (see
+ * signal::call_batch()). A listener created with batch_listener()
+ * receives the whole batch in one call. The other listeners get called
+ * once per item.
+ *
+ * Once all the listeners are connected, a signal can be frozen (see
+ * signal::freeze()). Its listeners cannot change anymore and call()
+ * becomes a loop over a flat array of object and function pointers.
+ */
+
+// self
+//
+#include    <serverplugins/exception.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <exception>
+#include    <functional>
+#include    <memory>
+#include    <thread>
+#include    <tuple>
+#include    <type_traits>
+#include    <utility>
+#include    <vector>
+
+
+
+namespace serverplugins
+{
+
+
+
+/** \brief A view on contiguous items.
+ *
+ * This is a minimal version of the C++20 std::span used to pass a batch
+ * of items to a signal. It does not own the items: the caller of the
+ * signal keeps them alive until the signal returns.
+ *
+ * \tparam T  The type of the items, `const` for a read-only view.
+ */
+template<typename T>
+class span
+{
+public:
+    typedef T                   element_type;
+    typedef std::remove_cv_t<T> value_type;
+    typedef T *                 iterator;
+
+    constexpr                   span() = default;
+
+    constexpr                   span(T * data, std::size_t size)
+                                    : f_data(data)
+                                    , f_size(size)
+                                {
+                                }
+
+    template<std::size_t N>
+    constexpr                   span(T (&items)[N])
+                                    : f_data(items)
+                                    , f_size(N)
+                                {
+                                }
+
+    template<typename C
+           , typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<C &>().data()), T *>>>
+    constexpr                   span(C & items)
+                                    : f_data(items.data())
+                                    , f_size(items.size())
+                                {
+                                }
+
+    template<typename C
+           , typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<C const &>().data()), T *>>>
+    constexpr                   span(C const & items)
+                                    : f_data(items.data())
+                                    , f_size(items.size())
+                                {
+                                }
+
+    template<typename U
+           , typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    constexpr                   span(span<U> const & items)
+                                    : f_data(items.data())
+                                    , f_size(items.size())
+                                {
+                                }
+
+    constexpr T *               data() const { return f_data; }
+    constexpr std::size_t       size() const { return f_size; }
+    constexpr bool              empty() const { return f_size == 0; }
+    constexpr iterator          begin() const { return f_data; }
+    constexpr iterator          end() const { return f_data + f_size; }
+    constexpr T &               operator [] (std::size_t idx) const { return f_data[idx]; }
+
+    constexpr span              subspan(std::size_t offset, std::size_t count) const
+                                {
+                                    return span(f_data + offset, count);
+                                }
+
+private:
+    T *                         f_data = nullptr;
+    std::size_t                 f_size = 0;
+};
+
+
+
+namespace detail
+{
+
+
+
+/** \brief The type used to pass an argument to the listeners.
+ *
+ * Arguments are passed by constant reference, except for arguments
+ * already declared as references which are passed as is (i.e. a
+ * listener can modify a `std::string &` parameter).
+ */
+template<typename T>
+using signal_argument_t = std::add_lvalue_reference_t<std::add_const_t<T>>;
+
+
+/** \brief Check whether the arguments are placeholders in order.
+ *
+ * The SERVERPLUGINS_LISTEN() macro passes the arguments it receives
+ * to the listener() function. When those are `_1`, `_2`, ..., `_N`,
+ * the member function can be called directly with the first N arguments
+ * of the signal.
+ */
+template<std::size_t I, typename ... A>
+struct sequential_placeholders
+    : std::true_type
+{
+};
+
+
+template<std::size_t I, typename A, typename ... R>
+struct sequential_placeholders<I, A, R...>
+    : std::bool_constant<std::is_placeholder<std::decay_t<A>>::value == static_cast<int>(I + 1)
+                      && sequential_placeholders<I + 1, R...>::value>
+{
+};
+
+
+/** \brief A listener defined by a member function.
+ *
+ * This is the object returned by listener() when no std::bind() is
+ * necessary. The delegate converts it to a call of member function
+ * \p M with the first \p N arguments of the signal.
+ */
+template<auto M, typename O, std::size_t N>
+struct member_listener
+{
+    O *         f_object = nullptr;
+};
+
+
+/** \brief A listener defined by a member function and a batch handler.
+ *
+ * This is the object returned by batch_listener(). The delegate calls
+ * member function \p M for each item emitted one by one and member
+ * function \p B with the whole span of a batch.
+ */
+template<auto M, auto B, typename O, std::size_t N>
+struct member_batch_listener
+{
+    O *         f_object = nullptr;
+};
+
+
+/** \brief Call member function \p M with the first \p N arguments.
+ *
+ * The signals which use the value returned by their listeners (the
+ * awaitable and the result signals) wrap a member_listener in this
+ * object since the delegate itself ignores that value.
+ */
+template<auto M, typename O, std::size_t N>
+struct member_call
+{
+    template<typename ... A>
+    decltype(auto) operator () (A & ... args) const
+    {
+        if constexpr (N == sizeof...(A))
+        {
+            return (f_object->*M)(args...);
+        }
+        else
+        {
+            return call(std::forward_as_tuple(args...), std::make_index_sequence<N>());
+        }
+    }
+
+    template<typename T, std::size_t ... I>
+    decltype(auto) call(T const & t, std::index_sequence<I...>) const
+    {
+        return (f_object->*M)(std::get<I>(t)...);
+    }
+
+    O *         f_object = nullptr;
+};
+
+
+/** \brief Whether a callable has its own batch handler.
+ *
+ * A callable with a `call_batch(batch_t)` function keeps handling the
+ * batches itself once converted to a delegate.
+ */
+template<typename F, typename B, typename = void>
+struct has_call_batch
+    : std::false_type
+{
+};
+
+
+template<typename F, typename B>
+struct has_call_batch<F, B, std::void_t<decltype(std::declval<F const &>().call_batch(std::declval<B>()))>>
+    : std::true_type
+{
+};
+
+
+/** \brief The type of one item of a batch.
+ *
+ * A signal with one parameter uses the decayed type of that parameter
+ * (i.e. a `std::string const &` parameter gives a `std::string`). A
+ * signal with any other number of parameters uses a tuple.
+ */
+template<typename ... Args>
+struct batch_item
+{
+    typedef std::tuple<std::decay_t<Args>...>   type;
+};
+
+
+template<typename A>
+struct batch_item<A>
+{
+    typedef std::decay_t<A>                     type;
+};
+
+
+/** \brief Whether one of the parameters is a non-const reference.
+ *
+ * The listeners of such a signal can modify the arguments, so the
+ * items of a batch are not made read-only either.
+ */
+template<typename ... Args>
+constexpr bool const has_mutable_reference =
+        ((std::is_lvalue_reference_v<Args>
+            && !std::is_const_v<std::remove_reference_t<Args>>) || ...);
+
+
+/** \brief Call \p f with the parameters saved in one batch item.
+ *
+ * \tparam N  The number of parameters of the signal.
+ */
+template<std::size_t N, typename F, typename T>
+decltype(auto) apply_item(F && f, T & item)
+{
+    if constexpr (N == 1)
+    {
+        return std::forward<F>(f)(item);
+    }
+    else
+    {
+        return std::apply(std::forward<F>(f), item);
+    }
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Create a listener from a member function.
+ *
+ * This function is used by the SERVERPLUGINS_LISTEN() macros. If the
+ * \p args are placeholders in order, it returns a lightweight object
+ * which a delegate calls directly. Otherwise, it returns the result of
+ * std::bind(), as the macros did before.
+ *
+ * \tparam M  The member function to call (i.e. `&my_plugin::on_signal`).
+ * \tparam O  The type of the listener.
+ * \tparam A  The types of the arguments.
+ * \param[in] object  The listener (`this`).
+ * \param[in] args  The arguments as in std::bind().
+ *
+ * \return An object which can be converted to a delegate.
+ */
+template<auto M, typename O, typename ... A>
+auto listener(O * object, A && ... args)
+{
+    if constexpr (detail::sequential_placeholders<0, A...>::value)
+    {
+        return detail::member_listener<M, O, sizeof...(A)>{ object };
+    }
+    else
+    {
+        return std::bind(M, object, std::forward<A>(args)...);
+    }
+}
+
+
+/** \brief Create a listener which also handles batches.
+ *
+ * This function is used by the SERVERPLUGINS_LISTEN_BATCH() macro. The
+ * resulting delegate calls \p M when the signal is emitted with one
+ * item and \p B with the whole span when the signal is emitted with a
+ * batch (see signal::call_batch()).
+ *
+ * The batch handler takes the `batch_t` of the signal:
+ *
+ * \code
+ *     void on_record(emitter::signal_record_t::batch_t records);
+ * \endcode
+ *
+ * \tparam M  The member function handling one item.
+ * \tparam B  The member function handling a batch.
+ * \tparam O  The type of the listener.
+ * \tparam A  The types of the arguments, placeholders in order.
+ * \param[in] object  The listener (`this`).
+ *
+ * \return An object which can be converted to a delegate.
+ */
+template<auto M, auto B, typename O, typename ... A>
+auto batch_listener(O * object, A && ...)
+{
+    static_assert(detail::sequential_placeholders<0, A...>::value
+                , "the arguments of a batch listener must be the placeholders in order");
+
+    return detail::member_batch_listener<M, B, O, sizeof...(A)>{ object };
+}
+
+
+
+template<typename ... Args>
+class signal;
+
+
+/** \brief A function called by a signal.
+ *
+ * A delegate is a pointer to an object and a pointer to a function
+ * calling that object. It is cheap to copy and, when created from a
+ * listener() of a member function, it does not allocate anything.
+ *
+ * A delegate created from any other callable keeps a copy of that
+ * callable in a shared pointer.
+ *
+ * A delegate created with batch_listener(), or from a callable with
+ * a `call_batch()` function, also has a pointer to a function handling
+ * a whole batch of items. Without it, call_batch() calls the delegate
+ * once per item.
+ *
+ * \tparam Args  The types of the parameters of the signal.
+ */
+template<typename ... Args>
+class delegate
+{
+public:
+    typedef typename detail::batch_item<Args...>::type
+                                item_t;
+    typedef span<std::conditional_t<detail::has_mutable_reference<Args...>, item_t, item_t const>>
+                                batch_t;
+    typedef void (*stub_t)(void *, detail::signal_argument_t<Args>...);
+    typedef void (*batch_stub_t)(void *, batch_t);
+
+                                delegate() = default;
+
+    template<auto M, typename O, std::size_t N>
+                                delegate(detail::member_listener<M, O, N> const & l)
+                                    : f_object(l.f_object)
+                                    , f_stub(&member_stub<M, O, N>)
+                                {
+                                }
+
+    template<auto M, auto B, typename O, std::size_t N>
+                                delegate(detail::member_batch_listener<M, B, O, N> const & l)
+                                    : f_object(l.f_object)
+                                    , f_stub(&member_stub<M, O, N>)
+                                    , f_batch_stub(&batch_stub<B, O>)
+                                {
+                                }
+
+    template<typename F
+           , typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, delegate>
+                                      && std::is_invocable_v<std::decay_t<F> &, detail::signal_argument_t<Args>...>>>
+                                delegate(F && f)
+                                    : f_owner(std::make_shared<std::decay_t<F>>(std::forward<F>(f)))
+                                    , f_object(f_owner.get())
+                                    , f_stub(&function_stub<std::decay_t<F>>)
+                                    , f_batch_stub(function_batch_stub_for<std::decay_t<F>>())
+                                {
+                                }
+
+    void                        operator () (detail::signal_argument_t<Args>... args) const
+                                {
+                                    f_stub(f_object, args...);
+                                }
+
+    void                        call_batch(batch_t items) const
+                                {
+                                    if(f_batch_stub != nullptr)
+                                    {
+                                        f_batch_stub(f_object, items);
+                                        return;
+                                    }
+                                    for(auto & item : items)
+                                    {
+                                        detail::apply_item<sizeof...(Args)>(*this, item);
+                                    }
+                                }
+
+    bool                        is_member() const
+                                {
+                                    return f_owner == nullptr;
+                                }
+
+    bool                        has_batch() const
+                                {
+                                    return f_batch_stub != nullptr;
+                                }
+
+                                explicit operator bool () const
+                                {
+                                    return f_stub != nullptr;
+                                }
+
+private:
+    template<typename ... A>
+    friend class signal;
+
+    template<auto M, typename O, std::size_t N>
+    static void                 member_stub(void * object, detail::signal_argument_t<Args>... args)
+                                {
+                                    O * o(static_cast<O *>(object));
+                                    if constexpr (N == sizeof...(Args))
+                                    {
+                                        (o->*M)(args...);
+                                    }
+                                    else
+                                    {
+                                        call_member<M>(o, std::forward_as_tuple(args...), std::make_index_sequence<N>());
+                                    }
+                                }
+
+    template<auto M, typename O, typename T, std::size_t ... I>
+    static void                 call_member(O * o, T const & t, std::index_sequence<I...>)
+                                {
+                                    (o->*M)(std::get<I>(t)...);
+                                }
+
+    template<auto B, typename O>
+    static void                 batch_stub(void * object, batch_t items)
+                                {
+                                    (static_cast<O *>(object)->*B)(items);
+                                }
+
+    template<typename F>
+    static void                 function_stub(void * object, detail::signal_argument_t<Args>... args)
+                                {
+                                    (*static_cast<F *>(object))(args...);
+                                }
+
+    template<typename F>
+    static void                 function_batch_stub(void * object, batch_t items)
+                                {
+                                    static_cast<F *>(object)->call_batch(items);
+                                }
+
+    template<typename F>
+    static constexpr batch_stub_t
+                                function_batch_stub_for()
+                                {
+                                    if constexpr (detail::has_call_batch<F, batch_t>::value)
+                                    {
+                                        return &function_batch_stub<F>;
+                                    }
+                                    else
+                                    {
+                                        return nullptr;
+                                    }
+                                }
+
+    std::shared_ptr<void>       f_owner = std::shared_ptr<void>();
+    void *                      f_object = nullptr;
+    stub_t                      f_stub = nullptr;
+    batch_stub_t                f_batch_stub = nullptr;
+};
+
+
+template<typename ... Args>
+class delegate<void(Args...)>
+    : public delegate<Args...>
+{
+public:
+    using delegate<Args...>::delegate;
+};
+
+
+
+namespace detail
+{
+
+
+/** \brief Call a function \p count times, one after the other.
+ *
+ * This is what call_parallel() does without a pool. As with
+ * delivery_pool::fan_out(), all the calls happen even if some of them
+ * throw, and the exception of the call with the smallest index gets
+ * rethrown once they are all done.
+ *
+ * \tparam F  The type of the function, called as `f(index)`.
+ * \param[in] count  The number of calls.
+ * \param[in] f  The function to call.
+ */
+template<typename F>
+void call_each(std::size_t count, F const & f)
+{
+    std::exception_ptr error;
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        try
+        {
+            f(idx);
+        }
+        catch(...)
+        {
+            if(error == nullptr)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if(error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+
+/** \brief A pointer to read-only data replaced with read-copy-update.
+ *
+ * The data pointed to is never modified once published. The writers
+ * create new data and replace the pointer with publish(), while holding
+ * the mutex returned by get_mutex(). The readers create a reader object
+ * and use the data returned by its get() function without locking
+ * anything.
+ *
+ * The replaced data cannot be deleted immediately since readers may
+ * still be using it. Each reader registers itself in one of two reader
+ * counters; the data is deleted once both counters were seen at zero
+ * after it was replaced (two grace periods). This check happens when
+ * the data gets replaced and when the last reader of a grace period
+ * goes away, and it never blocks.
+ *
+ * Once the data is known to never change again, freeze() can be called.
+ * From then on the readers do not register anymore, reading the data is
+ * then as cheap as reading a plain pointer.
+ *
+ * \tparam T  The type of the data.
+ */
+template<typename T>
+class rcu
+{
+public:
+    /** \brief Register a reader in the current reader counter.
+     *
+     * The constructor increments the reader counter of the current
+     * parity and the destructor decrements it. The parity is checked
+     * again after the increment so a flip happening in between is
+     * not missed.
+     *
+     * Once the data is frozen, the reader does not register at all.
+     */
+    class reader
+    {
+    public:
+        reader(rcu const & r)
+            : f_rcu(r)
+        {
+            if(f_rcu.f_frozen.load(std::memory_order_acquire))
+            {
+                f_parity = NOT_REGISTERED;
+                return;
+            }
+            for(;;)
+            {
+                f_parity = f_rcu.f_parity.load();
+                f_rcu.f_readers[f_parity].fetch_add(1);
+                if(f_rcu.f_parity.load() == f_parity)
+                {
+                    break;
+                }
+                f_rcu.f_readers[f_parity].fetch_sub(1);
+            }
+        }
+
+        reader(reader const &) = delete;
+        reader & operator = (reader const &) = delete;
+
+        ~reader()
+        {
+            if(f_parity != NOT_REGISTERED
+            && f_rcu.f_readers[f_parity].fetch_sub(1) == 1
+            && f_rcu.f_retired.load() != 0)
+            {
+                f_rcu.try_reclaim();
+            }
+        }
+
+        T const * get() const
+        {
+            return f_rcu.f_current.load();
+        }
+
+    private:
+        static constexpr std::size_t
+                                    NOT_REGISTERED = 2;
+
+        rcu const &                 f_rcu;
+        std::size_t                 f_parity = 0;
+    };
+
+                                rcu() = default;
+                                rcu(rcu const &) = delete;
+    rcu &                       operator = (rcu const &) = delete;
+
+                                ~rcu()
+                                {
+                                    // no reader can exist at this point
+                                    //
+                                    delete f_current.load();
+                                    for(auto d : f_waiting)
+                                    {
+                                        delete d;
+                                    }
+                                    for(auto d : f_pending)
+                                    {
+                                        delete d;
+                                    }
+                                }
+
+    cppthread::mutex &          get_mutex() const
+                                {
+                                    return f_mutex;
+                                }
+
+    /** \brief Get the current data.
+     *
+     * The mutex must be locked by the caller.
+     */
+    T const *                   current() const
+                                {
+                                    return f_current.load();
+                                }
+
+    /** \brief Replace the data.
+     *
+     * The previous data gets deleted once no reader can still be using
+     * it. The \p value pointer can be a null pointer.
+     *
+     * The mutex must be locked by the caller.
+     */
+    void                        publish(T const * value)
+                                {
+                                    T const * previous(f_current.exchange(value));
+                                    if(previous != nullptr)
+                                    {
+                                        f_pending.push_back(previous);
+                                        f_retired.fetch_add(1);
+                                    }
+                                    advance();
+                                }
+
+    /** \brief Stop replacing the data.
+     *
+     * Once frozen, the current data must not be replaced anymore and the
+     * readers stop registering themselves. The data replaced before the
+     * call still gets deleted once the readers that were using it are
+     * gone.
+     *
+     * The mutex must be locked by the caller.
+     */
+    void                        freeze()
+                                {
+                                    f_frozen.store(true, std::memory_order_release);
+                                }
+
+    /** \brief Allow the data to be replaced again.
+     *
+     * \warning
+     * The readers created while the data was frozen are not registered.
+     * No such reader may exist when this function gets called.
+     *
+     * The mutex must be locked by the caller.
+     */
+    void                        thaw()
+                                {
+                                    f_frozen.store(false, std::memory_order_release);
+                                }
+
+    /** \brief Check whether freeze() was called.
+     *
+     * \return true if the data cannot be replaced anymore.
+     */
+    bool                        is_frozen() const
+                                {
+                                    return f_frozen.load(std::memory_order_acquire);
+                                }
+
+    /** \brief Wait for the replaced data to be deleted.
+     *
+     * \warning
+     * This function must not be called by a reader since it would wait
+     * for itself to go away.
+     */
+    void                        synchronize()
+                                {
+                                    for(;;)
+                                    {
+                                        {
+                                            cppthread::guard lock(f_mutex);
+                                            advance();
+                                            if(f_waiting.empty()
+                                            && f_pending.empty())
+                                            {
+                                                return;
+                                            }
+                                        }
+                                        std::this_thread::yield();
+                                    }
+                                }
+
+private:
+    typedef std::vector<T const *>  retired_t;
+
+    /** \brief Reclaim the replaced data if possible.
+     *
+     * This function is called by the last reader of a grace period. It
+     * does nothing if another thread is replacing the data.
+     */
+    void try_reclaim() const
+    {
+        if(f_mutex.try_lock())
+        {
+            advance();
+            f_mutex.unlock();
+        }
+    }
+
+    /** \brief End a grace period if the previous readers are gone.
+     *
+     * The data in f_waiting was replaced before the last flip of the
+     * parity. If no reader registered before that flip is left, it can
+     * be deleted. Then the data in f_pending starts waiting and the
+     * parity gets flipped.
+     *
+     * The f_mutex must be locked by the caller.
+     */
+    void advance() const
+    {
+        std::size_t const parity(f_parity.load());
+        if(f_readers[parity ^ 1].load() != 0)
+        {
+            return;
+        }
+
+        f_retired.fetch_sub(f_waiting.size());
+        for(auto d : f_waiting)
+        {
+            delete d;
+        }
+        f_waiting.swap(f_pending);
+        f_pending.clear();
+
+        if(!f_waiting.empty())
+        {
+            f_parity.store(parity ^ 1);
+        }
+    }
+
+    mutable cppthread::mutex        f_mutex = cppthread::mutex();
+    std::atomic<T const *>          f_current = nullptr;
+    mutable std::atomic<std::size_t>
+                                    f_parity = 0;
+    mutable std::atomic<std::size_t>
+                                    f_readers[2] = {};
+    mutable std::atomic<std::size_t>
+                                    f_retired = 0;
+    mutable retired_t               f_pending = retired_t();
+    mutable retired_t               f_waiting = retired_t();
+    std::atomic<bool>               f_frozen = false;
+};
+
+
+} // namespace detail
+
+
+
+/** \brief A signal.
+ *
+ * This class holds the list of listeners of one signal. It has the same
+ * interface as the snapdev::callback_manager previously used by the
+ * PLUGIN_SIGNAL_WITH_MODE() macro.
+ *
+ * The listeners are saved in a vector sorted by priority. The listeners
+ * with a higher priority get called first. Listeners with the same
+ * priority are called in the order they were added.
+ *
+ * The vector is never modified once published. Adding or removing a
+ * listener creates a new vector and replaces the pointer. The call()
+ * function reads the pointer without locking anything, so a signal can
+ * be emitted by any number of threads while other threads add or remove
+ * listeners (read-copy-update). A listener can also add or remove
+ * listeners while the signal is being emitted.
+ *
+ * The replaced vectors cannot be deleted immediately since threads
+ * emitting the signal may still be using them. They get deleted once
+ * the calls which started before the replacement returned (see
+ * detail::rcu).
+ *
+ * \note
+ * Since a call() works on the vector that was current when it started,
+ * a listener removed by another thread may still be called by emissions
+ * which started before remove_callback() returned. The collection takes
+ * care of that case before unloading a plugin (see
+ * collection::unload_plugin() and synchronize()).
+ *
+ * Once frozen (see freeze()), the listeners cannot change anymore and
+ * the emissions do not register themselves as readers.
+ *
+ * \tparam Args  The types of the parameters of the signal. The function
+ * type `void(Args...)` can also be used.
+ */
+template<typename ... Args>
+class signal
+{
+public:
+    typedef std::function<void(Args...)>    value_type;
+    typedef delegate<Args...>               delegate_t;
+    typedef typename delegate_t::item_t     item_t;
+    typedef typename delegate_t::batch_t    batch_t;
+    typedef int                             callback_id_t;
+    typedef int                             priority_t;
+
+    static constexpr callback_id_t          NULL_CALLBACK_ID = 0;
+    static constexpr priority_t             DEFAULT_PRIORITY = 0;
+
+                                signal() = default;
+                                signal(signal const &) = delete;
+    signal &                    operator = (signal const &) = delete;
+
+    callback_id_t add_callback(delegate_t const & callback, priority_t priority = DEFAULT_PRIORITY)
+    {
+        cppthread::guard lock(f_listeners.get_mutex());
+        verify_not_frozen();
+
+        listener_t l;
+        l.f_id = ++f_next_id;
+        l.f_priority = priority;
+        l.f_delegate = callback;
+
+        listener_vector_t const * current(f_listeners.current());
+        auto listeners(std::make_unique<listener_vector_t>());
+        if(current != nullptr)
+        {
+            listeners->reserve(current->size() + 1);
+            *listeners = *current;
+        }
+        auto it(std::find_if(
+                  listeners->begin()
+                , listeners->end()
+                , [priority](listener_t const & item)
+                  {
+                      return item.f_priority < priority;
+                  }));
+        listeners->insert(it, l);
+        f_listeners.publish(listeners.release());
+
+        return l.f_id;
+    }
+
+    bool remove_callback(callback_id_t callback_id)
+    {
+        cppthread::guard lock(f_listeners.get_mutex());
+        verify_not_frozen();
+
+        listener_vector_t const * current(f_listeners.current());
+        if(current == nullptr)
+        {
+            return false;
+        }
+        auto it(std::find_if(
+                  current->begin()
+                , current->end()
+                , [callback_id](listener_t const & item)
+                  {
+                      return item.f_id == callback_id;
+                  }));
+        if(it == current->end())
+        {
+            return false;
+        }
+
+        auto listeners(std::make_unique<listener_vector_t>());
+        listeners->reserve(current->size() - 1);
+        listeners->insert(listeners->end(), current->begin(), it);
+        listeners->insert(listeners->end(), it + 1, current->end());
+        f_listeners.publish(listeners.release());
+
+        return true;
+    }
+
+    void clear()
+    {
+        cppthread::guard lock(f_listeners.get_mutex());
+        verify_not_frozen();
+        f_listeners.publish(nullptr);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    std::size_t size() const
+    {
+        // the pointer cannot be deleted while we hold the mutex
+        //
+        cppthread::guard lock(f_listeners.get_mutex());
+        listener_vector_t const * current(f_listeners.current());
+        return current == nullptr ? 0 : current->size();
+    }
+
+    /** \brief Prevent any further changes to the listeners.
+     *
+     * This function copies the object and function pointers of the
+     * listeners, in priority order, in a flat array which call() uses
+     * from then on. The other functions emitting the signal keep using
+     * the vector of listeners, which can't be replaced anymore, so they
+     * do not have to register as readers either.
+     *
+     * Once frozen, add_callback(), remove_callback(), and clear() throw
+     * a logic_error until thaw() gets called.
+     *
+     * Calling this function more than once has no effect.
+     */
+    void freeze()
+    {
+        cppthread::guard lock(f_listeners.get_mutex());
+        if(f_listeners.is_frozen())
+        {
+            return;
+        }
+
+        listener_vector_t const * current(f_listeners.current());
+        if(current != nullptr)
+        {
+            f_frozen.reserve(current->size());
+            for(auto const & l : *current)
+            {
+                f_frozen.push_back(frozen_call_t{ l.f_delegate.f_object, l.f_delegate.f_stub });
+            }
+        }
+        f_listeners.freeze();
+    }
+
+    /** \brief Allow changes to the listeners again.
+     *
+     * This function is used to tear down a frozen signal, for example
+     * when the collection which froze it gets destroyed.
+     *
+     * \warning
+     * The emissions of a frozen signal do not register as readers so
+     * this function must not be called while the signal is being
+     * emitted.
+     */
+    void thaw()
+    {
+        cppthread::guard lock(f_listeners.get_mutex());
+        f_listeners.thaw();
+        f_frozen.clear();
+    }
+
+    /** \brief Check whether the signal was frozen.
+     *
+     * \return true if freeze() was called and thaw() was not.
+     */
+    bool is_frozen() const
+    {
+        return f_listeners.is_frozen();
+    }
+
+    /** \brief Delete the replaced vectors of listeners.
+     *
+     * The vectors replaced by add_callback(), remove_callback(), and
+     * clear() are normally deleted later, once no call() can still be
+     * using them. This function waits for those calls to return and
+     * deletes the vectors now.
+     *
+     * This matters when a listener is about to be unloaded: a copy of
+     * its delegate may be held by one of those vectors and, if it was
+     * not created by listener(), destroying that copy runs code found
+     * in the listener plugin.
+     *
+     * \warning
+     * This function must not be called from a listener of this signal
+     * since it would wait for itself to return.
+     */
+    void synchronize()
+    {
+        f_listeners.synchronize();
+    }
+
+    void call(detail::signal_argument_t<Args>... args) const
+    {
+        if(f_listeners.is_frozen())
+        {
+            for(auto const & c : f_frozen)
+            {
+                c.f_stub(c.f_object, args...);
+            }
+            return;
+        }
+
+        typename detail::rcu<listener_vector_t>::reader const r(f_listeners);
+        listener_vector_t const * listeners(r.get());
+        if(listeners != nullptr)
+        {
+            for(auto const & l : *listeners)
+            {
+                l.f_delegate(args...);
+            }
+        }
+    }
+
+    /** \brief Call the listeners until \p proceed returns false.
+     *
+     * This function works like call() except that \p proceed gets called
+     * before each listener. Once it returns false, the remaining listeners
+     * are not called.
+     *
+     * \tparam P  The type of the function checking whether to continue.
+     * \param[in] proceed  The function called before each listener.
+     * \param[in] args  The arguments of the signal.
+     *
+     * \return false if \p proceed returned false.
+     */
+    template<typename P>
+    bool call_while(P const & proceed, detail::signal_argument_t<Args>... args) const
+    {
+        if(f_listeners.is_frozen())
+        {
+            for(auto const & c : f_frozen)
+            {
+                if(!proceed())
+                {
+                    return false;
+                }
+                c.f_stub(c.f_object, args...);
+            }
+            return true;
+        }
+
+        typename detail::rcu<listener_vector_t>::reader const r(f_listeners);
+        listener_vector_t const * listeners(r.get());
+        if(listeners != nullptr)
+        {
+            for(auto const & l : *listeners)
+            {
+                if(!proceed())
+                {
+                    return false;
+                }
+                l.f_delegate(args...);
+            }
+        }
+        return true;
+    }
+
+    /** \brief Call all the listeners in parallel.
+     *
+     * This function calls the listeners concurrently using the
+     * fan_out() function of \p pool (i.e. a serverplugins::delivery_pool).
+     * It returns once all the listeners returned, so the duration of the
+     * call is about the duration of the slowest listener instead of the
+     * sum of all the listeners.
+     *
+     * The listeners must be independent from each other. The priority
+     * is still used to choose which exception is rethrown when more
+     * than one listener throws: the one of the listener which would
+     * have been called first.
+     *
+     * When \p pool is a null pointer or there is only one listener, the
+     * listeners get called one after the other in this thread. All of
+     * them are still called when one throws, as with a pool.
+     *
+     * \tparam P  The type of the pool.
+     * \param[in] pool  The pool running the listeners.
+     * \param[in] args  The arguments of the signal.
+     */
+    template<typename P>
+    void call_parallel(P * pool, detail::signal_argument_t<Args>... args) const
+    {
+        static_assert(((!std::is_lvalue_reference_v<Args>
+                            || std::is_const_v<std::remove_reference_t<Args>>) && ...)
+                    , "a signal with a non-const reference parameter cannot call its listeners in parallel");
+
+        typename detail::rcu<listener_vector_t>::reader const r(f_listeners);
+        listener_vector_t const * listeners(r.get());
+        if(listeners == nullptr)
+        {
+            return;
+        }
+        auto const f([listeners, &args...](std::size_t idx)
+              {
+                  (*listeners)[idx].f_delegate(args...);
+              });
+        if(pool == nullptr
+        || listeners->size() == 1)
+        {
+            detail::call_each(listeners->size(), f);
+            return;
+        }
+
+        pool->fan_out(listeners->size(), f);
+    }
+
+    /** \brief Call all the listeners with a batch of items.
+     *
+     * This function is equivalent to calling call() once per item, except
+     * that the list of listeners is walked once for the whole batch and
+     * each listener sees all the items before the next listener gets
+     * called. A listener created with batch_listener() receives the
+     * whole span in a single call, the others get called once per item.
+     *
+     * When the signal has a non-const reference parameter, the items
+     * are not read-only and the changes made by the listeners are seen
+     * by the following listeners and by the caller, as with call().
+     *
+     * \param[in] items  The items, one set of arguments each.
+     */
+    void call_batch(batch_t items) const
+    {
+        if(items.empty())
+        {
+            return;
+        }
+
+        typename detail::rcu<listener_vector_t>::reader const r(f_listeners);
+        listener_vector_t const * listeners(r.get());
+        if(listeners != nullptr)
+        {
+            for(auto const & l : *listeners)
+            {
+                l.f_delegate.call_batch(items);
+            }
+        }
+    }
+
+    /** \brief Call all the listeners in parallel with a batch of items.
+     *
+     * This function is to call_batch() what call_parallel() is to call():
+     * each listener processes the whole batch, concurrently with the
+     * other listeners.
+     *
+     * \tparam P  The type of the pool.
+     * \param[in] pool  The pool running the listeners.
+     * \param[in] items  The items, one set of arguments each.
+     */
+    template<typename P>
+    void call_parallel_batch(P * pool, batch_t items) const
+    {
+        static_assert(!detail::has_mutable_reference<Args...>
+                    , "a signal with a non-const reference parameter cannot call its listeners in parallel");
+
+        if(items.empty())
+        {
+            return;
+        }
+
+        typename detail::rcu<listener_vector_t>::reader const r(f_listeners);
+        listener_vector_t const * listeners(r.get());
+        if(listeners == nullptr)
+        {
+            return;
+        }
+        auto const f([listeners, items](std::size_t idx)
+              {
+                  (*listeners)[idx].f_delegate.call_batch(items);
+              });
+        if(pool == nullptr
+        || listeners->size() == 1)
+        {
+            detail::call_each(listeners->size(), f);
+            return;
+        }
+
+        pool->fan_out(listeners->size(), f);
+    }
+
+    /** \brief Call \p f with the arguments saved in one batch item.
+     *
+     * This is used by the PLUGIN_SIGNAL_WITH_MODE() macro to call the
+     * \<name>_start() and \<name>_done() functions on each item of a
+     * batch.
+     *
+     * \param[in] f  The function to call.
+     * \param[in] item  One item of a batch.
+     *
+     * \return What \p f returns.
+     */
+    template<typename F, typename I>
+    static decltype(auto) apply_item(F && f, I & item)
+    {
+        return detail::apply_item<sizeof...(Args)>(std::forward<F>(f), item);
+    }
+
+    /** \brief Get a function calling the listeners in parallel.
+     *
+     * The PLUGIN_SIGNAL_WITH_MODE() macro uses this function with the
+     * PARALLEL modes since the arguments are defined as a list between
+     * parenthesis, as in:
+     *
+     * \code
+     *     f_signal_index.parallel(pool)(document);
+     * \endcode
+     *
+     * \tparam P  The type of the pool.
+     * \param[in] pool  The pool running the listeners.
+     *
+     * \return A function calling call_parallel().
+     */
+    template<typename P>
+    auto parallel(P * pool) const
+    {
+        return [this, pool](detail::signal_argument_t<Args>... args)
+            {
+                call_parallel(pool, args...);
+            };
+    }
+
+private:
+    struct listener_t
+    {
+        callback_id_t               f_id = NULL_CALLBACK_ID;
+        priority_t                  f_priority = DEFAULT_PRIORITY;
+        delegate_t                  f_delegate = delegate_t();
+    };
+    typedef std::vector<listener_t> listener_vector_t;
+
+    struct frozen_call_t
+    {
+        void *                      f_object = nullptr;
+        typename delegate_t::stub_t f_stub = nullptr;
+    };
+    typedef std::vector<frozen_call_t>
+                                    frozen_vector_t;
+
+    void verify_not_frozen() const
+    {
+        if(f_listeners.is_frozen())
+        {
+            throw logic_error("the listeners of a frozen signal cannot be changed.");
+        }
+    }
+
+    detail::rcu<listener_vector_t>  f_listeners = detail::rcu<listener_vector_t>();
+    callback_id_t                   f_next_id = NULL_CALLBACK_ID;
+    frozen_vector_t                 f_frozen = frozen_vector_t();
+};
+
+
+template<typename ... Args>
+class signal<void(Args...)>
+    : public signal<Args...>
+{
+};
+
+
+
+} // namespace serverplugins
+// vim: ts=4 sw=4 et
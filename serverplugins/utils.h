@@ -128,7 +128,7 @@ struct version_t
                         {
                         }
 
-                        version_t(
+                        constexpr version_t(
                                   std::int32_t major
                                 , std::int32_t minor
                                 , std::int32_t patch = 0)
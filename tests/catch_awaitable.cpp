@@ -0,0 +1,302 @@
+// Copyright (c) 2006-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// serverplugins
+//
+#include    <serverplugins/awaitable_signal.h>
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <deque>
+#include    <thread>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+#ifdef SERVERPLUGINS_COROUTINES
+namespace
+{
+
+
+class thread_executor
+    : public serverplugins::executor
+{
+public:
+    thread_executor()
+        : f_thread([this]() { run(); })
+    {
+    }
+
+    ~thread_executor()
+    {
+        {
+            cppthread::guard lock(f_mutex);
+            f_stop = true;
+            f_mutex.broadcast();
+        }
+        f_thread.join();
+    }
+
+    virtual void post(work_t && work) override
+    {
+        cppthread::guard lock(f_mutex);
+        f_work.push_back(std::move(work));
+        ++f_posted;
+        f_mutex.broadcast();
+    }
+
+    std::thread::id get_id() const
+    {
+        return f_thread.get_id();
+    }
+
+    std::size_t get_posted() const
+    {
+        cppthread::guard lock(f_mutex);
+        return f_posted;
+    }
+
+private:
+    void run()
+    {
+        for(;;)
+        {
+            work_t work;
+            {
+                cppthread::guard lock(f_mutex);
+                while(f_work.empty() && !f_stop)
+                {
+                    f_mutex.wait();
+                }
+                if(f_work.empty())
+                {
+                    return;
+                }
+                work = std::move(f_work.front());
+                f_work.pop_front();
+            }
+            work();
+        }
+    }
+
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    std::deque<work_t>          f_work = std::deque<work_t>();
+    std::size_t                 f_posted = 0;
+    bool                        f_stop = false;
+    std::thread                 f_thread;
+};
+
+
+// simulate an I/O completing in another thread
+//
+struct resume_in
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const { f_executor->post([h]() { h.resume(); }); }
+    void await_resume() const noexcept {}
+
+    serverplugins::executor::pointer_t
+                                f_executor = serverplugins::executor::pointer_t();
+};
+
+
+class awaitable_emitter
+{
+public:
+    PLUGIN_AWAITABLE_SIGNAL_WITH_MODE(lookup, (std::string const & key), (key), START_AND_DONE);
+
+    std::vector<std::string>    f_done = std::vector<std::string>();
+};
+
+
+bool awaitable_emitter::lookup_start(std::string const & key)
+{
+    return !key.empty();
+}
+
+
+void awaitable_emitter::lookup_done(std::string const & key)
+{
+    f_done.push_back(key);
+}
+
+
+struct awaitable_listener
+{
+    serverplugins::task<bool> on_lookup(std::string const & key)
+    {
+        f_calls.push_back("async:" + key);
+        if(f_io != nullptr)
+        {
+            co_await resume_in{ f_io };
+            f_threads.push_back(std::this_thread::get_id());
+        }
+        if(key == "throw")
+        {
+            throw std::runtime_error("lookup failed");
+        }
+        co_return key != "stop";
+    }
+
+    serverplugins::task<> on_log(std::string const & key)
+    {
+        f_calls.push_back("log:" + key);
+        f_threads.push_back(std::this_thread::get_id());
+        co_return;
+    }
+
+    void on_plain(std::string const & key)
+    {
+        f_calls.push_back("plain:" + key);
+    }
+
+    std::vector<std::string>    f_calls = std::vector<std::string>();
+    std::vector<std::thread::id>
+                                f_threads = std::vector<std::thread::id>();
+    serverplugins::executor::pointer_t
+                                f_io = serverplugins::executor::pointer_t();
+};
+
+
+serverplugins::task<int> count_found(awaitable_emitter & e, std::vector<std::string> const & keys)
+{
+    int found(0);
+    for(auto const & k : keys)
+    {
+        if(co_await e.lookup(k))
+        {
+            ++found;
+        }
+    }
+    co_return found;
+}
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("awaitable", "[plugins][awaitable]")
+{
+    CATCH_START_SECTION("awaitable: listeners run in order and can stop the chain")
+    {
+        awaitable_emitter e;
+        CATCH_REQUIRE(serverplugins::sync_wait(e.lookup("nobody")));
+        CATCH_REQUIRE(e.f_done == std::vector<std::string>({"nobody"}));
+
+        awaitable_listener l;
+        e.signal_listen_lookup(serverplugins::listener<&awaitable_listener::on_plain>(&l, std::placeholders::_1), -10);
+        e.signal_listen_lookup(serverplugins::listener<&awaitable_listener::on_lookup>(&l, std::placeholders::_1), 10);
+        e.signal_listen_lookup(serverplugins::listener<&awaitable_listener::on_log>(&l, std::placeholders::_1));
+        e.signal_listen_lookup([&l](std::string const & key)
+            {
+                l.f_calls.push_back("lambda:" + key);
+                return true;
+            });
+
+        CATCH_REQUIRE(serverplugins::sync_wait(e.lookup("a")));
+        CATCH_REQUIRE(l.f_calls == std::vector<std::string>({"async:a", "log:a", "lambda:a", "plain:a"}));
+        CATCH_REQUIRE(e.f_done == std::vector<std::string>({"nobody", "a"}));
+
+        // a listener returning false stops the chain and <name>_done()
+        //
+        l.f_calls.clear();
+        CATCH_REQUIRE_FALSE(serverplugins::sync_wait(e.lookup("stop")));
+        CATCH_REQUIRE(l.f_calls == std::vector<std::string>({"async:stop"}));
+        CATCH_REQUIRE(e.f_done.size() == 2);
+
+        // <name>_start() can refuse the emission
+        //
+        l.f_calls.clear();
+        CATCH_REQUIRE_FALSE(serverplugins::sync_wait(e.lookup("")));
+        CATCH_REQUIRE(l.f_calls.empty());
+
+        // exceptions get to the emitter
+        //
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  serverplugins::sync_wait(e.lookup("throw"))
+                , std::runtime_error
+                , Catch::Matchers::Message("lookup failed"));
+        CATCH_REQUIRE(l.f_calls == std::vector<std::string>({"async:throw"}));
+        CATCH_REQUIRE(e.f_done.size() == 2);
+
+        // the emitter can itself be a coroutine
+        //
+        l.f_calls.clear();
+        CATCH_REQUIRE(serverplugins::sync_wait(count_found(e, {"x", "stop", "y", ""})) == 2);
+        CATCH_REQUIRE(e.f_done == std::vector<std::string>({"nobody", "a", "x", "y"}));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("awaitable: the emission resumes on the executor")
+    {
+        std::shared_ptr<thread_executor> server(std::make_shared<thread_executor>());
+        std::shared_ptr<thread_executor> io(std::make_shared<thread_executor>());
+
+        serverplugins::awaitable_signal<void(std::string const &)> s;
+        awaitable_listener l;
+        l.f_io = io;
+        s.add_callback(serverplugins::listener<&awaitable_listener::on_lookup>(&l, std::placeholders::_1), 10);
+        s.add_callback(serverplugins::listener<&awaitable_listener::on_log>(&l, std::placeholders::_1));
+
+        // the emission goes on in the server thread, or in the thread
+        // which started it if the I/O completed before it had suspended,
+        // but never in the I/O thread
+        //
+        CATCH_REQUIRE(serverplugins::sync_wait(s.call(server, "key")));
+        CATCH_REQUIRE(l.f_calls == std::vector<std::string>({"async:key", "log:key"}));
+        CATCH_REQUIRE(l.f_threads.size() == 2);
+        CATCH_REQUIRE(l.f_threads[0] == io->get_id());
+        CATCH_REQUIRE(l.f_threads[1] != io->get_id());
+        std::size_t const posted(server->get_posted());
+        CATCH_REQUIRE(posted <= 1);
+        CATCH_REQUIRE((posted == 1) == (l.f_threads[1] == server->get_id()));
+
+        // a listener which does not suspend does not go through the executor
+        //
+        l.f_io = nullptr;
+        l.f_calls.clear();
+        l.f_threads.clear();
+        CATCH_REQUIRE_FALSE(serverplugins::sync_wait(s.call(server, "stop")));
+        CATCH_REQUIRE(l.f_calls == std::vector<std::string>({"async:stop"}));
+        CATCH_REQUIRE(server->get_posted() == posted);
+    }
+    CATCH_END_SECTION()
+}
+#endif
+
+
+
+// vim: ts=4 sw=4 et
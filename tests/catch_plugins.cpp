@@ -22,12 +22,23 @@
 #include    <serverplugins/plugin.h>
 
 #include    <serverplugins/collection.h>
+#include    <serverplugins/delivery_pool.h>
+#include    <serverplugins/discovery_index.h>
+#include    <serverplugins/id.h>
+#include    <serverplugins/load_plan.h>
+#include    <serverplugins/load_report.h>
+#include    <serverplugins/note.h>
+#include    <serverplugins/result_signal.h>
+#include    <serverplugins/signal_profile.h>
+#include    <serverplugins/static_plugin.h>
+#include    <serverplugins/typed_signal.h>
 
 
 // self
 //
 #include    "catch_main.h"
 
+#include    "plugin_builtin.h"
 #include    "plugin_daemon.h"
 #include    "plugin_testme.h"
 
@@ -39,11 +50,16 @@
 
 // C++
 //
+#include    <atomic>
 #include    <fstream>
+#include    <optional>
+#include    <set>
+#include    <thread>
 
 
 // C
 //
+#include    <fcntl.h>
 #include    <unistd.h>
 #include    <sys/stat.h>
 #include    <sys/types.h>
@@ -532,6 +548,12 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                 std::ofstream out(fake);
                 out << "fake plugin 1\n";
             }
+
+            // the directory listings are cached, the new file is not
+            // visible until the cache gets cleared
+            //
+            CATCH_REQUIRE(n.to_filename("fake").empty());
+            n.clear_directory_cache();
             filename = n.to_filename("fake");
             CATCH_REQUIRE(filename == fake);
             unlink(fake.c_str());
@@ -543,6 +565,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                 std::ofstream out(fake);
                 out << "fake plugin 2\n";
             }
+            n.clear_directory_cache();
             filename = n.to_filename("fake");
             CATCH_REQUIRE(filename == fake);
             unlink(fake.c_str());
@@ -557,6 +580,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                     std::ofstream out(fake);
                     out << "fake plugin 3\n";
                 }
+                n.clear_directory_cache();
                 filename = n.to_filename("fake");
                 CATCH_REQUIRE(filename == fake);
                 unlink(fake.c_str());
@@ -568,6 +592,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                     std::ofstream out(fake);
                     out << "fake plugin 4\n";
                 }
+                n.clear_directory_cache();
                 filename = n.to_filename("fake");
                 CATCH_REQUIRE(filename == fake);
                 unlink(fake.c_str());
@@ -602,6 +627,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                 std::ofstream out(fake);
                 out << "fake plugin 1\n";
             }
+            n.clear_directory_cache();
             filename = n.to_filename("fake");
             CATCH_REQUIRE(filename == "./" + fake);
             unlink(fake.c_str());
@@ -613,6 +639,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                 std::ofstream out(fake);
                 out << "fake plugin 2\n";
             }
+            n.clear_directory_cache();
             filename = n.to_filename("fake");
             CATCH_REQUIRE(filename == "./" + fake);
             unlink(fake.c_str());
@@ -627,6 +654,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                     std::ofstream out(fake);
                     out << "fake plugin 3\n";
                 }
+                n.clear_directory_cache();
                 filename = n.to_filename("fake");
                 CATCH_REQUIRE(filename == "./" + fake);
                 unlink(fake.c_str());
@@ -638,6 +666,7 @@ CATCH_TEST_CASE("names", "[plugins][names]")
                     std::ofstream out(fake);
                     out << "fake plugin 4\n";
                 }
+                n.clear_directory_cache();
                 filename = n.to_filename("fake");
                 CATCH_REQUIRE(filename == "./" + fake);
                 unlink(fake.c_str());
@@ -681,12 +710,265 @@ CATCH_TEST_CASE("names", "[plugins][names]")
         serverplugins::paths p;
         p.add(CMAKE_BINARY_DIR "/tests:/usr/local/lib/snaplogger/plugins:/usr/lib/snaplogger/plugins");
         serverplugins::names n(p);
+        CATCH_REQUIRE_FALSE(n.get_find_static_plugins());
         n.find_plugins();
         CATCH_REQUIRE(n.map().size() == 1);
         CATCH_REQUIRE(n.map().begin()->second == CMAKE_BINARY_DIR "/tests/libtestme.so");
     }
     CATCH_END_SECTION()
 
+    CATCH_START_SECTION("names: find_plugins() can include the static plugins")
+    {
+        serverplugins::paths p;
+        p.add(CMAKE_BINARY_DIR "/tests");
+        serverplugins::names n(p);
+        n.set_find_static_plugins(true);
+        CATCH_REQUIRE(n.get_find_static_plugins());
+        n.find_plugins();
+
+        // the builtin plugin is linked in the unittest executable
+        //
+        CATCH_REQUIRE(n.map().size() == 2);
+        CATCH_REQUIRE(n.map().at("testme") == CMAKE_BINARY_DIR "/tests/libtestme.so");
+        CATCH_REQUIRE(n.map().at("builtin") == "static:builtin");
+
+        // the prefix and suffix apply to the static plugins too
+        //
+        serverplugins::names filtered(p);
+        filtered.set_find_static_plugins(true);
+        filtered.find_plugins("test");
+        CATCH_REQUIRE(filtered.map().size() == 1);
+        CATCH_REQUIRE(filtered.map().begin()->first == "testme");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("names: find_plugins() scans each directory once")
+    {
+        // the files do not need to be valid plugins, find_plugins() only
+        // looks at the names
+        //
+        std::string const dir(CMAKE_BINARY_DIR "/scanner");
+        std::string const dir2(CMAKE_BINARY_DIR "/scanner2");
+        std::vector<std::string> const subdirs{
+              dir
+            , dir + "/gamma"
+            , dir + "/delta"
+            , dir + "/alpha"
+            , dir + "/.hidden"
+            , dir2
+        };
+        std::vector<std::string> const files{
+              dir + "/alpha.so"
+            , dir + "/libbeta.so"
+            , dir + "/gamma/gamma.so"
+            , dir + "/delta/libdelta.so"
+            , dir + "/alpha/libalpha.so"        // overrides dir/alpha.so
+            , dir + "/.epsilon.so"              // hidden, ignored
+            , dir + "/.hidden/libzeta.so"       // hidden, ignored
+            , dir + "/notes.txt"
+            , dir2 + "/libbeta.so"              // overrides dir/libbeta.so
+        };
+        for(auto const & d : subdirs)
+        {
+            mkdir(d.c_str(), 0700);
+        }
+        for(auto const & f : files)
+        {
+            std::ofstream out(f);
+        }
+
+        serverplugins::paths p;
+        p.add(dir + ":" + dir2);
+
+        serverplugins::names sequential(p);
+        CATCH_REQUIRE(sequential.get_scan_workers() == 1);
+        sequential.find_plugins();
+
+        serverplugins::names parallel(p);
+        parallel.set_scan_workers(4);
+        CATCH_REQUIRE(parallel.get_scan_workers() == 4);
+        parallel.find_plugins();
+
+        CATCH_REQUIRE(sequential.map() == parallel.map());
+        CATCH_REQUIRE(parallel.map().size() == 4);
+        CATCH_REQUIRE(parallel.map().at("alpha") == dir + "/alpha/libalpha.so");
+        CATCH_REQUIRE(parallel.map().at("beta") == dir2 + "/libbeta.so");
+        CATCH_REQUIRE(parallel.map().at("gamma") == dir + "/gamma/gamma.so");
+        CATCH_REQUIRE(parallel.map().at("delta") == dir + "/delta/libdelta.so");
+
+        serverplugins::names::scan_counters_t const counters(parallel.get_scan_counters());
+        CATCH_REQUIRE(counters.f_directories == 5);
+        CATCH_REQUIRE(counters.f_syscalls > 0);
+        CATCH_REQUIRE(counters.saved() > 0);
+
+        // the listings are reused by to_filename()
+        //
+        CATCH_REQUIRE(parallel.to_filename("gamma") == dir + "/gamma/gamma.so");
+        CATCH_REQUIRE(parallel.get_scan_counters().f_directories == 5);
+
+        for(auto const & f : files)
+        {
+            unlink(f.c_str());
+        }
+        for(auto it(subdirs.rbegin()); it != subdirs.rend(); ++it)
+        {
+            rmdir(it->c_str());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("names: find_plugins() through a discovery index")
+    {
+        // use a separate directory so we can control its modification time
+        //
+        std::string const dir(CMAKE_BINARY_DIR "/discovery");
+        std::string const index_filename(CMAKE_BINARY_DIR "/discovery.idx");
+        mkdir(dir.c_str(), 0700);
+        mkdir((dir + "/sub").c_str(), 0700);
+        unlink(index_filename.c_str());
+        {
+            std::ifstream in(CMAKE_BINARY_DIR "/tests/libtestme.so", std::ios::binary);
+            std::ofstream out(dir + "/libtestme.so", std::ios::binary);
+            out << in.rdbuf();
+        }
+        unlink((dir + "/sub/libsecond.so").c_str());
+
+        // move the directories back in time, a directory modified within
+        // the same second as the index was saved always gets read again
+        //
+        timespec const past[2] = { { time(nullptr) - 10, 0 }, { time(nullptr) - 10, 0 } };
+        CATCH_REQUIRE(utimensat(AT_FDCWD, dir.c_str(), past, 0) == 0);
+        CATCH_REQUIRE(utimensat(AT_FDCWD, (dir + "/sub").c_str(), past, 0) == 0);
+
+        serverplugins::paths p;
+        p.add(dir);
+
+        {
+            serverplugins::names n(p);
+            n.set_index_filename(index_filename);
+            CATCH_REQUIRE(n.get_index_filename() == index_filename);
+            n.find_plugins();
+            CATCH_REQUIRE(n.map().size() == 1);
+            CATCH_REQUIRE(n.map().begin()->first == "testme");
+            CATCH_REQUIRE(n.map().begin()->second == dir + "/libtestme.so");
+        }
+
+        // the index is now current
+        //
+        {
+            serverplugins::discovery_index index;
+            CATCH_REQUIRE(index.load(index_filename));
+            CATCH_REQUIRE_FALSE(index.refresh(p));
+            CATCH_REQUIRE(index.rescanned_directories() == 0);
+
+            serverplugins::discovery_index::file_t file;
+            CATCH_REQUIRE(index.find(dir + "/libtestme.so", file));
+            CATCH_CHECK(file.f_digest != 0);
+            CATCH_CHECK(file.f_size > 0);
+            CATCH_REQUIRE_FALSE(index.find(dir + "/libunknown.so", file));
+        }
+
+        // a directory read again keeps the digest of the files which did
+        // not change instead of reading their definition again
+        //
+        {
+            std::ofstream out(dir + "/README");
+            out << "not a plugin\n";
+        }
+        {
+            timespec const earlier[2] = { { time(nullptr) - 5, 0 }, { time(nullptr) - 5, 0 } };
+            CATCH_REQUIRE(utimensat(AT_FDCWD, dir.c_str(), earlier, 0) == 0);
+        }
+        {
+            serverplugins::discovery_index index;
+            CATCH_REQUIRE(index.load(index_filename));
+            CATCH_REQUIRE(index.refresh(p));
+            CATCH_REQUIRE(index.rescanned_directories() == 1);
+            CATCH_REQUIRE(index.read_definitions() == 0);
+
+            serverplugins::discovery_index::file_t file;
+            CATCH_REQUIRE(index.find(dir + "/libtestme.so", file));
+            CATCH_CHECK(file.f_digest != 0);
+            CATCH_REQUIRE(index.save(index_filename));
+        }
+
+        // a new plugin in a sub-directory only requires that sub-directory
+        // to be read again
+        //
+        {
+            std::ifstream in(dir + "/libtestme.so", std::ios::binary);
+            std::ofstream out(dir + "/sub/libsecond.so", std::ios::binary);
+            out << in.rdbuf();
+        }
+        {
+            serverplugins::discovery_index index;
+            CATCH_REQUIRE(index.load(index_filename));
+            CATCH_REQUIRE(index.refresh(p));
+            CATCH_REQUIRE(index.rescanned_directories() == 1);
+            CATCH_REQUIRE(index.read_definitions() == 1);
+            CATCH_REQUIRE(index.files(dir).size() == 2);
+        }
+        {
+            serverplugins::names n(p);
+            n.set_index_filename(index_filename);
+            n.find_plugins("sec");
+            CATCH_REQUIRE(n.map().size() == 1);
+            CATCH_REQUIRE(n.map().begin()->first == "second");
+            CATCH_REQUIRE(n.map().begin()->second == dir + "/sub/libsecond.so");
+        }
+
+        // a corrupt index is ignored and rebuilt
+        //
+        {
+            std::ofstream out(index_filename);
+            out << "not an index\n";
+        }
+        {
+            serverplugins::names n(p);
+            n.set_index_filename(index_filename);
+            n.find_plugins();
+            CATCH_REQUIRE(n.map().size() == 2);
+        }
+        {
+            serverplugins::discovery_index index;
+            CATCH_REQUIRE(index.load(index_filename));
+        }
+
+        // the same name found in two sub-directories resolves to the same
+        // file as with glob(), which sorts the whole paths ("sub-x/" comes
+        // before "sub/" and the last one found wins)
+        //
+        mkdir((dir + "/sub-x").c_str(), 0700);
+        for(auto const & sub : { "/sub/libdup.so", "/sub-x/libdup.so" })
+        {
+            std::ifstream in(dir + "/libtestme.so", std::ios::binary);
+            std::ofstream out(dir + sub, std::ios::binary);
+            out << in.rdbuf();
+        }
+        {
+            serverplugins::names scanned(p);
+            scanned.find_plugins("dup");
+
+            serverplugins::names indexed(p);
+            indexed.set_index_filename(index_filename);
+            indexed.find_plugins("dup");
+
+            CATCH_REQUIRE(indexed.map().at("dup") == dir + "/sub/libdup.so");
+            CATCH_REQUIRE(indexed.map() == scanned.map());
+        }
+
+        unlink((dir + "/sub-x/libdup.so").c_str());
+        unlink((dir + "/sub/libdup.so").c_str());
+        unlink((dir + "/sub/libsecond.so").c_str());
+        unlink((dir + "/libtestme.so").c_str());
+        unlink((dir + "/README").c_str());
+        rmdir((dir + "/sub-x").c_str());
+        rmdir((dir + "/sub").c_str());
+        rmdir(dir.c_str());
+        unlink(index_filename.c_str());
+    }
+    CATCH_END_SECTION()
+
     CATCH_START_SECTION("names: add invalid 'names'")
     {
         serverplugins::paths p;
@@ -722,73 +1004,1163 @@ CATCH_TEST_CASE("names", "[plugins][names]")
 }
 
 
-CATCH_TEST_CASE("collection", "[plugins][collection]")
+CATCH_TEST_CASE("note", "[plugins][note]")
 {
-    CATCH_START_SECTION("collection: load the plugin")
+    CATCH_START_SECTION("note: read the definition of testme without loading it")
     {
-        // initialize the daemon
+        serverplugins::definition def;
+        CATCH_REQUIRE(serverplugins::read_definition_note(CMAKE_BINARY_DIR "/tests/libtestme.so", def));
+
+        CATCH_CHECK(def.f_version.f_major == 5);
+        CATCH_CHECK(def.f_version.f_minor == 3);
+        CATCH_CHECK(def.f_version.f_patch == 0);
+        CATCH_CHECK(def.f_library_version.f_major == SERVERPLUGINS_VERSION_MAJOR);
+        CATCH_CHECK(def.f_library_version.f_minor == SERVERPLUGINS_VERSION_MINOR);
+        CATCH_CHECK(def.f_library_version.f_patch == SERVERPLUGINS_VERSION_PATCH);
+        CATCH_CHECK(def.f_last_modification == UTC_BUILD_TIME_STAMP);
+        CATCH_CHECK(def.f_name == "testme");
+        CATCH_CHECK(def.f_description == "a test plugin to make sure it all works.");
+        CATCH_CHECK(def.f_help_uri == "https://snapwebsites.org/help");
+        CATCH_CHECK(def.f_icon == "cute.ico");
+        CATCH_CHECK(def.f_categorization_tags == serverplugins::string_set_t({"test", "powerful", "software"}));
+        CATCH_CHECK(def.f_dependencies.empty());
+        CATCH_CHECK(def.f_conflicts == serverplugins::string_set_t({"other_test", "power_test", "unknown"}));
+        CATCH_CHECK(def.f_suggestions == serverplugins::string_set_t({"beautiful"}));
+        CATCH_CHECK(def.f_settings_path.empty());
+        CATCH_CHECK(def.f_interests == serverplugins::string_set_t({"daemon::ready"}));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("note: files without a valid note")
+    {
+        serverplugins::definition def;
+        CATCH_REQUIRE_FALSE(serverplugins::read_definition_note(CMAKE_BINARY_DIR "/tests/does-not-exist.so", def));
+
+        std::string const fake(CMAKE_BINARY_DIR "/tests/not-elf.so");
+        {
+            std::ofstream out(fake);
+            out << "this is not an ELF file\n";
+        }
+        CATCH_REQUIRE_FALSE(serverplugins::read_definition_note(fake, def));
+        unlink(fake.c_str());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("note: parse invalid descriptions")
+    {
+        serverplugins::definition def;
+
+        char const no_equal[] = "name\0";
+        CATCH_REQUIRE_FALSE(serverplugins::parse_definition_note(no_equal, sizeof(no_equal) - 1, def));
+
+        char const no_nul[] = "name=abc";
+        CATCH_REQUIRE_FALSE(serverplugins::parse_definition_note(no_nul, sizeof(no_nul) - 1, def));
+
+        char const bad_version[] = "name=abc\0version=1.x.3\0";
+        CATCH_REQUIRE_FALSE(serverplugins::parse_definition_note(bad_version, sizeof(bad_version) - 1, def));
+
+        char const no_name[] = "version=1.2.3\0";
+        CATCH_REQUIRE_FALSE(serverplugins::parse_definition_note(no_name, sizeof(no_name) - 1, def));
+
+        char const valid[] = "name=abc\0version=1.2.3\0future_field=ignored\0dependency=xyz\0";
+        CATCH_REQUIRE(serverplugins::parse_definition_note(valid, sizeof(valid) - 1, def));
+        CATCH_CHECK(def.f_name == "abc");
+        CATCH_CHECK(def.f_version.f_major == 1);
+        CATCH_CHECK(def.f_version.f_minor == 2);
+        CATCH_CHECK(def.f_version.f_patch == 3);
+        CATCH_CHECK(def.f_dependencies == serverplugins::string_set_t({"xyz"}));
+    }
+    CATCH_END_SECTION()
+}
+
+
+namespace
+{
+
+
+struct copy_counter
+{
+    copy_counter() = default;
+    copy_counter(copy_counter const & rhs) : f_copies(rhs.f_copies) { ++*f_copies; }
+    copy_counter & operator = (copy_counter const & rhs) = delete;
+
+    std::shared_ptr<int>    f_copies = std::make_shared<int>(0);
+};
+
+
+struct listener_object
+{
+    void on_value(int value) { f_calls.push_back(value); }
+    void on_both(int value, std::string const & name) { f_calls.push_back(value + static_cast<int>(name.length())); }
+    void on_nothing() { f_calls.push_back(-1); }
+    void on_modify(std::string & s) { s += "+"; }
+    void on_counter(copy_counter const & c) { f_calls.push_back(*c.f_copies); }
+    void on_values(serverplugins::signal<void(int)>::batch_t values)
+    {
+        f_batches.push_back(values.size());
+        f_calls.insert(f_calls.end(), values.begin(), values.end());
+    }
+    void on_pairs(serverplugins::signal<void(int, std::string const &)>::batch_t items)
+    {
+        f_batches.push_back(items.size());
+        for(auto const & item : items)
+        {
+            on_both(std::get<0>(item), std::get<1>(item));
+        }
+    }
+    void on_modify_batch(serverplugins::signal<void(std::string &)>::batch_t items)
+    {
+        f_batches.push_back(items.size());
+        for(auto & item : items)
+        {
+            item += "*";
+        }
+    }
+
+    std::vector<int>        f_calls = std::vector<int>();
+    std::vector<std::size_t>
+                            f_batches = std::vector<std::size_t>();
+};
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("id", "[plugins][id]")
+{
+    CATCH_START_SECTION("id: names and identifiers match one to one")
+    {
+        CATCH_REQUIRE(serverplugins::find_id("id-test-first") == serverplugins::NULL_ID);
+        serverplugins::id_t const first(serverplugins::get_id("id-test-first"));
+        CATCH_REQUIRE(first >= serverplugins::MIN_ID);
+        CATCH_REQUIRE(first <= serverplugins::MAX_ID);
+        CATCH_REQUIRE(serverplugins::get_id("id-test-first") == first);
+        CATCH_REQUIRE(serverplugins::find_id("id-test-first") == first);
+        CATCH_REQUIRE(serverplugins::get_name(first) == "id-test-first");
+        CATCH_REQUIRE(serverplugins::get_name(serverplugins::NULL_ID).empty());
+        CATCH_REQUIRE(serverplugins::get_name(serverplugins::MAX_ID).empty());
+
+        // the hash of a constant gets computed at compile time
         //
-        char const * argv[] = { "/usr/sbin/daemon", nullptr };
-        optional_namespace::daemon::pointer_t d(std::make_shared<optional_namespace::daemon>(1, const_cast<char **>(argv)));
-        d->complete_plugin_initialization();
+        static_assert(serverplugins::id_hash("") == 0xcbf29ce484222325ULL);
+        static_assert(serverplugins::id_hash("a") == 0xaf63dc4c8601ec8cULL);
+        serverplugins::id_t const second(SERVERPLUGINS_ID("id-test-second"));
+        CATCH_REQUIRE(second != first);
+        CATCH_REQUIRE(serverplugins::find_id("id-test-second") == second);
+        CATCH_REQUIRE(serverplugins::find_id("id-test-second", serverplugins::id_hash("id-test-second")) == second);
+
+        // many more than 255 identifiers, which forces the table to grow
+        //
+        std::vector<serverplugins::id_t> ids;
+        for(int idx(0); idx < 1000; ++idx)
+        {
+            ids.push_back(serverplugins::get_id("id-test-" + std::to_string(idx)));
+        }
+        for(int idx(0); idx < 1000; ++idx)
+        {
+            CATCH_REQUIRE(serverplugins::find_id("id-test-" + std::to_string(idx)) == ids[idx]);
+            CATCH_REQUIRE(serverplugins::get_name(ids[idx]) == "id-test-" + std::to_string(idx));
+        }
+        CATCH_REQUIRE(serverplugins::get_id("id-test-first") == first);
 
-        // define a list of colon separated paths
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  serverplugins::get_id("")
+                , serverplugins::name_mismatch
+                , Catch::Matchers::ExceptionMessage(
+                          "serverplugins_exception: serverplugins: an identifier cannot be an empty string."));
+        CATCH_REQUIRE_THROWS_AS(serverplugins::find_id(""), serverplugins::name_mismatch);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("id: search while other threads add identifiers")
+    {
+        serverplugins::id_t const known(serverplugins::get_id("id-test-known"));
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+        for(int t(0); t < 4; ++t)
+        {
+            threads.emplace_back([t, known, &failed]()
+                {
+                    for(int idx(0); idx < 2000; ++idx)
+                    {
+                        std::string const name("id-test-thread-" + std::to_string(idx % 500) + "-" + std::to_string(t % 2));
+                        serverplugins::id_t const id(serverplugins::get_id(name));
+                        if(serverplugins::get_name(id) != name
+                        || serverplugins::find_id("id-test-known") != known)
+                        {
+                            failed = true;
+                        }
+                    }
+                });
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+        CATCH_REQUIRE_FALSE(failed);
+        CATCH_REQUIRE(serverplugins::find_id("id-test-thread-17-0") != serverplugins::find_id("id-test-thread-17-1"));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("signal", "[plugins][signal]")
+{
+    CATCH_START_SECTION("signal: listeners get called in priority order")
+    {
+        serverplugins::signal<void(int)> s;
+        CATCH_REQUIRE(s.empty());
+        s.call(1);
+
+        listener_object a;
+        listener_object b;
+        std::vector<int> order;
+        s.add_callback(serverplugins::listener<&listener_object::on_value>(&a, std::placeholders::_1));
+        s.add_callback([&order](int) { order.push_back(2); }, -5);
+        s.add_callback([&order](int) { order.push_back(1); }, 10);
+        s.add_callback([&order](int) { order.push_back(3); }, -5);
+        s.add_callback(serverplugins::listener<&listener_object::on_value>(&b, 7));
+        CATCH_REQUIRE(s.size() == 5);
+
+        s.call(3);
+        CATCH_REQUIRE(a.f_calls == std::vector<int>({3}));
+        CATCH_REQUIRE(b.f_calls == std::vector<int>({7}));
+        CATCH_REQUIRE(order == std::vector<int>({1, 2, 3}));
+
+        s.clear();
+        CATCH_REQUIRE(s.empty());
+        s.call(4);
+        CATCH_REQUIRE(a.f_calls.size() == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("signal: member listeners do not allocate")
+    {
+        listener_object l;
+
+        serverplugins::signal<int, std::string const &>::delegate_t const direct(
+                serverplugins::listener<&listener_object::on_both>(&l, std::placeholders::_1, std::placeholders::_2));
+        CATCH_REQUIRE(direct.is_member());
+
+        serverplugins::signal<int, std::string const &>::delegate_t const first(
+                serverplugins::listener<&listener_object::on_value>(&l, std::placeholders::_1));
+        CATCH_REQUIRE(first.is_member());
+
+        serverplugins::signal<int, std::string const &>::delegate_t const none(
+                serverplugins::listener<&listener_object::on_nothing>(&l));
+        CATCH_REQUIRE(none.is_member());
+
+        serverplugins::signal<int, std::string const &>::delegate_t const swapped(
+                serverplugins::listener<&listener_object::on_value>(&l, 100));
+        CATCH_REQUIRE_FALSE(swapped.is_member());
+
+        direct(5, "four");
+        first(5, "four");
+        none(5, "four");
+        swapped(5, "four");
+        CATCH_REQUIRE(l.f_calls == std::vector<int>({9, 5, -1, 100}));
+
+        // arguments are passed by reference
         //
-        serverplugins::paths p;
-        p.add(CMAKE_BINARY_DIR "/tests:/usr/local/lib/snaplogger/plugins:/usr/lib/snaplogger/plugins");
+        serverplugins::signal<void(copy_counter)> by_value;
+        by_value.add_callback(serverplugins::listener<&listener_object::on_counter>(&l, std::placeholders::_1));
+        by_value.add_callback(serverplugins::listener<&listener_object::on_counter>(&l, std::placeholders::_1));
+        copy_counter c;
+        by_value.call(c);
+        CATCH_REQUIRE(*c.f_copies == 0);
+        CATCH_REQUIRE(l.f_calls.back() == 0);
+
+        serverplugins::signal<void(std::string &)> by_reference;
+        by_reference.add_callback(serverplugins::listener<&listener_object::on_modify>(&l, std::placeholders::_1));
+        by_reference.add_callback(serverplugins::listener<&listener_object::on_modify>(&l, std::placeholders::_1));
+        std::string str("value");
+        by_reference.call(str);
+        CATCH_REQUIRE(str == "value++");
+    }
+    CATCH_END_SECTION()
 
-        // setup the plugin filenames
+    CATCH_START_SECTION("signal: add and remove listeners while emitting")
+    {
+        serverplugins::signal<void(int)> s;
+        CATCH_REQUIRE_FALSE(s.remove_callback(1));
+
+        std::vector<int> calls;
+        serverplugins::signal<void(int)>::callback_id_t second(serverplugins::signal<void(int)>::NULL_CALLBACK_ID);
+        serverplugins::signal<void(int)>::callback_id_t const first(s.add_callback([&](int value)
+            {
+                calls.push_back(value);
+                if(value == 1)
+                {
+                    // removed while emitting: still called this time
+                    //
+                    CATCH_REQUIRE(s.remove_callback(second));
+
+                    // added while emitting: called next time only
+                    //
+                    s.add_callback([&calls](int v) { calls.push_back(v * 100); });
+                }
+            }, 10));
+        second = s.add_callback([&calls](int value) { calls.push_back(value * 10); });
+        CATCH_REQUIRE(first != second);
+
+        s.call(1);
+        CATCH_REQUIRE(calls == std::vector<int>({1, 10}));
+        s.call(2);
+        CATCH_REQUIRE(calls == std::vector<int>({1, 10, 2, 200}));
+
+        CATCH_REQUIRE(s.remove_callback(first));
+        CATCH_REQUIRE_FALSE(s.remove_callback(first));
+        CATCH_REQUIRE(s.size() == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("signal: emit a batch")
+    {
+        serverplugins::signal<void(int)> s;
+        std::vector<int> const values({1, 2, 3});
+        s.call_batch(values);
+
+        listener_object batch;
+        listener_object single;
+        std::vector<int> order;
+        s.add_callback(serverplugins::batch_listener<&listener_object::on_value, &listener_object::on_values>(&batch, std::placeholders::_1), 10);
+        s.add_callback(serverplugins::listener<&listener_object::on_value>(&single, std::placeholders::_1), 5);
+        s.add_callback([&order](int value) { order.push_back(value); });
+
+        serverplugins::signal<void(int)>::delegate_t const d(
+                serverplugins::batch_listener<&listener_object::on_value, &listener_object::on_values>(&batch, std::placeholders::_1));
+        CATCH_REQUIRE(d.is_member());
+        CATCH_REQUIRE(d.has_batch());
+
+        // each listener sees the whole batch before the next one
         //
-        serverplugins::names n(p);
-        n.find_plugins();
+        s.call_batch(values);
+        CATCH_REQUIRE(batch.f_batches == std::vector<std::size_t>({3}));
+        CATCH_REQUIRE(batch.f_calls == values);
+        CATCH_REQUIRE(single.f_batches.empty());
+        CATCH_REQUIRE(single.f_calls == values);
+        CATCH_REQUIRE(order == values);
+
+        // a single emission uses the per item function
+        //
+        s.call(4);
+        CATCH_REQUIRE(batch.f_batches.size() == 1);
+        CATCH_REQUIRE(batch.f_calls == std::vector<int>({1, 2, 3, 4}));
 
-        // create a collection from plugins we found automatically
-        // (opposed to setting the name from a plugins=... variable found in your daemon settings)
+        // empty batches are ignored
         //
-        serverplugins::collection c(n);
+        s.call_batch(serverplugins::signal<void(int)>::batch_t());
+        int const array[] = { 5, 6 };
+        s.call_batch(array);
+        CATCH_REQUIRE(batch.f_batches == std::vector<std::size_t>({3, 2}));
+        CATCH_REQUIRE(order == std::vector<int>({1, 2, 3, 4, 5, 6}));
 
-        // now load the plugins
+        // several parameters make a tuple
         //
-        bool const loaded(c.load_plugins(d));
-        CATCH_REQUIRE(loaded);
+        serverplugins::signal<void(int, std::string const &)> pairs;
+        pairs.add_callback(serverplugins::batch_listener<&listener_object::on_both, &listener_object::on_pairs>(&batch, std::placeholders::_1, std::placeholders::_2));
+        pairs.add_callback(serverplugins::listener<&listener_object::on_both>(&single, std::placeholders::_1, std::placeholders::_2));
+        std::vector<serverplugins::signal<void(int, std::string const &)>::item_t> const items({{1, "one"}, {2, "three"}});
+        pairs.call_batch(items);
+        CATCH_REQUIRE(batch.f_batches == std::vector<std::size_t>({3, 2, 2}));
+        CATCH_REQUIRE(std::vector<int>(batch.f_calls.end() - 2, batch.f_calls.end()) == std::vector<int>({4, 7}));
+        CATCH_REQUIRE(std::vector<int>(single.f_calls.end() - 2, single.f_calls.end()) == std::vector<int>({4, 7}));
+
+        // references can still be modified
+        //
+        serverplugins::signal<void(std::string &)> by_reference;
+        by_reference.add_callback(serverplugins::batch_listener<&listener_object::on_modify, &listener_object::on_modify_batch>(&batch, std::placeholders::_1));
+        by_reference.add_callback(serverplugins::listener<&listener_object::on_modify>(&single, std::placeholders::_1));
+        std::vector<std::string> strings({"a", "b"});
+        by_reference.call_batch(strings);
+        CATCH_REQUIRE(strings == std::vector<std::string>({"a*+", "b*+"}));
+    }
+    CATCH_END_SECTION()
 
-        // make sure the testme plugin was indeed loaded
+    CATCH_START_SECTION("signal: dispatch by key")
+    {
+        serverplugins::keyed_signal<void(std::string const &, int)> s;
+        CATCH_REQUIRE(s.empty());
+        s.call("/", 1);
+
+        std::vector<std::string> order;
+        auto record([&order](std::string const & name)
+            {
+                return [&order, name](std::string const & key, int value)
+                    {
+                        order.push_back(name + ":" + key + "=" + std::to_string(value));
+                    };
+            });
+        s.add_key_callback("/admin/users", record("users"));
+        s.add_prefix_callback("/admin/", record("admin"), 5);
+        s.add_prefix_callback("/admin/users/", record("user"));
+        s.add_callback(record("all"), -5);
+        auto const root(s.add_key_callback("/", record("root"), 10));
+        CATCH_REQUIRE(s.size() == 5);
+
+        // exact keys also get the prefix and wildcard listeners, in
+        // priority order
         //
-        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
-        CATCH_REQUIRE(r != nullptr);
+        s.call("/admin/users", 1);
+        CATCH_REQUIRE(order == std::vector<std::string>({"admin:/admin/users=1", "users:/admin/users=1", "all:/admin/users=1"}));
+
+        order.clear();
+        s.call("/admin/users/17", 2);
+        s.call("/admin/", 3);
+        s.call("/admin", 4);
+        s.call("/", 5);
+        CATCH_REQUIRE(order == std::vector<std::string>({
+                  "admin:/admin/users/17=2"
+                , "user:/admin/users/17=2"
+                , "all:/admin/users/17=2"
+                , "admin:/admin/=3"
+                , "all:/admin/=3"
+                , "all:/admin=4"
+                , "root:/=5"
+                , "all:/=5"
+            }));
+
+        // a batch calls the listeners of each key
+        //
+        order.clear();
+        CATCH_REQUIRE(s.remove_callback(root));
+        CATCH_REQUIRE_FALSE(s.remove_callback(root));
+        std::vector<serverplugins::keyed_signal<void(std::string const &, int)>::item_t> const items({
+                  {"/admin/a", 1}
+                , {"/admin/b", 2}
+                , {"/", 3}
+            });
+        s.call_batch(items);
+        CATCH_REQUIRE(order == std::vector<std::string>({
+                  "admin:/admin/a=1"
+                , "admin:/admin/b=2"
+                , "all:/admin/a=1"
+                , "all:/admin/b=2"
+                , "all:/=3"
+            }));
+
+        // integer keys support exact keys and wildcards
+        //
+        serverplugins::keyed_signal<void(int)> ids;
+        listener_object a;
+        listener_object b;
+        ids.add_key_callback(3, serverplugins::listener<&listener_object::on_value>(&a, std::placeholders::_1));
+        ids.add_callback(serverplugins::batch_listener<&listener_object::on_value, &listener_object::on_values>(&b, std::placeholders::_1));
+        ids.call(3);
+        ids.call(4);
+        int const values[] = { 3, 3, 5 };
+        ids.call_batch(values);
+        CATCH_REQUIRE(a.f_calls == std::vector<int>({3, 3, 3}));
+        CATCH_REQUIRE(b.f_calls == std::vector<int>({3, 4, 3, 3, 5}));
+        CATCH_REQUIRE(b.f_batches == std::vector<std::size_t>({2, 1}));
+
+        ids.clear();
+        CATCH_REQUIRE(ids.empty());
+        ids.call(3);
+        CATCH_REQUIRE(a.f_calls.size() == 3);
+    }
+    CATCH_END_SECTION()
 
-        // verify the plugin definitions
+    CATCH_START_SECTION("signal: combine the results of the listeners")
+    {
+        // the first answer stops the emission
         //
-        serverplugins::version_t const v(r->version());
-        CATCH_CHECK(v.f_major == 5);
-        CATCH_CHECK(v.f_minor == 3);
-        CATCH_CHECK(v.f_patch == 0);
+        serverplugins::result_signal<serverplugins::combiner::first<std::string>, void(int)> find;
+        CATCH_REQUIRE_FALSE(find.call(1).has_value());
 
-        //time_t m(last_modification());
+        std::vector<int> called;
+        find.add_callback([&called](int value) -> std::optional<std::string>
+            {
+                called.push_back(1);
+                if(value == 1)
+                {
+                    return std::string("one");
+                }
+                return std::nullopt;
+            }, 10);
+        find.add_callback([&called](int value)
+            {
+                called.push_back(2);
+                return std::to_string(value);
+            });
+        find.add_callback([&called](int) -> std::optional<std::string>
+            {
+                called.push_back(3);
+                return std::string("never");
+            }, -10);
+        CATCH_REQUIRE(find.size() == 3);
+        CATCH_REQUIRE(find.call(1) == std::string("one"));
+        CATCH_REQUIRE(called == std::vector<int>({1}));
+        CATCH_REQUIRE(find.call(7) == std::string("7"));
+        CATCH_REQUIRE(called == std::vector<int>({1, 1, 2}));
+        CATCH_REQUIRE_FALSE(serverplugins::result_signal<serverplugins::combiner::first<std::string>, void(int)>::refused().has_value());
+
+        // any_true stops at the first true, all_true at the first false
+        //
+        serverplugins::result_signal<serverplugins::combiner::any_true, void(int)> any;
+        serverplugins::result_signal<serverplugins::combiner::all_true, void(int)> all;
+        CATCH_REQUIRE_FALSE(any.call(0));
+        CATCH_REQUIRE(all.call(0));
+        int calls(0);
+        for(int limit(1); limit <= 3; ++limit)
+        {
+            any.add_callback([&calls, limit](int value) { ++calls; return value == limit; });
+            all.add_callback([&calls, limit](int value) { ++calls; return value < limit; });
+        }
+        CATCH_REQUIRE(any.call(1));
+        CATCH_REQUIRE(calls == 1);
+        CATCH_REQUIRE_FALSE(any.call(5));
+        CATCH_REQUIRE(calls == 4);
+        CATCH_REQUIRE(all.call(0));
+        CATCH_REQUIRE(calls == 7);
+        CATCH_REQUIRE_FALSE(all.call(1));
+        CATCH_REQUIRE(calls == 8);
+
+        // sum calls everyone, member functions work as with other signals
+        //
+        struct weight
+        {
+            int on_weight(int value) { return value * f_factor; }
+            int f_factor = 0;
+        };
+        weight w2{2};
+        weight w5{5};
+        serverplugins::result_signal<serverplugins::combiner::sum<int>, void(int)> total;
+        total.add_callback(serverplugins::listener<&weight::on_weight>(&w2, std::placeholders::_1));
+        auto const id(total.add_callback(serverplugins::listener<&weight::on_weight>(&w5, std::placeholders::_1)));
+        CATCH_REQUIRE(total.call(3) == 21);
+        CATCH_REQUIRE(total.remove_callback(id));
+        CATCH_REQUIRE(total.call(3) == 6);
+    }
+    CATCH_END_SECTION()
 
-        CATCH_REQUIRE(r->name() == "testme");
-        CATCH_REQUIRE(r->filename() == CMAKE_BINARY_DIR "/tests/libtestme.so");
-        CATCH_REQUIRE(r->description() == "a test plugin to make sure it all works.");
-        CATCH_REQUIRE(r->help_uri() == "https://snapwebsites.org/help");
-        CATCH_REQUIRE(r->icon() == "cute.ico");
+    CATCH_START_SECTION("signal: freeze the listeners")
+    {
+        serverplugins::signal<void(int)> s;
+        listener_object a;
+        std::vector<int> order;
+        s.add_callback([&order](int) { order.push_back(2); });
+        s.add_callback(serverplugins::listener<&listener_object::on_value>(&a, std::placeholders::_1), 5);
+        auto const id(s.add_callback([&order](int) { order.push_back(1); }, 10));
+        s.add_callback(serverplugins::batch_listener<&listener_object::on_value, &listener_object::on_values>(&a, std::placeholders::_1), -5);
+        CATCH_REQUIRE_FALSE(s.is_frozen());
+
+        s.freeze();
+        s.freeze();
+        CATCH_REQUIRE(s.is_frozen());
+        CATCH_REQUIRE(s.size() == 4);
+
+        // the frozen array keeps the priority order
+        //
+        s.call(3);
+        CATCH_REQUIRE(order == std::vector<int>({1, 2}));
+        CATCH_REQUIRE(a.f_calls == std::vector<int>({3, 3}));
+
+        int count(0);
+        CATCH_REQUIRE_FALSE(s.call_while([&count]() { return ++count <= 2; }, 4));
+        CATCH_REQUIRE(order == std::vector<int>({1, 2, 1}));
+        CATCH_REQUIRE(a.f_calls == std::vector<int>({3, 3, 4}));
+
+        int const values[] = { 5, 6 };
+        s.call_batch(values);
+        CATCH_REQUIRE(order == std::vector<int>({1, 2, 1, 1, 1, 2, 2}));
+        CATCH_REQUIRE(a.f_calls == std::vector<int>({3, 3, 4, 5, 6, 5, 6}));
+        CATCH_REQUIRE(a.f_batches == std::vector<std::size_t>({2}));
+
+        // the listeners cannot change anymore
+        //
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  s.add_callback([](int) {})
+                , serverplugins::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: the listeners of a frozen signal cannot be changed."));
+        CATCH_REQUIRE_THROWS_AS(s.remove_callback(id), serverplugins::logic_error);
+        CATCH_REQUIRE_THROWS_AS(s.clear(), serverplugins::logic_error);
+        CATCH_REQUIRE(s.size() == 4);
 
-        serverplugins::string_set_t tags(r->categorization_tags());
-        CATCH_REQUIRE(tags.size() == 3);
-        CATCH_REQUIRE(tags.find("test") != tags.end());
-        CATCH_REQUIRE(tags.find("powerful") != tags.end());
-        CATCH_REQUIRE(tags.find("software") != tags.end());
-        CATCH_REQUIRE(tags.find("undefined") == tags.end());
+        // until thawed
+        //
+        s.thaw();
+        CATCH_REQUIRE_FALSE(s.is_frozen());
+        CATCH_REQUIRE(s.remove_callback(id));
+        order.clear();
+        s.call(7);
+        CATCH_REQUIRE(order == std::vector<int>({2}));
+
+        // an empty signal can be frozen too
+        //
+        serverplugins::signal<void(int)> empty;
+        empty.freeze();
+        empty.call(1);
+        CATCH_REQUIRE(empty.call_while([]() { return false; }, 1));
 
-        // at this time we have a single plugins so not dependencies
-        // (although we could depend on "daemon", but that's not necessary)
+        // keyed and result signals
         //
-        serverplugins::string_set_t dependencies(r->dependencies());
-        CATCH_REQUIRE(dependencies.empty());
+        serverplugins::keyed_signal<void(int)> ids;
+        ids.add_key_callback(3, serverplugins::listener<&listener_object::on_value>(&a, std::placeholders::_1));
+        ids.freeze();
+        CATCH_REQUIRE(ids.is_frozen());
+        ids.call(3);
+        ids.call(4);
+        CATCH_REQUIRE(a.f_calls.back() == 3);
+        CATCH_REQUIRE(a.f_calls.size() == 10);
+        CATCH_REQUIRE_THROWS_AS(ids.add_callback([](int) {}), serverplugins::logic_error);
+
+        serverplugins::result_signal<serverplugins::combiner::sum<int>, void(int)> total;
+        total.add_callback([](int value) { return value * 2; });
+        total.add_callback([](int value) { return value * 5; });
+        total.freeze();
+        CATCH_REQUIRE(total.is_frozen());
+        CATCH_REQUIRE(total.call(3) == 21);
+        CATCH_REQUIRE_THROWS_AS(total.add_callback([](int value) { return value; }), serverplugins::logic_error);
+    }
+    CATCH_END_SECTION()
 
-        serverplugins::string_set_t conflicts(r->conflicts());
-        CATCH_REQUIRE(conflicts.size() == 3);
-        CATCH_REQUIRE(conflicts.find("other_test") != conflicts.end());
-        CATCH_REQUIRE(conflicts.find("power_test") != conflicts.end());
+    CATCH_START_SECTION("signal: profile the listeners")
+    {
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(0) == 0);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(1) == 0);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(2) == 1);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(3) == 1);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(1024) == 10);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(2047) == 10);
+        CATCH_REQUIRE(serverplugins::listener_profile::bucket(~0ULL) == serverplugins::SIGNAL_PROFILE_BUCKETS - 1);
+
+        serverplugins::listener_profile::pointer_t profile(std::make_shared<serverplugins::listener_profile>());
+        profile->record(std::chrono::nanoseconds(1500));
+        profile->record(std::chrono::nanoseconds(100));
+
+        // use more threads than shards so some threads share a shard
+        //
+        std::size_t const thread_count(serverplugins::SIGNAL_PROFILE_SHARDS * 2);
+        std::vector<std::thread> threads;
+        for(std::size_t idx(0); idx < thread_count; ++idx)
+        {
+            threads.emplace_back([profile]()
+                {
+                    for(int count(0); count < 1000; ++count)
+                    {
+                        profile->record(std::chrono::nanoseconds(10));
+                    }
+                });
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+
+        serverplugins::signal_profile_t result;
+        profile->collect(result);
+        CATCH_REQUIRE(result.f_calls == thread_count * 1000 + 2);
+        CATCH_REQUIRE(result.f_total_ns == 1600 + thread_count * 10000);
+        CATCH_REQUIRE(result.f_max_ns == 1500);
+        CATCH_REQUIRE(result.f_histogram[3] == thread_count * 1000);
+        CATCH_REQUIRE(result.f_histogram[6] == 1);
+        CATCH_REQUIRE(result.f_histogram[10] == 1);
+
+        // the wrapper measures the calls and keeps the batch handler
+        //
+        listener_object l;
+        serverplugins::signal<void(int)> s;
+        s.add_callback(serverplugins::detail::make_profiled_delegate(
+                  serverplugins::signal<void(int)>::delegate_t(
+                        serverplugins::batch_listener<&listener_object::on_value, &listener_object::on_values>(&l, std::placeholders::_1))
+                , profile));
+        profile->reset();
+        s.call(1);
+        s.call_batch(std::vector<int>({2, 3}));
+        CATCH_REQUIRE(l.f_calls == std::vector<int>({1, 2, 3}));
+        CATCH_REQUIRE(l.f_batches == std::vector<std::size_t>({2}));
+        profile->collect(result);
+        CATCH_REQUIRE(result.f_calls == 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("signal: replaced listener lists get reclaimed")
+    {
+        serverplugins::signal<void(int)> s;
+
+        std::shared_ptr<int> token(std::make_shared<int>(0));
+        serverplugins::signal<void(int)>::callback_id_t const id(s.add_callback([token](int) {}));
+        CATCH_REQUIRE(token.use_count() == 2);
+
+        CATCH_REQUIRE(s.remove_callback(id));
+        s.call(1);
+        CATCH_REQUIRE(token.use_count() == 1);
+
+        // synchronize() does not need a call()
+        //
+        serverplugins::signal<void(int)>::callback_id_t const other(s.add_callback([token](int) {}));
+        s.call(2);
+        CATCH_REQUIRE(token.use_count() == 2);
+        CATCH_REQUIRE(s.remove_callback(other));
+        s.synchronize();
+        CATCH_REQUIRE(token.use_count() == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("signal: emit while other threads add and remove listeners")
+    {
+        serverplugins::signal<void(int)> s;
+
+        std::atomic<std::size_t> permanent(0);
+        std::atomic<std::size_t> temporary(0);
+        s.add_callback([&permanent](int) { ++permanent; });
+
+        std::size_t const emitters(4);
+        std::size_t const emits(20'000);
+        std::atomic<bool> done(false);
+
+        std::vector<std::thread> threads;
+        for(std::size_t idx(0); idx < emitters; ++idx)
+        {
+            threads.emplace_back([&s]()
+                {
+                    for(std::size_t count(0); count < emits; ++count)
+                    {
+                        s.call(static_cast<int>(count));
+                    }
+                });
+        }
+        std::thread churn([&]()
+            {
+                std::shared_ptr<int> token(std::make_shared<int>(0));
+                while(!done.load())
+                {
+                    serverplugins::signal<void(int)>::callback_id_t const id(s.add_callback(
+                        [&temporary, token](int) { ++temporary; }, static_cast<int>(temporary.load() % 3) - 1));
+                    if(!s.remove_callback(id))
+                    {
+                        throw std::logic_error("could not remove the temporary listener");
+                    }
+                }
+            });
+
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+        done.store(true);
+        churn.join();
+
+        CATCH_REQUIRE(permanent.load() == emitters * emits);
+        CATCH_REQUIRE(s.size() == 1);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("delivery", "[plugins][delivery]")
+{
+    CATCH_START_SECTION("delivery: asynchronous listeners run in order in the pool")
+    {
+        typedef serverplugins::signal<void(std::string const &, int)> signal_t;
+
+        serverplugins::delivery_pool::pointer_t pool(std::make_shared<serverplugins::delivery_pool>(2));
+        CATCH_REQUIRE(pool->get_workers() == 2);
+
+        std::thread::id const emitter(std::this_thread::get_id());
+        std::vector<int> values;
+        bool same_thread(false);
+        signal_t s;
+        s.add_callback(serverplugins::asynchronous<signal_t>(
+                  pool
+                , 100
+                , serverplugins::backpressure_t::BACKPRESSURE_BLOCK
+                , [&](std::string const & text, int value)
+                  {
+                      if(text != "value"
+                      || std::this_thread::get_id() == emitter)
+                      {
+                          same_thread = true;
+                      }
+                      values.push_back(value);
+                  }));
+
+        for(int idx(0); idx < 250; ++idx)
+        {
+            std::string text("value");
+            s.call(text, idx);
+            text = "changed";       // the listener got a copy
+        }
+        pool->flush();
+
+        CATCH_REQUIRE(pool->pending() == 0);
+        CATCH_REQUIRE_FALSE(same_thread);
+        CATCH_REQUIRE(values.size() == 250);
+        for(int idx(0); idx < 250; ++idx)
+        {
+            CATCH_REQUIRE(values[idx] == idx);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("delivery: backpressure policies")
+    {
+        serverplugins::delivery_pool::pointer_t pool(std::make_shared<serverplugins::delivery_pool>(1));
+
+        std::atomic<bool> open(true);
+        std::vector<int> values;
+        auto const task([&](int value)
+            {
+                return [&open, &values, value]()
+                    {
+                        while(!open.load())
+                        {
+                            std::this_thread::yield();
+                        }
+                        values.push_back(value);
+                    };
+            });
+        auto const wait_until_running([&pool](serverplugins::delivery_queue::pointer_t q)
+            {
+                while(q->size() != 0 || pool->pending() == 0)
+                {
+                    std::this_thread::yield();
+                }
+            });
+
+        // reject: the calls over capacity are discarded
+        //
+        {
+            serverplugins::delivery_queue::pointer_t q(pool->create_queue(2, serverplugins::backpressure_t::BACKPRESSURE_REJECT));
+            CATCH_REQUIRE(q->get_capacity() == 2);
+            CATCH_REQUIRE(q->get_backpressure() == serverplugins::backpressure_t::BACKPRESSURE_REJECT);
+
+            values.clear();
+            open.store(false);
+            CATCH_REQUIRE(q->push(task(0)));
+            wait_until_running(q);
+            CATCH_REQUIRE(q->push(task(1)));
+            CATCH_REQUIRE(q->push(task(2)));
+            CATCH_REQUIRE_FALSE(q->push(task(3)));
+            CATCH_REQUIRE_FALSE(q->push(task(4)));
+            CATCH_REQUIRE(q->size() == 2);
+            open.store(true);
+            q->flush();
+
+            CATCH_REQUIRE(values == std::vector<int>({ 0, 1, 2 }));
+            serverplugins::delivery_queue::counters_t const counters(q->get_counters());
+            CATCH_REQUIRE(counters.f_delivered == 3);
+            CATCH_REQUIRE(counters.f_rejected == 2);
+            CATCH_REQUIRE(counters.f_dropped == 0);
+            CATCH_REQUIRE(counters.f_blocked == 0);
+        }
+
+        // drop oldest: the newest calls are kept
+        //
+        {
+            serverplugins::delivery_queue::pointer_t q(pool->create_queue(2, serverplugins::backpressure_t::BACKPRESSURE_DROP_OLDEST));
+
+            values.clear();
+            open.store(false);
+            CATCH_REQUIRE(q->push(task(0)));
+            wait_until_running(q);
+            for(int idx(1); idx <= 5; ++idx)
+            {
+                CATCH_REQUIRE(q->push(task(idx)));
+            }
+            open.store(true);
+            q->flush();
+
+            CATCH_REQUIRE(values == std::vector<int>({ 0, 4, 5 }));
+            serverplugins::delivery_queue::counters_t const counters(q->get_counters());
+            CATCH_REQUIRE(counters.f_delivered == 3);
+            CATCH_REQUIRE(counters.f_dropped == 3);
+        }
+
+        // block: the emitter waits for room
+        //
+        {
+            serverplugins::delivery_queue::pointer_t q(pool->create_queue(1, serverplugins::backpressure_t::BACKPRESSURE_BLOCK));
+
+            values.clear();
+            open.store(false);
+            CATCH_REQUIRE(q->push(task(0)));
+            wait_until_running(q);
+            CATCH_REQUIRE(q->push(task(1)));
+            std::thread release([&open]()
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    open.store(true);
+                });
+            CATCH_REQUIRE(q->push(task(2)));        // blocks until "release" opens the gate
+            release.join();
+            q->flush();
+
+            CATCH_REQUIRE(values == std::vector<int>({ 0, 1, 2 }));
+            CATCH_REQUIRE(q->get_counters().f_blocked == 1);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("delivery: fan out calls in parallel")
+    {
+        serverplugins::delivery_pool::pointer_t pool(std::make_shared<serverplugins::delivery_pool>(3));
+
+        std::vector<int> called(4);
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        pool->fan_out(called.size(), [&called](std::size_t idx)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                ++called[idx];
+            });
+        std::chrono::steady_clock::duration const elapsed(std::chrono::steady_clock::now() - start);
+
+        CATCH_REQUIRE(called == std::vector<int>({ 1, 1, 1, 1 }));
+        CATCH_REQUIRE(elapsed < std::chrono::milliseconds(350));
+
+        // nothing to do
+        //
+        pool->fan_out(0, [](std::size_t) { throw std::logic_error("not called"); });
+
+        // the exception with the smallest index wins
+        //
+        std::atomic<std::size_t> count(0);
+        for(int repeat(0); repeat < 10; ++repeat)
+        {
+            count = 0;
+            try
+            {
+                pool->fan_out(8, [&count](std::size_t idx)
+                    {
+                        ++count;
+                        if(idx == 3 || idx == 6)
+                        {
+                            throw std::runtime_error("index " + std::to_string(idx));
+                        }
+                    });
+                CATCH_REQUIRE(false);
+            }
+            catch(std::runtime_error const & e)
+            {
+                CATCH_REQUIRE(std::string(e.what()) == "index 3");
+            }
+            CATCH_REQUIRE(count.load() == 8);
+        }
+
+        // a thread of the pool can fan out too
+        //
+        serverplugins::delivery_pool::pointer_t single(std::make_shared<serverplugins::delivery_pool>(1));
+        serverplugins::delivery_queue::pointer_t q(single->create_queue());
+        std::size_t nested(0);
+        CATCH_REQUIRE(q->push([&single, &nested]()
+            {
+                single->fan_out(5, [&nested](std::size_t) { ++nested; });
+            }));
+        single->flush();
+        CATCH_REQUIRE(nested == 5);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("delivery: call the listeners of a signal in parallel")
+    {
+        typedef serverplugins::signal<void(std::string const &)> signal_t;
+
+        serverplugins::delivery_pool::pointer_t pool(std::make_shared<serverplugins::delivery_pool>(2));
+
+        std::atomic<int> called(0);
+        std::atomic<int> attempts(0);
+        signal_t s;
+        s.call_parallel(pool.get(), "nobody");
+        for(int priority(1); priority <= 3; ++priority)
+        {
+            s.add_callback([&called, &attempts, priority](std::string const & document)
+                {
+                    ++attempts;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    if(document == "invalid")
+                    {
+                        throw std::runtime_error("priority " + std::to_string(priority));
+                    }
+                    called += priority;
+                }, priority);
+        }
+
+        s.call_parallel(pool.get(), "document");
+        CATCH_REQUIRE(called.load() == 6);
+
+        s.parallel(pool.get())("document");
+        CATCH_REQUIRE(called.load() == 12);
+
+        // without a pool, the listeners are called one after the other
+        //
+        s.call_parallel(static_cast<serverplugins::delivery_pool *>(nullptr), "document");
+        CATCH_REQUIRE(called.load() == 18);
+
+        // the exception of the listener with the highest priority wins
+        //
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  s.call_parallel(pool.get(), "invalid")
+                , std::runtime_error
+                , Catch::Matchers::Message("priority 3"));
+        CATCH_REQUIRE(attempts.load() == 12);
+
+        // without a pool, all the listeners are still called and the
+        // same exception wins
+        //
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  s.call_parallel(static_cast<serverplugins::delivery_pool *>(nullptr), "invalid")
+                , std::runtime_error
+                , Catch::Matchers::Message("priority 3"));
+        CATCH_REQUIRE(attempts.load() == 15);
+        CATCH_REQUIRE(called.load() == 18);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("delivery: exceptions, flush from a listener, and stop")
+    {
+        serverplugins::delivery_pool::pointer_t pool(std::make_shared<serverplugins::delivery_pool>(1));
+        serverplugins::delivery_queue::pointer_t q(pool->create_queue());
+        CATCH_REQUIRE(q->get_capacity() == serverplugins::DEFAULT_DELIVERY_QUEUE_CAPACITY);
+
+        bool flush_failed(false);
+        CATCH_REQUIRE(q->push([]() { throw std::runtime_error("listener failed"); }));
+        CATCH_REQUIRE(q->push([&pool, &flush_failed]()
+            {
+                try
+                {
+                    pool->flush();
+                }
+                catch(serverplugins::logic_error const &)
+                {
+                    flush_failed = true;
+                }
+            }));
+        pool->flush();
+
+        CATCH_REQUIRE(flush_failed);
+        serverplugins::delivery_queue::counters_t counters(q->get_counters());
+        CATCH_REQUIRE(counters.f_failed == 1);
+        CATCH_REQUIRE(counters.f_delivered == 1);
+
+        pool->stop();
+        pool->stop();
+        CATCH_REQUIRE_FALSE(q->push([]() {}));
+        counters = q->get_counters();
+        CATCH_REQUIRE(counters.f_rejected == 1);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+namespace
+{
+
+
+// the daemon, paths, names, and collection setup of the
+// "collection: load the plugin" test, shared by the other collection
+// tests; the names are the plugins in \p list or, when empty, all the
+// plugins found in \p path
+//
+char const * const g_plugin_paths = CMAKE_BINARY_DIR "/tests:/usr/local/lib/snaplogger/plugins:/usr/lib/snaplogger/plugins";
+
+
+optional_namespace::daemon::pointer_t create_daemon()
+{
+    char const * argv[] = { "/usr/sbin/daemon", nullptr };
+    optional_namespace::daemon::pointer_t d(std::make_shared<optional_namespace::daemon>(1, const_cast<char **>(argv)));
+    d->complete_plugin_initialization();
+    return d;
+}
+
+
+serverplugins::names create_names(
+      std::string const & path = g_plugin_paths
+    , std::string const & list = std::string()
+    , serverplugins::load_report::pointer_t report = serverplugins::load_report::pointer_t())
+{
+    serverplugins::paths p;
+    p.add(path);
+
+    serverplugins::names n(p);
+    n.set_load_report(report);
+    if(list.empty())
+    {
+        n.find_plugins();
+    }
+    else
+    {
+        n.add(list);
+    }
+    return n;
+}
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("collection", "[plugins][collection]")
+{
+    CATCH_START_SECTION("collection: load the plugin")
+    {
+        // initialize the daemon
+        //
+        char const * argv[] = { "/usr/sbin/daemon", nullptr };
+        optional_namespace::daemon::pointer_t d(std::make_shared<optional_namespace::daemon>(1, const_cast<char **>(argv)));
+        d->complete_plugin_initialization();
+
+        // define a list of colon separated paths
+        //
+        serverplugins::paths p;
+        p.add(CMAKE_BINARY_DIR "/tests:/usr/local/lib/snaplogger/plugins:/usr/lib/snaplogger/plugins");
+
+        // setup the plugin filenames
+        //
+        serverplugins::names n(p);
+        n.find_plugins();
+
+        // create a collection from plugins we found automatically
+        // (opposed to setting the name from a plugins=... variable found in your daemon settings)
+        //
+        serverplugins::collection c(n);
+
+        // now load the plugins
+        //
+        bool const loaded(c.load_plugins(d));
+        CATCH_REQUIRE(loaded);
+
+        // make sure the testme plugin was indeed loaded
+        //
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        // verify the plugin definitions
+        //
+        serverplugins::version_t const v(r->version());
+        CATCH_CHECK(v.f_major == 5);
+        CATCH_CHECK(v.f_minor == 3);
+        CATCH_CHECK(v.f_patch == 0);
+
+        //time_t m(last_modification());
+
+        CATCH_REQUIRE(r->name() == "testme");
+        CATCH_REQUIRE(r->filename() == CMAKE_BINARY_DIR "/tests/libtestme.so");
+        CATCH_REQUIRE(r->description() == "a test plugin to make sure it all works.");
+        CATCH_REQUIRE(r->help_uri() == "https://snapwebsites.org/help");
+        CATCH_REQUIRE(r->icon() == "cute.ico");
+
+        serverplugins::string_set_t tags(r->categorization_tags());
+        CATCH_REQUIRE(tags.size() == 3);
+        CATCH_REQUIRE(tags.find("test") != tags.end());
+        CATCH_REQUIRE(tags.find("powerful") != tags.end());
+        CATCH_REQUIRE(tags.find("software") != tags.end());
+        CATCH_REQUIRE(tags.find("undefined") == tags.end());
+
+        // at this time we have a single plugins so not dependencies
+        // (although we could depend on "daemon", but that's not necessary)
+        //
+        serverplugins::string_set_t dependencies(r->dependencies());
+        CATCH_REQUIRE(dependencies.empty());
+
+        serverplugins::string_set_t conflicts(r->conflicts());
+        CATCH_REQUIRE(conflicts.size() == 3);
+        CATCH_REQUIRE(conflicts.find("other_test") != conflicts.end());
+        CATCH_REQUIRE(conflicts.find("power_test") != conflicts.end());
         CATCH_REQUIRE(conflicts.find("unknown") != conflicts.end());
         CATCH_REQUIRE(conflicts.find("undefined") == conflicts.end());
 
@@ -803,6 +2175,796 @@ CATCH_TEST_CASE("collection", "[plugins][collection]")
         CATCH_CHECK(msg == "testme:plugin: it worked, it was called!");
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load the plugin with several workers")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.get_load_workers() == 1);
+        c.set_load_workers(4);
+        CATCH_REQUIRE(c.get_load_workers() == 4);
+        c.set_load_workers(0);
+        CATCH_REQUIRE(c.get_load_workers() >= 1);
+        c.set_load_workers(4);
+
+        bool const loaded(c.load_plugins(d));
+        CATCH_REQUIRE(loaded);
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+        CATCH_REQUIRE(r->filename() == CMAKE_BINARY_DIR "/tests/libtestme.so");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load independent plugins in parallel")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+        serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/independent", std::string(), report));
+        c.set_load_workers(4);
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        // the plugins were loaded by more than one thread
+        //
+        std::set<pid_t> threads;
+        std::size_t loaded(0);
+        for(auto const & e : report->events())
+        {
+            if(e.f_phase == "dlopen")
+            {
+                threads.insert(e.f_thread);
+                ++loaded;
+            }
+        }
+        CATCH_REQUIRE(loaded >= 4);
+        CATCH_REQUIRE(threads.size() > 1);
+
+        // whichever thread loaded them, they get bootstrapped in order
+        //
+        CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"alpha", "bravo", "charlie", "delta"}));
+        for(auto const & name : d->f_bootstrapped)
+        {
+            serverplugins::plugin::pointer_t const plugin(c.get_plugin<serverplugins::plugin>(name));
+            CATCH_REQUIRE(plugin != nullptr);
+            CATCH_REQUIRE(plugin->filename() == CMAKE_BINARY_DIR "/sibling_plugins/independent/lib" + name + ".so");
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: dependencies get bootstrapped first")
+    {
+        // a chain, only the top plugin is requested, the others are
+        // found through its dependencies
+        //
+        // this is the first time these plugins get loaded, without
+        // workers or preflight, and the report includes the time it
+        // took to open each one of them
+        //
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+            serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/chain", "chain_a", report));
+            CATCH_REQUIRE(c.get_load_workers() == 1);
+            CATCH_REQUIRE_FALSE(c.get_preflight());
+            CATCH_REQUIRE(c.load_plugins(d));
+            CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"chain_c", "chain_b", "chain_a"}));
+
+            serverplugins::load_report::plugin_map_t const plugins(report->plugins());
+            for(auto const & name : { "chain_a", "chain_b", "chain_c" })
+            {
+                auto const it(plugins.find(name));
+                CATCH_REQUIRE(it != plugins.end());
+                CATCH_REQUIRE(it->second.find("dlopen") != it->second.end());
+                CATCH_REQUIRE(it->second.find("static_init") != it->second.end());
+            }
+        }
+
+        // a diamond, the bottom plugin gets bootstrapped once, before
+        // both sides
+        //
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/diamond", "diamond_a"));
+            CATCH_REQUIRE(c.load_plugins(d));
+            CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"diamond_d", "diamond_b", "diamond_c", "diamond_a"}));
+        }
+
+        // a cycle cannot be sorted; the plugins which can be are
+        // bootstrapped first, the others follow in alphabetical order
+        //
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/cycle", "cycle_c, cycle_d"));
+            CATCH_REQUIRE_FALSE(c.load_plugins(d));
+            CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"cycle_c", "cycle_a", "cycle_b", "cycle_d"}));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load the plugin with a preflight")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE_FALSE(c.get_preflight());
+        c.set_preflight();
+        CATCH_REQUIRE(c.get_preflight());
+
+        bool const loaded(c.load_plugins(d));
+        CATCH_REQUIRE(loaded);
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+        CATCH_REQUIRE(r->plugins() == &c);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: preflight never loads a plugin in conflict")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+        serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/conflict", "conflict_a, conflict_b", report));
+        c.set_preflight();
+        CATCH_REQUIRE_FALSE(c.load_plugins(d));
+
+        CATCH_REQUIRE(c.is_loaded("conflict_a"));
+        CATCH_REQUIRE_FALSE(c.is_loaded("conflict_b"));
+        CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"conflict_a"}));
+
+        // the rejected plugin was never opened
+        //
+        std::vector<std::string> opened;
+        for(auto const & e : report->events())
+        {
+            if(e.f_phase == "dlopen")
+            {
+                opened.push_back(e.f_plugin);
+            }
+        }
+        CATCH_REQUIRE(opened == std::vector<std::string>({"conflict_a"}));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load the plugin lazily on first get_plugin()")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE_FALSE(c.get_lazy());
+        c.set_lazy();
+        CATCH_REQUIRE(c.get_lazy());
+
+        CATCH_REQUIRE(c.load_plugins(d));
+        CATCH_REQUIRE(c.is_loaded("testme"));
+
+        serverplugins::collection::lazy_counters_t counters(c.get_lazy_counters());
+        CATCH_REQUIRE(counters.f_deferred == 1);
+        CATCH_REQUIRE(counters.f_materialized_by_get == 0);
+        CATCH_REQUIRE(counters.f_untouched == serverplugins::string_set_t({"testme"}));
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+        CATCH_REQUIRE(r->plugins() == &c);
+        CATCH_REQUIRE(c.get_plugin<optional_namespace::testme>("testme") == r);
+
+        counters = c.get_lazy_counters();
+        CATCH_REQUIRE(counters.f_materialized_by_get == 1);
+        CATCH_REQUIRE(counters.f_materialized_by_signal == 0);
+        CATCH_REQUIRE(counters.f_untouched.empty());
+
+        // the plugin is now bootstrapped and listening
+        //
+        d->ready(17);
+        CATCH_REQUIRE(r->get_ready() == 17);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load the plugin lazily on first signal")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        c.set_lazy();
+        CATCH_REQUIRE(c.load_plugins(d));
+        CATCH_REQUIRE(c.get_lazy_counters().f_untouched == serverplugins::string_set_t({"testme"}));
+
+        // the interest is for the "ready" signal of the daemon, the same
+        // signal emitted by another plugin does not load testme
+        //
+        c.materialize_listeners("builtin", "ready");
+        CATCH_REQUIRE(c.get_lazy_counters().f_untouched == serverplugins::string_set_t({"testme"}));
+
+        // testme declared an interest in "ready" so it gets loaded
+        // and receives the very first emission
+        //
+        d->ready(33);
+
+        serverplugins::collection::lazy_counters_t const counters(c.get_lazy_counters());
+        CATCH_REQUIRE(counters.f_deferred == 1);
+        CATCH_REQUIRE(counters.f_materialized_by_signal == 1);
+        CATCH_REQUIRE(counters.f_materialized_by_get == 0);
+        CATCH_REQUIRE(counters.f_untouched.empty());
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+        CATCH_REQUIRE(r->get_ready() == 33);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load a deferred plugin from a bootstrap() function")
+    {
+        // the daemon gets bootstrapped first and requests chain_b, which
+        // gets loaded (with its dependency) while load_plugins() is still
+        // going through the list of plugins to bootstrap
+        //
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        d->f_get_on_bootstrap.push_back("chain_b");
+        serverplugins::collection c(create_names(CMAKE_BINARY_DIR "/sibling_plugins/chain", "chain_a"));
+        c.set_lazy();
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        // each plugin gets bootstrapped exactly once
+        //
+        CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"chain_c", "chain_b"}));
+
+        serverplugins::collection::lazy_counters_t const counters(c.get_lazy_counters());
+        CATCH_REQUIRE(counters.f_deferred == 3);
+        CATCH_REQUIRE(counters.f_materialized_by_get == 1);
+        CATCH_REQUIRE(counters.f_materialized_as_dependency == 1);
+        CATCH_REQUIRE(counters.f_untouched == serverplugins::string_set_t({"chain_a"}));
+
+        // the loaded plugins are found without loading anything else
+        //
+        CATCH_REQUIRE(c.get_plugin<serverplugins::plugin>("chain_c") != nullptr);
+        CATCH_REQUIRE(c.get_plugin<serverplugins::plugin>("chain_b") != nullptr);
+        CATCH_REQUIRE(c.get_lazy_counters().f_untouched == serverplugins::string_set_t({"chain_a"}));
+
+        CATCH_REQUIRE(c.get_plugin<serverplugins::plugin>("chain_a") != nullptr);
+        CATCH_REQUIRE(d->f_bootstrapped == std::vector<std::string>({"chain_c", "chain_b", "chain_a"}));
+        CATCH_REQUIRE(c.get_lazy_counters().f_untouched.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: load the plugin with a cached plan")
+    {
+        std::string const plan_filename(CMAKE_BINARY_DIR "/plugins.plan");
+        unlink(plan_filename.c_str());
+
+        // first time the plan gets created
+        //
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::collection c(create_names());
+            CATCH_REQUIRE(c.get_plan_filename().empty());
+            c.set_plan_filename(plan_filename);
+            CATCH_REQUIRE(c.get_plan_filename() == plan_filename);
+            CATCH_REQUIRE(c.load_plugins(d));
+            CATCH_REQUIRE_FALSE(c.used_cached_plan());
+        }
+
+        serverplugins::load_plan plan;
+        CATCH_REQUIRE(plan.load(plan_filename));
+        CATCH_REQUIRE(plan.get_server_name() == "daemon");
+        CATCH_REQUIRE(plan.get_requested().size() == 1);
+        CATCH_REQUIRE(plan.get_plugins().size() == 1);
+        CATCH_REQUIRE(plan.get_plugins()[0].f_name == "testme");
+        CATCH_REQUIRE(plan.get_plugins()[0].f_filename == CMAKE_BINARY_DIR "/tests/libtestme.so");
+        CATCH_REQUIRE(plan.get_conflicts().size() == 3);
+        CATCH_REQUIRE(plan.is_current());
+
+        // second time the plan gets used
+        //
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::collection c(create_names());
+            c.set_plan_filename(plan_filename);
+            CATCH_REQUIRE(c.load_plugins(d));
+            CATCH_REQUIRE(c.used_cached_plan());
+
+            optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->plugins() == &c);
+        }
+
+        // a plugin file changed, the plan is ignored and saved again
+        //
+        timespec const now[2] = { { 0, UTIME_NOW }, { 0, UTIME_NOW } };
+        CATCH_REQUIRE(utimensat(AT_FDCWD, CMAKE_BINARY_DIR "/tests/libtestme.so", now, 0) == 0);
+        CATCH_REQUIRE_FALSE(plan.is_current());
+        {
+            optional_namespace::daemon::pointer_t d(create_daemon());
+            serverplugins::collection c(create_names());
+            c.set_plan_filename(plan_filename);
+            CATCH_REQUIRE(c.load_plugins(d));
+            CATCH_REQUIRE_FALSE(c.used_cached_plan());
+        }
+        CATCH_REQUIRE(plan.load(plan_filename));
+        CATCH_REQUIRE(plan.is_current());
+
+        // an invalid plan is ignored
+        //
+        {
+            std::ofstream out(plan_filename);
+            out << "SPPLAN";
+        }
+        CATCH_REQUIRE_FALSE(plan.load(plan_filename));
+        CATCH_REQUIRE(plan.get_plugins().empty());
+
+        unlink(plan_filename.c_str());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: unload and reload a plugin")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        // the server cannot be unloaded
+        //
+        CATCH_REQUIRE_FALSE(c.unload_plugin("daemon"));
+        CATCH_REQUIRE_FALSE(c.unload_plugin("unknown"));
+        CATCH_REQUIRE_FALSE(c.reload_plugin("unknown"));
+
+        // a plugin still referenced cannot be unloaded
+        //
+        {
+            optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE_FALSE(c.unload_plugin("testme"));
+            CATCH_REQUIRE(c.is_loaded("testme"));
+
+            d->ready(5);
+            CATCH_REQUIRE(r->get_ready() == 5);
+        }
+
+        // the emission of an awaitable signal keeps a task guard until
+        // it is done since a listener may be a suspended coroutine
+        //
+        {
+            std::optional<serverplugins::detail::task_guard> pending;
+            {
+                serverplugins::detail::signal_guard const guard(d.get(), "ready");
+                pending.emplace(guard.start_task());
+            }
+            CATCH_REQUIRE_FALSE(c.unload_plugin("testme"));
+            CATCH_REQUIRE_FALSE(c.reload_plugin("testme"));
+            CATCH_REQUIRE(c.is_loaded("testme"));
+        }
+
+        // reload: the new instance listens to the daemon again
+        //
+        CATCH_REQUIRE(c.reload_plugin("testme"));
+        CATCH_REQUIRE(c.is_loaded("testme"));
+        {
+            optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_ready() == 0);
+            d->ready(7);
+            CATCH_REQUIRE(r->get_ready() == 7);
+        }
+
+        // unload: the daemon can still emit its signal
+        //
+        CATCH_REQUIRE(d->f_listener_token.use_count() > 1);
+        CATCH_REQUIRE(c.unload_plugin("testme"));
+        CATCH_REQUIRE_FALSE(c.is_loaded("testme"));
+
+        // the listeners of the plugin, including the copies retired by
+        // the signals, were destroyed before the library was unloaded
+        //
+        CATCH_REQUIRE(d->f_listener_token.use_count() == 1);
+        CATCH_REQUIRE(c.get_plugin<optional_namespace::testme>("testme") == nullptr);
+        d->ready(9);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: plugin handles")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        c.set_lazy();
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        // the handle loads a deferred plugin
+        //
+        std::string_view const testme_name("testme");
+        serverplugins::plugin_handle<optional_namespace::testme> const h(c.get_handle<optional_namespace::testme>(testme_name));
+        CATCH_REQUIRE(h);
+        CATCH_REQUIRE(c.get_lazy_counters().f_untouched.empty());
+        CATCH_REQUIRE(h.get() == c.get_plugin<optional_namespace::testme>("testme").get());
+        d->ready(11);
+        CATCH_REQUIRE(h->get_ready() == 11);
+        CATCH_REQUIRE((*h).get_ready() == 11);
+        CATCH_REQUIRE(c.get_handle<optional_namespace::testme>("testme").get() == h.get());
+
+        CATCH_REQUIRE_FALSE(c.get_handle<optional_namespace::testme>("unknown"));
+        CATCH_REQUIRE_FALSE(serverplugins::plugin_handle<optional_namespace::testme>());
+
+        // the server is verified once
+        //
+        serverplugins::plugin_handle<optional_namespace::daemon> const s(c.get_server_handle<optional_namespace::daemon>());
+        CATCH_REQUIRE(s.get() == d.get());
+        CATCH_REQUIRE_FALSE(c.get_server_handle<optional_namespace::builtin>());
+
+        // the handle follows the plugin when reloaded or unloaded
+        //
+        CATCH_REQUIRE(c.reload_plugin("testme"));
+        CATCH_REQUIRE(h);
+        CATCH_REQUIRE(h->get_ready() == 0);
+        d->ready(12);
+        CATCH_REQUIRE(h->get_ready() == 12);
+
+        CATCH_REQUIRE(c.unload_plugin("testme"));
+        CATCH_REQUIRE_FALSE(h);
+        CATCH_REQUIRE(h.get() == nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: freeze")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        c.set_lazy();
+        CATCH_REQUIRE(c.load_plugins(d));
+        CATCH_REQUIRE_FALSE(c.is_frozen());
+
+        // the deferred plugins get loaded first
+        //
+        c.freeze();
+        c.freeze();
+        CATCH_REQUIRE(c.is_frozen());
+
+        serverplugins::collection::lazy_counters_t const counters(c.get_lazy_counters());
+        CATCH_REQUIRE(counters.f_deferred == 1);
+        CATCH_REQUIRE(counters.f_materialized_by_freeze == 1);
+        CATCH_REQUIRE(counters.f_untouched.empty());
+
+        // the signals still reach the listeners
+        //
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+        d->ready(45);
+        CATCH_REQUIRE(r->get_ready() == 45);
+
+        // but the plugins cannot be unloaded anymore
+        //
+        r.reset();
+        CATCH_REQUIRE_FALSE(c.unload_plugin("testme"));
+        CATCH_REQUIRE_FALSE(c.reload_plugin("testme"));
+        CATCH_REQUIRE(c.is_loaded("testme"));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: static plugin")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+
+        // the builtin plugin is found without any paths
+        //
+        serverplugins::paths p;
+        serverplugins::names n(p);
+        CATCH_REQUIRE(n.to_filename("builtin") == "static:builtin");
+        n.push("builtin");
+        CATCH_REQUIRE(n.map().size() == 1);
+        CATCH_REQUIRE(n.map().at("builtin") == "static:builtin");
+
+        serverplugins::static_plugin const * sp(serverplugins::static_plugin::find("builtin"));
+        CATCH_REQUIRE(sp != nullptr);
+        CATCH_REQUIRE(std::string(sp->name()) == "builtin");
+        CATCH_REQUIRE(serverplugins::static_plugin::find_by_filename("static:builtin") == sp);
+        CATCH_REQUIRE(serverplugins::static_plugin::find("testme") == nullptr);
+        CATCH_REQUIRE(serverplugins::static_plugin::find_by_filename(CMAKE_BINARY_DIR "/tests/libtestme.so") == nullptr);
+        CATCH_REQUIRE(serverplugins::static_plugin::is_static_filename("static:builtin"));
+        CATCH_REQUIRE_FALSE(serverplugins::static_plugin::is_static_filename("builtin"));
+
+        // the definition comes from the table, not an ELF note
+        //
+        serverplugins::definition def;
+        std::uint64_t digest(1);
+        CATCH_REQUIRE(serverplugins::read_definition_note("static:builtin", def, &digest));
+        CATCH_REQUIRE(def.f_name == "builtin");
+        CATCH_REQUIRE(def.f_version.f_major == 1);
+        CATCH_REQUIRE(def.f_version.f_minor == 2);
+        CATCH_REQUIRE(def.f_description == "a test plugin linked in the executable.");
+        CATCH_REQUIRE(digest == 0);
+        CATCH_REQUIRE_FALSE(serverplugins::read_definition_note("static:unknown", def));
+
+        serverplugins::collection c(n);
+        CATCH_REQUIRE(c.load_plugins(d));
+        CATCH_REQUIRE(c.is_loaded("builtin"));
+        CATCH_REQUIRE_FALSE(c.is_loaded("testme"));
+
+        optional_namespace::builtin::pointer_t b(c.get_plugin<optional_namespace::builtin>("builtin"));
+        CATCH_REQUIRE(b != nullptr);
+        CATCH_REQUIRE(b->plugins() == &c);
+        CATCH_REQUIRE(b->filename() == "static:builtin");
+        CATCH_REQUIRE(b->it_worked() == "builtin:plugin: it worked, it was called!");
+        int const bootstraps(b->get_bootstraps());
+        CATCH_REQUIRE(bootstraps >= 1);
+
+        // a static plugin cannot be unloaded
+        //
+        CATCH_REQUIRE_FALSE(c.unload_plugin("builtin"));
+        CATCH_REQUIRE(c.is_loaded("builtin"));
+
+        // the plugin gets created once and shared between collections
+        //
+        serverplugins::collection other(n);
+        CATCH_REQUIRE(other.load_plugins(d));
+        CATCH_REQUIRE(other.get_plugin<optional_namespace::builtin>("builtin") == b);
+        CATCH_REQUIRE(b->get_bootstraps() == bootstraps + 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: asynchronous listeners")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        c.set_delivery_workers(2);
+        CATCH_REQUIRE(c.get_delivery_workers() == 2);
+        CATCH_REQUIRE(c.load_plugins(d));
+        CATCH_REQUIRE(c.get_delivery_pool()->get_workers() == 2);
+
+        {
+            optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+            CATCH_REQUIRE(r != nullptr);
+
+            d->message("one");
+            d->message("two");
+            d->message("three");
+            c.get_delivery_pool()->flush();
+            CATCH_REQUIRE(r->get_messages() == std::vector<std::string>({ "one", "two", "three" }));
+        }
+
+        // unloading waits for the calls still in the queue
+        //
+        for(int idx(0); idx < 20; ++idx)
+        {
+            d->message("unload " + std::to_string(idx));
+        }
+        CATCH_REQUIRE(c.unload_plugin("testme"));
+        CATCH_REQUIRE(c.get_delivery_pool()->pending() == 0);
+        d->message("nobody listens");
+        CATCH_REQUIRE(c.get_delivery_pool()->pending() == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: parallel signal")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        c.set_delivery_workers(2);
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        std::atomic<int> called(0);
+        d->signal_listen_index([&called](std::string const &)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                ++called;
+            });
+
+        for(int idx(0); idx < 10; ++idx)
+        {
+            // the listeners are joined before index_done() gets called
+            //
+            d->index("page " + std::to_string(idx));
+            CATCH_REQUIRE(called.load() == idx + 1);
+            CATCH_REQUIRE(r->get_indexed() == "page " + std::to_string(idx));
+            CATCH_REQUIRE(d->f_indexed == "page " + std::to_string(idx));
+        }
+
+        CATCH_REQUIRE(called.load() == 10);
+
+        // on an exception, index_done() does not get called
+        //
+        CATCH_REQUIRE_THROWS_AS(d->index("invalid"), std::runtime_error);
+        CATCH_REQUIRE(d->f_indexed == "page 9");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: batch signal")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        std::vector<std::string> single;
+        d->signal_listen_record([&single](std::string const & key, int)
+            {
+                single.push_back(key);
+            });
+
+        d->record("first", 1);
+        CATCH_REQUIRE(r->get_records() == std::vector<std::string>({"first=1"}));
+        CATCH_REQUIRE(r->get_record_batches() == 0);
+
+        // record_start() refuses negative values, which splits the batch
+        //
+        std::vector<optional_namespace::daemon::signal_record_t::item_t> const records({
+                  {"a", 1}
+                , {"b", 2}
+                , {"refused", -1}
+                , {"c", 3}
+            });
+        d->record_batch(records);
+        CATCH_REQUIRE(r->get_records() == std::vector<std::string>({"first=1", "a=1", "b=2", "c=3"}));
+        CATCH_REQUIRE(r->get_record_batches() == 2);
+        CATCH_REQUIRE(single == std::vector<std::string>({"first", "a", "b", "c"}));
+        CATCH_REQUIRE(d->f_recorded == std::vector<std::string>({"first", "a", "b", "c"}));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: keyed signal")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        std::vector<std::string> home;
+        d->signal_listen_key_request("/", [&home](std::string const & url, int)
+            {
+                home.push_back(url);
+            });
+
+        // testme only listens to the "/admin/" prefix
+        //
+        d->request("/", 1);
+        d->request("/admin/users", 2);
+        d->request("/about", 1);
+        d->request("/admin/", 3);
+        CATCH_REQUIRE(r->get_requests() == std::vector<std::string>({"2 /admin/users", "3 /admin/"}));
+        CATCH_REQUIRE(home == std::vector<std::string>({"/"}));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: result signal")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        CATCH_REQUIRE(d->lookup("testme") == std::string("found by testme"));
+        CATCH_REQUIRE_FALSE(d->lookup("unknown").has_value());
+        CATCH_REQUIRE(r->get_lookups() == 2);
+
+        // lookup_start() refuses empty names
+        //
+        CATCH_REQUIRE_FALSE(d->lookup(std::string()).has_value());
+        CATCH_REQUIRE(r->get_lookups() == 2);
+
+        // a listener with a higher priority answering first stops the
+        // emission before testme gets called
+        //
+        d->signal_listen_lookup([](std::string const & name) -> std::optional<std::string>
+            {
+                if(name == "testme")
+                {
+                    return std::string("cached");
+                }
+                return std::nullopt;
+            }, 10);
+        CATCH_REQUIRE(d->lookup("testme") == std::string("cached"));
+        CATCH_REQUIRE(r->get_lookups() == 2);
+        CATCH_REQUIRE_FALSE(d->lookup("other").has_value());
+        CATCH_REQUIRE(r->get_lookups() == 3);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: signal profiles")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::collection c(create_names());
+        CATCH_REQUIRE(c.load_plugins(d));
+        optional_namespace::testme::pointer_t r(c.get_plugin<optional_namespace::testme>("testme"));
+        CATCH_REQUIRE(r != nullptr);
+
+        d->ready(1);
+        d->ready(2);
+        d->record("a", 1);
+
+        // the profiling wrapper, if any, still calls the listeners
+        //
+        CATCH_REQUIRE(r->get_ready() == 2);
+        CATCH_REQUIRE_FALSE(r->get_records().empty());
+        CATCH_REQUIRE(r->get_records().back() == "a=1");
+
+        serverplugins::signal_profile_vector_t const profiles(c.get_signal_profiles());
+#ifdef SERVERPLUGINS_PROFILING
+        // testme listens to ready (twice, the second is the lambda holding
+        // the daemon token), message, index, record, request, and lookup
+        //
+        CATCH_REQUIRE(profiles.size() == 7);
+        char const * const signals[] = { "index", "lookup", "message", "ready", "ready", "record", "request" };
+        std::uint64_t const calls[] = { 0, 0, 0, 2, 2, 1, 0 };
+        for(std::size_t idx(0); idx < profiles.size(); ++idx)
+        {
+            CATCH_REQUIRE(profiles[idx].f_emitter == "daemon");
+            CATCH_REQUIRE(profiles[idx].f_signal == signals[idx]);
+            CATCH_REQUIRE(profiles[idx].f_listener == "testme");
+            CATCH_REQUIRE(profiles[idx].f_calls == calls[idx]);
+            CATCH_REQUIRE(profiles[idx].f_total_ns >= profiles[idx].f_max_ns);
+
+            std::uint64_t sum(0);
+            for(auto const h : profiles[idx].f_histogram)
+            {
+                sum += h;
+            }
+            CATCH_REQUIRE(sum == calls[idx]);
+        }
+
+        c.reset_signal_profiles();
+        for(auto const & p : c.get_signal_profiles())
+        {
+            CATCH_REQUIRE(p.f_calls == 0);
+            CATCH_REQUIRE(p.f_total_ns == 0);
+            CATCH_REQUIRE(p.f_max_ns == 0);
+            CATCH_REQUIRE(p.f_histogram == serverplugins::signal_profile_t::histogram_t());
+        }
+
+        d->ready(3);
+        CATCH_REQUIRE(c.get_signal_profiles()[3].f_calls == 1);
+        CATCH_REQUIRE(c.get_signal_profiles()[5].f_calls == 0);
+#else
+        // nothing gets measured and resetting is a no-op
+        //
+        CATCH_REQUIRE(profiles.empty());
+        c.reset_signal_profiles();
+        d->ready(3);
+        CATCH_REQUIRE(r->get_ready() == 3);
+        CATCH_REQUIRE(c.get_signal_profiles().empty());
+#endif
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("collection: record a load report")
+    {
+        optional_namespace::daemon::pointer_t d(create_daemon());
+        serverplugins::load_report::pointer_t report(std::make_shared<serverplugins::load_report>());
+        serverplugins::names n(create_names(g_plugin_paths, std::string(), report));
+        CATCH_REQUIRE(n.get_load_report() == report);
+
+        serverplugins::collection c(n);
+        CATCH_REQUIRE(c.get_load_report() == report);
+        CATCH_REQUIRE(c.load_plugins(d));
+
+        serverplugins::load_report::phase_map_t const phases(report->phases());
+        for(auto const & phase : { "find_plugins", "load_plugins", "resolve", "order", "bootstrap" })
+        {
+            CATCH_REQUIRE(phases.find(phase) != phases.end());
+        }
+        CATCH_REQUIRE(phases.at("load_plugins") >= phases.at("resolve"));
+
+        serverplugins::load_report::plugin_map_t const plugins(report->plugins());
+        CATCH_REQUIRE(plugins.find("testme") != plugins.end());
+        CATCH_REQUIRE(plugins.at("testme").find("bootstrap") != plugins.at("testme").end());
+        CATCH_REQUIRE(plugins.find("daemon") != plugins.end());
+
+        for(auto const & e : report->events())
+        {
+            CATCH_REQUIRE(e.f_start <= e.f_end);
+            CATCH_REQUIRE(e.f_thread != 0);
+        }
+
+        std::string const trace(report->to_chrome_trace());
+        CATCH_REQUIRE(trace.find("\"traceEvents\":[{") != std::string::npos);
+        CATCH_REQUIRE(trace.find("\"name\":\"testme bootstrap\"") != std::string::npos);
+        CATCH_REQUIRE(trace.find("\"ph\":\"X\"") != std::string::npos);
+        CATCH_REQUIRE(trace.back() == '\n');
+
+        report->clear();
+        CATCH_REQUIRE(report->events().empty());
+    }
+    CATCH_END_SECTION()
 }
 
 
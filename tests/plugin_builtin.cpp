@@ -0,0 +1,60 @@
+// Copyright (c) 2006-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/serverplugins
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "plugin_builtin.h"
+
+
+
+namespace optional_namespace
+{
+
+
+
+SERVERPLUGINS_VERSION(builtin, 1, 2)
+
+
+SERVERPLUGINS_START(builtin)
+    , ::serverplugins::description("a test plugin linked in the executable.")
+    , ::serverplugins::categorization_tag("test")
+SERVERPLUGINS_END(builtin)
+
+
+void builtin::bootstrap()
+{
+    ++f_bootstraps;
+}
+
+
+std::string builtin::it_worked()
+{
+    return std::string("builtin:plugin: it worked, it was called!");
+}
+
+
+int builtin::get_bootstraps() const
+{
+    return f_bootstraps;
+}
+
+
+
+} // optional_namespace namespace
+// vim: ts=4 sw=4 et
@@ -24,6 +24,11 @@
 #include    "plugin_daemon.h"
 
 
+// serverplugins
+//
+#include    <serverplugins/collection.h>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -51,6 +56,47 @@ daemon::daemon(int argc, char * argv[])
 }
 
 
+void daemon::index_done(std::string const & document)
+{
+    f_indexed = document;
+}
+
+
+void daemon::bootstrap()
+{
+    // the tests can request plugins while the collection is still
+    // bootstrapping (in lazy mode, this loads them)
+    //
+    for(auto const & name : f_get_on_bootstrap)
+    {
+        if(plugins()->get_plugin<serverplugins::plugin>(name) == nullptr)
+        {
+            throw std::runtime_error("daemon: plugin \"" + name + "\" not found.");
+        }
+    }
+}
+
+
+bool daemon::record_start(std::string const & key, int value)
+{
+    static_cast<void>(key);
+    return value >= 0;
+}
+
+
+void daemon::record_done(std::string const & key, int value)
+{
+    static_cast<void>(value);
+    f_recorded.push_back(key);
+}
+
+
+bool daemon::lookup_start(std::string const & name)
+{
+    return !name.empty();
+}
+
+
 
 } // namespace optional_namespace
 // vim: ts=4 sw=4 et
@@ -20,7 +20,9 @@
 
 // serverplugins
 //
+#include    <serverplugins/result_signal.h>
 #include    <serverplugins/server.h>
+#include    <serverplugins/signals.h>
 
 
 
@@ -46,7 +48,21 @@ public:
     //
     daemon(int argc, char * argv[]);
 
+    virtual void bootstrap() override;
+
+    PLUGIN_SIGNAL_WITH_MODE(ready, (int value), (value), NEITHER);
+    PLUGIN_SIGNAL_WITH_MODE(message, (std::string const & text), (text), NEITHER);
+    PLUGIN_SIGNAL_WITH_MODE(index, (std::string const & document), (document), PARALLEL_DONE);
+    PLUGIN_SIGNAL_WITH_MODE(record, (std::string const & key, int value), (key, value), START_AND_DONE);
+    PLUGIN_KEYED_SIGNAL_WITH_MODE(request, (std::string const & url, int method), (url, method), NEITHER);
+    PLUGIN_RESULT_SIGNAL_WITH_MODE(lookup, ::serverplugins::combiner::first<std::string>, (std::string const & name), (name), START);
+
     int f_value = 0xA987;
+    std::string f_indexed = std::string();
+    std::vector<std::string> f_recorded = std::vector<std::string>();
+    std::vector<std::string> f_bootstrapped = std::vector<std::string>();
+    std::vector<std::string> f_get_on_bootstrap = std::vector<std::string>();
+    std::shared_ptr<int> f_listener_token = std::make_shared<int>(0);
 };
 
 
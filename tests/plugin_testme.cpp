@@ -31,6 +31,12 @@
 #include    "serverplugins/collection.h"
 
 
+// C++
+//
+#include    <chrono>
+#include    <thread>
+
+
 
 /** \brief In your plugins, a namespace is encouraged but optional.
  *
@@ -62,6 +68,7 @@ SERVERPLUGINS_START(testme)
     , ::serverplugins::conflict("power_test")
     , ::serverplugins::conflict("unknown")
     , ::serverplugins::suggestion("beautiful")
+    , ::serverplugins::interest("daemon", "ready")
 SERVERPLUGINS_END(testme)
 
 
@@ -85,6 +92,18 @@ void testme::bootstrap()
     {
         throw std::runtime_error("testme: plugin called with an unexpected data pointer.");
     }
+
+    SERVERPLUGINS_LISTEN(testme, daemon, ready, std::placeholders::_1);
+    SERVERPLUGINS_LISTEN_ASYNC(testme, daemon, message, 10, serverplugins::backpressure_t::BACKPRESSURE_BLOCK, std::placeholders::_1);
+    SERVERPLUGINS_LISTEN(testme, daemon, index, std::placeholders::_1);
+    SERVERPLUGINS_LISTEN_BATCH(testme, daemon, record, std::placeholders::_1, std::placeholders::_2);
+    SERVERPLUGINS_LISTEN_PREFIX(testme, daemon, request, "/admin/", std::placeholders::_1, std::placeholders::_2);
+    SERVERPLUGINS_LISTEN(testme, daemon, lookup, std::placeholders::_1);
+
+    // this listener keeps a copy of the daemon token; the tests check
+    // that it gets destroyed before the library gets unloaded
+    //
+    SERVERPLUGINS_LISTEN_CALLBACK(testme, daemon, ready, [token = d->f_listener_token](int) {});
 }
 
 
@@ -94,6 +113,106 @@ std::string testme::it_worked()
 }
 
 
+void testme::on_ready(int value)
+{
+    f_ready = value;
+}
+
+
+int testme::get_ready() const
+{
+    return f_ready;
+}
+
+
+void testme::on_message(std::string const & text)
+{
+    // simulate a slow listener
+    //
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    f_messages.push_back(text);
+}
+
+
+std::vector<std::string> testme::get_messages() const
+{
+    return f_messages;
+}
+
+
+void testme::on_index(std::string const & document)
+{
+    if(document == "invalid")
+    {
+        throw std::runtime_error("testme: cannot index an invalid document.");
+    }
+    f_indexed = document;
+}
+
+
+std::string testme::get_indexed() const
+{
+    return f_indexed;
+}
+
+
+void testme::on_record(std::string const & key, int value)
+{
+    f_records.push_back(key + "=" + std::to_string(value));
+}
+
+
+void testme::on_record_batch(daemon::signal_record_t::batch_t records)
+{
+    ++f_record_batches;
+    for(auto const & r : records)
+    {
+        on_record(std::get<0>(r), std::get<1>(r));
+    }
+}
+
+
+std::vector<std::string> testme::get_records() const
+{
+    return f_records;
+}
+
+
+std::size_t testme::get_record_batches() const
+{
+    return f_record_batches;
+}
+
+
+void testme::on_request(std::string const & url, int method)
+{
+    f_requests.push_back(std::to_string(method) + " " + url);
+}
+
+
+std::vector<std::string> testme::get_requests() const
+{
+    return f_requests;
+}
+
+
+std::optional<std::string> testme::on_lookup(std::string const & name)
+{
+    ++f_lookups;
+    if(name == "testme")
+    {
+        return std::string("found by testme");
+    }
+    return std::nullopt;
+}
+
+
+std::size_t testme::get_lookups() const
+{
+    return f_lookups;
+}
+
+
 
 } // optional_namespace namespace
 // vim: ts=4 sw=4 et
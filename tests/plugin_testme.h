@@ -18,6 +18,11 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 #pragma once
 
+// self
+//
+#include    "plugin_daemon.h"
+
+
 // serverplugins
 //
 #include    <serverplugins/plugin.h>
@@ -43,7 +48,36 @@ public:
     virtual void        bootstrap();
     virtual std::string it_worked();
 
+    void                on_ready(int value);
+    virtual int         get_ready() const;
+    void                on_message(std::string const & text);
+    virtual std::vector<std::string>
+                        get_messages() const;
+    void                on_index(std::string const & document);
+    virtual std::string get_indexed() const;
+    void                on_record(std::string const & key, int value);
+    void                on_record_batch(daemon::signal_record_t::batch_t records);
+    virtual std::vector<std::string>
+                        get_records() const;
+    virtual std::size_t get_record_batches() const;
+    void                on_request(std::string const & url, int method);
+    virtual std::vector<std::string>
+                        get_requests() const;
+    std::optional<std::string>
+                        on_lookup(std::string const & name);
+    virtual std::size_t get_lookups() const;
+
 private:
+    int                 f_ready = 0;
+    std::vector<std::string>
+                        f_messages = std::vector<std::string>();
+    std::string         f_indexed = std::string();
+    std::vector<std::string>
+                        f_records = std::vector<std::string>();
+    std::size_t         f_record_batches = 0;
+    std::vector<std::string>
+                        f_requests = std::vector<std::string>();
+    std::size_t         f_lookups = 0;
 };
 
 